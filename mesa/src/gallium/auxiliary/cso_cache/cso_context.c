@@ -64,8 +64,12 @@ struct sampler_info
    void *samplers[PIPE_MAX_SAMPLERS];
    unsigned nr_samplers;
 
+   /** The CSOs behind samplers[], to skip hashing unchanged templates */
+   struct cso_sampler *cso_samplers[PIPE_MAX_SAMPLERS];
+
    void *samplers_saved[PIPE_MAX_SAMPLERS];
    unsigned nr_samplers_saved;
+   struct cso_sampler *cso_samplers_saved[PIPE_MAX_SAMPLERS];
 
    struct pipe_sampler_view *views[PIPE_MAX_SAMPLERS];
    unsigned nr_views;
@@ -155,6 +159,18 @@ static boolean delete_depth_stencil_state(struct cso_context *ctx, void *state)
 static boolean delete_sampler_state(struct cso_context *ctx, void *state)
 {
    struct cso_sampler *cso = (struct cso_sampler *)state;
+   unsigned shader, i;
+
+   /* Bound and saved samplers are referenced by sampler_info */
+   for (shader = 0; shader < PIPE_SHADER_TYPES; shader++) {
+      const struct sampler_info *info = &ctx->samplers[shader];
+      for (i = 0; i < PIPE_MAX_SAMPLERS; i++) {
+         if (info->cso_samplers[i] == cso ||
+             info->cso_samplers_saved[i] == cso)
+            return FALSE;
+      }
+   }
+
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
    FREE(state);
@@ -325,6 +341,8 @@ void cso_release_all( struct cso_context *ctx )
          pipe_sampler_view_reference(&info->views[i], NULL);
          pipe_sampler_view_reference(&info->views_saved[i], NULL);
       }
+      memset(info->cso_samplers, 0, sizeof(info->cso_samplers));
+      memset(info->cso_samplers_saved, 0, sizeof(info->cso_samplers_saved));
    }
 
    util_unreference_framebuffer_state(&ctx->fb);
@@ -1005,41 +1023,55 @@ single_sampler(struct cso_context *ctx,
                unsigned idx,
                const struct pipe_sampler_state *templ)
 {
-   void *handle = NULL;
+   struct cso_sampler *cso = NULL;
 
    if (templ != NULL) {
       unsigned key_size = sizeof(struct pipe_sampler_state);
-      unsigned hash_key = cso_construct_key((void*)templ, key_size);
-      struct cso_hash_iter iter =
-         cso_find_state_template(ctx->cache,
-                                 hash_key, CSO_SAMPLER,
-                                 (void *) templ, key_size);
 
-      if (cso_hash_iter_is_null(iter)) {
-         struct cso_sampler *cso = MALLOC(sizeof(struct cso_sampler));
-         if (!cso)
-            return PIPE_ERROR_OUT_OF_MEMORY;
-
-         memcpy(&cso->state, templ, sizeof(*templ));
-         cso->data = ctx->pipe->create_sampler_state(ctx->pipe, &cso->state);
-         cso->delete_state =
-            (cso_state_callback) ctx->pipe->delete_sampler_state;
-         cso->context = ctx->pipe;
+      /* Most slots are re-set to the state they already hold */
+      cso = info->cso_samplers[idx];
+      if (cso && memcmp(&cso->state, templ, key_size) == 0) {
+         info->samplers[idx] = cso->data;
+         return PIPE_OK;
+      }
+      else {
+         unsigned hash_key = cso_construct_key((void*)templ, key_size);
+         struct cso_hash_iter iter =
+            cso_find_state_template(ctx->cache,
+                                    hash_key, CSO_SAMPLER,
+                                    (void *) templ, key_size);
 
-         iter = cso_insert_state(ctx->cache, hash_key, CSO_SAMPLER, cso);
          if (cso_hash_iter_is_null(iter)) {
-            FREE(cso);
-            return PIPE_ERROR_OUT_OF_MEMORY;
+            cso = MALLOC(sizeof(struct cso_sampler));
+            if (!cso)
+               return PIPE_ERROR_OUT_OF_MEMORY;
+
+            memcpy(&cso->state, templ, sizeof(*templ));
+            cso->data = ctx->pipe->create_sampler_state(ctx->pipe, &cso->state);
+            cso->delete_state =
+               (cso_state_callback) ctx->pipe->delete_sampler_state;
+            cso->context = ctx->pipe;
+
+            /* Forget the old CSO first, so that cache sanitizing may free
+             * it.
+             */
+            info->cso_samplers[idx] = NULL;
+
+            iter = cso_insert_state(ctx->cache, hash_key, CSO_SAMPLER, cso);
+            if (cso_hash_iter_is_null(iter)) {
+               FREE(cso);
+               info->samplers[idx] = NULL;
+               return PIPE_ERROR_OUT_OF_MEMORY;
+            }
+         }
+         else {
+            cso = (struct cso_sampler *)cso_hash_iter_data(iter);
          }
-
-         handle = cso->data;
-      }
-      else {
-         handle = ((struct cso_sampler *)cso_hash_iter_data(iter))->data;
       }
    }
 
-   info->samplers[idx] = handle;
+   info->cso_samplers[idx] = cso;
+   info->samplers[idx] = cso ? cso->data : NULL;
 
    return PIPE_OK;
 }
@@ -1149,6 +1181,8 @@ cso_save_samplers(struct cso_context *ctx, unsigned shader_stage)
    struct sampler_info *info = &ctx->samplers[shader_stage];
    info->nr_samplers_saved = info->nr_samplers;
    memcpy(info->samplers_saved, info->samplers, sizeof(info->samplers));
+   memcpy(info->cso_samplers_saved, info->cso_samplers,
+          sizeof(info->cso_samplers));
 }
 
 
@@ -1158,6 +1192,9 @@ cso_restore_samplers(struct cso_context *ctx, unsigned shader_stage)
    struct sampler_info *info = &ctx->samplers[shader_stage];
    info->nr_samplers = info->nr_samplers_saved;
    memcpy(info->samplers, info->samplers_saved, sizeof(info->samplers));
+   memcpy(info->cso_samplers, info->cso_samplers_saved,
+          sizeof(info->cso_samplers));
+   memset(info->cso_samplers_saved, 0, sizeof(info->cso_samplers_saved));
    single_sampler_done(ctx, shader_stage);
 }
 
@@ -1414,6 +1451,26 @@ cso_draw_vbo(struct cso_context *cso,
    }
 }
 
+/**
+ * Draw \p num_draws primitives with the current state, with a single
+ * driver call if the driver implements multi_draw_vbo.
+ */
+void
+cso_multi_draw_vbo(struct cso_context *cso,
+                   const struct pipe_draw_info *info,
+                   unsigned num_draws)
+{
+   struct pipe_context *pipe = cso->pipe;
+   unsigned i;
+
+   if (!cso->vbuf && pipe->multi_draw_vbo && num_draws > 1) {
+      pipe->multi_draw_vbo(pipe, info, num_draws);
+   } else {
+      for (i = 0; i < num_draws; i++)
+         cso_draw_vbo(cso, &info[i]);
+   }
+}
+
 void
 cso_draw_arrays(struct cso_context *cso, uint mode, uint start, uint count)
 {
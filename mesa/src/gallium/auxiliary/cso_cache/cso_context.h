@@ -228,6 +228,11 @@ void
 cso_draw_vbo(struct cso_context *cso,
              const struct pipe_draw_info *info);
 
+void
+cso_multi_draw_vbo(struct cso_context *cso,
+                   const struct pipe_draw_info *info,
+                   unsigned num_draws);
+
 /* helper drawing function */
 void
 cso_draw_arrays(struct cso_context *cso, uint mode, uint start, uint count);
@@ -241,6 +241,10 @@ draw_set_mapped_so_targets(struct draw_context *draw,
 void draw_vbo(struct draw_context *draw,
               const struct pipe_draw_info *info);
 
+void draw_multi_vbo(struct draw_context *draw,
+                    const struct pipe_draw_info *info,
+                    unsigned num_draws);
+
 
 /*******************************************************************************
  * Driver backend interface 
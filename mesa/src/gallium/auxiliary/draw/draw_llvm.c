@@ -47,6 +47,7 @@
 #include "gallivm/lp_bld_type.h"
 #include "gallivm/lp_bld_pack.h"
 #include "gallivm/lp_bld_format.h"
+#include "gallivm/lp_bld_conv.h"
 
 #include "tgsi/tgsi_exec.h"
 #include "tgsi/tgsi_dump.h"
@@ -59,6 +60,8 @@
 
 #define DEBUG_STORE 0
 
+DEBUG_GET_ONCE_BOOL_OPTION(draw_no_soa_fetch, "DRAW_NO_SOA_FETCH", FALSE)
+
 
 static void
 draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *var,
@@ -638,6 +641,7 @@ generate_vs(struct draw_llvm_variant *variant,
                      outputs,
                      sampler,
                      &llvm->draw->vs.vertex_shader->info,
+                     NULL,
                      NULL);
 
    {
@@ -808,6 +812,222 @@ convert_to_soa(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Whether fetch_soa() can fetch a vertex element of this format: plain
+ * array formats whose channels are all 32-bit or 16-bit floats, or all
+ * 8-bit or 16-bit normalized integers.
+ */
+static boolean
+fetch_soa_supported(const struct util_format_description *format_desc)
+{
+   const struct util_format_channel_description *chan =
+      &format_desc->channel[0];
+   unsigned i;
+
+   if (debug_get_option_draw_no_soa_fetch())
+      return FALSE;
+
+   if (format_desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       format_desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       !format_desc->is_array ||
+       format_desc->block.width != 1 ||
+       format_desc->block.height != 1)
+      return FALSE;
+
+   for (i = 1; i < format_desc->nr_channels; ++i) {
+      if (format_desc->channel[i].type != chan->type ||
+          format_desc->channel[i].size != chan->size ||
+          format_desc->channel[i].normalized != chan->normalized ||
+          format_desc->channel[i].pure_integer != chan->pure_integer)
+         return FALSE;
+   }
+
+   switch (chan->type) {
+   case UTIL_FORMAT_TYPE_FLOAT:
+      return chan->size == 32 || chan->size == 16;
+   case UTIL_FORMAT_TYPE_UNSIGNED:
+   case UTIL_FORMAT_TYPE_SIGNED:
+      return chan->normalized && (chan->size == 8 || chan->size == 16);
+   default:
+      return FALSE;
+   }
+}
+
+
+/**
+ * Fetch a vertex element for all the vertices of a SoA vector at once.
+ *
+ * Each vertex is read with a single load of the whole element, the
+ * channels are then shuffled across the vertices and converted to float a
+ * full vector at a time, so unlike generate_fetch() plus convert_to_soa()
+ * there is neither a per vertex conversion nor a transpose.
+ *
+ * offsets holds the byte offset of each vertex in the mapped buffer and
+ * overflowed tells which of them would read past its end.  Those read from
+ * a zeroed temporary instead and produce all zeros, like generate_fetch().
+ */
+static void
+fetch_soa(struct gallivm_state *gallivm,
+          const struct util_format_description *format_desc,
+          struct lp_type soa_type,
+          LLVMValueRef map_ptr,
+          LLVMValueRef *offsets,
+          LLVMValueRef *overflowed,
+          LLVMValueRef *dst)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct util_format_channel_description *chan =
+      &format_desc->channel[0];
+   const unsigned nr_channels = format_desc->nr_channels;
+   struct lp_type chan_type = lp_type_int_vec(chan->size,
+                                              chan->size * soa_type.length);
+   LLVMTypeRef elem_type =
+      LLVMVectorType(LLVMIntTypeInContext(gallivm->context, chan->size),
+                     nr_channels);
+   LLVMTypeRef elem_ptr_type = LLVMPointerType(elem_type, 0);
+   LLVMTypeRef int_vec_type = lp_build_int_vec_type(gallivm, soa_type);
+   LLVMValueRef elems[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef channels[4];
+   LLVMValueRef dummy = lp_build_alloca(gallivm, elem_type, "fetch_dummy");
+   LLVMValueRef mask = LLVMConstNull(int_vec_type);
+   struct lp_build_context bld;
+   unsigned i, c;
+
+   assert(soa_type.length <= LP_MAX_VECTOR_LENGTH);
+
+   lp_build_context_init(&bld, gallivm, soa_type);
+
+   for (i = 0; i < soa_type.length; ++i) {
+      LLVMValueRef lane = lp_build_const_int32(gallivm, i);
+      LLVMValueRef ptr = LLVMBuildGEP(builder, map_ptr, &offsets[i], 1, "");
+
+      ptr = LLVMBuildBitCast(builder, ptr, elem_ptr_type, "");
+      ptr = LLVMBuildSelect(builder, overflowed[i], dummy, ptr, "");
+      elems[i] = LLVMBuildLoad(builder, ptr, "");
+      lp_set_load_alignment(elems[i], chan->size / 8);
+
+      mask = LLVMBuildInsertElement(builder, mask,
+                                    LLVMBuildSExt(builder, overflowed[i],
+                                                  LLVMInt32TypeInContext(gallivm->context),
+                                                  ""),
+                                    lane, "");
+   }
+
+   for (c = 0; c < nr_channels; ++c) {
+      LLVMValueRef chan_index = lp_build_const_int32(gallivm, c);
+      LLVMValueRef res = LLVMGetUndef(lp_build_vec_type(gallivm, chan_type));
+
+      for (i = 0; i < soa_type.length; ++i) {
+         LLVMValueRef val =
+            LLVMBuildExtractElement(builder, elems[i], chan_index, "");
+         res = LLVMBuildInsertElement(builder, res, val,
+                                      lp_build_const_int32(gallivm, i), "");
+      }
+
+      switch (chan->type) {
+      case UTIL_FORMAT_TYPE_FLOAT:
+         if (chan->size == 16)
+            res = lp_build_half_to_float(gallivm, res);
+         else
+            res = LLVMBuildBitCast(builder, res, bld.vec_type, "");
+         break;
+      case UTIL_FORMAT_TYPE_UNSIGNED:
+         if (chan->size < 32)
+            res = LLVMBuildZExt(builder, res, int_vec_type, "");
+         res = lp_build_unsigned_norm_to_float(gallivm, chan->size,
+                                               soa_type, res);
+         break;
+      case UTIL_FORMAT_TYPE_SIGNED:
+         if (chan->size < 32)
+            res = LLVMBuildSExt(builder, res, int_vec_type, "");
+         res = LLVMBuildSIToFP(builder, res, bld.vec_type, "");
+         res = LLVMBuildFMul(builder, res,
+                             lp_build_const_vec(gallivm, soa_type,
+                                                1.0 / ((1 << (chan->size - 1)) - 1)),
+                             "");
+         break;
+      default:
+         assert(0);
+         res = bld.undef;
+      }
+
+      channels[c] = res;
+   }
+
+   for (c = 0; c < TGSI_NUM_CHANNELS; ++c) {
+      enum util_format_swizzle swizzle = format_desc->swizzle[c];
+      LLVMValueRef res;
+
+      if (swizzle < nr_channels)
+         res = channels[swizzle];
+      else if (swizzle == UTIL_FORMAT_SWIZZLE_1)
+         res = bld.one;
+      else
+         res = bld.zero;
+
+      /* vertices past the end of the buffer read as (0, 0, 0, 0) */
+      dst[c] = lp_build_select(&bld, mask, bld.zero, res);
+   }
+}
+
+
+/**
+ * Compute the offset of a vertex element for fetch_soa() and whether
+ * reading it would overflow its buffer.
+ *
+ * The offset of the vertex itself, index * stride + buffer_offset, is the
+ * same for all the elements of an interleaved buffer, so it is computed
+ * once per buffer and kept in vb_offset / vb_ofbit.
+ */
+static void
+generate_fetch_offset(struct gallivm_state *gallivm,
+                      LLVMValueRef vbuffers_ptr,
+                      const struct pipe_vertex_element *velem,
+                      LLVMValueRef vbuf,
+                      LLVMValueRef index,
+                      LLVMValueRef *vb_offset,
+                      LLVMValueRef *vb_ofbit,
+                      LLVMValueRef *offset,
+                      LLVMValueRef *overflowed)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef indices =
+      LLVMConstInt(LLVMInt64TypeInContext(gallivm->context),
+                   velem->vertex_buffer_index, 0);
+   LLVMValueRef vbuffer_ptr = LLVMBuildGEP(builder, vbuffers_ptr,
+                                           &indices, 1, "");
+   LLVMValueRef buffer_size = draw_jit_dvbuffer_size(gallivm, vbuffer_ptr);
+   LLVMValueRef needed_buffer_size;
+   LLVMValueRef ofbit;
+
+   if (!*vb_offset) {
+      LLVMValueRef vb_stride = draw_jit_vbuffer_stride(gallivm, vbuf);
+      LLVMValueRef vb_buffer_offset = draw_jit_vbuffer_offset(gallivm, vbuf);
+
+      ofbit = NULL;
+      *vb_offset = lp_build_umul_overflow(gallivm, vb_stride, index, &ofbit);
+      *vb_offset = lp_build_uadd_overflow(gallivm, *vb_offset,
+                                          vb_buffer_offset, &ofbit);
+      *vb_ofbit = ofbit;
+   }
+
+   ofbit = *vb_ofbit;
+   *offset = lp_build_uadd_overflow(
+      gallivm, *vb_offset,
+      lp_build_const_int32(gallivm, velem->src_offset), &ofbit);
+   needed_buffer_size = lp_build_uadd_overflow(
+      gallivm, *offset,
+      lp_build_const_int32(gallivm,
+                           util_format_get_blocksize(velem->src_format)),
+      &ofbit);
+
+   *overflowed = LLVMBuildICmp(builder, LLVMIntUGT,
+                               needed_buffer_size, buffer_size,
+                               "buffer_overflowed");
+   *overflowed = LLVMBuildOr(builder, *overflowed, ofbit, "");
+}
+
+
 static void
 store_aos(struct gallivm_state *gallivm,
           LLVMValueRef io_ptr,
@@ -1525,6 +1745,7 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant,
    const unsigned pos = draw_current_shader_position_output(llvm->draw);
    const unsigned cv = draw_current_shader_clipvertex_output(llvm->draw);
    boolean have_clipdist = FALSE;
+   boolean soa_fetch[PIPE_MAX_ATTRIBS];
    struct lp_bld_tgsi_system_values system_values;
 
    memset(&system_values, 0, sizeof(system_values));
@@ -1630,10 +1851,19 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant,
 
    fetch_max = LLVMBuildSub(builder, end, one, "fetch_max");
 
+   /* per vertex elements keep the one vertex at a time path */
+   for (j = 0; j < draw->pt.nr_vertex_elements; ++j) {
+      struct pipe_vertex_element *velem = &draw->pt.vertex_element[j];
+      soa_fetch[j] = !velem->instance_divisor &&
+         fetch_soa_supported(util_format_description(velem->src_format));
+   }
+
    lp_build_loop_begin(&lp_loop, gallivm, zero);
    {
       LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
       LLVMValueRef aos_attribs[PIPE_MAX_SHADER_INPUTS][LP_MAX_VECTOR_WIDTH / 32] = { { 0 } };
+      LLVMValueRef fetch_offsets[PIPE_MAX_SHADER_INPUTS][LP_MAX_VECTOR_LENGTH];
+      LLVMValueRef fetch_overflowed[PIPE_MAX_SHADER_INPUTS][LP_MAX_VECTOR_LENGTH];
       LLVMValueRef io;
       LLVMValueRef clipmask;   /* holds the clipmask value */
       const LLVMValueRef (*ptr_aos)[TGSI_NUM_CHANNELS];
@@ -1647,6 +1877,8 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant,
 #endif
       system_values.vertex_id = lp_build_zero(gallivm, lp_type_uint_vec(32, 32*vector_length));
       for (i = 0; i < vector_length; ++i) {
+         LLVMValueRef vb_offsets[PIPE_MAX_ATTRIBS];
+         LLVMValueRef vb_ofbits[PIPE_MAX_ATTRIBS];
          LLVMValueRef true_index =
             LLVMBuildAdd(builder,
                          lp_loop.counter,
@@ -1700,18 +1932,41 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant,
             true_index = LLVMBuildLoad(builder, index_ptr, "true_index");
          }
 
+         memset(vb_offsets, 0, sizeof vb_offsets);
          for (j = 0; j < draw->pt.nr_vertex_elements; ++j) {
             struct pipe_vertex_element *velem = &draw->pt.vertex_element[j];
-            LLVMValueRef vb_index =
-               lp_build_const_int32(gallivm, velem->vertex_buffer_index);
+            unsigned vb_idx = velem->vertex_buffer_index;
+            LLVMValueRef vb_index = lp_build_const_int32(gallivm, vb_idx);
             LLVMValueRef vb = LLVMBuildGEP(builder, vb_ptr, &vb_index, 1, "");
-            generate_fetch(gallivm, draw, vbuffers_ptr,
-                           &aos_attribs[j][i], velem, vb, true_index,
-                           system_values.instance_id);
+            if (soa_fetch[j])
+               generate_fetch_offset(gallivm, vbuffers_ptr, velem, vb,
+                                     true_index,
+                                     &vb_offsets[vb_idx], &vb_ofbits[vb_idx],
+                                     &fetch_offsets[j][i],
+                                     &fetch_overflowed[j][i]);
+            else
+               generate_fetch(gallivm, draw, vbuffers_ptr,
+                              &aos_attribs[j][i], velem, vb, true_index,
+                              system_values.instance_id);
+         }
+      }
+
+      for (j = 0; j < draw->pt.nr_vertex_elements; ++j) {
+         struct pipe_vertex_element *velem = &draw->pt.vertex_element[j];
+         if (soa_fetch[j]) {
+            LLVMValueRef vb_index =
+               LLVMConstInt(LLVMInt64TypeInContext(gallivm->context),
+                            velem->vertex_buffer_index, 0);
+            LLVMValueRef vbuffer_ptr = LLVMBuildGEP(builder, vbuffers_ptr,
+                                                    &vb_index, 1, "");
+            fetch_soa(gallivm, util_format_description(velem->src_format),
+                      vs_type, draw_jit_dvbuffer_map(gallivm, vbuffer_ptr),
+                      fetch_offsets[j], fetch_overflowed[j], inputs[j]);
+         }
+         else {
+            convert_to_soa(gallivm, &aos_attribs[j], &inputs[j], 1, vs_type);
          }
       }
-      convert_to_soa(gallivm, aos_attribs, inputs,
-                     draw->pt.nr_vertex_elements, vs_type);
 
       ptr_aos = (const LLVMValueRef (*)[TGSI_NUM_CHANNELS]) inputs;
       generate_vs(variant,
@@ -2163,7 +2418,8 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
                      outputs,
                      sampler,
                      &llvm->draw->gs.geometry_shader->info,
-                     (const struct lp_build_tgsi_gs_iface *)&gs_iface);
+                     (const struct lp_build_tgsi_gs_iface *)&gs_iface,
+                     NULL);
 
    sampler->destroy(sampler);
 
@@ -62,6 +62,7 @@ struct lp_build_mask_context;
 struct gallivm_state;
 struct lp_derivatives;
 struct lp_build_tgsi_gs_iface;
+struct lp_build_tgsi_cs_iface;
 
 
 enum lp_build_tex_modifier {
@@ -156,6 +157,12 @@ struct lp_bld_tgsi_system_values {
    LLVMValueRef instance_id;
    LLVMValueRef vertex_id;
    LLVMValueRef prim_id;
+
+   /* Compute shaders: thread ids are vectors, the rest scalars */
+   LLVMValueRef thread_id[3];
+   LLVMValueRef block_id[3];
+   LLVMValueRef block_size[3];
+   LLVMValueRef grid_size[3];
 };
 
 
@@ -227,7 +234,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef (*outputs)[4],
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface);
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface);
 
 
 void
@@ -410,6 +418,30 @@ struct lp_build_tgsi_gs_iface
                        LLVMValueRef emitted_prims_vec);
 };
 
+/**
+ * Compute shader interface: memory resources and work group barriers.
+ */
+struct lp_build_tgsi_cs_iface
+{
+   /** Instruction the kernel starts at (the pc passed to launch_grid) */
+   int entry_pc;
+
+   /**
+    * Return an i8 pointer to byte \p address (scalar i32) of resource
+    * \p index (a TGSI_RESOURCE_x value or a bound resource slot), as seen
+    * by SIMD lane \p lane.
+    */
+   LLVMValueRef (*resource_ptr)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                                struct lp_build_tgsi_context * bld_base,
+                                unsigned index,
+                                unsigned lane,
+                                LLVMValueRef address);
+
+   /** Wait until all the threads of the work group reach the barrier */
+   void (*barrier)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                   struct lp_build_tgsi_context * bld_base);
+};
+
 struct lp_build_tgsi_soa_context
 {
    struct lp_build_tgsi_context bld_base;
@@ -423,6 +455,8 @@ struct lp_build_tgsi_soa_context
    LLVMValueRef emitted_vertices_vec_ptr;
    LLVMValueRef max_output_vertices_vec;
 
+   const struct lp_build_tgsi_cs_iface *cs_iface;
+
    LLVMValueRef consts_ptr;
    const LLVMValueRef (*inputs)[TGSI_NUM_CHANNELS];
    LLVMValueRef (*outputs)[TGSI_NUM_CHANNELS];
@@ -1250,6 +1250,41 @@ emit_fetch_system_value(
       atype = TGSI_TYPE_UNSIGNED;
       break;
 
+   case TGSI_SEMANTIC_THREAD_ID:
+      if (swizzle < 3)
+         res = bld->system_values.thread_id[swizzle];
+      else
+         res = bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_ID:
+      if (swizzle < 3)
+         res = lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                         bld->system_values.block_id[swizzle]);
+      else
+         res = bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_SIZE:
+      if (swizzle < 3)
+         res = lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                         bld->system_values.block_size[swizzle]);
+      else
+         res = bld_base->uint_bld.one;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_GRID_SIZE:
+      if (swizzle < 3)
+         res = lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                         bld->system_values.grid_size[swizzle]);
+      else
+         res = bld_base->uint_bld.one;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
    default:
       assert(!"unexpected semantic in emit_fetch_system_value");
       res = bld_base->base.zero;
@@ -1548,7 +1583,8 @@ emit_store(
    unsigned chan_index;
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
 
-   if(info->num_dst) {
+   /* Resource destinations (STORE, fences) are written by the emit action */
+   if(info->num_dst && inst->Dst[0].Register.File != TGSI_FILE_RESOURCE) {
       LLVMValueRef pred[TGSI_NUM_CHANNELS];
 
       emit_fetch_predicate( bld, inst, pred );
@@ -2515,6 +2551,186 @@ sviewinfo_emit(
    emit_size_query(bld, emit_data->inst, emit_data->output, TRUE);
 }
 
+/**
+ * Access a compute resource (LOAD/STORE).
+ *
+ * The address may differ per lane and resources are plain memory, so this
+ * is done one active lane at a time, with consecutive channels at
+ * consecutive dwords.
+ */
+static void
+emit_resource_access(struct lp_build_tgsi_soa_context *bld,
+                     unsigned index,
+                     LLVMValueRef address,
+                     unsigned writemask,
+                     boolean is_store,
+                     LLVMValueRef *values)
+{
+   struct lp_build_tgsi_context *bld_base = &bld->bld_base;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMTypeRef i32_ptr_type =
+      LLVMPointerType(LLVMInt32TypeInContext(gallivm->context), 0);
+   LLVMValueRef exec_mask = lp_build_mask_value(bld->mask);
+   LLVMValueRef results[TGSI_NUM_CHANNELS];
+   unsigned lane, chan;
+
+   if (bld->exec_mask.has_mask) {
+      exec_mask = LLVMBuildAnd(builder, exec_mask,
+                               bld->exec_mask.exec_mask, "");
+   }
+
+   address = LLVMBuildBitCast(builder, address, uint_bld->vec_type, "");
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (!(writemask & (1 << chan)))
+         continue;
+      if (is_store) {
+         values[chan] = LLVMBuildBitCast(builder, values[chan],
+                                         uint_bld->vec_type, "");
+      } else {
+         results[chan] = lp_build_alloca(gallivm, uint_bld->vec_type, "");
+      }
+   }
+
+   for (lane = 0; lane < uint_bld->type.length; lane++) {
+      LLVMValueRef lane_index = lp_build_const_int32(gallivm, lane);
+      LLVMValueRef active, ptr;
+      struct lp_build_if_state ifthen;
+
+      active = LLVMBuildExtractElement(builder, exec_mask, lane_index, "");
+      active = LLVMBuildICmp(builder, LLVMIntNE, active,
+                             lp_build_const_int32(gallivm, 0), "");
+      lp_build_if(&ifthen, gallivm, active);
+
+      ptr = bld->cs_iface->resource_ptr(bld->cs_iface, bld_base, index, lane,
+                                        LLVMBuildExtractElement(builder, address,
+                                                                lane_index, ""));
+      ptr = LLVMBuildBitCast(builder, ptr, i32_ptr_type, "");
+
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         LLVMValueRef chan_index = lp_build_const_int32(gallivm, chan);
+         LLVMValueRef elem_ptr;
+
+         if (!(writemask & (1 << chan)))
+            continue;
+
+         elem_ptr = LLVMBuildGEP(builder, ptr, &chan_index, 1, "");
+         if (is_store) {
+            LLVMBuildStore(builder,
+                           LLVMBuildExtractElement(builder, values[chan],
+                                                   lane_index, ""),
+                           elem_ptr);
+         } else {
+            LLVMValueRef res = LLVMBuildLoad(builder, results[chan], "");
+            res = LLVMBuildInsertElement(builder, res,
+                                         LLVMBuildLoad(builder, elem_ptr, ""),
+                                         lane_index, "");
+            LLVMBuildStore(builder, res, results[chan]);
+         }
+      }
+
+      lp_build_endif(&ifthen);
+   }
+
+   if (!is_store) {
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         if (writemask & (1 << chan)) {
+            values[chan] = LLVMBuildBitCast(builder,
+                                            LLVMBuildLoad(builder, results[chan], ""),
+                                            bld_base->base.vec_type, "");
+         }
+      }
+   }
+}
+
+static void
+load_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+
+   assert(inst->Src[0].Register.File == TGSI_FILE_RESOURCE);
+
+   emit_resource_access(bld, inst->Src[0].Register.Index,
+                        lp_build_emit_fetch(bld_base, inst, 1, TGSI_CHAN_X),
+                        inst->Dst[0].Register.WriteMask, FALSE,
+                        emit_data->output);
+}
+
+static void
+store_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   unsigned writemask = inst->Dst[0].Register.WriteMask;
+   LLVMValueRef values[TGSI_NUM_CHANNELS];
+   unsigned chan;
+
+   assert(inst->Dst[0].Register.File == TGSI_FILE_RESOURCE);
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (writemask & (1 << chan))
+         values[chan] = lp_build_emit_fetch(bld_base, inst, 1, chan);
+   }
+
+   emit_resource_access(bld, inst->Dst[0].Register.Index,
+                        lp_build_emit_fetch(bld_base, inst, 0, TGSI_CHAN_X),
+                        writemask, TRUE, values);
+}
+
+static void
+barrier_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+
+   bld->cs_iface->barrier(bld->cs_iface, bld_base);
+}
+
+static void
+cs_end_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct lp_exec_mask *mask = &bld->exec_mask;
+
+   /* Kernels may END within control flow, which only retires the threads
+    * that execute it, like a RET from the kernel.
+    */
+   if (mask->cond_stack_size ||
+       mask->loop_stack_size ||
+       mask->switch_stack_size ||
+       mask->call_stack_size > 1) {
+      lp_exec_mask_ret(mask, &bld_base->pc);
+   }
+   else {
+      bld_base->pc = -1;
+   }
+}
+
+static void
+fence_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   /* Memory accesses are executed in program order by the thread running
+    * the work group, and work groups only synchronize through barriers.
+    */
+}
+
 static LLVMValueRef
 mask_to_one_vec(struct lp_build_tgsi_context *bld_base)
 {
@@ -3108,7 +3324,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef (*outputs)[TGSI_NUM_CHANNELS],
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface)
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface)
 {
    struct lp_build_tgsi_soa_context bld;
 
@@ -3217,8 +3434,28 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                                 max_output_vertices);
    }
 
+   if (cs_iface) {
+      bld.cs_iface = cs_iface;
+      bld.bld_base.op_actions[TGSI_OPCODE_LOAD].emit = load_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_STORE].emit = store_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_BARRIER].emit = barrier_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_END].emit = cs_end_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_MFENCE].emit = fence_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_LFENCE].emit = fence_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_SFENCE].emit = fence_emit;
+   }
+
    lp_exec_mask_init(&bld.exec_mask, &bld.bld_base.int_bld);
 
+   if (cs_iface) {
+      /* Kernels are subroutines of the program, so call the entry point
+       * from an empty main: its RET or ENDSUB then ends the program.
+       */
+      int pc = -1;
+      lp_exec_mask_call(&bld.exec_mask, cs_iface->entry_pc, &pc);
+      bld.bld_base.pc = pc;
+   }
+
    bld.system_values = *system_values;
 
    lp_build_tgsi_llvm(&bld.bld_base, tokens);
@@ -0,0 +1,500 @@
+/**************************************************************************
+ *
+ * Copyright 2013 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * On-disk blob cache.
+ *
+ * Layout: \<root\>/\<first two hex digits of key\>/\<remaining 38 digits\>.
+ * Each file starts with a small header holding the full key, the payload
+ * size and a CRC32 of the payload.
+ */
+
+
+#include "pipe/p_config.h"
+
+#include "os/os_thread.h"
+#include "util/u_debug.h"
+#include "util/u_disk_cache.h"
+#include "util/u_hash.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+
+#if defined(PIPE_OS_UNIX)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+
+#define DISK_CACHE_MAGIC   0x4d534331  /* "MSC1" */
+#define DISK_CACHE_VERSION 1
+#define DISK_CACHE_BUCKETS 256
+
+
+struct disk_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint8_t key[UTIL_SHA1_DIGEST_LENGTH];
+   uint32_t size;
+   uint32_t crc32;
+};
+
+
+struct util_disk_cache
+{
+   char *path;
+   uint64_t max_size;
+
+   pipe_mutex mutex;
+   struct util_disk_cache_stats stats;
+
+   /** Whether stats.total_size holds the size of the directory yet */
+   boolean size_known;
+
+   /** State of the private random number generator */
+   uint32_t rand_state;
+};
+
+
+/**
+ * Create a directory and any missing parents.
+ */
+static boolean
+disk_cache_mkdir(const char *path)
+{
+   char buf[PATH_MAX];
+   char *p;
+
+   if (strlen(path) >= sizeof buf)
+      return FALSE;
+   strcpy(buf, path);
+
+   for (p = buf + 1; *p; p++) {
+      if (*p == '/') {
+         *p = '\0';
+         if (mkdir(buf, 0755) != 0 && errno != EEXIST)
+            return FALSE;
+         *p = '/';
+      }
+   }
+
+   if (mkdir(buf, 0755) != 0 && errno != EEXIST)
+      return FALSE;
+
+   return TRUE;
+}
+
+
+static void
+disk_cache_entry_path(const struct util_disk_cache *cache,
+                      const uint8_t key[UTIL_SHA1_DIGEST_LENGTH],
+                      char *buf, size_t size)
+{
+   char hex[2 * UTIL_SHA1_DIGEST_LENGTH + 1];
+
+   util_sha1_format(hex, key);
+   util_snprintf(buf, size, "%s/%c%c/%s", cache->path, hex[0], hex[1], hex + 2);
+}
+
+
+/**
+ * Sum the sizes of all entries of one bucket, optionally finding the least
+ * recently used one.
+ */
+static uint64_t
+disk_cache_scan_bucket(const char *dir, char *lru, size_t lru_size)
+{
+   uint64_t total = 0;
+   time_t lru_time = 0;
+   struct dirent *ent;
+   DIR *d;
+
+   if (lru)
+      lru[0] = '\0';
+
+   d = opendir(dir);
+   if (!d)
+      return 0;
+
+   while ((ent = readdir(d)) != NULL) {
+      char file[PATH_MAX];
+      struct stat st;
+
+      if (ent->d_name[0] == '.')
+         continue;
+
+      util_snprintf(file, sizeof file, "%s/%s", dir, ent->d_name);
+      if (stat(file, &st) != 0 || !S_ISREG(st.st_mode))
+         continue;
+
+      total += st.st_size;
+
+      /* temporary files of in-flight writes are never evicted */
+      if (lru && !strstr(ent->d_name, ".tmp") &&
+          (!lru[0] || st.st_mtime < lru_time)) {
+         util_snprintf(lru, lru_size, "%s", file);
+         lru_time = st.st_mtime;
+      }
+   }
+
+   closedir(d);
+   return total;
+}
+
+
+/**
+ * Compute the size of the cache directory, the first time it's needed.
+ * Called with the mutex held.
+ */
+static void
+disk_cache_update_size(struct util_disk_cache *cache)
+{
+   unsigned i;
+
+   if (cache->size_known)
+      return;
+
+   for (i = 0; i < DISK_CACHE_BUCKETS; i++) {
+      char dir[PATH_MAX];
+
+      util_snprintf(dir, sizeof dir, "%s/%02x", cache->path, i);
+      cache->stats.total_size += disk_cache_scan_bucket(dir, NULL, 0);
+   }
+
+   cache->size_known = TRUE;
+}
+
+
+/**
+ * Xorshift generator, so that picking buckets doesn't advance the
+ * application's rand() sequence.  Called with the mutex held.
+ */
+static uint32_t
+disk_cache_rand(struct util_disk_cache *cache)
+{
+   uint32_t x = cache->rand_state;
+
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   cache->rand_state = x;
+
+   return x;
+}
+
+
+/**
+ * Drop one entry.  Called with the mutex held.
+ */
+static boolean
+disk_cache_evict_one(struct util_disk_cache *cache)
+{
+   unsigned start = disk_cache_rand(cache) % DISK_CACHE_BUCKETS;
+   unsigned i;
+
+   for (i = 0; i < DISK_CACHE_BUCKETS; i++) {
+      char dir[PATH_MAX];
+      char lru[PATH_MAX];
+      struct stat st;
+
+      util_snprintf(dir, sizeof dir, "%s/%02x", cache->path,
+                    (start + i) % DISK_CACHE_BUCKETS);
+      disk_cache_scan_bucket(dir, lru, sizeof lru);
+      if (!lru[0])
+         continue;
+
+      if (stat(lru, &st) == 0 && unlink(lru) == 0) {
+         cache->stats.evictions++;
+         if (cache->stats.total_size > (uint64_t)st.st_size)
+            cache->stats.total_size -= st.st_size;
+         else
+            cache->stats.total_size = 0;
+      }
+      return TRUE;
+   }
+
+   return FALSE;
+}
+
+
+struct util_disk_cache *
+util_disk_cache_create(const char *path, uint64_t max_size)
+{
+   struct util_disk_cache *cache;
+
+   if (!path || !path[0] || strlen(path) > PATH_MAX - 64)
+      return NULL;
+
+   if (!disk_cache_mkdir(path))
+      return NULL;
+
+   cache = CALLOC_STRUCT(util_disk_cache);
+   if (!cache)
+      return NULL;
+
+   cache->path = strdup(path);
+   if (!cache->path) {
+      FREE(cache);
+      return NULL;
+   }
+   cache->max_size = max_size;
+   pipe_mutex_init(cache->mutex);
+
+   /* xorshift must not start from zero */
+   cache->rand_state = util_hash_crc32(path, strlen(path)) | 1;
+
+   /* The directory is only scanned for its size once a store has to
+    * enforce the limit, not on every context creation.
+    */
+
+   return cache;
+}
+
+
+void
+util_disk_cache_destroy(struct util_disk_cache *cache)
+{
+   if (!cache)
+      return;
+
+   pipe_mutex_destroy(cache->mutex);
+   free(cache->path);
+   FREE(cache);
+}
+
+
+void *
+util_disk_cache_get(struct util_disk_cache *cache,
+                    const uint8_t key[UTIL_SHA1_DIGEST_LENGTH],
+                    size_t *size)
+{
+   char file[PATH_MAX];
+   struct disk_cache_header header;
+   void *data = NULL;
+   boolean corrupt = FALSE;
+   FILE *fp;
+
+   disk_cache_entry_path(cache, key, file, sizeof file);
+
+   fp = fopen(file, "rb");
+   if (fp) {
+      if (fread(&header, sizeof header, 1, fp) != 1 ||
+          header.magic != DISK_CACHE_MAGIC ||
+          header.version != DISK_CACHE_VERSION ||
+          memcmp(header.key, key, UTIL_SHA1_DIGEST_LENGTH) != 0) {
+         corrupt = TRUE;
+      }
+      else {
+         data = malloc(header.size ? header.size : 1);
+         if (!data ||
+             fread(data, 1, header.size, fp) != header.size ||
+             util_hash_crc32(data, header.size) != header.crc32) {
+            free(data);
+            data = NULL;
+            corrupt = TRUE;
+         }
+      }
+      fclose(fp);
+   }
+
+   if (corrupt)
+      unlink(file);
+   else if (data)
+      utimes(file, NULL); /* mark as recently used */
+
+   pipe_mutex_lock(cache->mutex);
+   if (data) {
+      cache->stats.hits++;
+      cache->stats.bytes_read += header.size;
+   }
+   else {
+      cache->stats.misses++;
+      if (corrupt)
+         cache->stats.errors++;
+   }
+   pipe_mutex_unlock(cache->mutex);
+
+   if (data && size)
+      *size = header.size;
+
+   return data;
+}
+
+
+boolean
+util_disk_cache_put(struct util_disk_cache *cache,
+                    const uint8_t key[UTIL_SHA1_DIGEST_LENGTH],
+                    const void *data, size_t size)
+{
+   char file[PATH_MAX];
+   char tmp[PATH_MAX + sizeof ".tmpXXXXXX"];
+   char *slash;
+   struct disk_cache_header header;
+   uint64_t entry_size = sizeof header + size;
+   uint32_t seed;
+   boolean ok;
+   FILE *fp;
+   int fd;
+
+   if (size > 0xffffffff ||
+       (cache->max_size && entry_size > cache->max_size))
+      return FALSE;
+
+   pipe_mutex_lock(cache->mutex);
+   if (cache->max_size) {
+      disk_cache_update_size(cache);
+
+      /* mix the key into the bucket choice */
+      memcpy(&seed, key, sizeof seed);
+      cache->rand_state ^= seed;
+      if (!cache->rand_state)
+         cache->rand_state = 1;
+
+      while (cache->stats.total_size + entry_size > cache->max_size) {
+         if (!disk_cache_evict_one(cache))
+            break;
+      }
+   }
+   pipe_mutex_unlock(cache->mutex);
+
+   disk_cache_entry_path(cache, key, file, sizeof file);
+   /* a unique name, as other threads and processes may be writing the
+    * same entry; mkstemp() must not get a truncated template
+    */
+   ok = util_snprintf(tmp, sizeof tmp, "%s.tmpXXXXXX", file) <
+        (int) sizeof tmp;
+
+   slash = strrchr(file, '/');
+   *slash = '\0';
+   ok = ok && disk_cache_mkdir(file);
+   *slash = '/';
+
+   memset(&header, 0, sizeof header);
+   header.magic = DISK_CACHE_MAGIC;
+   header.version = DISK_CACHE_VERSION;
+   memcpy(header.key, key, UTIL_SHA1_DIGEST_LENGTH);
+   header.size = (uint32_t)size;
+   header.crc32 = util_hash_crc32(data, size);
+
+   fd = ok ? mkstemp(tmp) : -1;
+   fp = fd >= 0 ? fdopen(fd, "wb") : NULL;
+   if (fd >= 0 && !fp) {
+      close(fd);
+      unlink(tmp);
+   }
+   if (fp) {
+      ok = fwrite(&header, sizeof header, 1, fp) == 1 &&
+           fwrite(data, 1, size, fp) == size;
+      ok = (fclose(fp) == 0) && ok;
+
+      /* rename() is atomic, so readers either see the old or the new entry */
+      if (!ok || rename(tmp, file) != 0) {
+         unlink(tmp);
+         ok = FALSE;
+      }
+   }
+   else {
+      ok = FALSE;
+   }
+
+   pipe_mutex_lock(cache->mutex);
+   if (ok) {
+      cache->stats.stores++;
+      cache->stats.bytes_written += entry_size;
+      if (cache->size_known)
+         cache->stats.total_size += entry_size;
+   }
+   else {
+      cache->stats.errors++;
+   }
+   pipe_mutex_unlock(cache->mutex);
+
+   return ok;
+}
+
+
+void
+util_disk_cache_get_stats(struct util_disk_cache *cache,
+                          struct util_disk_cache_stats *stats)
+{
+   pipe_mutex_lock(cache->mutex);
+   disk_cache_update_size(cache);
+   *stats = cache->stats;
+   pipe_mutex_unlock(cache->mutex);
+}
+
+
+#else /* !PIPE_OS_UNIX */
+
+
+struct util_disk_cache *
+util_disk_cache_create(const char *path, uint64_t max_size)
+{
+   return NULL;
+}
+
+
+void
+util_disk_cache_destroy(struct util_disk_cache *cache)
+{
+}
+
+
+void *
+util_disk_cache_get(struct util_disk_cache *cache,
+                    const uint8_t key[UTIL_SHA1_DIGEST_LENGTH],
+                    size_t *size)
+{
+   return NULL;
+}
+
+
+boolean
+util_disk_cache_put(struct util_disk_cache *cache,
+                    const uint8_t key[UTIL_SHA1_DIGEST_LENGTH],
+                    const void *data, size_t size)
+{
+   return FALSE;
+}
+
+
+void
+util_disk_cache_get_stats(struct util_disk_cache *cache,
+                          struct util_disk_cache_stats *stats)
+{
+   memset(stats, 0, sizeof *stats);
+}
+
+
+#endif /* !PIPE_OS_UNIX */
@@ -0,0 +1,112 @@
+/**************************************************************************
+ *
+ * Copyright 2013 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Persistent, content-addressed cache of binary blobs on disk.
+ *
+ * Entries are keyed by a SHA-1 digest and live in a directory that may be
+ * shared by any number of processes.  Writes are atomic (a temporary file
+ * is renamed into place), reads validate a checksum and silently discard
+ * damaged entries, and the total size is kept below a limit by evicting
+ * the least recently used entries of a randomly picked bucket.
+ *
+ * The size accounting is per process: it starts from a scan of the
+ * directory the first time a store has to enforce the limit (or the stats
+ * are queried) and is updated by this process' own stores and evictions,
+ * so concurrent writers may briefly overshoot the limit.
+ */
+
+#ifndef U_DISK_CACHE_H_
+#define U_DISK_CACHE_H_
+
+
+#include "pipe/p_compiler.h"
+#include "util/u_sha1.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+struct util_disk_cache;
+
+
+struct util_disk_cache_stats
+{
+   unsigned hits;
+   unsigned misses;
+   unsigned stores;
+   unsigned evictions;
+   unsigned errors;          /**< I/O failures and corrupt entries */
+   uint64_t bytes_read;
+   uint64_t bytes_written;
+   uint64_t total_size;      /**< estimated size of the cache directory */
+};
+
+
+/**
+ * Open (creating it if needed) the cache rooted at the given directory.
+ *
+ * \param max_size  size limit in bytes, 0 meaning no limit
+ * \return NULL if the directory cannot be used or the platform lacks
+ *         support.
+ */
+struct util_disk_cache *
+util_disk_cache_create(const char *path, uint64_t max_size);
+
+void
+util_disk_cache_destroy(struct util_disk_cache *cache);
+
+/**
+ * Look up an entry.
+ *
+ * \return a malloc'ed copy of the stored data, to be released with free(),
+ *         or NULL on a miss.  Plain malloc is used so that callers outside
+ *         of gallium can release it.
+ */
+void *
+util_disk_cache_get(struct util_disk_cache *cache,
+                    const uint8_t key[UTIL_SHA1_DIGEST_LENGTH],
+                    size_t *size);
+
+boolean
+util_disk_cache_put(struct util_disk_cache *cache,
+                    const uint8_t key[UTIL_SHA1_DIGEST_LENGTH],
+                    const void *data, size_t size);
+
+void
+util_disk_cache_get_stats(struct util_disk_cache *cache,
+                          struct util_disk_cache_stats *stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_DISK_CACHE_H_ */
@@ -37,6 +37,9 @@
 #include "u_rect.h"
 #include "u_format.h"
 #include "u_format_s3tc.h"
+#include "u_cpu_detect.h"
+#include "u_half.h"
+#include "u_sse.h"
 
 #include "pipe/p_defines.h"
 
@@ -490,6 +493,303 @@ util_format_fits_8unorm(const struct util_format_description *format_desc)
 }
 
 
+/**
+ * Conversion between two 32 bit bitmask formats which hold the same kinds
+ * of channels in a different order (or drop/add constant channels), such
+ * as B8G8R8A8_UNORM to R8G8B8X8_UNORM or B10G10R10A2_UNORM to
+ * R10G10B10A2_UNORM.  Each destination channel is a shifted and masked
+ * source channel, so no unpacking is necessary.
+ */
+struct util_format_swizzle32
+{
+   unsigned nr_chans;
+   unsigned src_shift[4];
+   unsigned dst_shift[4];
+   unsigned size[4];
+   uint32_t mask[4];
+   uint32_t constant;
+   boolean bytewise;
+};
+
+
+static boolean
+util_format_get_swizzle32(const struct util_format_description *dst_desc,
+                          const struct util_format_description *src_desc,
+                          struct util_format_swizzle32 *swz)
+{
+#ifdef PIPE_ARCH_LITTLE_ENDIAN
+   unsigned i, c;
+
+   if (dst_desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       src_desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       dst_desc->block.bits != 32 || src_desc->block.bits != 32 ||
+       !dst_desc->is_bitmask || !src_desc->is_bitmask ||
+       dst_desc->colorspace != src_desc->colorspace ||
+       dst_desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS)
+      return FALSE;
+
+   memset(swz, 0, sizeof *swz);
+   swz->bytewise = TRUE;
+
+   for (i = 0; i < dst_desc->nr_channels; i++) {
+      const struct util_format_channel_description *dst_chan =
+         &dst_desc->channel[i];
+      const struct util_format_channel_description *src_chan;
+      uint32_t mask;
+
+      if (dst_chan->type == UTIL_FORMAT_TYPE_VOID)
+         continue;
+
+      mask = dst_chan->size == 32 ? ~0u : (1u << dst_chan->size) - 1;
+
+      /* Find the first component stored in this channel */
+      for (c = 0; c < 4; c++) {
+         if (dst_desc->swizzle[c] == i)
+            break;
+      }
+      if (c == 4)
+         return FALSE;
+
+      switch (src_desc->swizzle[c]) {
+      case UTIL_FORMAT_SWIZZLE_0:
+         break;
+      case UTIL_FORMAT_SWIZZLE_1:
+         if (!dst_chan->normalized)
+            swz->constant |= 1u << dst_chan->shift;
+         else if (dst_chan->type == UTIL_FORMAT_TYPE_SIGNED)
+            swz->constant |= (mask >> 1) << dst_chan->shift;
+         else
+            swz->constant |= mask << dst_chan->shift;
+         break;
+      case UTIL_FORMAT_SWIZZLE_NONE:
+         return FALSE;
+      default:
+         src_chan = &src_desc->channel[src_desc->swizzle[c]];
+         if (src_chan->type != dst_chan->type ||
+             src_chan->normalized != dst_chan->normalized ||
+             src_chan->pure_integer != dst_chan->pure_integer ||
+             src_chan->size != dst_chan->size)
+            return FALSE;
+
+         swz->src_shift[swz->nr_chans] = src_chan->shift;
+         swz->dst_shift[swz->nr_chans] = dst_chan->shift;
+         swz->size[swz->nr_chans] = dst_chan->size;
+         swz->mask[swz->nr_chans] = mask;
+         swz->nr_chans++;
+
+         if (src_chan->shift % 8 || dst_chan->shift % 8 || dst_chan->size % 8)
+            swz->bytewise = FALSE;
+         break;
+      }
+   }
+
+   return TRUE;
+#else
+   return FALSE;
+#endif
+}
+
+
+static void
+util_format_swizzle32_row(const struct util_format_swizzle32 *swz,
+                          uint32_t *dst, const uint32_t *src, unsigned width)
+{
+   unsigned x = 0, i;
+
+#if defined(PIPE_ARCH_SSE)
+   if (swz->bytewise && util_cpu_caps.has_ssse3) {
+      union m128i shuffle;
+      const __m128i constant = _mm_set1_epi32(swz->constant);
+      unsigned p, b;
+
+      /* pshufb zeroes the bytes whose index has the top bit set */
+      memset(shuffle.ub, 0x80, sizeof shuffle.ub);
+      for (i = 0; i < swz->nr_chans; i++) {
+         for (b = 0; b < swz->size[i]; b += 8) {
+            for (p = 0; p < 4; p++) {
+               shuffle.ub[p * 4 + (swz->dst_shift[i] + b) / 8] =
+                  p * 4 + (swz->src_shift[i] + b) / 8;
+            }
+         }
+      }
+
+      for (; x + 4 <= width; x += 4) {
+         __m128i pixels = _mm_loadu_si128((const __m128i *)(src + x));
+         pixels = _mm_shuffle_epi8(pixels, shuffle.m);
+         pixels = _mm_or_si128(pixels, constant);
+         _mm_storeu_si128((__m128i *)(dst + x), pixels);
+      }
+   }
+   else {
+      __m128i src_shift[4], dst_shift[4], mask[4];
+      const __m128i constant = _mm_set1_epi32(swz->constant);
+
+      for (i = 0; i < swz->nr_chans; i++) {
+         src_shift[i] = _mm_cvtsi32_si128(swz->src_shift[i]);
+         dst_shift[i] = _mm_cvtsi32_si128(swz->dst_shift[i]);
+         mask[i] = _mm_set1_epi32(swz->mask[i]);
+      }
+
+      for (; x + 4 <= width; x += 4) {
+         __m128i pixels = _mm_loadu_si128((const __m128i *)(src + x));
+         __m128i result = constant;
+         for (i = 0; i < swz->nr_chans; i++) {
+            __m128i chan = _mm_srl_epi32(pixels, src_shift[i]);
+            chan = _mm_and_si128(chan, mask[i]);
+            result = _mm_or_si128(result, _mm_sll_epi32(chan, dst_shift[i]));
+         }
+         _mm_storeu_si128((__m128i *)(dst + x), result);
+      }
+   }
+#endif
+
+   for (; x < width; x++) {
+      uint32_t pixel = src[x];
+      uint32_t result = swz->constant;
+      for (i = 0; i < swz->nr_chans; i++)
+         result |= ((pixel >> swz->src_shift[i]) & swz->mask[i]) << swz->dst_shift[i];
+      dst[x] = result;
+   }
+}
+
+
+#if defined(PIPE_ARCH_SSE)
+
+/**
+ * Vectorized equivalents of the generated R16G16B16A16_FLOAT <-> float
+ * conversions, doing exactly what util_half_to_float() and
+ * util_float_to_half() do, four channels at a time.
+ */
+static INLINE __m128
+util_half4_to_float4(__m128i h)
+{
+   const __m128i magic = _mm_set1_epi32(0xef << 23);
+   const __m128 infnan = _mm_set1_ps(65536.0f);
+   __m128i f32;
+   __m128 f;
+
+   /* Exponent / Mantissa, adjusted */
+   f32 = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+   f = _mm_mul_ps(_mm_castsi128_ps(f32), _mm_castsi128_ps(magic));
+
+   /* Inf / NaN */
+   f = _mm_or_ps(f, _mm_and_ps(_mm_cmpge_ps(f, infnan),
+                               _mm_castsi128_ps(_mm_set1_epi32(0xff << 23))));
+
+   /* Sign */
+   f32 = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+   return _mm_or_ps(f, _mm_castsi128_ps(f32));
+}
+
+
+static INLINE __m128i
+util_float4_to_half4(__m128 f)
+{
+   const __m128i f32inf = _mm_set1_epi32(0xff << 23);
+   const __m128i f16inf = _mm_set1_epi32(0x1f << 23);
+   const __m128i round_mask = _mm_set1_epi32(~0xfff);
+   const __m128i magic = _mm_set1_epi32(0xf << 23);
+   __m128i f32 = _mm_castps_si128(f);
+   __m128i sign, is_inf, is_nan, num, h;
+
+   /* Sign */
+   sign = _mm_and_si128(f32, _mm_set1_epi32(0x80000000));
+   f32 = _mm_xor_si128(f32, sign);
+
+   is_inf = _mm_cmpeq_epi32(f32, f32inf);
+   is_nan = _mm_cmpgt_epi32(f32, f32inf);
+
+   /* Number */
+   num = _mm_and_si128(f32, round_mask);
+   num = _mm_castps_si128(_mm_mul_ps(_mm_castsi128_ps(num),
+                                     _mm_castsi128_ps(magic)));
+   num = _mm_sub_epi32(num, round_mask);
+
+   /* Clamp to infinity if overflowed */
+   num = _mm_or_si128(_mm_andnot_si128(_mm_cmpgt_epi32(num, f16inf), num),
+                      _mm_and_si128(_mm_cmpgt_epi32(num, f16inf), f16inf));
+   h = _mm_srli_epi32(num, 13);
+
+   h = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(is_inf, is_nan), h),
+                    _mm_or_si128(_mm_and_si128(is_inf, _mm_set1_epi32(0x7c00)),
+                                 _mm_and_si128(is_nan, _mm_set1_epi32(0x7e00))));
+
+   return _mm_or_si128(h, _mm_srli_epi32(sign, 16));
+}
+
+
+static void
+util_format_r16g16b16a16_float_unpack_rgba_float_sse2(float *dst_row, unsigned dst_stride,
+                                                      const uint8_t *src_row, unsigned src_stride,
+                                                      unsigned width, unsigned height)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++) {
+      const uint16_t *src = (const uint16_t *)src_row;
+      float *dst = dst_row;
+
+      for (x = 0; x + 2 <= width; x += 2) {
+         __m128i h = _mm_loadu_si128((const __m128i *)src);
+         _mm_storeu_ps(dst, util_half4_to_float4(
+                              _mm_unpacklo_epi16(h, _mm_setzero_si128())));
+         _mm_storeu_ps(dst + 4, util_half4_to_float4(
+                                  _mm_unpackhi_epi16(h, _mm_setzero_si128())));
+         src += 8;
+         dst += 8;
+      }
+
+      if (x < width) {
+         dst[0] = util_half_to_float(src[0]);
+         dst[1] = util_half_to_float(src[1]);
+         dst[2] = util_half_to_float(src[2]);
+         dst[3] = util_half_to_float(src[3]);
+      }
+
+      src_row += src_stride;
+      dst_row = (float *)((uint8_t *)dst_row + dst_stride);
+   }
+}
+
+
+static void
+util_format_r16g16b16a16_float_pack_rgba_float_sse2(uint8_t *dst_row, unsigned dst_stride,
+                                                    const float *src_row, unsigned src_stride,
+                                                    unsigned width, unsigned height)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++) {
+      const float *src = src_row;
+      uint16_t *dst = (uint16_t *)dst_row;
+
+      for (x = 0; x + 2 <= width; x += 2) {
+         __m128i lo = util_float4_to_half4(_mm_loadu_ps(src));
+         __m128i hi = util_float4_to_half4(_mm_loadu_ps(src + 4));
+
+         /* Sign extend so that the saturating pack leaves the bits alone */
+         lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+         hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+         _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(lo, hi));
+         src += 8;
+         dst += 8;
+      }
+
+      if (x < width) {
+         dst[0] = util_float_to_half(src[0]);
+         dst[1] = util_float_to_half(src[1]);
+         dst[2] = util_float_to_half(src[2]);
+         dst[3] = util_float_to_half(src[3]);
+      }
+
+      dst_row += dst_stride;
+      src_row = (const float *)((const uint8_t *)src_row + src_stride);
+   }
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
 void
 util_format_translate(enum pipe_format dst_format,
                       void *dst, unsigned dst_stride,
@@ -506,6 +806,7 @@ util_format_translate(enum pipe_format dst_format,
    unsigned x_step, y_step;
    unsigned dst_step;
    unsigned src_step;
+   struct util_format_swizzle32 swz;
 
    dst_format_desc = util_format_description(dst_format);
    src_format_desc = util_format_description(src_format);
@@ -544,7 +845,6 @@ util_format_translate(enum pipe_format dst_format,
 
    /*
     * TODO: double formats will loose precision
-    * TODO: Add a special case for formats that are mere swizzles of each other
     */
 
    if (src_format_desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS ||
@@ -587,6 +887,18 @@ util_format_translate(enum pipe_format dst_format,
       return;
    }
 
+   if (util_format_get_swizzle32(dst_format_desc, src_format_desc, &swz)) {
+      util_cpu_detect();
+
+      while (height--) {
+         util_format_swizzle32_row(&swz, (uint32_t *)dst_row,
+                                   (const uint32_t *)src_row, width);
+         dst_row += dst_step;
+         src_row += src_step;
+      }
+      return;
+   }
+
    if (util_format_fits_8unorm(src_format_desc) ||
        util_format_fits_8unorm(dst_format_desc)) {
       unsigned tmp_stride;
@@ -614,17 +926,48 @@ util_format_translate(enum pipe_format dst_format,
       FREE(tmp_row);
    }
    else {
+      void (*unpack_rgba_float)(float *, unsigned, const uint8_t *, unsigned,
+                                unsigned, unsigned) =
+         src_format_desc->unpack_rgba_float;
+      void (*pack_rgba_float)(uint8_t *, unsigned, const float *, unsigned,
+                              unsigned, unsigned) =
+         dst_format_desc->pack_rgba_float;
       unsigned tmp_stride;
       float *tmp_row;
 
+#if defined(PIPE_ARCH_SSE)
+      if (src_format == PIPE_FORMAT_R16G16B16A16_FLOAT)
+         unpack_rgba_float = util_format_r16g16b16a16_float_unpack_rgba_float_sse2;
+      if (dst_format == PIPE_FORMAT_R16G16B16A16_FLOAT)
+         pack_rgba_float = util_format_r16g16b16a16_float_pack_rgba_float_sse2;
+#endif
+
+      /*
+       * No need for an intermediate copy when one side already has the
+       * layout of the temporary rows.  Only for 1x1 blocks though: some
+       * block formats read and write whole blocks, past the edges of a
+       * region which isn't a multiple of the block size, which only the
+       * temporary rows have room for.
+       */
+      if (x_step == 1 && y_step == 1) {
+         if (dst_format == PIPE_FORMAT_R32G32B32A32_FLOAT) {
+            unpack_rgba_float((float *)dst_row, dst_stride, src_row, src_stride, width, height);
+            return;
+         }
+         if (src_format == PIPE_FORMAT_R32G32B32A32_FLOAT) {
+            pack_rgba_float(dst_row, dst_stride, (const float *)src_row, src_stride, width, height);
+            return;
+         }
+      }
+
       tmp_stride = MAX2(width, x_step) * 4 * sizeof *tmp_row;
       tmp_row = MALLOC(y_step * tmp_stride);
       if (!tmp_row)
          return;
 
       while (height >= y_step) {
-         src_format_desc->unpack_rgba_float(tmp_row, tmp_stride, src_row, src_stride, width, y_step);
-         dst_format_desc->pack_rgba_float(dst_row, dst_stride, tmp_row, tmp_stride, width, y_step);
+         unpack_rgba_float(tmp_row, tmp_stride, src_row, src_stride, width, y_step);
+         pack_rgba_float(dst_row, dst_stride, tmp_row, tmp_stride, width, y_step);
 
          dst_row += dst_step;
          src_row += src_step;
@@ -632,8 +975,8 @@ util_format_translate(enum pipe_format dst_format,
       }
 
       if (height) {
-         src_format_desc->unpack_rgba_float(tmp_row, tmp_stride, src_row, src_stride, width, height);
-         dst_format_desc->pack_rgba_float(dst_row, dst_stride, tmp_row, tmp_stride, width, height);
+         unpack_rgba_float(tmp_row, tmp_stride, src_row, src_stride, width, height);
+         pack_rgba_float(dst_row, dst_stride, tmp_row, tmp_stride, width, height);
       }
 
       FREE(tmp_row);
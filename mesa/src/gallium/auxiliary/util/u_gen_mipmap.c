@@ -1519,6 +1519,23 @@ util_gen_mipmap(struct gen_mipmap_state *ctx,
    assert(filter == PIPE_TEX_FILTER_LINEAR ||
           filter == PIPE_TEX_FILTER_NEAREST);
 
+   /* Let the driver do it directly if it knows how to */
+   if (pipe->generate_mipmap && filter == PIPE_TEX_FILTER_LINEAR) {
+      unsigned first_layer = 0, last_layer = 0;
+
+      if (pt->target == PIPE_TEXTURE_CUBE) {
+         first_layer = last_layer = face;
+      }
+      else if (pt->target == PIPE_TEXTURE_1D_ARRAY ||
+               pt->target == PIPE_TEXTURE_2D_ARRAY) {
+         last_layer = pt->array_size - 1;
+      }
+
+      if (pipe->generate_mipmap(pipe, pt, psv->format, baseLevel, lastLevel,
+                                first_layer, last_layer))
+         return;
+   }
+
    switch (pt->target) {
    case PIPE_TEXTURE_1D:
       type = TGSI_TEXTURE_1D;
@@ -0,0 +1,180 @@
+/**************************************************************************
+ *
+ * Copyright 2013 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * SHA-1 implementation, following FIPS 180-1.
+ */
+
+
+#include "u_sha1.h"
+#include <string.h>
+
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+
+static void
+util_sha1_transform(uint32_t state[5], const uint8_t block[64])
+{
+   uint32_t w[80];
+   uint32_t a, b, c, d, e, t;
+   unsigned i;
+
+   for (i = 0; i < 16; i++) {
+      w[i] = ((uint32_t)block[i*4 + 0] << 24) |
+             ((uint32_t)block[i*4 + 1] << 16) |
+             ((uint32_t)block[i*4 + 2] <<  8) |
+             ((uint32_t)block[i*4 + 3]);
+   }
+   for (i = 16; i < 80; i++)
+      w[i] = ROL32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+
+   a = state[0];
+   b = state[1];
+   c = state[2];
+   d = state[3];
+   e = state[4];
+
+   for (i = 0; i < 80; i++) {
+      if (i < 20)
+         t = ((b & c) | (~b & d)) + 0x5a827999;
+      else if (i < 40)
+         t = (b ^ c ^ d) + 0x6ed9eba1;
+      else if (i < 60)
+         t = ((b & c) | (b & d) | (c & d)) + 0x8f1bbcdc;
+      else
+         t = (b ^ c ^ d) + 0xca62c1d6;
+
+      t += ROL32(a, 5) + e + w[i];
+      e = d;
+      d = c;
+      c = ROL32(b, 30);
+      b = a;
+      a = t;
+   }
+
+   state[0] += a;
+   state[1] += b;
+   state[2] += c;
+   state[3] += d;
+   state[4] += e;
+}
+
+
+void
+util_sha1_init(struct util_sha1_ctx *ctx)
+{
+   ctx->state[0] = 0x67452301;
+   ctx->state[1] = 0xefcdab89;
+   ctx->state[2] = 0x98badcfe;
+   ctx->state[3] = 0x10325476;
+   ctx->state[4] = 0xc3d2e1f0;
+   ctx->count = 0;
+}
+
+
+void
+util_sha1_update(struct util_sha1_ctx *ctx, const void *data, size_t size)
+{
+   const uint8_t *src = (const uint8_t *)data;
+   unsigned used = (unsigned)(ctx->count & 63);
+
+   ctx->count += size;
+
+   if (used) {
+      unsigned avail = 64 - used;
+      if (size < avail) {
+         memcpy(ctx->buffer + used, src, size);
+         return;
+      }
+      memcpy(ctx->buffer + used, src, avail);
+      util_sha1_transform(ctx->state, ctx->buffer);
+      src += avail;
+      size -= avail;
+   }
+
+   while (size >= 64) {
+      util_sha1_transform(ctx->state, src);
+      src += 64;
+      size -= 64;
+   }
+
+   memcpy(ctx->buffer, src, size);
+}
+
+
+void
+util_sha1_final(struct util_sha1_ctx *ctx,
+                uint8_t digest[UTIL_SHA1_DIGEST_LENGTH])
+{
+   uint64_t bits = ctx->count * 8;
+   unsigned used = (unsigned)(ctx->count & 63);
+   unsigned i;
+
+   ctx->buffer[used++] = 0x80;
+   if (used > 56) {
+      memset(ctx->buffer + used, 0, 64 - used);
+      util_sha1_transform(ctx->state, ctx->buffer);
+      used = 0;
+   }
+   memset(ctx->buffer + used, 0, 56 - used);
+
+   for (i = 0; i < 8; i++)
+      ctx->buffer[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+   util_sha1_transform(ctx->state, ctx->buffer);
+
+   for (i = 0; i < UTIL_SHA1_DIGEST_LENGTH; i++)
+      digest[i] = (uint8_t)(ctx->state[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+
+void
+util_sha1_compute(const void *data, size_t size,
+                  uint8_t digest[UTIL_SHA1_DIGEST_LENGTH])
+{
+   struct util_sha1_ctx ctx;
+
+   util_sha1_init(&ctx);
+   util_sha1_update(&ctx, data, size);
+   util_sha1_final(&ctx, digest);
+}
+
+
+void
+util_sha1_format(char buf[2 * UTIL_SHA1_DIGEST_LENGTH + 1],
+                 const uint8_t digest[UTIL_SHA1_DIGEST_LENGTH])
+{
+   static const char hex[] = "0123456789abcdef";
+   unsigned i;
+
+   for (i = 0; i < UTIL_SHA1_DIGEST_LENGTH; i++) {
+      buf[i*2 + 0] = hex[digest[i] >> 4];
+      buf[i*2 + 1] = hex[digest[i] & 0xf];
+   }
+   buf[2 * UTIL_SHA1_DIGEST_LENGTH] = '\0';
+}
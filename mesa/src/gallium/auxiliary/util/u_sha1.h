@@ -0,0 +1,85 @@
+/**************************************************************************
+ *
+ * Copyright 2013 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * SHA-1 message digest.
+ *
+ * Used where a collision-resistant key is needed, e.g. for caches that
+ * persist across processes.  Not meant for cryptographic purposes.
+ */
+
+#ifndef U_SHA1_H_
+#define U_SHA1_H_
+
+
+#include "pipe/p_compiler.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define UTIL_SHA1_DIGEST_LENGTH 20
+
+
+struct util_sha1_ctx
+{
+   uint32_t state[5];
+   uint64_t count;        /**< number of bytes hashed so far */
+   uint8_t buffer[64];
+};
+
+
+void
+util_sha1_init(struct util_sha1_ctx *ctx);
+
+void
+util_sha1_update(struct util_sha1_ctx *ctx, const void *data, size_t size);
+
+void
+util_sha1_final(struct util_sha1_ctx *ctx,
+                uint8_t digest[UTIL_SHA1_DIGEST_LENGTH]);
+
+void
+util_sha1_compute(const void *data, size_t size,
+                  uint8_t digest[UTIL_SHA1_DIGEST_LENGTH]);
+
+/**
+ * Format a digest as 40 lowercase hex digits plus a terminating zero.
+ */
+void
+util_sha1_format(char buf[2 * UTIL_SHA1_DIGEST_LENGTH + 1],
+                 const uint8_t digest[UTIL_SHA1_DIGEST_LENGTH]);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_SHA1_H_ */
@@ -34,6 +34,7 @@
 #include "draw/draw_vbuf.h"
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
+#include "util/u_atomic.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_simple_list.h"
@@ -87,6 +88,9 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
 
    for (i = 0; i < Elements(llvmpipe->constants); i++) {
       for (j = 0; j < Elements(llvmpipe->constants[i]); j++) {
+         struct pipe_resource *buffer = llvmpipe->constants[i][j].buffer;
+         if (buffer && (i == PIPE_SHADER_VERTEX || i == PIPE_SHADER_GEOMETRY))
+            p_atomic_dec(&llvmpipe_resource(buffer)->draw_constant_refs);
          pipe_resource_reference(&llvmpipe->constants[i][j].buffer, NULL);
       }
    }
@@ -95,6 +99,8 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
       pipe_resource_reference(&llvmpipe->vertex_buffer[i].buffer, NULL);
    }
 
+   llvmpipe_cleanup_compute(llvmpipe);
+
    lp_delete_setup_variants(llvmpipe);
 
    align_free( llvmpipe );
@@ -162,6 +168,7 @@ llvmpipe_create_context( struct pipe_screen *screen, void *priv )
    llvmpipe_init_vs_funcs(llvmpipe);
    llvmpipe_init_gs_funcs(llvmpipe);
    llvmpipe_init_rasterizer_funcs(llvmpipe);
+   llvmpipe_init_compute_funcs(llvmpipe);
    llvmpipe_init_context_resource_funcs( &llvmpipe->pipe );
    llvmpipe_init_surface_functions(llvmpipe);
 
@@ -48,13 +48,19 @@
  * All the other drawing functions are implemented in terms of this function.
  * Basically, map the vertex buffers (and drawing surfaces), then hand off
  * the drawing to the 'draw' module.
+ *
+ * The buffers are mapped, the samplers prepared and the draw module
+ * flushed once for all \p num_draws primitives.
  */
 static void
-llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
+llvmpipe_multi_draw_vbo(struct pipe_context *pipe,
+                        const struct pipe_draw_info *info,
+                        unsigned num_draws)
 {
    struct llvmpipe_context *lp = llvmpipe_context(pipe);
    struct draw_context *draw = lp->draw;
    const void *mapped_indices = NULL;
+   boolean indexed = FALSE;
    unsigned i;
 
    if (!llvmpipe_check_render_cond(lp))
@@ -79,8 +85,11 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
       draw_set_mapped_vertex_buffer(draw, i, buf, size);
    }
 
+   for (i = 0; i < num_draws; i++)
+      indexed |= info[i].indexed;
+
    /* Map index buffer, if present */
-   if (info->indexed) {
+   if (indexed) {
       unsigned available_space = ~0;
       mapped_indices = lp->index_buffer.user_buffer;
       if (!mapped_indices) {
@@ -123,7 +132,7 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
                                     lp->active_statistics_queries > 0);
 
    /* draw! */
-   draw_vbo(draw, info);
+   draw_multi_vbo(draw, info, num_draws);
 
    /*
     * unmap vertex/index buffers
@@ -156,8 +165,16 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
 }
 
 
+static void
+llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
+{
+   llvmpipe_multi_draw_vbo(pipe, info, 1);
+}
+
+
 void
 llvmpipe_init_draw_funcs(struct llvmpipe_context *llvmpipe)
 {
    llvmpipe->pipe.draw_vbo = llvmpipe_draw_vbo;
+   llvmpipe->pipe.multi_draw_vbo = llvmpipe_multi_draw_vbo;
 }
@@ -129,3 +129,38 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
 
    return TRUE;
 }
+
+
+/**
+ * Like llvmpipe_flush_resource(), for CPU access to a box of the resource.
+ *
+ * When only reading back part of a render target, just the tiles which
+ * overlap the box are rasterized, and the rest of the scene stays binned.
+ */
+boolean
+llvmpipe_flush_resource_box(struct pipe_context *pipe,
+                            struct pipe_resource *resource,
+                            unsigned level,
+                            const struct pipe_box *box,
+                            boolean read_only,
+                            boolean do_not_block,
+                            const char *reason)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+
+   if (read_only &&
+       (llvmpipe_is_resource_referenced(pipe, resource, level) &
+        LP_REFERENCED_FOR_WRITE)) {
+      if (do_not_block)
+         return FALSE;
+
+      draw_flush(llvmpipe->draw);
+
+      if (lp_setup_flush_region(llvmpipe->setup, resource, level, box))
+         return TRUE;
+   }
+
+   return llvmpipe_flush_resource(pipe, resource, level, read_only,
+                                  TRUE, /* cpu_access */
+                                  do_not_block, reason);
+}
@@ -33,6 +33,7 @@
 struct pipe_context;
 struct pipe_fence_handle;
 struct pipe_resource;
+struct pipe_box;
 
 void
 llvmpipe_flush(struct pipe_context *pipe,
@@ -52,4 +53,13 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
                         boolean do_not_block,
                         const char *reason);
 
+boolean
+llvmpipe_flush_resource_box(struct pipe_context *pipe,
+                            struct pipe_resource *resource,
+                            unsigned level,
+                            const struct pipe_box *box,
+                            boolean read_only,
+                            boolean do_not_block,
+                            const char *reason);
+
 #endif
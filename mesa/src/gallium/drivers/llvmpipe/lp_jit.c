@@ -37,6 +37,7 @@
 #include "gallivm/lp_bld_init.h"
 #include "gallivm/lp_bld_debug.h"
 #include "lp_context.h"
+#include "lp_state_cs.h"
 #include "lp_jit.h"
 
 
@@ -215,6 +216,68 @@ lp_jit_create_types(struct lp_fragment_shader_variant *lp)
 }
 
 
+static void
+lp_jit_create_cs_types(struct lp_compute_shader_variant *lp)
+{
+   struct gallivm_state *gallivm = lp->gallivm;
+   LLVMContextRef lc = gallivm->context;
+   LLVMTypeRef int8_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(lc), 0);
+   LLVMTypeRef elem_types[LP_JIT_CS_CTX_COUNT];
+   LLVMTypeRef context_type;
+
+   elem_types[LP_JIT_CS_CTX_CONSTANTS] =
+         LLVMArrayType(LLVMPointerType(LLVMFloatTypeInContext(lc), 0), LP_MAX_TGSI_CONST_BUFFERS);
+   elem_types[LP_JIT_CS_CTX_RESOURCES] =
+         LLVMArrayType(int8_ptr_type, PIPE_MAX_SHADER_RESOURCES);
+   elem_types[LP_JIT_CS_CTX_GLOBALS] =
+         LLVMArrayType(int8_ptr_type, LP_MAX_GLOBAL_BUFFERS + 1);
+   elem_types[LP_JIT_CS_CTX_INPUT] = int8_ptr_type;
+   elem_types[LP_JIT_CS_CTX_BLOCK_SIZE] =
+   elem_types[LP_JIT_CS_CTX_GRID_SIZE] =
+         LLVMArrayType(LLVMInt32TypeInContext(lc), 3);
+   elem_types[LP_JIT_CS_CTX_PRIVATE_SIZE] = LLVMInt32TypeInContext(lc);
+
+   context_type = LLVMStructTypeInContext(lc, elem_types,
+                                          Elements(elem_types), 0);
+
+#if HAVE_LLVM < 0x0300
+   LLVMInvalidateStructLayout(gallivm->target, context_type);
+
+   LLVMAddTypeName(gallivm->module, "cs_context", context_type);
+#endif
+
+   LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, constants,
+                          gallivm->target, context_type,
+                          LP_JIT_CS_CTX_CONSTANTS);
+   LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, resources,
+                          gallivm->target, context_type,
+                          LP_JIT_CS_CTX_RESOURCES);
+   LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, globals,
+                          gallivm->target, context_type,
+                          LP_JIT_CS_CTX_GLOBALS);
+   LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, input,
+                          gallivm->target, context_type,
+                          LP_JIT_CS_CTX_INPUT);
+   LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, block_size,
+                          gallivm->target, context_type,
+                          LP_JIT_CS_CTX_BLOCK_SIZE);
+   LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, grid_size,
+                          gallivm->target, context_type,
+                          LP_JIT_CS_CTX_GRID_SIZE);
+   LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, private_size,
+                          gallivm->target, context_type,
+                          LP_JIT_CS_CTX_PRIVATE_SIZE);
+   LP_CHECK_STRUCT_SIZE(struct lp_jit_cs_context,
+                        gallivm->target, context_type);
+
+   lp->jit_context_ptr_type = LLVMPointerType(context_type, 0);
+
+   if (gallivm_debug & GALLIVM_DEBUG_IR) {
+      LLVMDumpModule(gallivm->module);
+   }
+}
+
+
 void
 lp_jit_screen_cleanup(struct llvmpipe_screen *screen)
 {
@@ -235,3 +298,11 @@ lp_jit_init_types(struct lp_fragment_shader_variant *lp)
    if (!lp->jit_context_ptr_type)
       lp_jit_create_types(lp);
 }
+
+
+void
+lp_jit_init_cs_types(struct lp_compute_shader_variant *lp)
+{
+   if (!lp->jit_context_ptr_type)
+      lp_jit_create_cs_types(lp);
+}
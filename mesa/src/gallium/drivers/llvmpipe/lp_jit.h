@@ -44,6 +44,8 @@
 
 
 struct lp_fragment_shader_variant;
+struct lp_compute_shader_variant;
+struct lp_cs_thread_data;
 struct llvmpipe_screen;
 
 
@@ -190,10 +192,12 @@ enum {
  * @param dady          shader input dady
  * @param color         color buffer
  * @param depth         depth buffer
- * @param mask          mask of visible pixels in block
+ * @param mask          mask of visible pixels in block, 16 bits per sample
  * @param thread_data   task thread data
  * @param stride        color buffer row stride in bytes
  * @param depth_stride  depth buffer row stride in bytes
+ * @param sample_stride color buffer sample plane stride in bytes
+ * @param depth_sample_stride  depth buffer sample plane stride in bytes
  */
 typedef void
 (*lp_jit_frag_func)(const struct lp_jit_context *context,
@@ -205,10 +209,101 @@ typedef void
                     const void *dady,
                     uint8_t **color,
                     uint8_t *depth,
-                    uint32_t mask,
+                    uint64_t mask,
                     struct lp_jit_thread_data *thread_data,
                     unsigned *stride,
-                    unsigned depth_stride);
+                    unsigned depth_stride,
+                    unsigned *sample_stride,
+                    unsigned depth_sample_stride);
+
+
+/**
+ * This structure is passed directly to the generated compute shader.
+ *
+ * Changes here must be reflected in the lp_jit_cs_context_* macros and
+ * lp_jit_init_cs_types function.
+ */
+struct lp_jit_cs_context
+{
+   const float *constants[LP_MAX_TGSI_CONST_BUFFERS];
+
+   /** Bound resources (set_compute_resources) */
+   uint8_t *resources[PIPE_MAX_SHADER_RESOURCES];
+
+   /** Buffers mapped into the GLOBAL resource, by high address bits */
+   uint8_t *globals[LP_MAX_GLOBAL_BUFFERS + 1];
+
+   const uint8_t *input;
+
+   uint32_t block_size[3];
+   uint32_t grid_size[3];
+
+   /** Bytes of PRIVATE memory per thread */
+   uint32_t private_size;
+};
+
+
+/**
+ * These enum values must match the position of the fields in the
+ * lp_jit_cs_context struct above.
+ */
+enum {
+   LP_JIT_CS_CTX_CONSTANTS = 0,
+   LP_JIT_CS_CTX_RESOURCES,
+   LP_JIT_CS_CTX_GLOBALS,
+   LP_JIT_CS_CTX_INPUT,
+   LP_JIT_CS_CTX_BLOCK_SIZE,
+   LP_JIT_CS_CTX_GRID_SIZE,
+   LP_JIT_CS_CTX_PRIVATE_SIZE,
+   LP_JIT_CS_CTX_COUNT
+};
+
+
+#define lp_jit_cs_context_constants(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_CONSTANTS, "constants")
+
+#define lp_jit_cs_context_resources(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_RESOURCES, "resources")
+
+#define lp_jit_cs_context_globals(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_GLOBALS, "globals")
+
+#define lp_jit_cs_context_input(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_CTX_INPUT, "input")
+
+#define lp_jit_cs_context_block_size(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_BLOCK_SIZE, "block_size")
+
+#define lp_jit_cs_context_grid_size(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_GRID_SIZE, "grid_size")
+
+#define lp_jit_cs_context_private_size(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_CTX_PRIVATE_SIZE, "private_size")
+
+
+/**
+ * typedef for compute shader function
+ *
+ * Runs one SIMD vector of threads of a work group.
+ *
+ * @param context       jit context
+ * @param block_id_x    work group id
+ * @param block_id_y    work group id
+ * @param block_id_z    work group id
+ * @param thread_index  linear index in the work group of the first thread
+ * @param local_mem     LOCAL memory of the work group
+ * @param private_mem   PRIVATE memory of the vector's first thread
+ * @param thread_data   work group state, for barriers
+ */
+typedef void
+(*lp_jit_cs_func)(const struct lp_jit_cs_context *context,
+                  uint32_t block_id_x,
+                  uint32_t block_id_y,
+                  uint32_t block_id_z,
+                  uint32_t thread_index,
+                  uint8_t *local_mem,
+                  uint8_t *private_mem,
+                  struct lp_cs_thread_data *thread_data);
 
 
 void
@@ -223,4 +318,8 @@ void
 lp_jit_init_types(struct lp_fragment_shader_variant *lp);
 
 
+void
+lp_jit_init_cs_types(struct lp_compute_shader_variant *lp);
+
+
 #endif /* LP_JIT_H */
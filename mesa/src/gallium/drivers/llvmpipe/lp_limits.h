@@ -64,6 +64,13 @@
 #define LP_MAX_THREADS 16
 
 
+/**
+ * Number of samples per pixel of a multisampled surface.  This is also
+ * the only sample count other than one that we accept.
+ */
+#define LP_MAX_SAMPLES 4
+
+
 /**
  * Max bytes per scene.  This may be replaced by a runtime parameter.
  */
@@ -91,4 +98,19 @@
  */
 #define LP_MAX_SETUP_VARIANTS 64
 
+
+/**
+ * Compute shaders.
+ *
+ * Addresses in the GLOBAL resource are 32 bits: the low
+ * LP_GLOBAL_ADDRESS_BITS are an offset into a buffer and the high bits
+ * select one of the bound buffers.  Buffer 0 is never bound so that no
+ * buffer maps to address zero.
+ */
+#define LP_MAX_CS_BLOCK_SIZE 1024
+#define LP_MAX_CS_LOCAL_SIZE (32 * 1024)
+#define LP_MAX_CS_PRIVATE_SIZE (8 * 1024)
+#define LP_GLOBAL_ADDRESS_BITS 26
+#define LP_MAX_GLOBAL_BUFFERS ((1 << (32 - LP_GLOBAL_ADDRESS_BITS)) - 1)
+
 #endif /* LP_LIMITS_H */
@@ -99,6 +99,7 @@ lp_print_counters(void)
       debug_printf("llvmpipe:   nr_non_empty_4x4:           %9u (%3.0f%% of %u)\n", lp_count.nr_non_empty_4, p4, total_4);
 
       debug_printf("llvmpipe: nr_color_tile_clear:          %9u\n", lp_count.nr_color_tile_clear);
+      debug_printf("llvmpipe: nr_color_tile_clear_skipped:  %9u\n", lp_count.nr_color_tile_clear_skipped);
       debug_printf("llvmpipe: nr_color_tile_load:           %9u\n", lp_count.nr_color_tile_load);
       debug_printf("llvmpipe: nr_color_tile_store:          %9u\n", lp_count.nr_color_tile_store);
 
@@ -106,5 +107,22 @@ lp_print_counters(void)
       debug_printf("llvmpipe: total LLVM compile time:      %.2f sec\n", lp_count.llvm_compile_time / 1000000.0);
       debug_printf("llvmpipe: average LLVM compile time:    %.2f sec\n", lp_count.llvm_compile_time / 1000000.0 / lp_count.nr_llvm_compiles);
 
+      debug_printf("llvmpipe: nr_tile_buffer_loads:         %9u\n", lp_count.nr_tile_buffer_loads);
+      debug_printf("llvmpipe: nr_tile_buffer_write_backs:   %9u\n", lp_count.nr_tile_buffer_write_backs);
+
+      debug_printf("llvmpipe: nr_region_flushes:            %9u\n", lp_count.nr_region_flushes);
+      debug_printf("llvmpipe: nr_region_flush_tiles:        %9u\n", lp_count.nr_region_flush_tiles);
+
+      debug_printf("llvmpipe: nr_cs_launches:               %9u\n", lp_count.nr_cs_launches);
+      debug_printf("llvmpipe: nr_cs_blocks:                 %9u\n", lp_count.nr_cs_blocks);
+      debug_printf("llvmpipe: nr_cs_barrier_blocks:         %9u\n", lp_count.nr_cs_barrier_blocks);
+
+      debug_printf("llvmpipe: nr_ms_tile_decompress:        %9u\n", lp_count.nr_ms_tile_decompress);
+      debug_printf("llvmpipe: nr_ms_resolve_tiles:          %9u\n", lp_count.nr_ms_resolve_tiles);
+      debug_printf("llvmpipe: nr_ms_resolve_tiles_compressed: %7u\n", lp_count.nr_ms_resolve_tiles_compressed);
+
+      debug_printf("llvmpipe: nr_mipmap_levels:             %9u\n", lp_count.nr_mipmap_levels);
+      debug_printf("llvmpipe: nr_buffer_renames:            %9u\n", lp_count.nr_buffer_renames);
+
    }
 }
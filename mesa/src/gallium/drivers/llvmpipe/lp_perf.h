@@ -59,7 +59,23 @@ struct lp_counters
    unsigned nr_llvm_compiles;
    int64_t llvm_compile_time;  /**< total, in microseconds */
 
+   unsigned nr_tile_buffer_loads;
+   unsigned nr_tile_buffer_write_backs;
+
+   unsigned nr_region_flushes;
+   unsigned nr_region_flush_tiles;
+
+   unsigned nr_cs_launches;
+   unsigned nr_cs_blocks;
+   unsigned nr_cs_barrier_blocks;
+   unsigned nr_ms_tile_decompress;
+   unsigned nr_ms_resolve_tiles;
+   unsigned nr_ms_resolve_tiles_compressed;
+   unsigned nr_mipmap_levels;
+   unsigned nr_buffer_renames;
+
    unsigned nr_color_tile_clear;
+   unsigned nr_color_tile_clear_skipped;
    unsigned nr_color_tile_load;
    unsigned nr_color_tile_store;
 };
@@ -53,6 +53,18 @@ const struct lp_rasterizer_task *jit_task = NULL;
 #endif
 
 
+/**
+ * The standard 4x pattern: a rotated grid, so that no two samples share
+ * a row or column.
+ */
+const int lp_sample_pos[LP_MAX_SAMPLES][2] = {
+   { -2, -6 },
+   {  6, -2 },
+   { -6,  2 },
+   {  2,  6 }
+};
+
+
 /**
  * Begin rasterizing a scene.
  * Called once per scene by one thread.
@@ -73,12 +85,119 @@ lp_rast_begin( struct lp_rasterizer *rast,
 static void
 lp_rast_end( struct lp_rasterizer *rast )
 {
-   lp_scene_end_rasterization( rast->curr_scene );
+   if (rast->curr_scene->partial)
+      lp_scene_end_partial_rasterization( rast->curr_scene );
+   else
+      lp_scene_end_rasterization( rast->curr_scene );
 
    rast->curr_scene = NULL;
 }
 
 
+/**
+ * Copy the sample 0 plane of a color buffer tile to the other samples.
+ */
+static void
+ms_decompress_tile(struct lp_rasterizer_task *task,
+                   unsigned buf, unsigned layer)
+{
+   const struct lp_scene *scene = task->scene;
+   enum pipe_format format = scene->fb.cbufs[buf]->format;
+   unsigned stride = scene->cbufs[buf].stride;
+   uint8_t *src = scene->cbufs[buf].map + layer * scene->cbufs[buf].layer_stride;
+   unsigned s;
+
+   for (s = 1; s < scene->nr_samples; s++) {
+      util_copy_rect(src + s * scene->cbufs[buf].sample_stride, format, stride,
+                     task->x, task->y, task->width, task->height,
+                     src, stride, task->x, task->y);
+   }
+
+   LP_COUNT(nr_ms_tile_decompress);
+}
+
+
+/**
+ * Decompress all compressed color buffer tiles, before drawing something
+ * which doesn't write the same values to all samples of a pixel.
+ */
+void
+lp_rast_ms_decompress(struct lp_rasterizer_task *task)
+{
+   unsigned bufs = task->ms_compressed;
+
+   assert(task->scene->fb_max_layer == 0);
+
+   while (bufs) {
+      unsigned i = u_bit_scan(&bufs);
+      ms_decompress_tile(task, i, 0);
+   }
+
+   task->ms_compressed = 0;
+}
+
+
+/**
+ * Look up which multisampled color buffer tiles are compressed.
+ * The flags are only tracked while rendering to a single layer; layered
+ * rendering starts by decompressing the tile in all layers.
+ */
+static void
+ms_tile_begin(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+   unsigned tx = task->x / TILE_SIZE;
+   unsigned ty = task->y / TILE_SIZE;
+   unsigned i, layer;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      uint8_t *flag;
+
+      if (!scene->cbufs[i].ms_compressed)
+         continue;
+
+      task->ms_color_bufs |= 1 << i;
+      flag = scene->cbufs[i].ms_compressed + ty * scene->cbufs[i].ms_stride + tx;
+
+      if (scene->fb_max_layer == 0) {
+         if (*flag)
+            task->ms_compressed |= 1 << i;
+      }
+      else {
+         for (layer = 0; layer <= scene->fb_max_layer; layer++) {
+            if (*flag) {
+               ms_decompress_tile(task, i, layer);
+               *flag = 0;
+            }
+            flag += scene->cbufs[i].ms_layer_stride;
+         }
+      }
+   }
+}
+
+
+/**
+ * Store the compressed flags of the tile back into the resources.
+ */
+static void
+ms_tile_end(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+   unsigned tx = task->x / TILE_SIZE;
+   unsigned ty = task->y / TILE_SIZE;
+   unsigned bufs = task->ms_color_bufs;
+
+   if (scene->fb_max_layer != 0)
+      return;
+
+   while (bufs) {
+      unsigned i = u_bit_scan(&bufs);
+      scene->cbufs[i].ms_compressed[ty * scene->cbufs[i].ms_stride + tx] =
+         (task->ms_compressed >> i) & 1;
+   }
+}
+
+
 /**
  * Begining rasterization of a tile.
  * \param x  window X position of the tile, in pixels
@@ -105,19 +224,117 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
    /* reset pointers to color and depth tile(s) */
    memset(task->color_tiles, 0, sizeof(task->color_tiles));
    task->depth_tile = NULL;
+
+   task->clear_color_pending = FALSE;
+
+   /* Clears and layered rendering address all layers of the framebuffer,
+    * and multisampled rendering all samples, while the tile buffers only
+    * hold one.
+    */
+   task->use_tile_buffer = (task->tile_buffer &&
+                            task->scene->fb_max_layer == 0 &&
+                            task->scene->nr_samples == 1);
+
+   task->ms_color_bufs = 0;
+   task->ms_compressed = 0;
+   if (task->scene->nr_samples > 1) {
+      unsigned i;
+
+      for (i = 0; i < task->scene->fb.nr_cbufs; i++)
+         task->color_sample_strides[i] = task->scene->cbufs[i].sample_stride;
+      task->depth_sample_stride = task->scene->zsbuf.sample_stride;
+
+      ms_tile_begin(task);
+   }
 }
 
 
 /**
- * Clear the rasterizer's current color tile.
- * This is a bin command called during bin processing.
- * Clear commands always clear all bound layers.
+ * Lay out the tile buffers for the surfaces bound to the task's scene,
+ * growing the buffer first if they don't fit.  On allocation failure the
+ * scene is rendered in place.
  */
 static void
-lp_rast_clear_color(struct lp_rasterizer_task *task,
-                    const union lp_rast_cmd_arg arg)
+lp_rast_setup_tile_buffers(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+   unsigned color_offsets[PIPE_MAX_COLOR_BUFS];
+   unsigned depth_offset;
+   unsigned size = 0;
+   unsigned i;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      color_offsets[i] = size;
+      if (scene->fb.cbufs[i])
+         size += TILE_SIZE * TILE_SIZE *
+                 util_format_get_blocksize(scene->fb.cbufs[i]->format);
+   }
+
+   depth_offset = size;
+   if (scene->fb.zsbuf)
+      size += TILE_SIZE * TILE_SIZE *
+              util_format_get_blocksize(scene->fb.zsbuf->format);
+
+   if (size > task->tile_buffer_size) {
+      align_free(task->tile_buffer);
+      task->tile_buffer = align_malloc(size, 64);
+      task->tile_buffer_size = task->tile_buffer ? size : 0;
+   }
+
+   if (!task->tile_buffer)
+      return;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++)
+      task->color_tile_buffers[i] = task->tile_buffer + color_offsets[i];
+   task->depth_tile_buffer = task->tile_buffer + depth_offset;
+}
+
+
+/**
+ * Write the tile buffers back to the framebuffer.
+ */
+static void
+lp_rast_tile_write_back(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+   unsigned i;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (task->color_tiles[i]) {
+         enum pipe_format format = scene->fb.cbufs[i]->format;
+         util_copy_rect(scene->cbufs[i].map, format,
+                        scene->cbufs[i].stride, task->x, task->y,
+                        task->width, task->height,
+                        task->color_tiles[i], task->color_strides[i], 0, 0);
+         LP_COUNT(nr_tile_buffer_write_backs);
+      }
+   }
+
+   if (task->depth_tile) {
+      util_copy_rect(scene->zsbuf.map, scene->fb.zsbuf->format,
+                     scene->zsbuf.stride, task->x, task->y,
+                     task->width, task->height,
+                     task->depth_tile, task->depth_stride, 0, 0);
+      LP_COUNT(nr_tile_buffer_write_backs);
+   }
+}
+
+
+/**
+ * Write the pending color clear to the current tile.
+ * Clears always clear all bound layers.  Multisampled tiles are left
+ * compressed, unless rendering is layered.
+ */
+static void
+resolve_clear_color(struct lp_rasterizer_task *task)
 {
    const struct lp_scene *scene = task->scene;
+   const union pipe_color_union *clear_color = &task->clear_color;
+   const unsigned num_samples = scene->fb_max_layer == 0 ? 1 : scene->nr_samples;
+   unsigned s;
+
+   assert(task->clear_color_pending);
+   task->clear_color_pending = FALSE;
 
    if (scene->fb.nr_cbufs) {
       unsigned i;
@@ -130,71 +347,97 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
           * couldn't handle it)...
           */
          LP_DBG(DEBUG_RAST, "%s pure int 0x%x,0x%x,0x%x,0x%x\n", __FUNCTION__,
-                    arg.clear_color.ui[0],
-                    arg.clear_color.ui[1],
-                    arg.clear_color.ui[2],
-                    arg.clear_color.ui[3]);
+                    clear_color->ui[0],
+                    clear_color->ui[1],
+                    clear_color->ui[2],
+                    clear_color->ui[3]);
 
          for (i = 0; i < scene->fb.nr_cbufs; i++) {
             enum pipe_format format = scene->fb.cbufs[i]->format;
 
             if (util_format_is_pure_sint(format)) {
-               util_format_write_4i(format, arg.clear_color.i, 0, &uc, 0, 0, 0, 1, 1);
+               util_format_write_4i(format, clear_color->i, 0, &uc, 0, 0, 0, 1, 1);
             }
             else {
                assert(util_format_is_pure_uint(format));
-               util_format_write_4ui(format, arg.clear_color.ui, 0, &uc, 0, 0, 0, 1, 1);
+               util_format_write_4ui(format, clear_color->ui, 0, &uc, 0, 0, 0, 1, 1);
             }
 
-            util_fill_box(scene->cbufs[i].map,
-                          format,
-                          scene->cbufs[i].stride,
-                          scene->cbufs[i].layer_stride,
-                          task->x,
-                          task->y,
-                          0,
-                          task->width,
-                          task->height,
-                          scene->fb_max_layer + 1,
-                          &uc);
+            for (s = 0; s < num_samples; s++) {
+               util_fill_box(lp_rast_get_unswizzled_color_tile_pointer(task, i, LP_TEX_USAGE_WRITE_ALL) +
+                             s * scene->cbufs[i].sample_stride,
+                             format,
+                             task->color_strides[i],
+                             scene->cbufs[i].layer_stride,
+                             0,
+                             0,
+                             0,
+                             task->width,
+                             task->height,
+                             scene->fb_max_layer + 1,
+                             &uc);
+            }
          }
       }
       else {
-         uint8_t clear_color[4];
+         uint8_t clear_color_ub[4];
 
          for (i = 0; i < 4; ++i) {
-            clear_color[i] = float_to_ubyte(arg.clear_color.f[i]);
+            clear_color_ub[i] = float_to_ubyte(clear_color->f[i]);
          }
 
          LP_DBG(DEBUG_RAST, "%s 0x%x,0x%x,0x%x,0x%x\n", __FUNCTION__,
-                    clear_color[0],
-                    clear_color[1],
-                    clear_color[2],
-                    clear_color[3]);
+                    clear_color_ub[0],
+                    clear_color_ub[1],
+                    clear_color_ub[2],
+                    clear_color_ub[3]);
 
          for (i = 0; i < scene->fb.nr_cbufs; i++) {
-            util_pack_color(arg.clear_color.f,
+            util_pack_color(clear_color->f,
                             scene->fb.cbufs[i]->format, &uc);
 
-            util_fill_box(scene->cbufs[i].map,
-                          scene->fb.cbufs[i]->format,
-                          scene->cbufs[i].stride,
-                          scene->cbufs[i].layer_stride,
-                          task->x,
-                          task->y,
-                          0,
-                          task->width,
-                          task->height,
-                          scene->fb_max_layer + 1,
-                          &uc);
+            for (s = 0; s < num_samples; s++) {
+               util_fill_box(lp_rast_get_unswizzled_color_tile_pointer(task, i, LP_TEX_USAGE_WRITE_ALL) +
+                             s * scene->cbufs[i].sample_stride,
+                             scene->fb.cbufs[i]->format,
+                             task->color_strides[i],
+                             scene->cbufs[i].layer_stride,
+                             0,
+                             0,
+                             0,
+                             task->width,
+                             task->height,
+                             scene->fb_max_layer + 1,
+                             &uc);
+            }
          }
       }
+
+      if (scene->fb_max_layer == 0)
+         task->ms_compressed = task->ms_color_bufs;
    }
 
    LP_COUNT(nr_color_tile_clear);
 }
 
 
+/**
+ * Clear the rasterizer's current color tile.
+ * This is a bin command called during bin processing.
+ * The clear is only recorded here, see resolve_clear_color().
+ */
+static void
+lp_rast_clear_color(struct lp_rasterizer_task *task,
+                    const union lp_rast_cmd_arg arg)
+{
+   if (task->clear_color_pending)
+      LP_COUNT(nr_color_tile_clear_skipped);
+
+   task->clear_color = arg.clear_color;
+   task->clear_color_pending = TRUE;
+}
+
+
 
 
 /**
@@ -213,7 +456,7 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
    uint32_t clear_mask = (uint32_t) clear_mask64;
    const unsigned height = task->height;
    const unsigned width = task->width;
-   const unsigned dst_stride = scene->zsbuf.stride;
+   unsigned dst_stride;
    uint8_t *dst;
    unsigned i, j;
    unsigned block_size;
@@ -226,14 +469,30 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
     */
 
    if (scene->fb.zsbuf) {
-      unsigned layer;
-      uint8_t *dst_layer = lp_rast_get_unswizzled_depth_tile_pointer(task, LP_TEX_USAGE_READ_WRITE);
+      const unsigned num_layers = scene->fb_max_layer + 1;
+      unsigned plane;
+      enum lp_texture_usage usage;
+      uint8_t *dst_tile;
+
       block_size = util_format_get_blocksize(scene->fb.zsbuf->format);
 
+      /* the old contents are only needed if some bits are kept */
+      if (block_size <= 4 &&
+          clear_mask == (uint32_t) ((1ULL << (block_size * 8)) - 1))
+         usage = LP_TEX_USAGE_WRITE_ALL;
+      else
+         usage = LP_TEX_USAGE_READ_WRITE;
+
+      dst_tile = lp_rast_get_unswizzled_depth_tile_pointer(task, usage);
+      dst_stride = task->depth_stride;
+
       clear_value &= clear_mask;
 
-      for (layer = 0; layer <= scene->fb_max_layer; layer++) {
-         dst = dst_layer;
+      /* every layer of every sample */
+      for (plane = 0; plane < num_layers * scene->nr_samples; plane++) {
+         dst = dst_tile +
+               (plane / num_layers) * scene->zsbuf.sample_stride +
+               (plane % num_layers) * scene->zsbuf.layer_stride;
 
          switch (block_size) {
          case 1:
@@ -306,7 +565,6 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
             assert(0);
             break;
          }
-         dst_layer += scene->zsbuf.layer_stride;
       }
    }
 }
@@ -327,6 +585,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    const struct lp_rast_state *state;
    struct lp_fragment_shader_variant *variant;
    const unsigned tile_x = task->x, tile_y = task->y;
+   uint64_t mask;
    unsigned x, y;
 
    if (inputs->disable) {
@@ -343,6 +602,8 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
+   mask = lp_rast_pixel_mask(task, variant, 0xffff);
+
    /* render the whole 64x64 tile in 4x4 chunks */
    for (y = 0; y < task->height; y += 4){
       for (x = 0; x < task->width; x += 4) {
@@ -354,16 +615,16 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
 
          /* color buffer */
          for (i = 0; i < scene->fb.nr_cbufs; i++){
-            stride[i] = scene->cbufs[i].stride;
             color[i] = lp_rast_get_unswizzled_color_block_pointer(task, i, tile_x + x,
                                                                   tile_y + y, inputs->layer);
+            stride[i] = task->color_strides[i];
          }
 
          /* depth buffer */
          if (scene->zsbuf.map) {
             depth = lp_rast_get_unswizzled_depth_block_pointer(task, tile_x + x,
                                                                tile_y + y, inputs->layer);
-            depth_stride = scene->zsbuf.stride;
+            depth_stride = task->depth_stride;
          }
 
          /* run shader on 4x4 block */
@@ -376,10 +637,12 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
                                             GET_DADY(inputs),
                                             color,
                                             depth,
-                                            0xffff,
+                                            mask,
                                             &task->thread_data,
                                             stride,
-                                            depth_stride);
+                                            depth_stride,
+                                            task->color_sample_strides,
+                                            task->depth_sample_stride);
          END_JIT_CALL();
       }
    }
@@ -402,21 +665,42 @@ lp_rast_shade_tile_opaque(struct lp_rasterizer_task *task,
       return;
    }
 
+   /* Opaque shaders write all channels of all pixels of the tile, so the
+    * tile buffers needn't be loaded first.  Tile buffers are only used
+    * when there is a single layer.
+    */
+   if (task->use_tile_buffer && !arg.shade_tile->disable) {
+      unsigned i;
+
+      for (i = 0; i < task->scene->fb.nr_cbufs; i++)
+         lp_rast_get_unswizzled_color_tile_pointer(task, i,
+                                                   LP_TEX_USAGE_WRITE_ALL);
+   }
+
+   /* All samples of the tile end up with the same colors; the tile
+    * needn't be decompressed first, and is compressed afterwards.
+    */
+   if (task->ms_color_bufs &&
+       !arg.shade_tile->disable &&
+       task->scene->fb_max_layer == 0 &&
+       task->state->variant->sample_invariant)
+      task->ms_compressed = task->ms_color_bufs;
+
    lp_rast_shade_tile(task, arg);
 }
 
 
 /**
  * Compute shading for a 4x4 block of pixels inside a triangle.
- * This is a bin command called during bin processing.
  * \param x  X position of quad in window coords
  * \param y  Y position of quad in window coords
+ * \param mask  coverage, 16 bits per sample
  */
-void
-lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
-                         const struct lp_rast_shader_inputs *inputs,
-                         unsigned x, unsigned y,
-                         unsigned mask)
+static void
+shade_quads(struct lp_rasterizer_task *task,
+            const struct lp_rast_shader_inputs *inputs,
+            unsigned x, unsigned y,
+            uint64_t mask)
 {
    const struct lp_rast_state *state = task->state;
    struct lp_fragment_shader_variant *variant = state->variant;
@@ -440,14 +724,14 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
 
    /* color buffer */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
-      stride[i] = scene->cbufs[i].stride;
       color[i] = lp_rast_get_unswizzled_color_block_pointer(task, i, x, y, inputs->layer);
+      stride[i] = task->color_strides[i];
    }
 
    /* depth buffer */
    if (scene->zsbuf.map) {
-      depth_stride = scene->zsbuf.stride;
       depth = lp_rast_get_unswizzled_depth_block_pointer(task, x, y, inputs->layer);
+      depth_stride = task->depth_stride;
    }
 
    assert(lp_check_alignment(state->jit_context.u8_blend_color, 16));
@@ -474,12 +758,46 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                                             mask,
                                             &task->thread_data,
                                             stride,
-                                            depth_stride);
+                                            depth_stride,
+                                            task->color_sample_strides,
+                                            task->depth_sample_stride);
       END_JIT_CALL();
    }
 }
 
 
+/**
+ * Compute shading for a 4x4 block of pixels inside a triangle, where
+ * 'mask' is the coverage of all samples of each pixel.
+ */
+void
+lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
+                         const struct lp_rast_shader_inputs *inputs,
+                         unsigned x, unsigned y,
+                         unsigned mask)
+{
+   shade_quads(task, inputs, x, y,
+               lp_rast_pixel_mask(task, task->state->variant, mask));
+}
+
+
+/**
+ * Compute shading for a 4x4 block of pixels inside a triangle, with
+ * coverage computed per sample (16 bits each).
+ */
+void
+lp_rast_shade_quads_samples(struct lp_rasterizer_task *task,
+                            const struct lp_rast_shader_inputs *inputs,
+                            unsigned x, unsigned y,
+                            uint64_t mask)
+{
+   if (task->ms_compressed)
+      lp_rast_ms_decompress(task);
+
+   shade_quads(task, inputs, x, y, mask);
+}
+
+
 
 /**
  * Begin a new occlusion query.
@@ -557,6 +875,16 @@ lp_rast_tile_end(struct lp_rasterizer_task *task)
 {
    unsigned i;
 
+   /* the tile was cleared but not drawn to */
+   if (task->clear_color_pending)
+      resolve_clear_color(task);
+
+   if (task->use_tile_buffer)
+      lp_rast_tile_write_back(task);
+
+   if (task->ms_color_bufs)
+      ms_tile_end(task);
+
    for (i = 0; i < task->scene->num_active_queries; ++i) {
       lp_rast_end_query(task, lp_rast_arg_query(task->scene->active_queries[i]));
    }
@@ -591,6 +919,43 @@ static lp_rast_cmd_func dispatch[LP_RAST_OP_MAX] =
 };
 
 
+/**
+ * Deal with a pending color clear before executing a command: write it
+ * if the command touches the color buffers, unless the command overwrites
+ * every pixel of the tile.
+ */
+static INLINE void
+prepare_color_tile(struct lp_rasterizer_task *task,
+                   unsigned cmd,
+                   const union lp_rast_cmd_arg arg)
+{
+   switch (cmd) {
+   case LP_RAST_OP_CLEAR_COLOR:
+   case LP_RAST_OP_CLEAR_ZSTENCIL:
+   case LP_RAST_OP_BEGIN_QUERY:
+   case LP_RAST_OP_END_QUERY:
+   case LP_RAST_OP_SET_STATE:
+      break;
+
+   case LP_RAST_OP_SHADE_TILE_OPAQUE:
+      /* Opaque shaders write all channels of all pixels, but only of the
+       * layer being rendered, while clears cover all layers.
+       */
+      if (!arg.shade_tile->disable &&
+          task->scene->fb_max_layer == 0) {
+         task->clear_color_pending = FALSE;
+         LP_COUNT(nr_color_tile_clear_skipped);
+         break;
+      }
+      /* fallthrough */
+
+   default:
+      resolve_clear_color(task);
+      break;
+   }
+}
+
+
 static void
 do_rasterize_bin(struct lp_rasterizer_task *task,
                  const struct cmd_bin *bin,
@@ -604,6 +969,9 @@ do_rasterize_bin(struct lp_rasterizer_task *task,
 
    for (block = bin->head; block; block = block->next) {
       for (k = 0; k < block->count; k++) {
+         if (task->clear_color_pending)
+            prepare_color_tile(task, block->cmd[k], block->arg[k]);
+
          dispatch[block->cmd[k]]( task, block->arg[k] );
       }
    }
@@ -664,6 +1032,9 @@ rasterize_scene(struct lp_rasterizer_task *task,
    task->scene = scene;
 
    if (!task->rast->no_rast && !scene->discard) {
+      if (task->rast->tile_buffers)
+         lp_rast_setup_tile_buffers(task);
+
       /* loop over scene bins, rasterize each */
       {
          struct cmd_bin *bin;
@@ -678,7 +1049,8 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 
 
-   if (scene->fence) {
+   /* A partially rasterized scene will be rasterized again */
+   if (scene->fence && !scene->partial) {
       lp_fence_signal(scene->fence);
    }
 
@@ -739,6 +1111,38 @@ lp_rast_finish( struct lp_rasterizer *rast )
 }
 
 
+/**
+ * Run a job on all the rasterizer threads and wait for it to complete.
+ * No scene may be in flight.
+ */
+void
+lp_rast_run_job( struct lp_rasterizer *rast,
+                 lp_rast_job_func func,
+                 void *data )
+{
+   if (rast->num_threads == 0) {
+      func(data, 0);
+   }
+   else {
+      unsigned i;
+
+      rast->job_func = func;
+      rast->job_data = data;
+
+      for (i = 0; i < rast->num_threads; i++) {
+         pipe_semaphore_signal(&rast->tasks[i].work_ready);
+      }
+
+      for (i = 0; i < rast->num_threads; i++) {
+         pipe_semaphore_wait(&rast->tasks[i].work_done);
+      }
+
+      rast->job_func = NULL;
+      rast->job_data = NULL;
+   }
+}
+
+
 /**
  * This is the thread's main entrypoint.
  * It's a simple loop:
@@ -767,6 +1171,12 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
       if (rast->exit_flag)
          break;
 
+      if (rast->job_func) {
+         rast->job_func(rast->job_data, task->thread_index);
+         pipe_semaphore_signal(&task->work_done);
+         continue;
+      }
+
       if (task->thread_index == 0) {
          /* thread[0]:
           *  - get next scene to rasterize
@@ -858,6 +1268,8 @@ lp_rast_create( unsigned num_threads )
 
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
 
+   rast->tile_buffers = debug_get_bool_option("LP_TILE_BUFFERS", FALSE);
+
    create_rast_threads(rast);
 
    /* for synchronizing rasterization threads */
@@ -905,6 +1317,10 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
 
    lp_scene_queue_destroy(rast->full_scenes);
 
+   for (i = 0; i < Elements(rast->tasks); i++) {
+      align_free(rast->tasks[i].tile_buffer);
+   }
+
    FREE(rast);
 }
 
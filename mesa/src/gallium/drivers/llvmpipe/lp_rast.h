@@ -86,7 +86,8 @@ struct lp_rast_shader_inputs {
    unsigned frontfacing:1;      /** True for front-facing */
    unsigned disable:1;          /** Partially binned, disable this command */
    unsigned opaque:1;           /** Is opaque */
-   unsigned pad0:29;            /* wasted space */
+   unsigned multisample:1;      /** Compute coverage per sample */
+   unsigned pad0:28;            /* wasted space */
    unsigned stride;             /* how much to advance data between a0, dadx, dady */
    unsigned layer;              /* the layer to render to (from gs, already clamped) */
    unsigned pad2;               /* wasted space */
@@ -107,6 +108,29 @@ struct lp_rast_plane {
    int eo;
 };
 
+
+/**
+ * Sample positions of multisampled surfaces, in FIXED_ONE units relative
+ * to the pixel center, and the largest absolute value among them.
+ */
+extern const int lp_sample_pos[LP_MAX_SAMPLES][2];
+
+#define LP_SAMPLE_POS_MAX 6
+
+
+/**
+ * How much further than at the pixel center the edge function of a
+ * plane can get at any sample position.  Trivial accept/reject tests
+ * widen their thresholds by this much when rasterizing per sample.
+ */
+static INLINE int
+lp_rast_ms_margin(const struct lp_rast_plane *plane)
+{
+   return ((abs(plane->dcdx) + abs(plane->dcdy)) * LP_SAMPLE_POS_MAX)
+      >> FIXED_ORDER;
+}
+
+
 /**
  * Rasterization information for a triangle known to be in this bin,
  * plus inputs to run the shader:
@@ -150,6 +174,19 @@ void
 lp_rast_finish( struct lp_rasterizer *rast );
 
 
+/**
+ * Work run by the rasterizer threads instead of a scene, e.g. compute
+ * work groups.  Called once on every thread, or once on the calling
+ * thread when there are no rasterizer threads.
+ */
+typedef void (*lp_rast_job_func)(void *data, unsigned thread_index);
+
+void
+lp_rast_run_job( struct lp_rasterizer *rast,
+                 lp_rast_job_func func,
+                 void *data );
+
+
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
    struct {
@@ -30,6 +30,7 @@
 
 #include "os/os_thread.h"
 #include "util/u_format.h"
+#include "util/u_surface.h"
 #include "gallivm/lp_bld_debug.h"
 #include "lp_memory.h"
 #include "lp_rast.h"
@@ -37,6 +38,7 @@
 #include "lp_state.h"
 #include "lp_texture.h"
 #include "lp_limits.h"
+#include "lp_perf.h"
 
 
 #define TILE_VECTOR_HEIGHT 4
@@ -91,6 +93,45 @@ struct lp_rasterizer_task
    uint8_t *color_tiles[PIPE_MAX_COLOR_BUFS];
    uint8_t *depth_tile;
 
+   /** Row pitch of color_tiles[] and depth_tile */
+   unsigned color_strides[PIPE_MAX_COLOR_BUFS];
+   unsigned depth_stride;
+
+   /**
+    * Thread-local tile buffers (LP_TILE_BUFFERS option).  When in use the
+    * tile is rendered there, and written back to the framebuffer once at
+    * the end of the bin.  The buffer is sized for the surfaces bound to
+    * the current scene, and only grows.
+    */
+   uint8_t *tile_buffer;
+   unsigned tile_buffer_size;
+   uint8_t *color_tile_buffers[PIPE_MAX_COLOR_BUFS];
+   uint8_t *depth_tile_buffer;
+   boolean use_tile_buffer;
+
+   /**
+    * Color clear of the current tile which hasn't been written yet.
+    * It's written before the first command touching the color buffers,
+    * or dropped if that command overwrites the whole tile anyway.
+    * A pending clear never outlives the tile's bin: it's written at the
+    * end of the bin at the latest, so other scenes, transfers and
+    * samplers always see cleared memory.
+    */
+   boolean clear_color_pending;
+   union pipe_color_union clear_color;
+
+   /**
+    * Multisampling: mask of the color buffers which are multisampled, and
+    * of those whose current tile is compressed, i.e. only holds valid
+    * data in the sample 0 plane (see llvmpipe_resource::ms_compressed).
+    */
+   unsigned ms_color_bufs;
+   unsigned ms_compressed;
+
+   /** Sample plane strides of the color buffers and depth buffer */
+   unsigned color_sample_strides[PIPE_MAX_COLOR_BUFS];
+   unsigned depth_sample_stride;
+
    /** "back" pointer */
    struct lp_rasterizer *rast;
 
@@ -115,6 +156,7 @@ struct lp_rasterizer
 {
    boolean exit_flag;
    boolean no_rast;  /**< For debugging/profiling */
+   boolean tile_buffers;  /**< LP_TILE_BUFFERS option */
 
    /** The incoming queue of scenes ready to rasterize */
    struct lp_scene_queue *full_scenes;
@@ -130,6 +172,10 @@ struct lp_rasterizer
 
    /** For synchronizing the rasterization threads */
    pipe_barrier barrier;
+
+   /** Job to run instead of the next scene, see lp_rast_run_job() */
+   lp_rast_job_func job_func;
+   void *job_data;
 };
 
 
@@ -139,10 +185,45 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                          unsigned x, unsigned y,
                          unsigned mask);
 
+void
+lp_rast_shade_quads_samples(struct lp_rasterizer_task *task,
+                            const struct lp_rast_shader_inputs *inputs,
+                            unsigned x, unsigned y,
+                            uint64_t mask);
+
+void
+lp_rast_ms_decompress(struct lp_rasterizer_task *task);
+
+
+/**
+ * Return the coverage mask to run the shader with, for a block whose
+ * pixels in 'mask' are covered at all of their samples.
+ * While every multisampled color tile is compressed and the shader
+ * produces the same results for all samples of a pixel, writing sample 0
+ * is enough and keeps the tiles compressed.  Otherwise the tiles are
+ * decompressed and the mask is replicated to all samples.
+ */
+static INLINE uint64_t
+lp_rast_pixel_mask(struct lp_rasterizer_task *task,
+                   const struct lp_fragment_shader_variant *variant,
+                   unsigned mask)
+{
+   if (task->ms_compressed) {
+      if (task->ms_compressed == task->ms_color_bufs &&
+          variant->sample_invariant)
+         return mask;
+      lp_rast_ms_decompress(task);
+   }
+   return mask * 0x0001000100010001ULL;
+}
+
 
 
 /**
- * Get pointer to the unswizzled color tile
+ * Get pointer to the unswizzled color tile.
+ * When rendering to tile buffers, the tile's contents are loaded into the
+ * tile buffer unless usage is LP_TEX_USAGE_WRITE_ALL, in which case the
+ * caller must overwrite the whole tile.
  */
 static INLINE uint8_t *
 lp_rast_get_unswizzled_color_tile_pointer(struct lp_rasterizer_task *task,
@@ -159,10 +240,28 @@ lp_rast_get_unswizzled_color_tile_pointer(struct lp_rasterizer_task *task,
 
    if (!task->color_tiles[buf]) {
       struct pipe_surface *cbuf = scene->fb.cbufs[buf];
+      uint8_t *map;
       assert(cbuf);
 
       format_bytes = util_format_get_blocksize(cbuf->format);
-      task->color_tiles[buf] = scene->cbufs[buf].map + scene->cbufs[buf].stride * task->y + format_bytes * task->x;
+      map = scene->cbufs[buf].map + scene->cbufs[buf].stride * task->y + format_bytes * task->x;
+
+      if (task->use_tile_buffer) {
+         task->color_tiles[buf] = task->color_tile_buffers[buf];
+         task->color_strides[buf] = TILE_SIZE * format_bytes;
+
+         if (usage != LP_TEX_USAGE_WRITE_ALL) {
+            util_copy_rect(task->color_tiles[buf], cbuf->format,
+                           task->color_strides[buf], 0, 0,
+                           task->width, task->height,
+                           map, scene->cbufs[buf].stride, 0, 0);
+            LP_COUNT(nr_tile_buffer_loads);
+         }
+      }
+      else {
+         task->color_tiles[buf] = map;
+         task->color_strides[buf] = scene->cbufs[buf].stride;
+      }
    }
 
    return task->color_tiles[buf];
@@ -170,7 +269,8 @@ lp_rast_get_unswizzled_color_tile_pointer(struct lp_rasterizer_task *task,
 
 
 /**
- * Get pointer to the unswizzled depth tile
+ * Get pointer to the unswizzled depth tile.
+ * See lp_rast_get_unswizzled_color_tile_pointer() about usage.
  */
 static INLINE uint8_t *
 lp_rast_get_unswizzled_depth_tile_pointer(struct lp_rasterizer_task *task,
@@ -186,10 +286,28 @@ lp_rast_get_unswizzled_depth_tile_pointer(struct lp_rasterizer_task *task,
 
    if (!task->depth_tile) {
       struct pipe_surface *dbuf = scene->fb.zsbuf;
+      uint8_t *map;
       assert(dbuf);
 
       format_bytes = util_format_get_blocksize(dbuf->format);
-      task->depth_tile = scene->zsbuf.map + scene->zsbuf.stride * task->y + format_bytes * task->x;
+      map = scene->zsbuf.map + scene->zsbuf.stride * task->y + format_bytes * task->x;
+
+      if (task->use_tile_buffer) {
+         task->depth_tile = task->depth_tile_buffer;
+         task->depth_stride = TILE_SIZE * format_bytes;
+
+         if (usage != LP_TEX_USAGE_WRITE_ALL) {
+            util_copy_rect(task->depth_tile, dbuf->format,
+                           task->depth_stride, 0, 0,
+                           task->width, task->height,
+                           map, scene->zsbuf.stride, 0, 0);
+            LP_COUNT(nr_tile_buffer_loads);
+         }
+      }
+      else {
+         task->depth_tile = map;
+         task->depth_stride = scene->zsbuf.stride;
+      }
    }
 
    return task->depth_tile;
@@ -221,11 +339,12 @@ lp_rast_get_unswizzled_color_block_pointer(struct lp_rasterizer_task *task,
 
    px = x % TILE_SIZE;
    py = y % TILE_SIZE;
-   pixel_offset = px * format_bytes + py * task->scene->cbufs[buf].stride;
+   pixel_offset = px * format_bytes + py * task->color_strides[buf];
 
    color = color + pixel_offset;
 
    if (layer) {
+      assert(!task->use_tile_buffer);
       color += layer * task->scene->cbufs[buf].layer_stride;
    }
 
@@ -257,11 +376,12 @@ lp_rast_get_unswizzled_depth_block_pointer(struct lp_rasterizer_task *task,
 
    px = x % TILE_SIZE;
    py = y % TILE_SIZE;
-   pixel_offset = px * format_bytes + py * task->scene->zsbuf.stride;
+   pixel_offset = px * format_bytes + py * task->depth_stride;
 
    depth = depth + pixel_offset;
 
    if (layer) {
+      assert(!task->use_tile_buffer);
       depth += layer * task->scene->zsbuf.layer_stride;
    }
 
@@ -288,17 +408,20 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
    unsigned stride[PIPE_MAX_COLOR_BUFS];
    uint8_t *depth = NULL;
    unsigned depth_stride = 0;
+   uint64_t mask;
    unsigned i;
 
+   mask = lp_rast_pixel_mask(task, variant, 0xffff);
+
    /* color buffer */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
-      stride[i] = scene->cbufs[i].stride;
       color[i] = lp_rast_get_unswizzled_color_block_pointer(task, i, x, y, inputs->layer);
+      stride[i] = task->color_strides[i];
    }
 
    if (scene->zsbuf.map) {
       depth = lp_rast_get_unswizzled_depth_block_pointer(task, x, y, inputs->layer);
-      depth_stride = scene->zsbuf.stride;
+      depth_stride = task->depth_stride;
    }
 
    /*
@@ -320,10 +443,12 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
                                          GET_DADY(inputs),
                                          color,
                                          depth,
-                                         0xffff,
+                                         mask,
                                          &task->thread_data,
                                          stride,
-                                         depth_stride);
+                                         depth_stride,
+                                         task->color_sample_strides,
+                                         task->depth_sample_stride);
       END_JIT_CALL();
    }
 }
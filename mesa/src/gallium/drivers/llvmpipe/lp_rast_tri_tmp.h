@@ -49,10 +49,42 @@ TAG(do_block_4)(struct lp_rasterizer_task *task,
    unsigned mask = 0xffff;
    int j;
 
-   for (j = 0; j < NR_PLANES; j++) {
-      mask &= ~build_mask_linear(c[j] - 1, 
-				 -plane[j].dcdx,
-				 plane[j].dcdy);
+   if (tri->inputs.multisample) {
+      unsigned smask[LP_MAX_SAMPLES];
+      unsigned s;
+
+      /* Evaluate the edge functions at each sample position instead */
+      for (s = 0; s < LP_MAX_SAMPLES; s++) {
+         smask[s] = 0xffff;
+         for (j = 0; j < NR_PLANES; j++) {
+            const int dc = (-plane[j].dcdx * lp_sample_pos[s][0] +
+                            plane[j].dcdy * lp_sample_pos[s][1]) / FIXED_ONE;
+
+            smask[s] &= ~build_mask_linear(c[j] - 1 + dc,
+                                           -plane[j].dcdx,
+                                           plane[j].dcdy);
+         }
+      }
+
+      if (smask[0] == smask[1] && smask[0] == smask[2] && smask[0] == smask[3]) {
+         mask = smask[0];
+      }
+      else {
+         uint64_t ms_mask = 0;
+
+         for (s = 0; s < LP_MAX_SAMPLES; s++)
+            ms_mask |= (uint64_t) smask[s] << (16 * s);
+
+         lp_rast_shade_quads_samples(task, &tri->inputs, x, y, ms_mask);
+         return;
+      }
+   }
+   else {
+      for (j = 0; j < NR_PLANES; j++) {
+         mask &= ~build_mask_linear(c[j] - 1, 
+                                    -plane[j].dcdx,
+                                    plane[j].dcdy);
+      }
    }
 
    /* Now pass to the shader:
@@ -81,9 +113,10 @@ TAG(do_block_16)(struct lp_rasterizer_task *task,
    for (j = 0; j < NR_PLANES; j++) {
       const int dcdx = -plane[j].dcdx * 4;
       const int dcdy = plane[j].dcdy * 4;
-      const int cox = plane[j].eo * 4;
+      const int margin = tri->inputs.multisample ? lp_rast_ms_margin(&plane[j]) : 0;
+      const int cox = plane[j].eo * 4 + margin;
       const int ei = plane[j].dcdy - plane[j].dcdx - plane[j].eo;
-      const int cio = ei * 4 - 1;
+      const int cio = ei * 4 - 1 - margin;
 
       build_masks(c[j] + cox,
 		  cio - cox,
@@ -181,9 +214,10 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
       {
 	 const int dcdx = -plane[j].dcdx * 16;
 	 const int dcdy = plane[j].dcdy * 16;
-	 const int cox = plane[j].eo * 16;
+         const int margin = tri->inputs.multisample ? lp_rast_ms_margin(&plane[j]) : 0;
+	 const int cox = plane[j].eo * 16 + margin;
          const int ei = plane[j].dcdy - plane[j].dcdx - plane[j].eo;
-         const int cio = ei * 16 - 1;
+         const int cio = ei * 16 - 1 - margin;
 
 	 build_masks(c[j] + cox,
 		     cio - cox,
@@ -31,9 +31,12 @@
 #include "util/u_inlines.h"
 #include "util/u_simple_list.h"
 #include "util/u_format.h"
+#include "util/u_atomic.h"
 #include "lp_scene.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
+#include "lp_screen.h"
+#include "lp_texture.h"
 
 
 #define RESOURCE_REF_SZ 32
@@ -45,6 +48,21 @@ struct resource_ref {
    struct resource_ref *next;
 };
 
+/** Initial number of resource hash set entries */
+#define RESOURCE_HASH_MIN_SIZE 64
+
+/** Resource hash set entry */
+struct resource_hash_entry {
+   const struct pipe_resource *resource;
+   unsigned usage;   /**< LP_REFERENCED_FOR_x flags */
+};
+
+struct retired_storage {
+   void *data;
+   unsigned size;
+   struct retired_storage *next;
+};
+
 
 /**
  * Create a new scene object.
@@ -62,6 +80,15 @@ lp_scene_create( struct pipe_context *pipe )
    scene->data.head =
       CALLOC_STRUCT(data_block);
 
+   scene->resource_hash = CALLOC(RESOURCE_HASH_MIN_SIZE,
+                                 sizeof *scene->resource_hash);
+   if (!scene->resource_hash) {
+      FREE(scene->data.head);
+      FREE(scene);
+      return NULL;
+   }
+   scene->resource_hash_size = RESOURCE_HASH_MIN_SIZE;
+
    pipe_mutex_init(scene->mutex);
 
 #ifdef DEBUG
@@ -93,6 +120,7 @@ lp_scene_destroy(struct lp_scene *scene)
    pipe_mutex_destroy(scene->mutex);
    assert(scene->data.head->next == NULL);
    FREE(scene->data.head);
+   FREE(scene->resource_hash);
    FREE(scene);
 }
 
@@ -168,6 +196,19 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
                                                      cbuf->u.tex.level,
                                                      cbuf->u.tex.first_layer,
                                                      LP_TEX_USAGE_READ_WRITE);
+
+         if (cbuf->texture->nr_samples > 1) {
+            struct llvmpipe_resource *lpr = llvmpipe_resource(cbuf->texture);
+            scene->cbufs[i].sample_stride = lpr->sample_stride;
+            scene->cbufs[i].ms_compressed =
+               llvmpipe_resource_ms_tile(lpr, cbuf->u.tex.first_layer, 0, 0);
+            scene->cbufs[i].ms_stride = lpr->ms_tiles_x;
+            scene->cbufs[i].ms_layer_stride = lpr->ms_tiles_x * lpr->ms_tiles_y;
+         }
+         else {
+            scene->cbufs[i].sample_stride = 0;
+            scene->cbufs[i].ms_compressed = NULL;
+         }
       }
       else {
          struct llvmpipe_resource *lpr = llvmpipe_resource(cbuf->texture);
@@ -177,6 +218,8 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
 
          scene->cbufs[i].map = lpr->data;
          scene->cbufs[i].map += cbuf->u.buf.first_element * pixstride;
+         scene->cbufs[i].sample_stride = 0;
+         scene->cbufs[i].ms_compressed = NULL;
       }
    }
 
@@ -190,21 +233,21 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
                                                zsbuf->u.tex.level,
                                                zsbuf->u.tex.first_layer,
                                                LP_TEX_USAGE_READ_WRITE);
+      scene->zsbuf.sample_stride =
+         llvmpipe_resource(zsbuf->texture)->sample_stride;
    }
 
    scene->fb_max_layer = max_layer;
+   scene->nr_samples = util_framebuffer_get_num_samples(fb);
 }
 
 
 
 
-/**
- * Free all the temporary data in a scene.
- */
-void
-lp_scene_end_rasterization(struct lp_scene *scene )
+static void
+unmap_framebuffer(struct lp_scene *scene)
 {
-   int i, j;
+   int i;
 
    /* Unmap color buffers */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
@@ -227,6 +270,18 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                               zsbuf->u.tex.first_layer);
       scene->zsbuf.map = NULL;
    }
+}
+
+
+/**
+ * Free all the temporary data in a scene.
+ */
+void
+lp_scene_end_rasterization(struct lp_scene *scene )
+{
+   int i, j;
+
+   unmap_framebuffer(scene);
 
    /* Reset all command lists:
     */
@@ -260,6 +315,7 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                             ref->resource[i]->height0,
                             llvmpipe_resource_size(ref->resource[i]));
             j++;
+            p_atomic_dec(&llvmpipe_resource(ref->resource[i])->scene_refs);
             pipe_resource_reference(&ref->resource[i], NULL);
          }
       }
@@ -269,6 +325,16 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                       j, scene->resource_reference_size);
    }
 
+   /* Nothing can read the old storage of renamed buffers anymore:
+    */
+   {
+      struct llvmpipe_screen *screen = llvmpipe_screen(scene->pipe->screen);
+      struct retired_storage *ret;
+
+      for (ret = scene->retired_storage; ret; ret = ret->next)
+         llvmpipe_buffer_storage_free(screen, ret->data, ret->size);
+   }
+
    /* Free all scene data blocks:
     */
    {
@@ -286,7 +352,14 @@ lp_scene_end_rasterization(struct lp_scene *scene )
 
    lp_fence_reference(&scene->fence, NULL);
 
+   if (scene->resource_count) {
+      memset(scene->resource_hash, 0,
+             scene->resource_hash_size * sizeof *scene->resource_hash);
+      scene->resource_count = 0;
+   }
+
    scene->resources = NULL;
+   scene->retired_storage = NULL;
    scene->scene_size = 0;
    scene->resource_reference_size = 0;
 
@@ -301,6 +374,51 @@ lp_scene_end_rasterization(struct lp_scene *scene )
 
 
 
+/**
+ * Restrict the next rasterization of the scene to the given bins, which
+ * are emptied afterwards while the other bins keep their commands.
+ */
+void
+lp_scene_set_partial(struct lp_scene *scene, const struct u_rect *bins)
+{
+   assert(bins->x0 >= 0 && bins->x1 < (int) scene->tiles_x);
+   assert(bins->y0 >= 0 && bins->y1 < (int) scene->tiles_y);
+
+   scene->bins = *bins;
+   scene->partial = TRUE;
+}
+
+
+/**
+ * Finish a partial rasterization: the rasterized bins are emptied, so that
+ * their commands don't execute twice, and binning can go on.
+ */
+void
+lp_scene_end_partial_rasterization(struct lp_scene *scene)
+{
+   int x, y;
+
+   assert(scene->partial);
+
+   unmap_framebuffer(scene);
+
+   for (y = scene->bins.y0; y <= scene->bins.y1; y++) {
+      for (x = scene->bins.x0; x <= scene->bins.x1; x++) {
+         struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
+         bin->head = NULL;
+         bin->tail = NULL;
+         bin->last_state = NULL;
+      }
+   }
+
+   scene->bins.x0 = 0;
+   scene->bins.y0 = 0;
+   scene->bins.x1 = scene->tiles_x - 1;
+   scene->bins.y1 = scene->tiles_y - 1;
+   scene->partial = FALSE;
+}
+
+
 struct cmd_block *
 lp_scene_new_cmd_block( struct lp_scene *scene,
                         struct cmd_bin *bin )
@@ -364,52 +482,101 @@ lp_scene_data_size( const struct lp_scene *scene )
 
 
 
+/**
+ * Find the hash set entry of a resource, or the empty entry where it
+ * belongs.  The set is never full.
+ */
+static struct resource_hash_entry *
+find_resource_entry(const struct lp_scene *scene,
+                    const struct pipe_resource *resource)
+{
+   unsigned mask = scene->resource_hash_size - 1;
+   unsigned i = (unsigned)(((uintptr_t)resource >> 4) * 2654435761u) & mask;
+
+   while (scene->resource_hash[i].resource &&
+          scene->resource_hash[i].resource != resource)
+      i = (i + 1) & mask;
+
+   return &scene->resource_hash[i];
+}
+
+
+/**
+ * Double the size of the resource hash set.
+ */
+static boolean
+grow_resource_hash(struct lp_scene *scene)
+{
+   struct resource_hash_entry *old_hash = scene->resource_hash;
+   unsigned old_size = scene->resource_hash_size;
+   unsigned i;
+
+   scene->resource_hash = CALLOC(old_size * 2, sizeof *scene->resource_hash);
+   if (!scene->resource_hash) {
+      scene->resource_hash = old_hash;
+      return FALSE;
+   }
+   scene->resource_hash_size = old_size * 2;
+
+   for (i = 0; i < old_size; i++) {
+      if (old_hash[i].resource)
+         *find_resource_entry(scene, old_hash[i].resource) = old_hash[i];
+   }
+
+   FREE(old_hash);
+   return TRUE;
+}
+
+
 /**
  * Add a reference to a resource by the scene.
+ * \param usage  LP_REFERENCED_FOR_READ and/or LP_REFERENCED_FOR_WRITE
  */
 boolean
 lp_scene_add_resource_reference(struct lp_scene *scene,
                                 struct pipe_resource *resource,
+                                unsigned usage,
                                 boolean initializing_scene)
 {
-   struct resource_ref *ref, **last = &scene->resources;
-   int i;
+   struct resource_hash_entry *entry;
+   struct resource_ref *ref = scene->resources;
 
-   /* Look at existing resource blocks:
-    */
-   for (ref = scene->resources; ref; ref = ref->next) {
-      last = &ref->next;
+   entry = find_resource_entry(scene, resource);
+   if (entry->resource) {
+      entry->usage |= usage;
+      return TRUE;
+   }
 
-      /* Search for this resource:
-       */
-      for (i = 0; i < ref->count; i++)
-         if (ref->resource[i] == resource)
-            return TRUE;
-
-      if (ref->count < RESOURCE_REF_SZ) {
-         /* If the block is half-empty, then append the reference here.
-          */
-         break;
-      }
+   /* Keep the set at most half full.
+    */
+   if ((scene->resource_count + 1) * 2 > scene->resource_hash_size) {
+      if (!grow_resource_hash(scene))
+         return FALSE;
+      entry = find_resource_entry(scene, resource);
    }
 
-   /* Create a new block if no half-empty block was found.
+   /* Start a new reference block if the newest one is full.
     */
-   if (!ref) {
-      assert(*last == NULL);
-      *last = lp_scene_alloc(scene, sizeof *ref);
-      if (*last == NULL)
+   if (!ref || ref->count == RESOURCE_REF_SZ) {
+      ref = lp_scene_alloc(scene, sizeof *ref);
+      if (ref == NULL)
           return FALSE;
 
-      ref = *last;
       memset(ref, 0, sizeof *ref);
+      ref->next = scene->resources;
+      scene->resources = ref;
    }
 
    /* Append the reference to the reference block.
     */
    pipe_resource_reference(&ref->resource[ref->count++], resource);
+   p_atomic_inc(&llvmpipe_resource(resource)->scene_refs);
    scene->resource_reference_size += llvmpipe_resource_size(resource);
 
+   entry->resource = resource;
+   entry->usage = usage;
+   scene->resource_count++;
+
    /* Heuristic to advise scene flushes.  This isn't helpful in the
     * initial setup of the scene, but after that point flush on the
     * next resource added which exceeds 64MB in referenced texture
@@ -424,22 +591,37 @@ lp_scene_add_resource_reference(struct lp_scene *scene,
 
 
 /**
- * Does this scene have a reference to the given resource?
+ * How does this scene use the given resource?
+ * \return LP_REFERENCED_FOR_x flags, or LP_UNREFERENCED
  */
-boolean
+unsigned
 lp_scene_is_resource_referenced(const struct lp_scene *scene,
                                 const struct pipe_resource *resource)
 {
-   const struct resource_ref *ref;
-   int i;
+   if (!scene->resource_count)
+      return LP_UNREFERENCED;
 
-   for (ref = scene->resources; ref; ref = ref->next) {
-      for (i = 0; i < ref->count; i++)
-         if (ref->resource[i] == resource)
-            return TRUE;
-   }
+   return find_resource_entry(scene, resource)->usage;
+}
+
+
+/**
+ * Hand the old storage of a renamed buffer to the scene, which frees it
+ * once it has been rasterized.
+ */
+boolean
+lp_scene_retire_storage(struct lp_scene *scene, void *data, unsigned size)
+{
+   struct retired_storage *ret = lp_scene_alloc(scene, sizeof *ret);
+
+   if (!ret)
+      return FALSE;
 
-   return FALSE;
+   ret->data = data;
+   ret->size = size;
+   ret->next = scene->retired_storage;
+   scene->retired_storage = ret;
+   return TRUE;
 }
 
 
@@ -450,11 +632,11 @@ static boolean
 next_bin(struct lp_scene *scene)
 {
    scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
+   if (scene->curr_x > scene->bins.x1) {
+      scene->curr_x = scene->bins.x0;
       scene->curr_y++;
    }
-   if (scene->curr_y >= scene->tiles_y) {
+   if (scene->curr_y > scene->bins.y1) {
       /* no more bins */
       return FALSE;
    }
@@ -484,8 +666,8 @@ lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
 
    if (scene->curr_x < 0) {
       /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
+      scene->curr_x = scene->bins.x0;
+      scene->curr_y = scene->bins.y0;
    }
    else if (!next_bin(scene)) {
       /* no more bins left */
@@ -516,6 +698,12 @@ void lp_scene_begin_binning( struct lp_scene *scene,
 
    assert(scene->tiles_x <= TILES_X);
    assert(scene->tiles_y <= TILES_Y);
+
+   scene->bins.x0 = 0;
+   scene->bins.y0 = 0;
+   scene->bins.x1 = scene->tiles_x - 1;
+   scene->bins.y1 = scene->tiles_y - 1;
+   scene->partial = FALSE;
 }
 
 
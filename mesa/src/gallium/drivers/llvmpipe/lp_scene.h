@@ -36,6 +36,7 @@
 #define LP_SCENE_H
 
 #include "os/os_thread.h"
+#include "util/u_rect.h"
 #include "lp_rast.h"
 #include "lp_debug.h"
 
@@ -116,6 +117,8 @@ struct data_block_list {
 };
 
 struct resource_ref;
+struct resource_hash_entry;
+struct retired_storage;
 
 /**
  * All bins and bin data are contained here.
@@ -142,17 +145,37 @@ struct lp_scene {
       uint8_t *map;
       unsigned stride;
       unsigned layer_stride;
+      unsigned sample_stride;
+      /* per-tile compressed flags of multisampled surfaces, and their
+       * row and layer strides
+       */
+      uint8_t *ms_compressed;
+      unsigned ms_stride;
+      unsigned ms_layer_stride;
    } zsbuf, cbufs[PIPE_MAX_COLOR_BUFS];
 
    /* OpenGL permits different amount of layers per rt, but rendering limited to minimum */
    unsigned fb_max_layer;
 
+   /** samples per pixel of all attachments */
+   unsigned nr_samples;
+
    /** the framebuffer to render the scene into */
    struct pipe_framebuffer_state fb;
 
-   /** list of resources referenced by the scene commands */
+   /** list of resources referenced by the scene commands, newest first */
    struct resource_ref *resources;
 
+   /** Open addressing hash set of the same resources, with their usage.
+    * Allocated on the heap and kept across scenes.
+    */
+   struct resource_hash_entry *resource_hash;
+   unsigned resource_hash_size;   /**< power of two */
+   unsigned resource_count;
+
+   /** buffer storage renamed away while the scene was still using it */
+   struct retired_storage *retired_storage;
+
    /** Total memory used by the scene (in bytes).  This sums all the
     * data blocks and counts all bins, state, resource references and
     * other random allocations within the scene.
@@ -173,6 +196,14 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
+   /**
+    * Bins to rasterize, in tiles.  Normally all of them, but a partial
+    * rasterization only does the ones overlapping a region of interest and
+    * leaves the others binned.
+    */
+   struct u_rect bins;
+   boolean partial;
+
    int curr_x, curr_y;  /**< for iterating over bins */
    pipe_mutex mutex;
 
@@ -197,10 +228,14 @@ struct cmd_block *lp_scene_new_cmd_block( struct lp_scene *scene,
 
 boolean lp_scene_add_resource_reference(struct lp_scene *scene,
                                         struct pipe_resource *resource,
+                                        unsigned usage,
                                         boolean initializing_scene);
 
-boolean lp_scene_is_resource_referenced(const struct lp_scene *scene,
-                                        const struct pipe_resource *resource );
+unsigned lp_scene_is_resource_referenced(const struct lp_scene *scene,
+                                         const struct pipe_resource *resource );
+
+boolean lp_scene_retire_storage(struct lp_scene *scene,
+                                void *data, unsigned size);
 
 
 /**
@@ -405,6 +440,12 @@ lp_scene_begin_rasterization(struct lp_scene *scene);
 void
 lp_scene_end_rasterization(struct lp_scene *scene );
 
+void
+lp_scene_set_partial(struct lp_scene *scene, const struct u_rect *bins);
+
+void
+lp_scene_end_partial_rasterization(struct lp_scene *scene);
+
 
 
 
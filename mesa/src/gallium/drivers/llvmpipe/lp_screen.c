@@ -47,6 +47,7 @@
 #include "lp_public.h"
 #include "lp_limits.h"
 #include "lp_rast.h"
+#include "lp_state.h"
 
 #include "state_tracker/sw_winsys.h"
 
@@ -202,7 +203,7 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_QUADS_FOLLOW_PROVOKING_VERTEX_CONVENTION:
       return 0;
    case PIPE_CAP_COMPUTE:
-      return 0;
+      return 1;
    case PIPE_CAP_USER_VERTEX_BUFFERS:
    case PIPE_CAP_USER_INDEX_BUFFERS:
       return 1;
@@ -264,11 +265,80 @@ llvmpipe_get_shader_param(struct pipe_screen *screen, unsigned shader, enum pipe
       default:
          return draw_get_shader_param(shader, param);
       }
+   case PIPE_SHADER_COMPUTE:
+      switch (param) {
+      case PIPE_SHADER_CAP_MAX_TEXTURE_SAMPLERS:
+         /* Kernels only access memory resources */
+         return 0;
+      case PIPE_SHADER_CAP_PREFERRED_IR:
+         return PIPE_SHADER_IR_TGSI;
+      default:
+         return gallivm_get_shader_param(param);
+      }
    default:
       return 0;
    }
 }
 
+static int
+llvmpipe_get_compute_param(struct pipe_screen *screen,
+                           enum pipe_compute_cap param,
+                           void *ret)
+{
+   uint64_t *ret64 = (uint64_t *) ret;
+
+   switch (param) {
+   case PIPE_COMPUTE_CAP_IR_TARGET:
+      if (ret)
+         strcpy((char *) ret, "tgsi");
+      return sizeof("tgsi");
+   case PIPE_COMPUTE_CAP_GRID_DIMENSION:
+      if (ret)
+         ret64[0] = 3;
+      return 8;
+   case PIPE_COMPUTE_CAP_MAX_GRID_SIZE:
+      if (ret) {
+         ret64[0] = 65535;
+         ret64[1] = 65535;
+         ret64[2] = 65535;
+      }
+      return 24;
+   case PIPE_COMPUTE_CAP_MAX_BLOCK_SIZE:
+      if (ret) {
+         ret64[0] = llvmpipe_cs_max_threads_per_block();
+         ret64[1] = llvmpipe_cs_max_threads_per_block();
+         ret64[2] = llvmpipe_cs_max_threads_per_block();
+      }
+      return 24;
+   case PIPE_COMPUTE_CAP_MAX_THREADS_PER_BLOCK:
+      if (ret)
+         ret64[0] = llvmpipe_cs_max_threads_per_block();
+      return 8;
+   case PIPE_COMPUTE_CAP_MAX_GLOBAL_SIZE:
+      if (ret)
+         ret64[0] = (uint64_t) LP_MAX_GLOBAL_BUFFERS << LP_GLOBAL_ADDRESS_BITS;
+      return 8;
+   case PIPE_COMPUTE_CAP_MAX_LOCAL_SIZE:
+      if (ret)
+         ret64[0] = LP_MAX_CS_LOCAL_SIZE;
+      return 8;
+   case PIPE_COMPUTE_CAP_MAX_PRIVATE_SIZE:
+      if (ret)
+         ret64[0] = LP_MAX_CS_PRIVATE_SIZE;
+      return 8;
+   case PIPE_COMPUTE_CAP_MAX_INPUT_SIZE:
+      if (ret)
+         ret64[0] = 4096;
+      return 8;
+   case PIPE_COMPUTE_CAP_MAX_MEM_ALLOC_SIZE:
+      /* Each buffer must be addressable in the GLOBAL resource */
+      if (ret)
+         ret64[0] = 1 << LP_GLOBAL_ADDRESS_BITS;
+      return 8;
+   }
+   return 0;
+}
+
 static float
 llvmpipe_get_paramf(struct pipe_screen *screen, enum pipe_capf param)
 {
@@ -326,8 +396,21 @@ llvmpipe_is_format_supported( struct pipe_screen *_screen,
           target == PIPE_TEXTURE_3D ||
           target == PIPE_TEXTURE_CUBE);
 
-   if (sample_count > 1)
-      return FALSE;
+   /*
+    * Multisampled surfaces can be rendered to and resolved, but not
+    * displayed or sampled from in shaders.
+    */
+   if (sample_count > 1) {
+      if (sample_count != LP_MAX_SAMPLES ||
+          (target != PIPE_TEXTURE_2D &&
+           target != PIPE_TEXTURE_2D_ARRAY &&
+           target != PIPE_TEXTURE_RECT) ||
+          (bind & ~(PIPE_BIND_RENDER_TARGET |
+                    PIPE_BIND_DEPTH_STENCIL)) ||
+          !(bind & (PIPE_BIND_RENDER_TARGET |
+                    PIPE_BIND_DEPTH_STENCIL)))
+         return FALSE;
+   }
 
    if (bind & PIPE_BIND_RENDER_TARGET) {
       if (format_desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB) {
@@ -424,6 +507,8 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
    if (screen->rast)
       lp_rast_destroy(screen->rast);
 
+   lp_fs_cache_destroy(screen);
+
    lp_jit_screen_cleanup(screen);
 
    if(winsys->destroy)
@@ -431,6 +516,8 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
 
    pipe_mutex_destroy(screen->rast_mutex);
 
+   llvmpipe_buffer_pool_destroy(screen);
+
    FREE(screen);
 }
 
@@ -519,6 +606,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.get_vendor = llvmpipe_get_vendor;
    screen->base.get_param = llvmpipe_get_param;
    screen->base.get_shader_param = llvmpipe_get_shader_param;
+   screen->base.get_compute_param = llvmpipe_get_compute_param;
    screen->base.get_paramf = llvmpipe_get_paramf;
    screen->base.is_format_supported = llvmpipe_is_format_supported;
 
@@ -548,6 +636,16 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
       return NULL;
    }
    pipe_mutex_init(screen->rast_mutex);
+   pipe_mutex_init(screen->buffer_pool_mutex);
+
+   if (!lp_fs_cache_init(screen)) {
+      lp_rast_destroy(screen->rast);
+      pipe_mutex_destroy(screen->rast_mutex);
+      pipe_mutex_destroy(screen->buffer_pool_mutex);
+      lp_jit_screen_cleanup(screen);
+      FREE(screen);
+      return NULL;
+   }
 
    util_format_s3tc_init();
 
@@ -41,6 +41,14 @@
 
 
 struct sw_winsys;
+struct util_hash_table;
+
+
+/** Number of freed buffer storages kept around for reuse */
+#define LP_BUFFER_POOL_SIZE 16
+
+/** Upper bound on the memory held by the buffer pool */
+#define LP_BUFFER_POOL_MAX_BYTES (32 * 1024 * 1024)
 
 
 struct llvmpipe_screen
@@ -57,6 +65,24 @@ struct llvmpipe_screen
 
    struct lp_rasterizer *rast;
    pipe_mutex rast_mutex;
+
+   /** Compiled fragment shader code shared by all contexts */
+   struct util_hash_table *fs_cache;
+   pipe_mutex fs_cache_mutex;
+
+   /* Statistics, protected by fs_cache_mutex */
+   unsigned fs_cache_compiles;
+   unsigned fs_cache_hits;
+   int64_t fs_cache_time_saved;  /**< compile time saved, in microseconds */
+
+   /** Recycled buffer storage, oldest first, protected by buffer_pool_mutex */
+   struct {
+      void *data;
+      unsigned size;
+   } buffer_pool[LP_BUFFER_POOL_SIZE];
+   unsigned buffer_pool_count;
+   unsigned buffer_pool_bytes;
+   pipe_mutex buffer_pool_mutex;
 };
 
 
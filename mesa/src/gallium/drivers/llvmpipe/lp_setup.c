@@ -39,6 +39,7 @@
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_pack_color.h"
+#include "util/u_atomic.h"
 #include "draw/draw_pipe.h"
 #include "os/os_time.h"
 #include "lp_context.h"
@@ -48,6 +49,7 @@
 #include "lp_debug.h"
 #include "lp_fence.h"
 #include "lp_query.h"
+#include "lp_perf.h"
 #include "lp_rast.h"
 #include "lp_setup_context.h"
 #include "lp_screen.h"
@@ -343,6 +345,84 @@ lp_setup_flush( struct lp_setup_context *setup,
 }
 
 
+/**
+ * Rasterize only the bins of the current scene which overlap a box of one
+ * of the render targets, leaving the other bins binned, so that the box
+ * can be read back without waiting for the whole scene to be rendered.
+ *
+ * Returns FALSE if that's not possible and the scene must be flushed
+ * as a whole.
+ */
+boolean
+lp_setup_flush_region( struct lp_setup_context *setup,
+                       const struct pipe_resource *resource,
+                       unsigned level,
+                       const struct pipe_box *box )
+{
+   struct llvmpipe_screen *screen;
+   struct lp_scene *scene;
+   const struct pipe_surface *surf = NULL;
+   struct u_rect bins;
+   unsigned i;
+
+   if (setup->state == SETUP_FLUSHED)
+      return TRUE;
+
+   /* Tiles which still have a query running can't be split */
+   if (setup->active_binned_queries)
+      return FALSE;
+
+   for (i = 0; i < setup->fb.nr_cbufs; i++) {
+      if (setup->fb.cbufs[i]->texture == resource)
+         surf = setup->fb.cbufs[i];
+   }
+   if (setup->fb.zsbuf && setup->fb.zsbuf->texture == resource)
+      surf = setup->fb.zsbuf;
+
+   if (!surf ||
+       resource->target == PIPE_BUFFER ||
+       surf->u.tex.level != level)
+      return FALSE;
+
+   /* Bin any pending clears */
+   if (!set_scene_state( setup, SETUP_ACTIVE, __FUNCTION__ ))
+      return FALSE;
+
+   scene = setup->scene;
+
+   bins.x0 = box->x / TILE_SIZE;
+   bins.y0 = box->y / TILE_SIZE;
+   bins.x1 = MIN2((box->x + box->width - 1) / TILE_SIZE,
+                  (int) scene->tiles_x - 1);
+   bins.y1 = MIN2((box->y + box->height - 1) / TILE_SIZE,
+                  (int) scene->tiles_y - 1);
+
+   if (box->width <= 0 || box->height <= 0 ||
+       bins.x0 > bins.x1 || bins.y0 > bins.y1)
+      return TRUE;
+
+   LP_DBG(DEBUG_SETUP, "%s tiles %d,%d..%d,%d\n", __FUNCTION__,
+          bins.x0, bins.y0, bins.x1, bins.y1);
+
+   LP_COUNT(nr_region_flushes);
+   LP_COUNT_ADD(nr_region_flush_tiles,
+                (bins.x1 - bins.x0 + 1) * (bins.y1 - bins.y0 + 1));
+
+   scene->num_active_queries = 0;
+   lp_scene_set_partial(scene, &bins);
+
+   screen = llvmpipe_screen(scene->pipe->screen);
+   pipe_mutex_lock(screen->rast_mutex);
+   lp_rast_queue_scene(screen->rast, scene);
+   lp_rast_finish(screen->rast);
+   pipe_mutex_unlock(screen->rast_mutex);
+
+   assert(!scene->partial);
+
+   return TRUE;
+}
+
+
 void
 lp_setup_bind_framebuffer( struct lp_setup_context *setup,
                            const struct pipe_framebuffer_state *fb )
@@ -362,6 +442,7 @@ lp_setup_bind_framebuffer( struct lp_setup_context *setup,
     * scene.
     */
    util_copy_framebuffer_state(&setup->fb, fb);
+   setup->nr_samples = util_framebuffer_get_num_samples(fb);
    setup->framebuffer.x0 = 0;
    setup->framebuffer.y0 = 0;
    setup->framebuffer.x1 = fb->width-1;
@@ -479,7 +560,8 @@ lp_setup_set_triangle_state( struct lp_setup_context *setup,
                              boolean ccw_is_frontface,
                              boolean scissor,
                              boolean half_pixel_center,
-                             boolean bottom_edge_rule)
+                             boolean bottom_edge_rule,
+                             boolean multisample)
 {
    LP_DBG(DEBUG_SETUP, "%s\n", __FUNCTION__);
 
@@ -488,6 +570,7 @@ lp_setup_set_triangle_state( struct lp_setup_context *setup,
    setup->triangle = first_triangle;
    setup->pixel_offset = half_pixel_center ? 0.5f : 0.0f;
    setup->bottom_edge_rule = bottom_edge_rule;
+   setup->multisample = multisample;
 
    if (setup->scissor_test != scissor) {
       setup->dirty |= LP_SETUP_NEW_SCISSOR;
@@ -839,6 +922,7 @@ unsigned
 lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
                                 const struct pipe_resource *texture )
 {
+   unsigned referenced = LP_UNREFERENCED;
    unsigned i;
 
    /* check the render targets */
@@ -852,12 +936,30 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
 
    /* check textures referenced by the scene */
    for (i = 0; i < Elements(setup->scenes); i++) {
-      if (lp_scene_is_resource_referenced(setup->scenes[i], texture)) {
-         return LP_REFERENCED_FOR_READ;
-      }
+      referenced |= lp_scene_is_resource_referenced(setup->scenes[i],
+                                                    texture);
    }
 
-   return LP_UNREFERENCED;
+   return referenced;
+}
+
+
+/**
+ * Keep the old storage of a renamed buffer alive until the scene being
+ * binned has been rasterized.  Fails unless that scene is the only one,
+ * of any context, which references the buffer.
+ */
+boolean
+lp_setup_retire_storage( struct lp_setup_context *setup,
+                         struct pipe_resource *resource,
+                         void *data, unsigned size )
+{
+   if (!setup->scene ||
+       !lp_scene_is_resource_referenced(setup->scene, resource) ||
+       p_atomic_read(&llvmpipe_resource(resource)->scene_refs) != 1)
+      return FALSE;
+
+   return lp_scene_retire_storage(setup->scene, data, size);
 }
 
 
@@ -989,6 +1091,7 @@ try_update_scene_state( struct lp_setup_context *setup )
             if (setup->fs.current_tex[i]) {
                if (!lp_scene_add_resource_reference(scene,
                                                     setup->fs.current_tex[i],
+                                                    LP_REFERENCED_FOR_READ,
                                                     new_scene)) {
                   assert(!new_scene);
                   return FALSE;
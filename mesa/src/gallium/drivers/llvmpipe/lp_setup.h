@@ -40,6 +40,7 @@ struct pipe_surface;
 struct pipe_blend_color;
 struct pipe_screen;
 struct pipe_framebuffer_state;
+struct pipe_box;
 struct lp_fragment_shader_variant;
 struct lp_jit_context;
 struct llvmpipe_query;
@@ -67,6 +68,12 @@ lp_setup_flush( struct lp_setup_context *setup,
                 struct pipe_fence_handle **fence,
                 const char *reason);
 
+boolean
+lp_setup_flush_region( struct lp_setup_context *setup,
+                       const struct pipe_resource *resource,
+                       unsigned level,
+                       const struct pipe_box *box );
+
 
 void
 lp_setup_bind_framebuffer( struct lp_setup_context *setup,
@@ -78,7 +85,8 @@ lp_setup_set_triangle_state( struct lp_setup_context *setup,
                              boolean front_is_ccw,
                              boolean scissor,
                              boolean half_pixel_center,
-                             boolean bottom_edge_rule);
+                             boolean bottom_edge_rule,
+                             boolean multisample);
 
 void 
 lp_setup_set_line_state( struct lp_setup_context *setup,
@@ -134,6 +142,11 @@ unsigned
 lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
                                 const struct pipe_resource *texture );
 
+boolean
+lp_setup_retire_storage( struct lp_setup_context *setup,
+                         struct pipe_resource *resource,
+                         void *data, unsigned size );
+
 void
 lp_setup_set_flatshade_first( struct lp_setup_context *setup, 
                               boolean flatshade_first );
@@ -100,6 +100,8 @@ struct lp_setup_context
    boolean rasterizer_discard;
    unsigned cullmode;
    unsigned bottom_edge_rule;
+   boolean multisample;     /**< rasterizer state's multisample flag */
+   unsigned nr_samples;     /**< samples per pixel of the framebuffer */
    float pixel_offset;
    float line_width;
    float point_size;
@@ -624,6 +624,7 @@ try_setup_line( struct lp_setup_context *setup,
    line->inputs.frontfacing = TRUE;
    line->inputs.disable = FALSE;
    line->inputs.opaque = FALSE;
+   line->inputs.multisample = FALSE;
    line->inputs.layer = layer;
 
    for (i = 0; i < 4; i++) {
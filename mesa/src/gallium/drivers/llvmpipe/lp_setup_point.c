@@ -400,6 +400,7 @@ try_setup_point( struct lp_setup_context *setup,
    point->inputs.frontfacing = TRUE;
    point->inputs.disable = FALSE;
    point->inputs.opaque = FALSE;
+   point->inputs.multisample = FALSE;
    point->inputs.layer = layer;
 
    {
@@ -262,6 +262,7 @@ do_triangle_ccw(struct lp_setup_context *setup,
    int nr_planes = 3;
    unsigned scissor_index = 0;
    unsigned layer = 0;
+   const boolean multisample = setup->multisample && setup->nr_samples > 1;
 
    /* Area should always be positive here */
    assert(position->area > 0);
@@ -292,14 +293,16 @@ do_triangle_ccw(struct lp_setup_context *setup,
        * slightly different rounding.
        */
       int adj = (setup->pixel_offset != 0) ? 1 : 0;
+      /* samples are up to this far away from the pixel center */
+      int ms = multisample ? LP_SAMPLE_POS_MAX : 0;
 
       /* Inclusive x0, exclusive x1 */
-      bbox.x0 =  MIN3(position->x[0], position->x[1], position->x[2]) >> FIXED_ORDER;
-      bbox.x1 = (MAX3(position->x[0], position->x[1], position->x[2]) - 1) >> FIXED_ORDER;
+      bbox.x0 = (MIN3(position->x[0], position->x[1], position->x[2]) - ms) >> FIXED_ORDER;
+      bbox.x1 = (MAX3(position->x[0], position->x[1], position->x[2]) - 1 + ms) >> FIXED_ORDER;
 
       /* Inclusive / exclusive depending upon adj (bottom-left or top-right) */
-      bbox.y0 = (MIN3(position->y[0], position->y[1], position->y[2]) + adj) >> FIXED_ORDER;
-      bbox.y1 = (MAX3(position->y[0], position->y[1], position->y[2]) - 1 + adj) >> FIXED_ORDER;
+      bbox.y0 = (MIN3(position->y[0], position->y[1], position->y[2]) + adj - ms) >> FIXED_ORDER;
+      bbox.y1 = (MAX3(position->y[0], position->y[1], position->y[2]) - 1 + adj + ms) >> FIXED_ORDER;
    }
 
    if (bbox.x1 < bbox.x0 ||
@@ -357,6 +360,7 @@ do_triangle_ccw(struct lp_setup_context *setup,
    tri->inputs.frontfacing = frontfacing;
    tri->inputs.disable = FALSE;
    tri->inputs.opaque = setup->fs.current.variant->opaque;
+   tri->inputs.multisample = multisample;
    tri->inputs.layer = layer;
 
    if (0)
@@ -615,7 +619,8 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
       assert(iy0 == bbox->y1 / TILE_SIZE &&
 	     ix0 == bbox->x1 / TILE_SIZE);
 
-      if (nr_planes == 3) {
+      /* The small triangle rasterizers only evaluate pixel centers */
+      if (nr_planes == 3 && !tri->inputs.multisample) {
          if (sz < 4)
          {
             /* Triangle is contained in a single 4x4 stamp:
@@ -650,7 +655,7 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
                                                 lp_rast_arg_triangle_contained(tri, px, py) );
          }
       }
-      else if (nr_planes == 4 && sz < 16) 
+      else if (nr_planes == 4 && sz < 16 && !tri->inputs.multisample)
       {
          px = MIN2(px, TILE_SIZE - 16);
          py = MIN2(py, TILE_SIZE - 16);
@@ -688,15 +693,18 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
       int iy1 = trimmed_box.y1 / TILE_SIZE;
       
       for (i = 0; i < nr_planes; i++) {
+         /* widen the trivial accept/reject tests to cover all samples */
+         int margin = tri->inputs.multisample ? lp_rast_ms_margin(&plane[i]) : 0;
+
          c[i] = (plane[i].c + 
                  plane[i].dcdy * iy0 * TILE_SIZE - 
                  plane[i].dcdx * ix0 * TILE_SIZE);
 
-         ei[i] = (plane[i].dcdy - 
-                  plane[i].dcdx - 
-                  plane[i].eo) << TILE_ORDER;
+         ei[i] = ((plane[i].dcdy - 
+                   plane[i].dcdx - 
+                   plane[i].eo) << TILE_ORDER) - margin;
 
-         eo[i] = plane[i].eo << TILE_ORDER;
+         eo[i] = (plane[i].eo << TILE_ORDER) + margin;
          xstep[i] = -(plane[i].dcdx << TILE_ORDER);
          ystep[i] = plane[i].dcdy << TILE_ORDER;
       }
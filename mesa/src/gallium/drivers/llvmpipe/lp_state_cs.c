@@ -0,0 +1,896 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Compute shaders.
+ *
+ * Kernels are TGSI programs translated with the SoA code generator, one
+ * SIMD vector of threads per call of the generated function.  The work
+ * groups of a grid are handed out to the rasterizer threads, each of which
+ * runs whole work groups.
+ *
+ * When a work group spans several vectors and the kernel has barriers,
+ * each vector runs as a fiber with its own stack, and a barrier switches
+ * back to the thread, which resumes every vector in turn.  Thus no vector
+ * goes past a barrier before all of them have reached it.  Where fibers
+ * aren't available work groups are limited to a single vector.
+ */
+
+#include "pipe/p_config.h"
+#include "pipe/p_defines.h"
+#include "util/u_atomic.h"
+#include "util/u_debug.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "os/os_time.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_struct.h"
+#include "gallivm/lp_bld_tgsi.h"
+#include "gallivm/lp_bld_type.h"
+#include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_flush.h"
+#include "lp_perf.h"
+#include "lp_rast.h"
+#include "lp_screen.h"
+#include "lp_state.h"
+#include "lp_state_cs.h"
+#include "lp_texture.h"
+
+#if defined(PIPE_OS_UNIX) && !defined(PIPE_OS_ANDROID) && !defined(PIPE_OS_APPLE)
+#define LP_CS_HAVE_FIBERS 1
+#include <ucontext.h>
+#endif
+
+
+/** Stack size of the fibers running the vectors of a work group */
+#define LP_CS_FIBER_STACK_SIZE (64 * 1024)
+
+
+static unsigned cs_no = 0;
+
+
+/**
+ * A launch_grid call, shared by all the rasterizer threads.
+ */
+struct lp_cs_job
+{
+   const struct lp_compute_shader_variant *variant;
+
+   struct lp_jit_cs_context jit_context;
+
+   int32_t num_blocks;
+   int32_t next_block;
+
+   /** Number of rasterizer threads which couldn't allocate their memory */
+   int32_t num_failed;
+
+   unsigned block_threads;
+   unsigned num_vectors;
+   unsigned local_size;
+   unsigned private_size;
+   boolean use_fibers;
+};
+
+
+#ifdef LP_CS_HAVE_FIBERS
+struct lp_cs_fiber
+{
+   ucontext_t context;
+   struct lp_cs_thread_data *thread;
+   unsigned vector;
+   boolean done;
+   void *stack;
+};
+#endif
+
+
+/**
+ * The work group a rasterizer thread is running.
+ */
+struct lp_cs_thread_data
+{
+   const struct lp_cs_job *job;
+
+   unsigned block_id[3];
+
+   uint8_t *local_mem;
+   uint8_t *private_mem;
+
+#ifdef LP_CS_HAVE_FIBERS
+   ucontext_t scheduler;
+   struct lp_cs_fiber *fibers;
+   struct lp_cs_fiber *current;
+#endif
+};
+
+
+static void
+cs_run_vector(struct lp_cs_thread_data *thread, unsigned vector)
+{
+   const struct lp_cs_job *job = thread->job;
+   const struct lp_compute_shader_variant *variant = job->variant;
+   unsigned thread_index = vector * variant->vector_length;
+
+   variant->jit_function(&job->jit_context,
+                         thread->block_id[0],
+                         thread->block_id[1],
+                         thread->block_id[2],
+                         thread_index,
+                         thread->local_mem,
+                         thread->private_mem + thread_index * job->private_size,
+                         thread);
+}
+
+
+/**
+ * Called by the generated code on TGSI_OPCODE_BARRIER.
+ */
+static void
+lp_cs_barrier(struct lp_cs_thread_data *thread)
+{
+#ifdef LP_CS_HAVE_FIBERS
+   struct lp_cs_fiber *fiber = thread->current;
+
+   if (fiber) {
+      swapcontext(&fiber->context, &thread->scheduler);
+   }
+#endif
+}
+
+
+#ifdef LP_CS_HAVE_FIBERS
+
+/**
+ * Fiber entrypoint.  makecontext() only passes int arguments, hence the
+ * fiber pointer split in two halves.
+ */
+static void
+cs_fiber_main(unsigned lo, unsigned hi)
+{
+   struct lp_cs_fiber *fiber =
+      (struct lp_cs_fiber *) (uintptr_t) (((uint64_t) hi << 32) | lo);
+
+   cs_run_vector(fiber->thread, fiber->vector);
+   fiber->done = TRUE;
+}
+
+
+static void
+cs_run_block_fibers(struct lp_cs_thread_data *thread)
+{
+   const struct lp_cs_job *job = thread->job;
+   unsigned num_running = job->num_vectors;
+   unsigned i;
+
+   for (i = 0; i < job->num_vectors; i++) {
+      struct lp_cs_fiber *fiber = &thread->fibers[i];
+      uint64_t ptr = (uintptr_t) fiber;
+
+      getcontext(&fiber->context);
+      fiber->context.uc_stack.ss_sp = fiber->stack;
+      fiber->context.uc_stack.ss_size = LP_CS_FIBER_STACK_SIZE;
+      fiber->context.uc_link = &thread->scheduler;
+      fiber->thread = thread;
+      fiber->vector = i;
+      fiber->done = FALSE;
+      makecontext(&fiber->context, (void (*)(void)) cs_fiber_main, 2,
+                  (unsigned) (ptr & 0xffffffff), (unsigned) (ptr >> 32));
+   }
+
+   /* Run every vector up to its next barrier, or its end, until all are
+    * done.
+    */
+   while (num_running) {
+      num_running = 0;
+      for (i = 0; i < job->num_vectors; i++) {
+         struct lp_cs_fiber *fiber = &thread->fibers[i];
+
+         if (fiber->done)
+            continue;
+
+         thread->current = fiber;
+         swapcontext(&thread->scheduler, &fiber->context);
+         if (!fiber->done)
+            num_running++;
+      }
+   }
+
+   thread->current = NULL;
+}
+
+#endif /* LP_CS_HAVE_FIBERS */
+
+
+/**
+ * Number of threads run by one call of a kernel.
+ */
+static unsigned
+cs_vector_length(void)
+{
+   return MIN2(lp_native_vector_width / 32, 16);
+}
+
+
+/**
+ * Largest work group size.  Without fibers a barrier can't hold back the
+ * other vectors of the work group, so work groups are limited to a single
+ * vector, which is what PIPE_COMPUTE_CAP_MAX_THREADS_PER_BLOCK reports.
+ */
+unsigned
+llvmpipe_cs_max_threads_per_block(void)
+{
+#ifdef LP_CS_HAVE_FIBERS
+   return LP_MAX_CS_BLOCK_SIZE;
+#else
+   return cs_vector_length();
+#endif
+}
+
+
+static void
+cs_run_block(struct lp_cs_thread_data *thread)
+{
+   const struct lp_cs_job *job = thread->job;
+   unsigned i;
+
+#ifdef LP_CS_HAVE_FIBERS
+   if (job->use_fibers) {
+      cs_run_block_fibers(thread);
+      return;
+   }
+#endif
+
+   for (i = 0; i < job->num_vectors; i++) {
+      cs_run_vector(thread, i);
+   }
+}
+
+
+static int
+cs_next_block(struct lp_cs_job *job)
+{
+   int32_t block;
+
+   do {
+      block = p_atomic_read(&job->next_block);
+      if (block >= job->num_blocks)
+         return -1;
+   } while (p_atomic_cmpxchg(&job->next_block, block, block + 1) != block);
+
+   return block;
+}
+
+
+/**
+ * Rasterizer thread job: run work groups until there are none left.
+ */
+static void
+cs_run_job(void *data, unsigned thread_index)
+{
+   struct lp_cs_job *job = (struct lp_cs_job *) data;
+   const uint32_t *grid_size = job->jit_context.grid_size;
+   struct lp_cs_thread_data thread;
+   int block;
+
+   memset(&thread, 0, sizeof thread);
+   thread.job = job;
+
+   thread.local_mem = align_malloc(MAX2(job->local_size, 16), 16);
+   thread.private_mem = align_malloc(MAX2(job->private_size *
+                                          job->num_vectors *
+                                          job->variant->vector_length, 16), 16);
+   if (!thread.local_mem || !thread.private_mem)
+      goto fail;
+
+#ifdef LP_CS_HAVE_FIBERS
+   if (job->use_fibers) {
+      unsigned i;
+
+      thread.fibers = CALLOC(job->num_vectors, sizeof *thread.fibers);
+      if (!thread.fibers)
+         goto fail;
+
+      for (i = 0; i < job->num_vectors; i++) {
+         thread.fibers[i].stack = MALLOC(LP_CS_FIBER_STACK_SIZE);
+         if (!thread.fibers[i].stack)
+            goto fail;
+      }
+   }
+#endif
+
+   while ((block = cs_next_block(job)) >= 0) {
+      thread.block_id[0] = block % grid_size[0];
+      block /= grid_size[0];
+      thread.block_id[1] = block % grid_size[1];
+      thread.block_id[2] = block / grid_size[1];
+
+      cs_run_block(&thread);
+   }
+   goto out;
+
+fail:
+   /* The other threads run the work groups this one can't, if any of
+    * them could allocate its memory.
+    */
+   p_atomic_inc(&job->num_failed);
+
+out:
+#ifdef LP_CS_HAVE_FIBERS
+   if (thread.fibers) {
+      unsigned i;
+      for (i = 0; i < job->num_vectors; i++) {
+         FREE(thread.fibers[i].stack);
+      }
+      FREE(thread.fibers);
+   }
+#endif
+   align_free(thread.local_mem);
+   align_free(thread.private_mem);
+}
+
+
+/**
+ * Code generation interface for the resources and barriers of the kernel.
+ */
+struct lp_cs_iface
+{
+   struct lp_build_tgsi_cs_iface base;
+
+   LLVMValueRef context_ptr;
+   LLVMValueRef local_mem;
+   LLVMValueRef private_mem;
+   LLVMValueRef thread_data;
+};
+
+
+static LLVMValueRef
+cs_resource_ptr(const struct lp_build_tgsi_cs_iface *cs_iface,
+                struct lp_build_tgsi_context *bld_base,
+                unsigned index,
+                unsigned lane,
+                LLVMValueRef address)
+{
+   const struct lp_cs_iface *iface = (const struct lp_cs_iface *) cs_iface;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef base;
+
+   switch (index) {
+   case TGSI_RESOURCE_GLOBAL:
+      base = lp_build_array_get(gallivm,
+                                lp_jit_cs_context_globals(gallivm, iface->context_ptr),
+                                LLVMBuildLShr(builder, address,
+                                              lp_build_const_int32(gallivm, LP_GLOBAL_ADDRESS_BITS),
+                                              ""));
+      address = LLVMBuildAnd(builder, address,
+                             lp_build_const_int32(gallivm, (1 << LP_GLOBAL_ADDRESS_BITS) - 1),
+                             "");
+      break;
+
+   case TGSI_RESOURCE_LOCAL:
+      base = iface->local_mem;
+      break;
+
+   case TGSI_RESOURCE_PRIVATE:
+      {
+         LLVMValueRef offset;
+
+         offset = lp_jit_cs_context_private_size(gallivm, iface->context_ptr);
+         offset = LLVMBuildMul(builder, offset,
+                               lp_build_const_int32(gallivm, lane), "");
+         base = LLVMBuildGEP(builder, iface->private_mem, &offset, 1, "");
+      }
+      break;
+
+   case TGSI_RESOURCE_INPUT:
+      base = lp_jit_cs_context_input(gallivm, iface->context_ptr);
+      break;
+
+   default:
+      assert(index < PIPE_MAX_SHADER_RESOURCES);
+      base = lp_build_array_get(gallivm,
+                                lp_jit_cs_context_resources(gallivm, iface->context_ptr),
+                                lp_build_const_int32(gallivm, index));
+      break;
+   }
+
+   return LLVMBuildGEP(builder, base, &address, 1, "");
+}
+
+
+static void
+cs_barrier(const struct lp_build_tgsi_cs_iface *cs_iface,
+           struct lp_build_tgsi_context *bld_base)
+{
+   const struct lp_cs_iface *iface = (const struct lp_cs_iface *) cs_iface;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMTypeRef arg_type = LLVMTypeOf(iface->thread_data);
+   LLVMValueRef function;
+
+   function = lp_build_const_func_pointer(gallivm,
+                                          func_to_pointer((func_pointer) lp_cs_barrier),
+                                          LLVMVoidTypeInContext(gallivm->context),
+                                          &arg_type, 1,
+                                          "lp_cs_barrier");
+
+   LLVMBuildCall(gallivm->builder, function,
+                 (LLVMValueRef *) &iface->thread_data, 1, "");
+}
+
+
+/**
+ * Generate the function running one vector of threads of a work group.
+ * Any change here must be reflected in lp_jit.h's lp_jit_cs_func.
+ */
+static void
+generate_compute(struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant *variant)
+{
+   struct gallivm_state *gallivm = variant->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(gallivm->context);
+   LLVMTypeRef int8_ptr_type =
+      LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   LLVMTypeRef arg_types[8];
+   LLVMTypeRef func_type;
+   LLVMValueRef function;
+   LLVMValueRef context_ptr, thread_index;
+   LLVMValueRef block_size_ptr, grid_size_ptr, consts_ptr;
+   LLVMValueRef lanes[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef index, num_threads, size;
+   LLVMBasicBlockRef block;
+   struct lp_type cs_type;
+   struct lp_build_context uint_bld;
+   struct lp_build_mask_context mask;
+   struct lp_bld_tgsi_system_values system_values;
+   struct lp_cs_iface iface;
+   char func_name[64];
+   unsigned i;
+
+   memset(&cs_type, 0, sizeof cs_type);
+   cs_type.floating = TRUE;      /* floating point values */
+   cs_type.sign = TRUE;          /* values are signed */
+   cs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
+   cs_type.width = 32;           /* 32-bit float */
+   cs_type.length = variant->vector_length;
+
+   util_snprintf(func_name, sizeof(func_name), "cs%u_variant%u",
+                 shader->no, variant->no);
+
+   arg_types[0] = variant->jit_context_ptr_type;  /* context */
+   arg_types[1] = int32_type;                     /* block_id_x */
+   arg_types[2] = int32_type;                     /* block_id_y */
+   arg_types[3] = int32_type;                     /* block_id_z */
+   arg_types[4] = int32_type;                     /* thread_index */
+   arg_types[5] = int8_ptr_type;                  /* local_mem */
+   arg_types[6] = int8_ptr_type;                  /* private_mem */
+   arg_types[7] = int8_ptr_type;                  /* thread_data */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(gallivm->context),
+                                arg_types, Elements(arg_types), 0);
+
+   function = LLVMAddFunction(gallivm->module, func_name, func_type);
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+
+   variant->function = function;
+
+   context_ptr = LLVMGetParam(function, 0);
+   thread_index = LLVMGetParam(function, 4);
+
+   lp_build_name(context_ptr, "context");
+   lp_build_name(LLVMGetParam(function, 1), "block_id_x");
+   lp_build_name(LLVMGetParam(function, 2), "block_id_y");
+   lp_build_name(LLVMGetParam(function, 3), "block_id_z");
+   lp_build_name(thread_index, "thread_index");
+   lp_build_name(LLVMGetParam(function, 5), "local_mem");
+   lp_build_name(LLVMGetParam(function, 6), "private_mem");
+   lp_build_name(LLVMGetParam(function, 7), "thread_data");
+
+   block = LLVMAppendBasicBlockInContext(gallivm->context, function, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&uint_bld, gallivm, lp_uint_type(cs_type));
+
+   memset(&system_values, 0, sizeof system_values);
+
+   block_size_ptr = lp_jit_cs_context_block_size(gallivm, context_ptr);
+   grid_size_ptr = lp_jit_cs_context_grid_size(gallivm, context_ptr);
+   for (i = 0; i < 3; i++) {
+      LLVMValueRef idx = lp_build_const_int32(gallivm, i);
+      system_values.block_id[i] = LLVMGetParam(function, 1 + i);
+      system_values.block_size[i] = lp_build_array_get(gallivm, block_size_ptr, idx);
+      system_values.grid_size[i] = lp_build_array_get(gallivm, grid_size_ptr, idx);
+   }
+
+   /* Linear index of the thread of each lane, and its 3D id */
+   for (i = 0; i < cs_type.length; i++) {
+      lanes[i] = lp_build_const_int32(gallivm, i);
+   }
+   index = lp_build_broadcast_scalar(&uint_bld, thread_index);
+   index = LLVMBuildAdd(builder, index, LLVMConstVector(lanes, cs_type.length), "");
+
+   size = lp_build_broadcast_scalar(&uint_bld, system_values.block_size[0]);
+   system_values.thread_id[0] = LLVMBuildURem(builder, index, size, "");
+   system_values.thread_id[1] = LLVMBuildUDiv(builder, index, size, "");
+   size = lp_build_broadcast_scalar(&uint_bld, system_values.block_size[1]);
+   system_values.thread_id[2] = LLVMBuildUDiv(builder, system_values.thread_id[1], size, "");
+   system_values.thread_id[1] = LLVMBuildURem(builder, system_values.thread_id[1], size, "");
+
+   /* The last vector of a work group may be partially used */
+   num_threads = LLVMBuildMul(builder, system_values.block_size[0],
+                              system_values.block_size[1], "");
+   num_threads = LLVMBuildMul(builder, num_threads,
+                              system_values.block_size[2], "");
+   lp_build_mask_begin(&mask, gallivm, cs_type,
+                       lp_build_cmp(&uint_bld, PIPE_FUNC_LESS, index,
+                                    lp_build_broadcast_scalar(&uint_bld, num_threads)));
+
+   consts_ptr = lp_jit_cs_context_constants(gallivm, context_ptr);
+
+   memset(&iface, 0, sizeof iface);
+   iface.base.entry_pc = variant->entry_pc;
+   iface.base.resource_ptr = cs_resource_ptr;
+   iface.base.barrier = cs_barrier;
+   iface.context_ptr = context_ptr;
+   iface.local_mem = LLVMGetParam(function, 5);
+   iface.private_mem = LLVMGetParam(function, 6);
+   iface.thread_data = LLVMGetParam(function, 7);
+
+   lp_build_tgsi_soa(gallivm, shader->base.prog, cs_type, &mask,
+                     consts_ptr, &system_values,
+                     NULL, NULL, NULL, &shader->info, NULL, &iface.base);
+
+   lp_build_mask_end(&mask);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, function);
+}
+
+
+static struct lp_compute_shader_variant *
+cs_get_variant(struct lp_compute_shader *shader, int pc)
+{
+   struct lp_compute_shader_variant *variant;
+   int64_t t0, dt;
+
+   for (variant = shader->variants; variant; variant = variant->next) {
+      if (variant->entry_pc == pc)
+         return variant;
+   }
+
+   if (pc < 0 || pc >= (int) shader->info.num_instructions) {
+      debug_printf("llvmpipe: invalid compute kernel entry point %d\n", pc);
+      return NULL;
+   }
+
+   variant = CALLOC_STRUCT(lp_compute_shader_variant);
+   if (!variant)
+      return NULL;
+
+   variant->gallivm = gallivm_create();
+   if (!variant->gallivm) {
+      FREE(variant);
+      return NULL;
+   }
+
+   variant->entry_pc = pc;
+   variant->vector_length = cs_vector_length();
+   variant->no = shader->variants_created++;
+
+   t0 = os_time_get();
+
+   lp_jit_init_cs_types(variant);
+
+   generate_compute(shader, variant);
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->jit_function = (lp_jit_cs_func)
+         gallivm_jit_function(variant->gallivm, variant->function);
+
+   dt = os_time_get() - t0;
+   LP_COUNT_ADD(llvm_compile_time, dt);
+   LP_COUNT(nr_llvm_compiles);
+
+   variant->next = shader->variants;
+   shader->variants = variant;
+
+   return variant;
+}
+
+
+static void *
+llvmpipe_create_compute_state(struct pipe_context *pipe,
+                              const struct pipe_compute_state *templ)
+{
+   struct lp_compute_shader *shader;
+
+   shader = CALLOC_STRUCT(lp_compute_shader);
+   if (!shader)
+      return NULL;
+
+   shader->no = cs_no++;
+   shader->base = *templ;
+
+   /* get/save the summary info for this shader */
+   shader->base.prog = tgsi_dup_tokens(templ->prog);
+   if (!shader->base.prog) {
+      FREE(shader);
+      return NULL;
+   }
+
+   tgsi_scan_shader(shader->base.prog, &shader->info);
+
+   if (LP_DEBUG & DEBUG_TGSI) {
+      debug_printf("llvmpipe: Create compute shader %u %p:\n",
+                   shader->no, (void *) shader);
+      tgsi_dump(shader->base.prog, 0);
+   }
+
+   /* Only raw memory resources are supported */
+   if (shader->info.file_count[TGSI_FILE_SAMPLER] ||
+       shader->info.file_count[TGSI_FILE_SAMPLER_VIEW] ||
+       templ->req_local_mem > LP_MAX_CS_LOCAL_SIZE ||
+       templ->req_private_mem > LP_MAX_CS_PRIVATE_SIZE) {
+      debug_printf("llvmpipe: unsupported compute shader\n");
+      FREE((void *) shader->base.prog);
+      FREE(shader);
+      return NULL;
+   }
+
+   return shader;
+}
+
+
+static void
+llvmpipe_bind_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+
+   llvmpipe->cs = (struct lp_compute_shader *) cs;
+}
+
+
+static void
+llvmpipe_delete_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct lp_compute_shader *shader = (struct lp_compute_shader *) cs;
+   struct lp_compute_shader_variant *variant, *next;
+
+   if (llvmpipe->cs == shader)
+      llvmpipe->cs = NULL;
+
+   for (variant = shader->variants; variant; variant = next) {
+      next = variant->next;
+      gallivm_free_function(variant->gallivm, variant->function,
+                            (const void *) variant->jit_function);
+      gallivm_destroy(variant->gallivm);
+      FREE(variant);
+   }
+
+   FREE((void *) shader->base.prog);
+   FREE(shader);
+}
+
+
+static void
+llvmpipe_set_compute_resources(struct pipe_context *pipe,
+                               unsigned start, unsigned count,
+                               struct pipe_surface **resources)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(start + count <= Elements(llvmpipe->cs_resources));
+
+   for (i = 0; i < count; i++) {
+      struct pipe_surface *surf = resources ? resources[i] : NULL;
+
+      assert(!surf || surf->texture->target == PIPE_BUFFER);
+      pipe_surface_reference(&llvmpipe->cs_resources[start + i], surf);
+   }
+}
+
+
+static void
+llvmpipe_set_global_binding(struct pipe_context *pipe,
+                            unsigned first, unsigned count,
+                            struct pipe_resource **resources,
+                            uint32_t **handles)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(first + count <= Elements(llvmpipe->cs_globals));
+
+   for (i = 0; i < count; i++) {
+      struct pipe_resource *res = resources ? resources[i] : NULL;
+
+      pipe_resource_reference(&llvmpipe->cs_globals[first + i], res);
+
+      /* Buffer n is at address n << LP_GLOBAL_ADDRESS_BITS, see
+       * lp_jit_cs_context::globals.
+       */
+      if (res)
+         *handles[i] = (first + i + 1) << LP_GLOBAL_ADDRESS_BITS;
+   }
+}
+
+
+static uint8_t *
+cs_buffer_data(struct pipe_resource *res)
+{
+   return (uint8_t *) llvmpipe_resource_data(res);
+}
+
+
+static void
+llvmpipe_launch_grid(struct pipe_context *pipe,
+                     const uint *block_layout, const uint *grid_layout,
+                     uint32_t pc, const void *input)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   struct lp_compute_shader *shader = llvmpipe->cs;
+   struct lp_compute_shader_variant *variant;
+   struct lp_cs_job job;
+   uint64_t num_blocks;
+   unsigned i;
+
+   if (!shader)
+      return;
+
+   variant = cs_get_variant(shader, pc);
+   if (!variant)
+      return;
+
+   memset(&job, 0, sizeof job);
+   job.variant = variant;
+
+   num_blocks = (uint64_t) grid_layout[0] * grid_layout[1] * grid_layout[2];
+   job.block_threads = block_layout[0] * block_layout[1] * block_layout[2];
+   if (!job.block_threads || !num_blocks)
+      return;
+
+   if (job.block_threads > llvmpipe_cs_max_threads_per_block() ||
+       num_blocks > INT32_MAX) {
+      debug_printf("llvmpipe: compute grid too large\n");
+      return;
+   }
+   job.num_blocks = (int32_t) num_blocks;
+
+   job.num_vectors = (job.block_threads + variant->vector_length - 1) /
+                     variant->vector_length;
+   job.local_size = shader->base.req_local_mem;
+   job.private_size = align(shader->base.req_private_mem, 4);
+
+#ifdef LP_CS_HAVE_FIBERS
+   if (job.num_vectors > 1 && shader->info.opcode_count[TGSI_OPCODE_BARRIER])
+      job.use_fibers = TRUE;
+#else
+   assert(job.num_vectors == 1);
+#endif
+
+   for (i = 0; i < Elements(job.jit_context.constants); i++) {
+      const struct pipe_constant_buffer *cb =
+         &llvmpipe->constants[PIPE_SHADER_COMPUTE][i];
+
+      if (cb->buffer) {
+         job.jit_context.constants[i] = (const float *)
+            (cs_buffer_data(cb->buffer) + cb->buffer_offset);
+      }
+      else if (cb->user_buffer) {
+         job.jit_context.constants[i] = (const float *)
+            ((const uint8_t *) cb->user_buffer + cb->buffer_offset);
+      }
+   }
+
+   for (i = 0; i < Elements(llvmpipe->cs_resources); i++) {
+      struct pipe_surface *surf = llvmpipe->cs_resources[i];
+
+      if (surf) {
+         job.jit_context.resources[i] = cs_buffer_data(surf->texture) +
+            surf->u.buf.first_element * util_format_get_blocksize(surf->format);
+      }
+   }
+
+   for (i = 0; i < Elements(llvmpipe->cs_globals); i++) {
+      if (llvmpipe->cs_globals[i])
+         job.jit_context.globals[i + 1] = cs_buffer_data(llvmpipe->cs_globals[i]);
+   }
+
+   job.jit_context.input = (const uint8_t *) input;
+   for (i = 0; i < 3; i++) {
+      job.jit_context.block_size[i] = block_layout[i];
+      job.jit_context.grid_size[i] = grid_layout[i];
+   }
+   job.jit_context.private_size = job.private_size;
+
+   /* Rendering must be complete before the kernel runs, as it may use its
+    * results, and the rasterizer threads must be idle.
+    */
+   llvmpipe_finish(pipe, __FUNCTION__);
+
+   LP_COUNT(nr_cs_launches);
+   LP_COUNT_ADD(nr_cs_blocks, job.num_blocks);
+   if (job.use_fibers)
+      LP_COUNT_ADD(nr_cs_barrier_blocks, job.num_blocks);
+
+   pipe_mutex_lock(screen->rast_mutex);
+   lp_rast_run_job(screen->rast, cs_run_job, &job);
+   pipe_mutex_unlock(screen->rast_mutex);
+
+   if (job.next_block < job.num_blocks) {
+      debug_printf("llvmpipe: out of memory, %d of %d compute work groups "
+                   "not run\n", job.num_blocks - job.next_block,
+                   job.num_blocks);
+   }
+   else if (job.num_failed) {
+      debug_printf("llvmpipe: out of memory on %d compute threads\n",
+                   job.num_failed);
+   }
+}
+
+
+void
+llvmpipe_cleanup_compute(struct llvmpipe_context *llvmpipe)
+{
+   unsigned i;
+
+   for (i = 0; i < Elements(llvmpipe->cs_resources); i++) {
+      pipe_surface_reference(&llvmpipe->cs_resources[i], NULL);
+   }
+
+   for (i = 0; i < Elements(llvmpipe->cs_globals); i++) {
+      pipe_resource_reference(&llvmpipe->cs_globals[i], NULL);
+   }
+}
+
+
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe)
+{
+   llvmpipe->pipe.create_compute_state = llvmpipe_create_compute_state;
+   llvmpipe->pipe.bind_compute_state = llvmpipe_bind_compute_state;
+   llvmpipe->pipe.delete_compute_state = llvmpipe_delete_compute_state;
+   llvmpipe->pipe.set_compute_resources = llvmpipe_set_compute_resources;
+   llvmpipe->pipe.set_global_binding = llvmpipe_set_global_binding;
+   llvmpipe->pipe.launch_grid = llvmpipe_launch_grid;
+}
@@ -67,6 +67,10 @@
 #include "util/u_string.h"
 #include "util/u_simple_list.h"
 #include "util/u_dual_blend.h"
+#include "util/u_hash.h"
+#include "util/u_hash_table.h"
+#include "util/u_framebuffer.h"
+#include "util/u_atomic.h"
 #include "os/os_time.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
@@ -95,6 +99,7 @@
 #include "lp_context.h"
 #include "lp_debug.h"
 #include "lp_perf.h"
+#include "lp_screen.h"
 #include "lp_setup.h"
 #include "lp_state.h"
 #include "lp_tex_sample.h"
@@ -214,6 +219,114 @@ find_output_by_semantic( const struct tgsi_shader_info *info,
 }
 
 
+/**
+ * Multisampling: combine the coverage of each sample with the mask of the
+ * fragments which survived the shader, and do the depth/stencil test and
+ * occlusion counting per sample.  The shader itself only runs once per
+ * pixel.  The resulting sample masks are written back to
+ * sample_mask_store.
+ */
+static void
+generate_fs_samples(struct gallivm_state *gallivm,
+                    const struct lp_fragment_shader_variant_key *key,
+                    struct lp_type type,
+                    const struct util_format_description *zs_format_desc,
+                    unsigned depth_mode,
+                    LLVMValueRef pixel_mask,
+                    LLVMValueRef sample_mask_store,
+                    LLVMValueRef loop_counter,
+                    LLVMValueRef z,
+                    LLVMValueRef dzdx,
+                    LLVMValueRef dzdy,
+                    LLVMValueRef *stencil_refs,
+                    LLVMValueRef facing,
+                    LLVMValueRef depth_ptr,
+                    LLVMValueRef depth_stride,
+                    LLVMValueRef depth_sample_stride,
+                    LLVMValueRef thread_data_ptr)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context f_bld;
+   unsigned s;
+
+   lp_build_context_init(&f_bld, gallivm, type);
+
+   for (s = 0; s < LP_MAX_SAMPLES; s++) {
+      LLVMValueRef index, sample_mask_ptr, sample_mask;
+
+      index = LLVMBuildMul(builder, loop_counter,
+                           lp_build_const_int32(gallivm, LP_MAX_SAMPLES), "");
+      index = LLVMBuildAdd(builder, index, lp_build_const_int32(gallivm, s), "");
+      sample_mask_ptr = LLVMBuildGEP(builder, sample_mask_store,
+                                     &index, 1, "sample_mask_ptr");
+      sample_mask = LLVMBuildLoad(builder, sample_mask_ptr, "");
+      sample_mask = LLVMBuildAnd(builder, sample_mask, pixel_mask, "");
+
+      if (depth_mode & LATE_DEPTH_TEST) {
+         struct lp_build_mask_context mask;
+         LLVMValueRef z_sample = z;
+         LLVMValueRef z_fb, s_fb, z_value, s_value;
+         LLVMValueRef sample_depth_ptr, offset;
+
+         /* Interpolate z at the sample position, unless the shader wrote it */
+         if (dzdx) {
+            LLVMValueRef dz;
+
+            dz = LLVMBuildFAdd(builder,
+                               LLVMBuildFMul(builder, dzdx,
+                                             lp_build_const_float(gallivm,
+                                                lp_sample_pos[s][0] / (float) FIXED_ONE), ""),
+                               LLVMBuildFMul(builder, dzdy,
+                                             lp_build_const_float(gallivm,
+                                                lp_sample_pos[s][1] / (float) FIXED_ONE), ""),
+                               "");
+            z_sample = lp_build_add(&f_bld, z, lp_build_broadcast_scalar(&f_bld, dz));
+            z_sample = lp_build_clamp(&f_bld, z_sample, f_bld.zero, f_bld.one);
+         }
+
+         offset = LLVMBuildMul(builder, depth_sample_stride,
+                               lp_build_const_int32(gallivm, s), "");
+         sample_depth_ptr = LLVMBuildGEP(builder, depth_ptr, &offset, 1, "");
+
+         lp_build_mask_begin(&mask, gallivm, type, sample_mask);
+
+         lp_build_depth_stencil_load_swizzled(gallivm, type,
+                                              zs_format_desc, key->resource_1d,
+                                              sample_depth_ptr, depth_stride,
+                                              &z_fb, &s_fb, loop_counter);
+         lp_build_depth_stencil_test(gallivm,
+                                     &key->depth,
+                                     key->stencil,
+                                     type,
+                                     zs_format_desc,
+                                     &mask,
+                                     stencil_refs,
+                                     z_sample, z_fb, s_fb,
+                                     facing,
+                                     &z_value, &s_value,
+                                     FALSE);
+         if (depth_mode & LATE_DEPTH_WRITE) {
+            lp_build_depth_stencil_write_swizzled(gallivm, type,
+                                                  zs_format_desc, key->resource_1d,
+                                                  NULL, NULL, NULL, loop_counter,
+                                                  sample_depth_ptr, depth_stride,
+                                                  z_value, s_value);
+         }
+
+         sample_mask = lp_build_mask_end(&mask);
+      }
+
+      if (key->occlusion_count) {
+         LLVMValueRef counter = lp_jit_thread_data_counter(gallivm, thread_data_ptr);
+         lp_build_name(counter, "counter");
+         lp_build_occlusion_count(gallivm, type, sample_mask, counter);
+      }
+
+      LLVMBuildStore(builder, sample_mask, sample_mask_ptr);
+   }
+}
+
+
 /**
  * Generate the fragment shader, depth/stencil test, and alpha tests.
  */
@@ -232,7 +345,11 @@ generate_fs_loop(struct gallivm_state *gallivm,
                  LLVMValueRef depth_ptr,
                  LLVMValueRef depth_stride,
                  LLVMValueRef facing,
-                 LLVMValueRef thread_data_ptr)
+                 LLVMValueRef thread_data_ptr,
+                 LLVMValueRef sample_mask_store,
+                 LLVMValueRef depth_sample_stride,
+                 LLVMValueRef dzdx,
+                 LLVMValueRef dzdy)
 {
    const struct util_format_description *zs_format_desc = NULL;
    const struct tgsi_token *tokens = shader->base.tokens;
@@ -298,6 +415,14 @@ generate_fs_loop(struct gallivm_state *gallivm,
                                         (key->stencil[1].enabled &&
                                          key->stencil[1].writemask))))
          depth_mode &= ~(LATE_DEPTH_WRITE | EARLY_DEPTH_WRITE);
+
+      /* Samples are tested once the shader has run for the pixel */
+      if (key->multisample) {
+         if (depth_mode & (EARLY_DEPTH_WRITE | LATE_DEPTH_WRITE))
+            depth_mode = LATE_DEPTH_TEST | LATE_DEPTH_WRITE;
+         else
+            depth_mode = LATE_DEPTH_TEST;
+      }
    }
    else {
       depth_mode = 0;
@@ -390,7 +515,7 @@ generate_fs_loop(struct gallivm_state *gallivm,
    lp_build_tgsi_soa(gallivm, tokens, type, &mask,
                      consts_ptr, &system_values,
                      interp->inputs,
-                     outputs, sampler, &shader->info.base, NULL);
+                     outputs, sampler, &shader->info.base, NULL, NULL);
 
    /* Alpha test */
    if (key->alpha.enabled) {
@@ -415,7 +540,24 @@ generate_fs_loop(struct gallivm_state *gallivm,
    }
 
    /* Late Z test */
-   if (depth_mode & LATE_DEPTH_TEST) {
+   if (key->multisample) {
+      int pos0 = find_output_by_semantic(&shader->info.base,
+                                         TGSI_SEMANTIC_POSITION,
+                                         0);
+
+      if (pos0 != -1 && outputs[pos0][2]) {
+         z = LLVMBuildLoad(builder, outputs[pos0][2], "output.z");
+         dzdx = dzdy = NULL;
+      }
+
+      generate_fs_samples(gallivm, key, type, zs_format_desc, depth_mode,
+                          lp_build_mask_value(&mask), sample_mask_store,
+                          loop_state.counter, z, dzdx, dzdy,
+                          stencil_refs, facing,
+                          depth_ptr, depth_stride, depth_sample_stride,
+                          thread_data_ptr);
+   }
+   else if (depth_mode & LATE_DEPTH_TEST) {
       int pos0 = find_output_by_semantic(&shader->info.base,
                                          TGSI_SEMANTIC_POSITION,
                                          0);
@@ -487,7 +629,7 @@ generate_fs_loop(struct gallivm_state *gallivm,
       }
    }
 
-   if (key->occlusion_count) {
+   if (key->occlusion_count && !key->multisample) {
       LLVMValueRef counter = lp_jit_thread_data_counter(gallivm, thread_data_ptr);
       lp_build_name(counter, "counter");
       lp_build_occlusion_count(gallivm, type,
@@ -1941,8 +2083,9 @@ generate_fragment(struct llvmpipe_context *lp,
    struct lp_type blend_type;
    LLVMTypeRef fs_elem_type;
    LLVMTypeRef blend_vec_type;
-   LLVMTypeRef arg_types[13];
+   LLVMTypeRef arg_types[15];
    LLVMTypeRef func_type;
+   LLVMTypeRef int64_type = LLVMInt64TypeInContext(gallivm->context);
    LLVMTypeRef int32_type = LLVMInt32TypeInContext(gallivm->context);
    LLVMTypeRef int8_type = LLVMInt8TypeInContext(gallivm->context);
    LLVMValueRef context_ptr;
@@ -1957,16 +2100,22 @@ generate_fragment(struct llvmpipe_context *lp,
    LLVMValueRef depth_stride;
    LLVMValueRef mask_input;
    LLVMValueRef thread_data_ptr;
+   LLVMValueRef sample_stride_ptr;
+   LLVMValueRef depth_sample_stride;
+   LLVMValueRef pixel_mask_input;
+   LLVMValueRef sample_mask_store = NULL;
+   LLVMValueRef dzdx = NULL, dzdy = NULL;
    LLVMBasicBlockRef block;
    LLVMBuilderRef builder;
    struct lp_build_sampler_soa *sampler;
    struct lp_build_interp_soa_context interp;
    LLVMValueRef fs_mask[16 / 4];
+   LLVMValueRef fs_sample_mask[LP_MAX_SAMPLES][16 / 4];
    LLVMValueRef fs_out_color[PIPE_MAX_COLOR_BUFS][TGSI_NUM_CHANNELS][16 / 4];
    LLVMValueRef function;
    LLVMValueRef facing;
    unsigned num_fs;
-   unsigned i;
+   unsigned i, s;
    unsigned chan;
    unsigned cbuf;
    boolean cbuf0_write_all;
@@ -2035,10 +2184,12 @@ generate_fragment(struct llvmpipe_context *lp,
    arg_types[6] = LLVMPointerType(fs_elem_type, 0);    /* dady */
    arg_types[7] = LLVMPointerType(LLVMPointerType(blend_vec_type, 0), 0);  /* color */
    arg_types[8] = LLVMPointerType(int8_type, 0);       /* depth */
-   arg_types[9] = int32_type;                          /* mask_input */
+   arg_types[9] = int64_type;                          /* mask_input */
    arg_types[10] = variant->jit_thread_data_ptr_type;  /* per thread data */
    arg_types[11] = LLVMPointerType(int32_type, 0);     /* stride */
    arg_types[12] = int32_type;                         /* depth_stride */
+   arg_types[13] = LLVMPointerType(int32_type, 0);     /* sample_stride */
+   arg_types[14] = int32_type;                         /* depth_sample_stride */
 
    func_type = LLVMFunctionType(LLVMVoidTypeInContext(gallivm->context),
                                 arg_types, Elements(arg_types), 0);
@@ -2068,6 +2219,8 @@ generate_fragment(struct llvmpipe_context *lp,
    thread_data_ptr  = LLVMGetParam(function, 10);
    stride_ptr   = LLVMGetParam(function, 11);
    depth_stride = LLVMGetParam(function, 12);
+   sample_stride_ptr = LLVMGetParam(function, 13);
+   depth_sample_stride = LLVMGetParam(function, 14);
 
    lp_build_name(context_ptr, "context");
    lp_build_name(x, "x");
@@ -2081,6 +2234,8 @@ generate_fragment(struct llvmpipe_context *lp,
    lp_build_name(mask_input, "mask_input");
    lp_build_name(stride_ptr, "stride_ptr");
    lp_build_name(depth_stride, "depth_stride");
+   lp_build_name(sample_stride_ptr, "sample_stride_ptr");
+   lp_build_name(depth_sample_stride, "depth_sample_stride");
 
    /*
     * Function body
@@ -2099,6 +2254,38 @@ generate_fragment(struct llvmpipe_context *lp,
    if (key->resource_1d)
       num_fs /= 2;
 
+   /*
+    * The mask has 16 bits of coverage per sample.  Without multisampling
+    * only the first 16 are relevant, otherwise the shader runs for the
+    * pixels with any sample covered.
+    */
+   if (key->multisample) {
+      LLVMValueRef bits = mask_input;
+      for (s = 1; s < LP_MAX_SAMPLES; s++) {
+         bits = LLVMBuildOr(builder, bits,
+                            LLVMBuildLShr(builder, mask_input,
+                                          LLVMConstInt(int64_type, 16 * s, 0), ""),
+                            "");
+      }
+      pixel_mask_input = LLVMBuildTrunc(builder, bits, int32_type, "");
+      pixel_mask_input = LLVMBuildAnd(builder, pixel_mask_input,
+                                      lp_build_const_int32(gallivm, 0xffff), "");
+
+      /* z gradients, to interpolate z at the sample positions */
+      if (key->depth.enabled || key->stencil[0].enabled) {
+         LLVMValueRef index = lp_build_const_int32(gallivm, 2);
+         dzdx = LLVMBuildLoad(builder,
+                              LLVMBuildGEP(builder, dadx_ptr, &index, 1, ""),
+                              "dzdx");
+         dzdy = LLVMBuildLoad(builder,
+                              LLVMBuildGEP(builder, dady_ptr, &index, 1, ""),
+                              "dzdy");
+      }
+   }
+   else {
+      pixel_mask_input = LLVMBuildTrunc(builder, mask_input, int32_type, "");
+   }
+
    {
       LLVMValueRef num_loop = lp_build_const_int32(gallivm, num_fs);
       LLVMTypeRef mask_type = lp_build_int_vec_type(gallivm, fs_type);
@@ -2128,7 +2315,7 @@ generate_fragment(struct llvmpipe_context *lp,
 
          if (partial_mask) {
             mask = generate_quad_mask(gallivm, fs_type,
-                                      i*fs_type.length/4, mask_input);
+                                      i*fs_type.length/4, pixel_mask_input);
          }
          else {
             mask = lp_build_const_int_vec(gallivm, fs_type, ~0);
@@ -2136,6 +2323,35 @@ generate_fragment(struct llvmpipe_context *lp,
          LLVMBuildStore(builder, mask, mask_ptr);
       }
 
+      /* Per-sample coverage, even for fully covered blocks, since a
+       * compressed tile only gets sample 0 written.
+       */
+      if (key->multisample) {
+         LLVMValueRef num_samples =
+            lp_build_const_int32(gallivm, num_fs * LP_MAX_SAMPLES);
+
+         sample_mask_store = lp_build_array_alloca(gallivm, mask_type,
+                                                   num_samples,
+                                                   "sample_mask_store");
+         for (i = 0; i < num_fs; i++) {
+            for (s = 0; s < LP_MAX_SAMPLES; s++) {
+               LLVMValueRef index =
+                  lp_build_const_int32(gallivm, i * LP_MAX_SAMPLES + s);
+               LLVMValueRef sample_bits =
+                  LLVMBuildLShr(builder, mask_input,
+                                LLVMConstInt(int64_type, 16 * s, 0), "");
+
+               sample_bits = LLVMBuildTrunc(builder, sample_bits, int32_type, "");
+               LLVMBuildStore(builder,
+                              generate_quad_mask(gallivm, fs_type,
+                                                 i*fs_type.length/4,
+                                                 sample_bits),
+                              LLVMBuildGEP(builder, sample_mask_store,
+                                           &index, 1, ""));
+            }
+         }
+      }
+
       generate_fs_loop(gallivm,
                        shader, key,
                        builder,
@@ -2149,13 +2365,27 @@ generate_fragment(struct llvmpipe_context *lp,
                        depth_ptr,
                        depth_stride,
                        facing,
-                       thread_data_ptr);
+                       thread_data_ptr,
+                       sample_mask_store,
+                       depth_sample_stride,
+                       dzdx, dzdy);
 
       for (i = 0; i < num_fs; i++) {
          LLVMValueRef indexi = lp_build_const_int32(gallivm, i);
          LLVMValueRef ptr = LLVMBuildGEP(builder, mask_store,
                                          &indexi, 1, "");
          fs_mask[i] = LLVMBuildLoad(builder, ptr, "mask");
+         if (key->multisample) {
+            /* the pixel mask is zero if the loop skipped the samples */
+            for (s = 0; s < LP_MAX_SAMPLES; s++) {
+               LLVMValueRef index =
+                  lp_build_const_int32(gallivm, i * LP_MAX_SAMPLES + s);
+               ptr = LLVMBuildGEP(builder, sample_mask_store, &index, 1, "");
+               fs_sample_mask[s][i] = LLVMBuildAnd(builder, fs_mask[i],
+                                                   LLVMBuildLoad(builder, ptr, ""),
+                                                   "sample_mask");
+            }
+         }
          /* This is fucked up need to reorganize things */
          for (cbuf = 0; cbuf < key->nr_cbufs; cbuf++) {
             for (chan = 0; chan < TGSI_NUM_CHANNELS; ++chan) {
@@ -2201,9 +2431,40 @@ generate_fragment(struct llvmpipe_context *lp,
                              LLVMBuildGEP(builder, stride_ptr, &index, 1, ""),
                              "");
 
-      generate_unswizzled_blend(gallivm, cbuf, variant, key->cbuf_format[cbuf],
-                                num_fs, fs_type, fs_mask, fs_out_color,
-                                context_ptr, color_ptr, stride, partial_mask, do_branch);
+      if (key->multisample) {
+         LLVMValueRef sample_stride;
+
+         sample_stride = LLVMBuildLoad(builder,
+                                       LLVMBuildGEP(builder, sample_stride_ptr,
+                                                    &index, 1, ""),
+                                       "");
+
+         /* Blend each sample plane under its own mask, skipping those
+          * with nothing covered.
+          */
+         for (s = 0; s < LP_MAX_SAMPLES; s++) {
+            LLVMValueRef offset = LLVMBuildMul(builder, sample_stride,
+                                               lp_build_const_int32(gallivm, s), "");
+            LLVMValueRef sample_color_ptr;
+
+            sample_color_ptr = LLVMBuildBitCast(builder, color_ptr,
+                                                LLVMPointerType(int8_type, 0), "");
+            sample_color_ptr = LLVMBuildGEP(builder, sample_color_ptr,
+                                            &offset, 1, "");
+            sample_color_ptr = LLVMBuildBitCast(builder, sample_color_ptr,
+                                                LLVMTypeOf(color_ptr), "");
+
+            generate_unswizzled_blend(gallivm, cbuf, variant, key->cbuf_format[cbuf],
+                                      num_fs, fs_type, fs_sample_mask[s], fs_out_color,
+                                      context_ptr, sample_color_ptr, stride,
+                                      TRUE, TRUE);
+         }
+      }
+      else {
+         generate_unswizzled_blend(gallivm, cbuf, variant, key->cbuf_format[cbuf],
+                                   num_fs, fs_type, fs_mask, fs_out_color,
+                                   context_ptr, color_ptr, stride, partial_mask, do_branch);
+      }
    }
 
    LLVMBuildRetVoid(builder);
@@ -2252,6 +2513,10 @@ dump_fs_variant_key(const struct lp_fragment_shader_variant_key *key)
       debug_printf("occlusion_count = 1\n");
    }
 
+   if (key->multisample) {
+      debug_printf("multisample = 1\n");
+   }
+
    if (key->blend.logicop_enable) {
       debug_printf("blend.logicop_func = %s\n", util_dump_logicop(key->blend.logicop_func, TRUE));
    }
@@ -2314,6 +2579,199 @@ lp_debug_fs_variant(const struct lp_fragment_shader_variant *variant)
 }
 
 
+/*
+ * Screen-wide cache of compiled variant code.
+ */
+
+static unsigned
+fs_code_hash(void *key)
+{
+   const struct lp_fs_variant_code *code = key;
+
+   return code->hash;
+}
+
+
+static int
+fs_code_compare(void *key1, void *key2)
+{
+   const struct lp_fs_variant_code *a = key1;
+   const struct lp_fs_variant_code *b = key2;
+
+   if (a->hash != b->hash ||
+       a->nr_tokens != b->nr_tokens ||
+       a->key_size != b->key_size)
+      return 1;
+
+   if (memcmp(&a->key, &b->key, a->key_size) != 0)
+      return 1;
+
+   return memcmp(a->tokens, b->tokens,
+                 a->nr_tokens * sizeof(struct tgsi_token)) != 0;
+}
+
+
+boolean
+lp_fs_cache_init(struct llvmpipe_screen *screen)
+{
+   screen->fs_cache = util_hash_table_create(fs_code_hash, fs_code_compare);
+   if (!screen->fs_cache)
+      return FALSE;
+
+   pipe_mutex_init(screen->fs_cache_mutex);
+   return TRUE;
+}
+
+
+void
+lp_fs_cache_destroy(struct llvmpipe_screen *screen)
+{
+   if (LP_DEBUG & DEBUG_COUNTERS) {
+      debug_printf("llvmpipe: fs variants compiled:         %u\n",
+                   screen->fs_cache_compiles);
+      debug_printf("llvmpipe: fs variants shared:           %u\n",
+                   screen->fs_cache_hits);
+      debug_printf("llvmpipe: LLVM compile time saved:      %.2f sec\n",
+                   screen->fs_cache_time_saved / 1000000.0);
+   }
+
+   /* All contexts, and so all the variants referencing the code, are gone */
+   util_hash_table_destroy(screen->fs_cache);
+   pipe_mutex_destroy(screen->fs_cache_mutex);
+}
+
+
+static unsigned
+fs_code_key_hash(const struct lp_fragment_shader *shader,
+                 const struct lp_fragment_shader_variant_key *key)
+{
+   return shader->tokens_hash ^
+          util_hash_crc32(key, shader->variant_key_size);
+}
+
+
+/**
+ * Look for code compiled for the same shader tokens and key, by any
+ * context, and take a reference to it.
+ */
+static struct lp_fs_variant_code *
+fs_cache_acquire(struct llvmpipe_screen *screen,
+                 const struct lp_fragment_shader *shader,
+                 const struct lp_fragment_shader_variant_key *key,
+                 unsigned hash)
+{
+   struct lp_fs_variant_code lookup;
+   struct lp_fs_variant_code *code;
+
+   lookup.hash = hash;
+   lookup.tokens = shader->base.tokens;
+   lookup.nr_tokens = shader->nr_tokens;
+   lookup.key_size = shader->variant_key_size;
+   memcpy(&lookup.key, key, shader->variant_key_size);
+
+   pipe_mutex_lock(screen->fs_cache_mutex);
+   code = util_hash_table_get(screen->fs_cache, &lookup);
+   if (code) {
+      code->refcount++;
+      screen->fs_cache_hits++;
+      screen->fs_cache_time_saved += code->compile_time;
+   }
+   pipe_mutex_unlock(screen->fs_cache_mutex);
+
+   return code;
+}
+
+
+/**
+ * Hand the code of a freshly compiled variant over to the cache, so that
+ * other variants can share it.  If that fails the variant keeps owning its
+ * code.
+ */
+static void
+fs_cache_insert(struct llvmpipe_screen *screen,
+                const struct lp_fragment_shader *shader,
+                struct lp_fragment_shader_variant *variant,
+                unsigned hash, int64_t compile_time)
+{
+   struct lp_fs_variant_code *code;
+   unsigned i;
+
+   code = CALLOC_STRUCT(lp_fs_variant_code);
+   if (!code)
+      return;
+
+   code->hash = hash;
+   code->tokens = tgsi_dup_tokens(shader->base.tokens);
+   code->nr_tokens = shader->nr_tokens;
+   code->key_size = shader->variant_key_size;
+   memcpy(&code->key, &variant->key, shader->variant_key_size);
+   if (!code->tokens) {
+      FREE(code);
+      return;
+   }
+
+   /* The entry is visible to other contexts as soon as it's in the table,
+    * so it must be complete by then.
+    */
+   code->gallivm = variant->gallivm;
+   for (i = 0; i < Elements(code->function); i++) {
+      code->function[i] = variant->function[i];
+      code->jit_function[i] = variant->jit_function[i];
+   }
+   code->nr_instrs = variant->nr_instrs;
+   code->compile_time = compile_time;
+   code->refcount = 1;
+
+   pipe_mutex_lock(screen->fs_cache_mutex);
+   /* Another context may have compiled the same code meanwhile */
+   if (util_hash_table_get(screen->fs_cache, code) ||
+       util_hash_table_set(screen->fs_cache, code, code) != PIPE_OK) {
+      pipe_mutex_unlock(screen->fs_cache_mutex);
+      FREE((void *) code->tokens);
+      FREE(code);
+      return;
+   }
+   screen->fs_cache_compiles++;
+   variant->code = code;
+   pipe_mutex_unlock(screen->fs_cache_mutex);
+}
+
+
+/**
+ * Drop a variant's reference to shared code, freeing the code once no
+ * variant of any context uses it anymore.
+ */
+static void
+fs_cache_release(struct llvmpipe_screen *screen,
+                 struct lp_fs_variant_code *code)
+{
+   boolean destroy;
+   unsigned i;
+
+   pipe_mutex_lock(screen->fs_cache_mutex);
+   assert(code->refcount > 0);
+   destroy = --code->refcount == 0;
+   if (destroy)
+      util_hash_table_remove(screen->fs_cache, code);
+   pipe_mutex_unlock(screen->fs_cache_mutex);
+
+   if (!destroy)
+      return;
+
+   for (i = 0; i < Elements(code->function); i++) {
+      if (code->function[i]) {
+         gallivm_free_function(code->gallivm,
+                               code->function[i],
+                               code->jit_function[i]);
+      }
+   }
+
+   gallivm_destroy(code->gallivm);
+   FREE((void *) code->tokens);
+   FREE(code);
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
@@ -2323,20 +2781,18 @@ generate_variant(struct llvmpipe_context *lp,
                  struct lp_fragment_shader *shader,
                  const struct lp_fragment_shader_variant_key *key)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_fragment_shader_variant *variant;
    const struct util_format_description *cbuf0_format_desc;
    boolean fullcolormask;
+   unsigned hash;
+   unsigned i;
+   int64_t t0, dt;
 
    variant = CALLOC_STRUCT(lp_fragment_shader_variant);
    if(!variant)
       return NULL;
 
-   variant->gallivm = gallivm_create();
-   if (!variant->gallivm) {
-      FREE(variant);
-      return NULL;
-   }
-
    variant->shader = shader;
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -2363,10 +2819,40 @@ generate_variant(struct llvmpipe_context *lp,
          !shader->info.base.uses_kill
          ? TRUE : FALSE;
 
+   variant->sample_invariant =
+         !key->stencil[0].enabled &&
+         !key->depth.enabled &&
+         !key->occlusion_count
+         ? TRUE : FALSE;
+
    if ((LP_DEBUG & DEBUG_FS) || (gallivm_debug & GALLIVM_DEBUG_IR)) {
       lp_debug_fs_variant(variant);
    }
 
+   /*
+    * Reuse the code if the same variant was already compiled, for this
+    * or any other context.
+    */
+   hash = fs_code_key_hash(shader, key);
+   variant->code = fs_cache_acquire(screen, shader, key, hash);
+   if (variant->code) {
+      variant->gallivm = variant->code->gallivm;
+      for (i = 0; i < Elements(variant->function); i++) {
+         variant->function[i] = variant->code->function[i];
+         variant->jit_function[i] = variant->code->jit_function[i];
+      }
+      variant->nr_instrs = variant->code->nr_instrs;
+      return variant;
+   }
+
+   variant->gallivm = gallivm_create();
+   if (!variant->gallivm) {
+      FREE(variant);
+      return NULL;
+   }
+
+   t0 = os_time_get();
+
    lp_jit_init_types(variant);
    
    if (variant->jit_function[RAST_EDGE_TEST] == NULL)
@@ -2399,6 +2885,12 @@ generate_variant(struct llvmpipe_context *lp,
       variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
    }
 
+   dt = os_time_get() - t0;
+   LP_COUNT_ADD(llvm_compile_time, dt);
+   LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
+
+   fs_cache_insert(screen, shader, variant, hash, dt);
+
    return variant;
 }
 
@@ -2426,6 +2918,11 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
    /* we need to keep a local copy of the tokens */
    shader->base.tokens = tgsi_dup_tokens(templ->tokens);
 
+   shader->nr_tokens = tgsi_num_tokens(templ->tokens);
+   shader->tokens_hash = util_hash_crc32(templ->tokens,
+                                         shader->nr_tokens *
+                                         sizeof(struct tgsi_token));
+
    shader->draw_data = draw_create_fragment_shader(llvmpipe->draw, templ);
    if (shader->draw_data == NULL) {
       FREE((void *) shader->base.tokens);
@@ -2535,16 +3032,21 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants);
    }
 
-   /* free all the variant's JIT'd functions */
-   for (i = 0; i < Elements(variant->function); i++) {
-      if (variant->function[i]) {
-         gallivm_free_function(variant->gallivm,
-                               variant->function[i],
-                               variant->jit_function[i]);
-      }
+   if (variant->code) {
+      fs_cache_release(llvmpipe_screen(lp->pipe.screen), variant->code);
    }
+   else {
+      /* free all the variant's JIT'd functions */
+      for (i = 0; i < Elements(variant->function); i++) {
+         if (variant->function[i]) {
+            gallivm_free_function(variant->gallivm,
+                                  variant->function[i],
+                                  variant->jit_function[i]);
+         }
+      }
 
-   gallivm_destroy(variant->gallivm);
+      gallivm_destroy(variant->gallivm);
+   }
 
    /* remove from shader's list */
    remove_from_list(&variant->list_item_local);
@@ -2604,6 +3106,16 @@ llvmpipe_set_constant_buffer(struct pipe_context *pipe,
    assert(shader < PIPE_SHADER_TYPES);
    assert(index < Elements(llvmpipe->constants[shader]));
 
+   if (shader == PIPE_SHADER_VERTEX ||
+       shader == PIPE_SHADER_GEOMETRY) {
+      /* see llvmpipe_rename_buffer() */
+      struct pipe_resource *old = llvmpipe->constants[shader][index].buffer;
+      if (old)
+         p_atomic_dec(&llvmpipe_resource(old)->draw_constant_refs);
+      if (constants)
+         p_atomic_inc(&llvmpipe_resource(constants)->draw_constant_refs);
+   }
+
    /* note: reference counting */
    util_copy_constant_buffer(&llvmpipe->constants[shader][index], cb);
 
@@ -2660,12 +3172,68 @@ force_dst_alpha_one(unsigned factor, boolean clamped_zero)
 }
 
 
+/**
+ * Clear the parts of the key which don't affect the generated code, so
+ * that equivalent state doesn't produce distinct variants.
+ */
+static void
+canonicalize_variant_key(const struct lp_fragment_shader *shader,
+                         struct lp_fragment_shader_variant_key *key)
+{
+   boolean color_inputs = FALSE;
+   unsigned i;
+
+   /* flatshade only changes the interpolation of color inputs */
+   for (i = 0; i < shader->info.base.num_inputs; i++) {
+      if (shader->inputs[i].interp == LP_INTERP_COLOR)
+         color_inputs = TRUE;
+   }
+   if (!color_inputs)
+      key->flatshade = 0;
+
+   for (i = 0; i < 2; i++) {
+      struct pipe_stencil_state *stencil = &key->stencil[i];
+
+      if (!stencil->enabled) {
+         memset(stencil, 0, sizeof *stencil);
+      }
+      else if (stencil->func == PIPE_FUNC_NEVER ||
+               stencil->func == PIPE_FUNC_ALWAYS) {
+         /* the value mask only applies to the comparison */
+         stencil->valuemask = 0xff;
+      }
+   }
+
+   /* factors and functions don't matter when blending is disabled */
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      struct pipe_rt_blend_state *rt = &key->blend.rt[i];
+
+      if (i >= key->nr_cbufs) {
+         memset(rt, 0, sizeof *rt);
+      }
+      else if (!rt->blend_enable) {
+         unsigned colormask = rt->colormask;
+         memset(rt, 0, sizeof *rt);
+         rt->colormask = colormask;
+      }
+   }
+
+   if (!key->blend.logicop_enable)
+      key->blend.logicop_func = 0;
+
+   /* not implemented */
+   key->blend.dither = 0;
+   key->blend.alpha_to_coverage = 0;
+   key->blend.alpha_to_one = 0;
+}
+
+
 /**
  * We need to generate several variants of the fragment pipeline to match
  * all the combinations of the contributing state atoms.
  *
- * TODO: there is actually no reason to tie this to context state -- the
- * generated code could be cached globally in the screen.
+ * The generated code itself is shared by all contexts, see
+ * fs_cache_acquire().
  */
 static void
 make_variant_key(struct llvmpipe_context *lp,
@@ -2710,6 +3278,10 @@ make_variant_key(struct llvmpipe_context *lp,
       key->occlusion_count = TRUE;
    }
 
+   if (util_framebuffer_get_num_samples(&lp->framebuffer) > 1) {
+      key->multisample = TRUE;
+   }
+
    if (lp->framebuffer.nr_cbufs) {
       memcpy(&key->blend, lp->blend, sizeof key->blend);
    }
@@ -2820,6 +3392,8 @@ make_variant_key(struct llvmpipe_context *lp,
          }
       }
    }
+
+   canonicalize_variant_key(shader, key);
 }
 
 
@@ -2856,7 +3430,6 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
    }
    else {
       /* variant not found, create it now */
-      int64_t t0, t1, dt;
       unsigned i;
       unsigned variants_to_cull;
 
@@ -2904,12 +3477,7 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
       /*
        * Generate the new variant.
        */
-      t0 = os_time_get();
       variant = generate_variant(lp, shader, &key);
-      t1 = os_time_get();
-      dt = t1 - t0;
-      LP_COUNT_ADD(llvm_compile_time, dt);
-      LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
 
       llvmpipe_variant_count++;
 
@@ -40,6 +40,7 @@
 
 struct tgsi_token;
 struct lp_fragment_shader;
+struct llvmpipe_screen;
 
 
 /** Indexes into jit_function[] array */
@@ -76,6 +77,7 @@ struct lp_fragment_shader_variant_key
    unsigned flatshade:1;
    unsigned occlusion_count:1;
    unsigned resource_1d:1;
+   unsigned multisample:1;      /* render to LP_MAX_SAMPLES samples */
 
    enum pipe_format zsbuf_format;
    enum pipe_format cbuf_format[PIPE_MAX_COLOR_BUFS];
@@ -92,12 +94,52 @@ struct lp_fs_variant_list_item
 };
 
 
+/**
+ * Compiled code of a fragment shader variant.
+ *
+ * The code only depends on the shader tokens and on the variant key, so it
+ * is kept in a screen-wide cache and shared by the variants of all the
+ * contexts (and threads) which use the same shader with the same state.
+ */
+struct lp_fs_variant_code
+{
+   /* Lookup key */
+   unsigned hash;
+   const struct tgsi_token *tokens;
+   unsigned nr_tokens;
+   unsigned key_size;
+
+   /** Number of variants using this code, protected by fs_cache_mutex */
+   unsigned refcount;
+
+   struct gallivm_state *gallivm;
+   LLVMValueRef function[2];
+   lp_jit_frag_func jit_function[2];
+   unsigned nr_instrs;
+
+   /** Time it took to compile, in microseconds */
+   int64_t compile_time;
+
+   /* Must be last, only the first key_size bytes are meaningful */
+   struct lp_fragment_shader_variant_key key;
+};
+
+
 struct lp_fragment_shader_variant
 {
    struct lp_fragment_shader_variant_key key;
 
    boolean opaque;
 
+   /**
+    * All samples of a fully covered pixel get the same result, i.e. there
+    * is no per-sample depth/stencil test or occlusion counting.
+    */
+   boolean sample_invariant;
+
+   /** Shared code this variant's functions come from, or NULL if owned */
+   struct lp_fs_variant_code *code;
+
    struct gallivm_state *gallivm;
 
    LLVMTypeRef jit_context_ptr_type;
@@ -130,6 +172,10 @@ struct lp_fragment_shader
 
    struct draw_fragment_shader *draw_data;
 
+   /** Hash of the tokens, for the screen's variant code cache */
+   unsigned tokens_hash;
+   unsigned nr_tokens;
+
    /* For debugging/profiling purposes */
    unsigned variant_key_size;
    unsigned no;
@@ -148,5 +194,11 @@ void
 llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                                struct lp_fragment_shader_variant *variant);
 
+boolean
+lp_fs_cache_init(struct llvmpipe_screen *screen);
+
+void
+lp_fs_cache_destroy(struct llvmpipe_screen *screen);
+
 
 #endif /* LP_STATE_FS_H_ */
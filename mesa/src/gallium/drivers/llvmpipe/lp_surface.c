@@ -25,11 +25,19 @@
  * 
  **************************************************************************/
 
+#include "util/u_atomic.h"
+#include "util/u_format.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
 #include "util/u_rect.h"
+#include "util/u_sse.h"
 #include "util/u_surface.h"
 #include "lp_context.h"
 #include "lp_flush.h"
 #include "lp_limits.h"
+#include "lp_perf.h"
+#include "lp_rast.h"
+#include "lp_screen.h"
 #include "lp_surface.h"
 #include "lp_texture.h"
 #include "lp_query.h"
@@ -50,6 +58,53 @@ adjust_to_tile_bounds(unsigned x, unsigned y, unsigned width, unsigned height,
 }
 
 
+/**
+ * Expand the compressed tiles of a multisampled color resource which
+ * intersect the given rectangle, so that every sample plane holds valid
+ * data there, and mark them as uncompressed.
+ */
+void
+llvmpipe_ms_decompress_region(struct llvmpipe_resource *lpr, unsigned layer,
+                              unsigned x, unsigned y,
+                              unsigned width, unsigned height)
+{
+   const enum pipe_format format = lpr->base.format;
+   const unsigned nr_samples = llvmpipe_resource_nr_samples(&lpr->base);
+   const unsigned stride = llvmpipe_resource_stride(&lpr->base, 0);
+   unsigned tx, ty, tw, th;
+   unsigned i, j, s;
+   ubyte *map;
+
+   if (!lpr->ms_compressed || !width || !height)
+      return;
+
+   map = llvmpipe_get_texture_image(lpr, layer, 0, LP_TEX_USAGE_READ_WRITE);
+   if (!map)
+      return;
+
+   adjust_to_tile_bounds(x, y, width, height, &tx, &ty, &tw, &th);
+
+   for (j = ty; j < ty + th; j += TILE_SIZE) {
+      for (i = tx; i < tx + tw; i += TILE_SIZE) {
+         uint8_t *flag = llvmpipe_resource_ms_tile(lpr, layer,
+                                                   i / TILE_SIZE,
+                                                   j / TILE_SIZE);
+         if (*flag) {
+            unsigned w = MIN2(TILE_SIZE, lpr->base.width0 - i);
+            unsigned h = MIN2(TILE_SIZE, lpr->base.height0 - j);
+
+            for (s = 1; s < nr_samples; s++) {
+               util_copy_rect(map + s * lpr->sample_stride, format, stride,
+                              i, j, w, h,
+                              map, stride, i, j);
+            }
+            *flag = 0;
+         }
+      }
+   }
+}
+
+
 
 static void
 lp_resource_copy(struct pipe_context *pipe,
@@ -64,7 +119,8 @@ lp_resource_copy(struct pipe_context *pipe,
    unsigned width = src_box->width;
    unsigned height = src_box->height;
    unsigned depth = src_box->depth;
-   unsigned z;
+   unsigned nr_samples = llvmpipe_resource_nr_samples(src);
+   unsigned z, s;
 
    llvmpipe_flush_resource(pipe,
                            dst, dst_level,
@@ -96,6 +152,14 @@ lp_resource_copy(struct pipe_context *pipe,
 
    for (z = 0; z < src_box->depth; z++){
 
+      /* multisampled resources are copied sample by sample */
+      if (nr_samples > 1) {
+         llvmpipe_ms_decompress_region(src_tex, src_box->z + z,
+                                       src_box->x, src_box->y, width, height);
+         llvmpipe_ms_decompress_region(dst_tex, dstz + z,
+                                       dstx, dsty, width, height);
+      }
+
       /* set src tiles to linear layout */
       {
          unsigned tx, ty, tw, th;
@@ -160,17 +224,214 @@ lp_resource_copy(struct pipe_context *pipe,
                                               dst_level);
 
       if (dst_linear_ptr && src_linear_ptr) {
-         util_copy_box(dst_linear_ptr, format,
-                       llvmpipe_resource_stride(&dst_tex->base, dst_level),
-                       dst_tex->img_stride[dst_level],
-                       dstx, dsty, 0,
-                       width, height, depth,
-                       src_linear_ptr,
-                       llvmpipe_resource_stride(&src_tex->base, src_level),
-                       src_tex->img_stride[src_level],
-                       src_box->x, src_box->y, 0);
+         assert(llvmpipe_resource_nr_samples(dst) == nr_samples);
+
+         for (s = 0; s < nr_samples; s++) {
+            util_copy_box(dst_linear_ptr + s * dst_tex->sample_stride, format,
+                          llvmpipe_resource_stride(&dst_tex->base, dst_level),
+                          dst_tex->img_stride[dst_level],
+                          dstx, dsty, 0,
+                          width, height, depth,
+                          src_linear_ptr + s * src_tex->sample_stride,
+                          llvmpipe_resource_stride(&src_tex->base, src_level),
+                          src_tex->img_stride[src_level],
+                          src_box->x, src_box->y, 0);
+         }
+      }
+   }
+}
+
+
+/**
+ * Average the samples of one row of an 8 bit per channel unorm format.
+ */
+static void
+ms_resolve_row_8unorm(ubyte *dst, const ubyte *src, unsigned sample_stride,
+                      unsigned nr_samples, unsigned num_bytes)
+{
+   unsigned i, s;
+
+   for (i = 0; i < num_bytes; i++) {
+      unsigned sum = nr_samples / 2;
+      for (s = 0; s < nr_samples; s++)
+         sum += src[s * sample_stride + i];
+      dst[i] = sum / nr_samples;
+   }
+}
+
+
+/**
+ * Average the samples of one row of any other color format, in floating
+ * point, which also takes care of sRGB decoding and encoding.
+ */
+static void
+ms_resolve_row_float(const struct util_format_description *desc,
+                     ubyte *dst, const ubyte *src, unsigned sample_stride,
+                     unsigned nr_samples, unsigned width)
+{
+   float sum[TILE_SIZE][4];
+   float tmp[TILE_SIZE][4];
+   unsigned i, c, s;
+
+   assert(width <= TILE_SIZE);
+
+   desc->unpack_rgba_float(&sum[0][0], 0, src, 0, width, 1);
+   for (s = 1; s < nr_samples; s++) {
+      desc->unpack_rgba_float(&tmp[0][0], 0, src + s * sample_stride, 0,
+                              width, 1);
+      for (i = 0; i < width; i++)
+         for (c = 0; c < 4; c++)
+            sum[i][c] += tmp[i][c];
+   }
+
+   for (i = 0; i < width; i++)
+      for (c = 0; c < 4; c++)
+         sum[i][c] *= 1.0f / nr_samples;
+
+   desc->pack_rgba_float(dst, 0, &sum[0][0], 0, width, 1);
+}
+
+
+/**
+ * Whether the samples of a format can be averaged byte by byte.
+ */
+static boolean
+format_is_8unorm(const struct util_format_description *desc)
+{
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB)
+      return FALSE;
+
+   for (i = 0; i < desc->nr_channels; i++) {
+      const struct util_format_channel_description *chan = &desc->channel[i];
+      if (chan->size != 8)
+         return FALSE;
+      if (chan->type != UTIL_FORMAT_TYPE_VOID &&
+          !(chan->type == UTIL_FORMAT_TYPE_UNSIGNED && chan->normalized))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Resolve a multisampled surface into a single-sampled one of the same
+ * format, tile by tile.  Compressed tiles only need their sample 0 copied;
+ * the others get their samples averaged, except for depth/stencil and
+ * integer formats, where sample 0 is taken as is.
+ * \return FALSE if the blit is more than a straight resolve
+ */
+static boolean
+lp_resolve(struct pipe_context *pipe, const struct pipe_blit_info *info)
+{
+   struct pipe_resource *src = info->src.resource;
+   struct pipe_resource *dst = info->dst.resource;
+   struct llvmpipe_resource *src_tex = llvmpipe_resource(src);
+   struct llvmpipe_resource *dst_tex = llvmpipe_resource(dst);
+   const enum pipe_format format = src->format;
+   const struct util_format_description *desc = util_format_description(format);
+   const unsigned nr_samples = llvmpipe_resource_nr_samples(src);
+   const unsigned blocksize = util_format_get_blocksize(format);
+   const int sx = info->src.box.x, sy = info->src.box.y;
+   const int width = info->src.box.width, height = info->src.box.height;
+   unsigned src_stride, dst_stride;
+   boolean average, bytewise;
+   int x, y, z;
+
+   if (info->src.format != format ||
+       info->dst.format != format ||
+       dst->format != format ||
+       dst->nr_samples > 1 ||
+       !llvmpipe_resource_is_texture(dst) ||
+       info->dst.box.width != width ||
+       info->dst.box.height != height ||
+       info->dst.box.depth != info->src.box.depth ||
+       width <= 0 || height <= 0 || info->src.box.depth <= 0 ||
+       sx < 0 || sy < 0 || info->dst.box.x < 0 || info->dst.box.y < 0 ||
+       sx + width > (int) src->width0 || sy + height > (int) src->height0 ||
+       info->mask != util_format_get_mask(format) ||
+       info->scissor_enable)
+      return FALSE;
+
+   average = !util_format_is_depth_or_stencil(format) &&
+             !util_format_is_pure_integer(format);
+   bytewise = average && format_is_8unorm(desc);
+
+   llvmpipe_flush_resource(pipe,
+                           dst, info->dst.level,
+                           FALSE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE, /* do_not_block */
+                           "resolve dest");
+
+   llvmpipe_flush_resource(pipe,
+                           src, 0,
+                           TRUE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE, /* do_not_block */
+                           "resolve src");
+
+   src_stride = llvmpipe_resource_stride(src, 0);
+   dst_stride = llvmpipe_resource_stride(dst, info->dst.level);
+
+   for (z = 0; z < info->src.box.depth; z++) {
+      const unsigned src_layer = info->src.box.z + z;
+      const ubyte *src_map =
+         llvmpipe_get_texture_image(src_tex, src_layer, 0,
+                                    LP_TEX_USAGE_READ);
+      ubyte *dst_map =
+         llvmpipe_get_texture_image(dst_tex, info->dst.box.z + z,
+                                    info->dst.level,
+                                    LP_TEX_USAGE_READ_WRITE);
+
+      if (!src_map || !dst_map)
+         return TRUE;
+
+      for (y = sy & ~(TILE_SIZE - 1); y < sy + height; y += TILE_SIZE) {
+         for (x = sx & ~(TILE_SIZE - 1); x < sx + width; x += TILE_SIZE) {
+            const int x0 = MAX2(x, sx), x1 = MIN2(x + TILE_SIZE, sx + width);
+            const int y0 = MAX2(y, sy), y1 = MIN2(y + TILE_SIZE, sy + height);
+            const int dx = info->dst.box.x + x0 - sx;
+            const int dy = info->dst.box.y + y0 - sy;
+            boolean compressed = src_tex->ms_compressed &&
+               *llvmpipe_resource_ms_tile(src_tex, src_layer,
+                                          x / TILE_SIZE, y / TILE_SIZE);
+            int row;
+
+            LP_COUNT(nr_ms_resolve_tiles);
+
+            if (compressed || !average) {
+               if (compressed)
+                  LP_COUNT(nr_ms_resolve_tiles_compressed);
+               util_copy_rect(dst_map, format, dst_stride, dx, dy,
+                              x1 - x0, y1 - y0,
+                              src_map, src_stride, x0, y0);
+               continue;
+            }
+
+            for (row = 0; row < y1 - y0; row++) {
+               const ubyte *src_row =
+                  src_map + (y0 + row) * src_stride + x0 * blocksize;
+               ubyte *dst_row =
+                  dst_map + (dy + row) * dst_stride + dx * blocksize;
+
+               if (bytewise)
+                  ms_resolve_row_8unorm(dst_row, src_row,
+                                        src_tex->sample_stride, nr_samples,
+                                        (x1 - x0) * blocksize);
+               else
+                  ms_resolve_row_float(desc, dst_row, src_row,
+                                       src_tex->sample_stride, nr_samples,
+                                       x1 - x0);
+            }
+         }
       }
    }
+
+   return TRUE;
 }
 
 
@@ -181,10 +442,9 @@ static void lp_blit(struct pipe_context *pipe,
    struct pipe_blit_info info = *blit_info;
 
    if (info.src.resource->nr_samples > 1 &&
-       info.dst.resource->nr_samples <= 1 &&
-       !util_format_is_depth_or_stencil(info.src.resource->format) &&
-       !util_format_is_pure_integer(info.src.resource->format)) {
-      debug_printf("llvmpipe: color resolve unimplemented\n");
+       info.dst.resource->nr_samples <= 1) {
+      if (!lp_resolve(pipe, &info))
+         debug_printf("llvmpipe: non-trivial resolve unimplemented\n");
       return;
    }
 
@@ -233,6 +493,322 @@ static void lp_blit(struct pipe_context *pipe,
 }
 
 
+/** Destination rows per unit of mipmap generation work */
+#define MIP_BAND_ROWS 16
+
+
+/**
+ * Downsampling of one mipmap level, split into bands of rows of each
+ * destination layer/slice for the rasterizer threads to pull.
+ */
+struct lp_mipmap_job
+{
+   const struct util_format_description *desc;
+   boolean bytewise;
+   boolean is_3d;
+   unsigned bpp;
+
+   const ubyte *src;
+   unsigned src_stride, src_img_stride;
+   unsigned src_width, src_height, src_depth;
+
+   ubyte *dst;
+   unsigned dst_stride, dst_img_stride;
+   unsigned dst_width, dst_height;
+
+   unsigned first_layer;
+   unsigned bands_per_plane;
+   int32_t num_bands;
+   int32_t next_band;
+};
+
+
+static int
+mipmap_next_band(struct lp_mipmap_job *job)
+{
+   int32_t band;
+
+   do {
+      band = p_atomic_read(&job->next_band);
+      if (band >= job->num_bands)
+         return -1;
+   } while (p_atomic_cmpxchg(&job->next_band, band, band + 1) != band);
+
+   return band;
+}
+
+
+/**
+ * 2x2 (or 2x2x2 with four rows) box filter of one row of an 8 bit unorm
+ * format, byte by byte with exact rounding.
+ */
+static void
+mip_row_8unorm(ubyte *dst, const ubyte *rows[4], unsigned nr_rows,
+               unsigned bpp, unsigned src_width, unsigned dst_width)
+{
+   const unsigned shift = nr_rows == 4 ? 3 : 2;
+   const unsigned round = 1 << (shift - 1);
+   unsigned x = 0, i, r;
+
+#if defined(PIPE_ARCH_SSE)
+   if (bpp == 4 && src_width >= 2) {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i bias = _mm_set1_epi16(round);
+
+      /* two destination texels out of four source texels per row */
+      for (; 2 * x + 4 <= src_width && x + 2 <= dst_width; x += 2) {
+         __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+         __m128i sum;
+
+         for (r = 0; r < nr_rows; r++) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(rows[r] + 2 * x * 4));
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+         }
+
+         /* add the horizontally adjacent texels */
+         lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+         hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+         sum = _mm_unpacklo_epi64(lo, hi);
+         sum = _mm_srli_epi16(_mm_add_epi16(sum, bias), shift);
+         _mm_storel_epi64((__m128i *)(dst + x * 4), _mm_packus_epi16(sum, sum));
+      }
+   }
+#endif
+
+   for (; x < dst_width; x++) {
+      const unsigned x0 = 2 * x * bpp;
+      const unsigned x1 = MIN2(2 * x + 1, src_width - 1) * bpp;
+
+      for (i = 0; i < bpp; i++) {
+         unsigned sum = round;
+         for (r = 0; r < nr_rows; r++)
+            sum += rows[r][x0 + i] + rows[r][x1 + i];
+         dst[x * bpp + i] = sum >> shift;
+      }
+   }
+}
+
+
+/**
+ * Same as mip_row_8unorm() for any other format, through floats.
+ * \param tmp  room for nr_rows + 1 rows of src_width RGBA floats
+ */
+static void
+mip_row_float(const struct util_format_description *desc,
+              ubyte *dst, const ubyte *rows[4], unsigned nr_rows,
+              unsigned src_width, unsigned dst_width, float *tmp)
+{
+   const float scale = 1.0f / (2 * nr_rows);
+   float *out = tmp + nr_rows * src_width * 4;
+   unsigned x, c, r;
+
+   for (r = 0; r < nr_rows; r++)
+      desc->unpack_rgba_float(tmp + r * src_width * 4, 0, rows[r], 0,
+                              src_width, 1);
+
+   for (x = 0; x < dst_width; x++) {
+      const unsigned x0 = 2 * x * 4;
+      const unsigned x1 = MIN2(2 * x + 1, src_width - 1) * 4;
+
+      for (c = 0; c < 4; c++) {
+         float sum = 0.0f;
+         for (r = 0; r < nr_rows; r++) {
+            const float *row = tmp + r * src_width * 4;
+            sum += row[x0 + c] + row[x1 + c];
+         }
+         out[x * 4 + c] = sum * scale;
+      }
+   }
+
+   desc->pack_rgba_float(dst, 0, out, 0, dst_width, 1);
+}
+
+
+static void
+mipmap_run_job(void *data, unsigned thread_index)
+{
+   struct lp_mipmap_job *job = (struct lp_mipmap_job *) data;
+   float *tmp = NULL;
+   int band;
+
+   (void) thread_index;
+
+   if (!job->bytewise) {
+      tmp = MALLOC(5 * job->src_width * 4 * sizeof *tmp);
+      if (!tmp)
+         return;
+   }
+
+   while ((band = mipmap_next_band(job)) >= 0) {
+      const unsigned plane = band / job->bands_per_plane;
+      const unsigned y0 = (band % job->bands_per_plane) * MIP_BAND_ROWS;
+      const unsigned y1 = MIN2(y0 + MIP_BAND_ROWS, job->dst_height);
+      const ubyte *src_a, *src_b;
+      ubyte *dst;
+      unsigned nr_rows, y;
+
+      if (job->is_3d) {
+         unsigned z = MIN2(2 * plane + 1, job->src_depth - 1);
+         src_a = job->src + 2 * plane * job->src_img_stride;
+         src_b = job->src + z * job->src_img_stride;
+         dst = job->dst + plane * job->dst_img_stride;
+         nr_rows = src_a != src_b ? 4 : 2;
+      }
+      else {
+         src_a = src_b = job->src + (job->first_layer + plane) * job->src_img_stride;
+         dst = job->dst + (job->first_layer + plane) * job->dst_img_stride;
+         nr_rows = 2;
+      }
+
+      for (y = y0; y < y1; y++) {
+         const unsigned sy0 = 2 * y;
+         const unsigned sy1 = MIN2(2 * y + 1, job->src_height - 1);
+         const ubyte *rows[4];
+
+         rows[0] = src_a + sy0 * job->src_stride;
+         rows[1] = src_a + sy1 * job->src_stride;
+         rows[2] = src_b + sy0 * job->src_stride;
+         rows[3] = src_b + sy1 * job->src_stride;
+
+         if (job->bytewise)
+            mip_row_8unorm(dst + y * job->dst_stride, rows, nr_rows,
+                           job->bpp, job->src_width, job->dst_width);
+         else
+            mip_row_float(job->desc, dst + y * job->dst_stride, rows, nr_rows,
+                          job->src_width, job->dst_width, tmp);
+      }
+   }
+
+   FREE(tmp);
+}
+
+
+/**
+ * Whether every level from base_level to last_level - 1 halves evenly,
+ * so that the 2x2 box filter covers all of its texels.  A dimension of
+ * one is fine too, it simply stays one.
+ */
+static boolean
+mipmap_levels_halve_evenly(const struct pipe_resource *resource,
+                           unsigned base_level, unsigned last_level)
+{
+   unsigned level;
+
+   for (level = base_level; level < last_level; level++) {
+      const unsigned width = u_minify(resource->width0, level);
+      const unsigned height = u_minify(resource->height0, level);
+      const unsigned depth = resource->target == PIPE_TEXTURE_3D ?
+         u_minify(resource->depth0, level) : 1;
+
+      if ((width > 1 && (width & 1)) ||
+          (height > 1 && (height & 1)) ||
+          (depth > 1 && (depth & 1)))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Generate mipmaps on the CPU with a box filter, splitting each level
+ * across the rasterizer threads, instead of rendering textured quads.
+ * Levels with odd dimensions would need a wider filter and are left to
+ * the caller by returning FALSE, as are failures to map the levels.
+ */
+static boolean
+lp_generate_mipmap(struct pipe_context *pipe,
+                   struct pipe_resource *resource,
+                   enum pipe_format format,
+                   unsigned base_level,
+                   unsigned last_level,
+                   unsigned first_layer,
+                   unsigned last_layer)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   struct llvmpipe_resource *lpr = llvmpipe_resource(resource);
+   const struct util_format_description *desc = util_format_description(format);
+   struct lp_mipmap_job job;
+   unsigned level;
+
+   if (!llvmpipe_resource_is_texture(resource) ||
+       resource->nr_samples > 1 ||
+       !desc ||
+       desc->block.width != 1 || desc->block.height != 1 ||
+       desc->block.bits != util_format_get_blocksizebits(resource->format) ||
+       desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS ||
+       util_format_is_pure_integer(format) ||
+       !desc->unpack_rgba_float || !desc->pack_rgba_float ||
+       !mipmap_levels_halve_evenly(resource, base_level, last_level))
+      return FALSE;
+
+   llvmpipe_flush_resource(pipe,
+                           resource, base_level,
+                           FALSE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE, /* do_not_block */
+                           "generate_mipmap");
+
+   memset(&job, 0, sizeof job);
+   job.desc = desc;
+   job.bytewise = format_is_8unorm(desc);
+   job.is_3d = resource->target == PIPE_TEXTURE_3D;
+   job.bpp = util_format_get_blocksize(format);
+
+   for (level = base_level + 1; level <= last_level; level++) {
+      unsigned num_planes;
+
+      job.src = llvmpipe_get_texture_image(lpr, 0, level - 1,
+                                           LP_TEX_USAGE_READ);
+      job.dst = llvmpipe_get_texture_image(lpr, 0, level,
+                                           LP_TEX_USAGE_READ_WRITE);
+      if (!job.src || !job.dst)
+         return FALSE;
+
+      job.src_stride = llvmpipe_resource_stride(resource, level - 1);
+      job.src_img_stride = lpr->img_stride[level - 1];
+      job.src_width = u_minify(resource->width0, level - 1);
+      job.src_height = u_minify(resource->height0, level - 1);
+      job.src_depth = u_minify(resource->depth0, level - 1);
+
+      job.dst_stride = llvmpipe_resource_stride(resource, level);
+      job.dst_img_stride = lpr->img_stride[level];
+      job.dst_width = u_minify(resource->width0, level);
+      job.dst_height = u_minify(resource->height0, level);
+
+      if (job.is_3d) {
+         job.first_layer = 0;
+         num_planes = u_minify(resource->depth0, level);
+      }
+      else {
+         job.first_layer = first_layer;
+         num_planes = last_layer - first_layer + 1;
+      }
+
+      job.bands_per_plane = (job.dst_height + MIP_BAND_ROWS - 1) / MIP_BAND_ROWS;
+      job.num_bands = num_planes * job.bands_per_plane;
+      job.next_band = 0;
+
+      /* tiny levels aren't worth waking up the threads for */
+      if (job.num_bands == 1) {
+         mipmap_run_job(&job, 0);
+      }
+      else {
+         pipe_mutex_lock(screen->rast_mutex);
+         lp_rast_run_job(screen->rast, mipmap_run_job, &job);
+         pipe_mutex_unlock(screen->rast_mutex);
+      }
+
+      LP_COUNT(nr_mipmap_levels);
+   }
+
+   screen->timestamp++;
+
+   return TRUE;
+}
+
+
 static struct pipe_surface *
 llvmpipe_create_surface(struct pipe_context *pipe,
                         struct pipe_resource *pt,
@@ -240,7 +816,8 @@ llvmpipe_create_surface(struct pipe_context *pipe,
 {
    struct pipe_surface *ps;
 
-   if (!(pt->bind & (PIPE_BIND_DEPTH_STENCIL | PIPE_BIND_RENDER_TARGET)))
+   if (!(pt->bind & (PIPE_BIND_DEPTH_STENCIL | PIPE_BIND_RENDER_TARGET |
+                     PIPE_BIND_COMPUTE_RESOURCE)))
       debug_printf("Illegal surface creation without bind flag\n");
 
    ps = CALLOC_STRUCT(pipe_surface);
@@ -324,6 +901,23 @@ llvmpipe_clear_depth_stencil(struct pipe_context *pipe,
 }
 
 
+static void
+llvmpipe_get_sample_position(struct pipe_context *pipe,
+                             unsigned sample_count,
+                             unsigned sample_index,
+                             float *out_value)
+{
+   if (sample_count == LP_MAX_SAMPLES && sample_index < LP_MAX_SAMPLES) {
+      out_value[0] = 0.5f + (float) lp_sample_pos[sample_index][0] / FIXED_ONE;
+      out_value[1] = 0.5f + (float) lp_sample_pos[sample_index][1] / FIXED_ONE;
+   }
+   else {
+      out_value[0] = 0.5f;
+      out_value[1] = 0.5f;
+   }
+}
+
+
 void
 llvmpipe_init_surface_functions(struct llvmpipe_context *lp)
 {
@@ -334,4 +928,6 @@ llvmpipe_init_surface_functions(struct llvmpipe_context *lp)
    /* These two are not actually functions dealing with surfaces */
    lp->pipe.resource_copy_region = lp_resource_copy;
    lp->pipe.blit = lp_blit;
+   lp->pipe.generate_mipmap = lp_generate_mipmap;
+   lp->pipe.get_sample_position = llvmpipe_get_sample_position;
 }
@@ -33,10 +33,16 @@
 
 
 struct llvmpipe_context;
+struct llvmpipe_resource;
 
 
 extern void
 llvmpipe_init_surface_functions(struct llvmpipe_context *lp);
 
+extern void
+llvmpipe_ms_decompress_region(struct llvmpipe_resource *lpr, unsigned layer,
+                              unsigned x, unsigned y,
+                              unsigned width, unsigned height);
+
 
 #endif /* LP_SURFACE_H */
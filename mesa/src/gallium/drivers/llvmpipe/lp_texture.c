@@ -35,21 +35,26 @@
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 
+#include "util/u_atomic.h"
 #include "util/u_inlines.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_format.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
+#include "util/u_rect.h"
 #include "util/u_simple_list.h"
 #include "util/u_transfer.h"
+#include "draw/draw_context.h"
 
 #include "lp_context.h"
 #include "lp_flush.h"
+#include "lp_perf.h"
 #include "lp_screen.h"
 #include "lp_texture.h"
 #include "lp_setup.h"
 #include "lp_state.h"
 #include "lp_rast.h"
+#include "lp_surface.h"
 
 #include "state_tracker/sw_winsys.h"
 
@@ -79,6 +84,17 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
    assert(LP_MAX_TEXTURE_2D_LEVELS <= LP_MAX_TEXTURE_LEVELS);
    assert(LP_MAX_TEXTURE_3D_LEVELS <= LP_MAX_TEXTURE_LEVELS);
 
+   if (pt->nr_samples > 1) {
+      /* Multisampling only for single level 2D render targets */
+      if (pt->nr_samples != LP_MAX_SAMPLES ||
+          pt->last_level != 0 ||
+          (pt->target != PIPE_TEXTURE_2D &&
+           pt->target != PIPE_TEXTURE_2D_ARRAY &&
+           pt->target != PIPE_TEXTURE_RECT) ||
+          util_format_is_compressed(pt->format))
+         goto fail;
+   }
+
    for (level = 0; level <= pt->last_level; level++) {
 
       /* Row stride and image stride */
@@ -148,7 +164,8 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
       }
 
       total_size += (uint64_t) lpr->num_slices_faces[level]
-                  * (uint64_t) lpr->img_stride[level];
+                  * (uint64_t) lpr->img_stride[level]
+                  * (uint64_t) llvmpipe_resource_nr_samples(pt);
       if (total_size > LP_MAX_TEXTURE_SIZE) {
          goto fail;
       }
@@ -220,6 +237,97 @@ llvmpipe_displaytarget_layout(struct llvmpipe_screen *screen,
 }
 
 
+/**
+ * Size of the storage of a buffer of the given size.
+ *
+ * Reserve some extra storage since if we'd render to a buffer we
+ * read/write always LP_RASTER_BLOCK_SIZE pixels, but the element
+ * offset doesn't need to be aligned to LP_RASTER_BLOCK_SIZE.
+ * Rounded up to a page so that buffers of similar size share
+ * storage in the buffer pool.
+ */
+static INLINE unsigned
+buffer_storage_size(unsigned bytes)
+{
+   return align(bytes + (LP_RASTER_BLOCK_SIZE - 1) * 4 * sizeof(float), 4096);
+}
+
+
+/**
+ * Allocate buffer storage, preferably recycling storage of the same size
+ * from the screen's buffer pool.
+ */
+void *
+llvmpipe_buffer_storage_alloc(struct llvmpipe_screen *screen, unsigned size)
+{
+   void *data = NULL;
+   int i;
+
+   pipe_mutex_lock(screen->buffer_pool_mutex);
+   for (i = screen->buffer_pool_count - 1; i >= 0; i--) {
+      if (screen->buffer_pool[i].size == size) {
+         data = screen->buffer_pool[i].data;
+         screen->buffer_pool_bytes -= size;
+         screen->buffer_pool_count--;
+         memmove(&screen->buffer_pool[i], &screen->buffer_pool[i + 1],
+                 (screen->buffer_pool_count - i) *
+                 sizeof screen->buffer_pool[0]);
+         break;
+      }
+   }
+   pipe_mutex_unlock(screen->buffer_pool_mutex);
+
+   if (!data)
+      data = align_malloc(size, 16);
+
+   return data;
+}
+
+
+/**
+ * Return buffer storage to the screen's buffer pool, evicting the oldest
+ * entries when the pool is full.  May be called from any thread.
+ */
+void
+llvmpipe_buffer_storage_free(struct llvmpipe_screen *screen,
+                             void *data, unsigned size)
+{
+   if (size > LP_BUFFER_POOL_MAX_BYTES / 4) {
+      align_free(data);
+      return;
+   }
+
+   pipe_mutex_lock(screen->buffer_pool_mutex);
+   while (screen->buffer_pool_count == LP_BUFFER_POOL_SIZE ||
+          screen->buffer_pool_bytes + size > LP_BUFFER_POOL_MAX_BYTES) {
+      align_free(screen->buffer_pool[0].data);
+      screen->buffer_pool_bytes -= screen->buffer_pool[0].size;
+      screen->buffer_pool_count--;
+      memmove(&screen->buffer_pool[0], &screen->buffer_pool[1],
+              screen->buffer_pool_count * sizeof screen->buffer_pool[0]);
+   }
+   screen->buffer_pool[screen->buffer_pool_count].data = data;
+   screen->buffer_pool[screen->buffer_pool_count].size = size;
+   screen->buffer_pool_count++;
+   screen->buffer_pool_bytes += size;
+   pipe_mutex_unlock(screen->buffer_pool_mutex);
+}
+
+
+void
+llvmpipe_buffer_pool_destroy(struct llvmpipe_screen *screen)
+{
+   unsigned i;
+
+   for (i = 0; i < screen->buffer_pool_count; i++)
+      align_free(screen->buffer_pool[i].data);
+   screen->buffer_pool_count = 0;
+   screen->buffer_pool_bytes = 0;
+
+   pipe_mutex_destroy(screen->buffer_pool_mutex);
+}
+
+
 static struct pipe_resource *
 llvmpipe_resource_create(struct pipe_screen *_screen,
                          const struct pipe_resource *templat)
@@ -240,6 +348,8 @@ llvmpipe_resource_create(struct pipe_screen *_screen,
                             PIPE_BIND_SCANOUT |
                             PIPE_BIND_SHARED)) {
          /* displayable surface */
+         if (lpr->base.nr_samples > 1)
+            goto fail;
          if (!llvmpipe_displaytarget_layout(screen, lpr))
             goto fail;
       }
@@ -256,12 +366,8 @@ llvmpipe_resource_create(struct pipe_screen *_screen,
       assert(templat->height0 == 1);
       assert(templat->depth0 == 1);
       assert(templat->last_level == 0);
-      /*
-       * Reserve some extra storage since if we'd render to a buffer we
-       * read/write always LP_RASTER_BLOCK_SIZE pixels, but the element
-       * offset doesn't need to be aligned to LP_RASTER_BLOCK_SIZE.
-       */
-      lpr->data = align_malloc(bytes + (LP_RASTER_BLOCK_SIZE - 1) * 4 * sizeof(float), 16);
+      lpr->data = llvmpipe_buffer_storage_alloc(screen,
+                                                buffer_storage_size(bytes));
       /*
        * buffers don't really have stride but it's probably safer
        * (for code doing same calculations for buffers and textures)
@@ -301,14 +407,16 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
    }
    else if (llvmpipe_resource_is_texture(pt)) {
       /* free linear image data */
-      if (lpr->linear_img.data) {
+      if (lpr->linear_img.data && !lpr->userBuffer) {
          align_free(lpr->linear_img.data);
          lpr->linear_img.data = NULL;
       }
+      FREE(lpr->ms_compressed);
    }
    else if (!lpr->userBuffer) {
       assert(lpr->data);
-      align_free(lpr->data);
+      llvmpipe_buffer_storage_free(screen, lpr->data,
+                                   buffer_storage_size(pt->width0));
    }
 
 #ifdef DEBUG
@@ -462,6 +570,84 @@ no_lpr:
 }
 
 
+/**
+ * Wrap user memory as a buffer, or as a single level 2D texture.
+ */
+static struct pipe_resource *
+llvmpipe_resource_from_user_memory(struct pipe_screen *screen,
+                                   const struct pipe_resource *templat,
+                                   void *user_memory,
+                                   unsigned stride)
+{
+   struct llvmpipe_resource *lpr;
+
+   /* Vector loads and stores want 16 byte alignment */
+   if ((uintptr_t) user_memory & 15)
+      return NULL;
+
+   if (templat->bind & (PIPE_BIND_DISPLAY_TARGET |
+                        PIPE_BIND_SCANOUT |
+                        PIPE_BIND_SHARED |
+                        PIPE_BIND_DEPTH_STENCIL))
+      return NULL;
+
+   if (llvmpipe_resource_is_texture(templat)) {
+      const unsigned bpp = util_format_get_blocksize(templat->format);
+
+      if ((templat->target != PIPE_TEXTURE_2D &&
+           templat->target != PIPE_TEXTURE_RECT) ||
+          templat->last_level != 0 ||
+          templat->array_size != 1 ||
+          templat->nr_samples > 1 ||
+          util_format_is_compressed(templat->format) ||
+          util_format_is_depth_or_stencil(templat->format) ||
+          stride % 16 != 0 ||
+          stride < templat->width0 * bpp ||
+          stride > LP_MAX_TEXTURE_SIZE / templat->height0)
+         return NULL;
+
+      /* Rendering reads and writes whole 4x4 blocks */
+      if ((templat->bind & PIPE_BIND_RENDER_TARGET) &&
+          (stride < align(templat->width0, LP_RASTER_BLOCK_SIZE) * bpp ||
+           templat->height0 % LP_RASTER_BLOCK_SIZE != 0))
+         return NULL;
+   }
+   else {
+      /* Rendering to buffers writes past the end, see resource_create */
+      if (templat->bind & PIPE_BIND_RENDER_TARGET)
+         return NULL;
+   }
+
+   lpr = CALLOC_STRUCT(llvmpipe_resource);
+   if (!lpr)
+      return NULL;
+
+   lpr->base = *templat;
+   pipe_reference_init(&lpr->base.reference, 1);
+   lpr->base.screen = screen;
+   lpr->userBuffer = TRUE;
+
+   if (llvmpipe_resource_is_texture(templat)) {
+      lpr->row_stride[0] = stride;
+      lpr->img_stride[0] = stride * templat->height0;
+      lpr->num_slices_faces[0] = 1;
+      lpr->linear_img.data = user_memory;
+   }
+   else {
+      lpr->row_stride[0] = templat->width0;
+      lpr->data = user_memory;
+   }
+
+   lpr->id = id_counter++;
+
+#ifdef DEBUG
+   insert_at_tail(&resource_list, lpr);
+#endif
+
+   return &lpr->base;
+}
+
+
 static boolean
 llvmpipe_resource_get_handle(struct pipe_screen *screen,
                             struct pipe_resource *pt,
@@ -478,6 +664,178 @@ llvmpipe_resource_get_handle(struct pipe_screen *screen,
 }
 
 
+/**
+ * Give a buffer fresh storage so that a map which discards its contents
+ * needn't wait for the scene still reading the old storage.  The scene
+ * frees the old storage once it has been rasterized.
+ *
+ * Only this context's scene and draw module can be told about the new
+ * storage, so buffers which other contexts' scenes reference or which
+ * other contexts bound as vertex/geometry shader constants aren't renamed.
+ */
+static boolean
+llvmpipe_rename_buffer(struct llvmpipe_context *llvmpipe,
+                       struct llvmpipe_resource *lpr)
+{
+   static const unsigned draw_shaders[] = {
+      PIPE_SHADER_VERTEX,
+      PIPE_SHADER_GEOMETRY
+   };
+   struct llvmpipe_screen *screen = llvmpipe_screen(llvmpipe->pipe.screen);
+   unsigned size = buffer_storage_size(lpr->base.width0);
+   int32_t draw_constant_refs = 0;
+   unsigned i, j;
+   void *data;
+
+   for (i = 0; i < Elements(draw_shaders); i++) {
+      for (j = 0; j < Elements(llvmpipe->constants[0]); j++) {
+         if (llvmpipe->constants[draw_shaders[i]][j].buffer == &lpr->base)
+            draw_constant_refs++;
+      }
+   }
+   if (p_atomic_read(&lpr->draw_constant_refs) != draw_constant_refs)
+      return FALSE;
+
+   data = llvmpipe_buffer_storage_alloc(screen, size);
+   if (!data)
+      return FALSE;
+
+   if (!lp_setup_retire_storage(llvmpipe->setup, &lpr->base,
+                                lpr->data, size)) {
+      llvmpipe_buffer_storage_free(screen, data, size);
+      return FALSE;
+   }
+
+   lpr->data = data;
+
+   /* The draw module was handed the old storage of constant buffers.
+    */
+   for (i = 0; i < Elements(draw_shaders); i++) {
+      for (j = 0; j < Elements(llvmpipe->constants[0]); j++) {
+         const struct pipe_constant_buffer *cb =
+            &llvmpipe->constants[draw_shaders[i]][j];
+
+         if (cb->buffer == &lpr->base)
+            draw_set_mapped_constant_buffer(llvmpipe->draw, draw_shaders[i], j,
+                                            (ubyte *) data + cb->buffer_offset,
+                                            cb->buffer_size);
+      }
+   }
+
+   /* Sampler views of the buffer must pick up the new storage.
+    */
+   screen->timestamp++;
+
+   LP_COUNT(nr_buffer_renames);
+   return TRUE;
+}
+
+
+/**
+ * Return whether tile (tx, ty) of a multisampled resource lies entirely
+ * within the given box.  The tiles on the right and bottom edges only
+ * extend to the edge of the resource.
+ */
+static boolean
+ms_tile_in_box(const struct llvmpipe_resource *lpr,
+               unsigned tx, unsigned ty, const struct pipe_box *box)
+{
+   unsigned x0 = tx * TILE_SIZE, y0 = ty * TILE_SIZE;
+   unsigned x1 = MIN2(x0 + TILE_SIZE, lpr->base.width0);
+   unsigned y1 = MIN2(y0 + TILE_SIZE, lpr->base.height0);
+
+   return x0 >= (unsigned) box->x &&
+          y0 >= (unsigned) box->y &&
+          x1 <= (unsigned) (box->x + box->width) &&
+          y1 <= (unsigned) (box->y + box->height);
+}
+
+
+/**
+ * Prepare the tiles of a multisampled color resource for a write map of
+ * the given box.  The map only exposes the sample 0 plane.  The tiles
+ * entirely within the box get completely overwritten there, so they are
+ * marked compressed.  The tiles the box only partly covers are
+ * decompressed, and on unmap the written pixels are copied to the other
+ * samples.
+ */
+static void
+ms_transfer_map_tiles(struct llvmpipe_resource *lpr,
+                      const struct pipe_box *box)
+{
+   unsigned tx, ty;
+   int z;
+
+   if (!box->width || !box->height)
+      return;
+
+   for (z = box->z; z < box->z + box->depth; z++) {
+      for (ty = box->y / TILE_SIZE;
+           ty <= (box->y + box->height - 1) / TILE_SIZE; ty++) {
+         for (tx = box->x / TILE_SIZE;
+              tx <= (box->x + box->width - 1) / TILE_SIZE; tx++) {
+            if (ms_tile_in_box(lpr, tx, ty, box)) {
+               *llvmpipe_resource_ms_tile(lpr, z, tx, ty) = 1;
+            }
+            else {
+               llvmpipe_ms_decompress_region(lpr, z,
+                                             tx * TILE_SIZE, ty * TILE_SIZE,
+                                             1, 1);
+            }
+         }
+      }
+   }
+}
+
+
+/**
+ * Copy what a write map stored in the sample 0 plane of the partly
+ * covered, and therefore uncompressed, tiles to the other samples.
+ */
+static void
+ms_transfer_unmap_tiles(struct llvmpipe_resource *lpr,
+                        const struct pipe_box *box)
+{
+   const enum pipe_format format = lpr->base.format;
+   const unsigned nr_samples = llvmpipe_resource_nr_samples(&lpr->base);
+   const unsigned stride = lpr->row_stride[0];
+   unsigned tx, ty, s;
+   int z;
+
+   if (!box->width || !box->height)
+      return;
+
+   for (z = box->z; z < box->z + box->depth; z++) {
+      ubyte *map = llvmpipe_get_texture_image(lpr, z, 0,
+                                              LP_TEX_USAGE_READ_WRITE);
+      if (!map)
+         return;
+
+      for (ty = box->y / TILE_SIZE;
+           ty <= (box->y + box->height - 1) / TILE_SIZE; ty++) {
+         for (tx = box->x / TILE_SIZE;
+              tx <= (box->x + box->width - 1) / TILE_SIZE; tx++) {
+            unsigned x0, y0, x1, y1;
+
+            if (*llvmpipe_resource_ms_tile(lpr, z, tx, ty))
+               continue;
+
+            x0 = MAX2(tx * TILE_SIZE, (unsigned) box->x);
+            y0 = MAX2(ty * TILE_SIZE, (unsigned) box->y);
+            x1 = MIN2((tx + 1) * TILE_SIZE, (unsigned) (box->x + box->width));
+            y1 = MIN2((ty + 1) * TILE_SIZE, (unsigned) (box->y + box->height));
+
+            for (s = 1; s < nr_samples; s++) {
+               util_copy_rect(map + s * lpr->sample_stride, format, stride,
+                              x0, y0, x1 - x0, y1 - y0,
+                              map, stride, x0, y0);
+            }
+         }
+      }
+   }
+}
+
+
 static void *
 llvmpipe_transfer_map( struct pipe_context *pipe,
                        struct pipe_resource *resource,
@@ -499,6 +857,21 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
    assert(resource);
    assert(level <= resource->last_level);
 
+   /*
+    * Instead of waiting for the scene to finish with a buffer whose contents
+    * are discarded anyway, orphan its storage.  Buffers the scene renders
+    * to can't be renamed as the scene has their storage mapped.
+    */
+   if ((usage & PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE) &&
+       !(usage & PIPE_TRANSFER_UNSYNCHRONIZED) &&
+       resource->target == PIPE_BUFFER &&
+       !lpr->userBuffer &&
+       llvmpipe_is_resource_referenced(pipe, resource, 0) ==
+          LP_REFERENCED_FOR_READ &&
+       llvmpipe_rename_buffer(llvmpipe, lpr)) {
+      usage |= PIPE_TRANSFER_UNSYNCHRONIZED;
+   }
+
    /*
     * Transfers, like other pipe operations, must happen in order, so flush the
     * context if necessary.
@@ -506,12 +879,12 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
    if (!(usage & PIPE_TRANSFER_UNSYNCHRONIZED)) {
       boolean read_only = !(usage & PIPE_TRANSFER_WRITE);
       boolean do_not_block = !!(usage & PIPE_TRANSFER_DONTBLOCK);
-      if (!llvmpipe_flush_resource(pipe, resource,
-                                   level,
-                                   read_only,
-                                   TRUE, /* cpu_access */
-                                   do_not_block,
-                                   __FUNCTION__)) {
+      if (!llvmpipe_flush_resource_box(pipe, resource,
+                                       level,
+                                       box,
+                                       read_only,
+                                       do_not_block,
+                                       __FUNCTION__)) {
          /*
           * It would have blocked, but state tracker requested no to.
           */
@@ -583,6 +956,9 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
       /* Do something to notify sharing contexts of a texture change.
        */
       screen->timestamp++;
+
+      if (lpr->ms_compressed)
+         ms_transfer_map_tiles(lpr, box);
    }
 
    map +=
@@ -599,6 +975,11 @@ llvmpipe_transfer_unmap(struct pipe_context *pipe,
 {
    assert(transfer->resource);
 
+   if ((transfer->usage & PIPE_TRANSFER_WRITE) &&
+       llvmpipe_resource(transfer->resource)->ms_compressed)
+      ms_transfer_unmap_tiles(llvmpipe_resource(transfer->resource),
+                              &transfer->box);
+
    llvmpipe_resource_unmap(transfer->resource,
                            transfer->level,
                            transfer->box.z);
@@ -742,8 +1123,9 @@ llvmpipe_get_texture_image_address(struct llvmpipe_resource *lpr,
 /**
  * Allocate storage for a linear image
  * (all cube faces and all 3D slices, all levels).
+ * \return FALSE if out of memory, in which case nothing is allocated
  */
-static void
+static boolean
 alloc_image_data(struct llvmpipe_resource *lpr)
 {
    uint alignment = MAX2(16, util_cpu_caps.cacheline);
@@ -774,11 +1156,42 @@ alloc_image_data(struct llvmpipe_resource *lpr)
          lpr->linear_mip_offsets[level] = offset;
          offset += align(buffer_size, alignment);
       }
+
+      /*
+       * Multisampled resources have a single level; the samples are
+       * stored as that many consecutive copies of it.  Only color
+       * buffers track which tiles are compressed.
+       */
+      if (lpr->base.nr_samples > 1) {
+         lpr->sample_stride = offset;
+         offset *= lpr->base.nr_samples;
+      }
+
+      if (lpr->base.nr_samples > 1 &&
+          !util_format_is_depth_or_stencil(lpr->base.format)) {
+         unsigned num_tiles;
+
+         lpr->ms_tiles_x = align(lpr->base.width0, TILE_SIZE) / TILE_SIZE;
+         lpr->ms_tiles_y = align(lpr->base.height0, TILE_SIZE) / TILE_SIZE;
+         num_tiles = lpr->ms_tiles_x * lpr->ms_tiles_y *
+                     lpr->num_slices_faces[0];
+         lpr->ms_compressed = MALLOC(num_tiles);
+         if (!lpr->ms_compressed)
+            return FALSE;
+         /* All zero samples are trivially equal */
+         memset(lpr->ms_compressed, 1, num_tiles);
+      }
+
       lpr->linear_img.data = align_malloc(offset, alignment);
-      if (lpr->linear_img.data) {
-         memset(lpr->linear_img.data, 0, offset);
+      if (!lpr->linear_img.data) {
+         FREE(lpr->ms_compressed);
+         lpr->ms_compressed = NULL;
+         return FALSE;
       }
+      memset(lpr->linear_img.data, 0, offset);
    }
+
+   return lpr->linear_img.data != NULL;
 }
 
 
@@ -814,7 +1227,8 @@ llvmpipe_get_texture_image(struct llvmpipe_resource *lpr,
 
    if (!target_data) {
       /* allocate memory for the target image now */
-      alloc_image_data(lpr);
+      if (!alloc_image_data(lpr))
+         return NULL;
       target_data = target_img->data;
    }
 
@@ -875,9 +1289,9 @@ llvmpipe_get_texture_tile_linear(struct llvmpipe_resource *lpr,
    if (!linear_img->data) {
       /* allocate memory for the linear image now */
       /* XXX should probably not do that here? */
-      alloc_image_data(lpr);
+      if (!alloc_image_data(lpr))
+         return NULL;
    }
-   assert(linear_img->data);
 
    /* compute address of the slice/face of the image that contains the tile */
    linear_image = llvmpipe_get_texture_image_address(lpr, face_slice, level);
@@ -900,6 +1314,7 @@ llvmpipe_resource_size(const struct pipe_resource *resource)
          if (lpr->linear_img.data)
             size += tex_image_size(lpr, lvl);
       }
+      size *= llvmpipe_resource_nr_samples(resource);
    }
    else {
       size = resource->width0;
@@ -949,6 +1364,7 @@ llvmpipe_init_screen_resource_funcs(struct pipe_screen *screen)
    screen->resource_create = llvmpipe_resource_create;
    screen->resource_destroy = llvmpipe_resource_destroy;
    screen->resource_from_handle = llvmpipe_resource_from_handle;
+   screen->resource_from_user_memory = llvmpipe_resource_from_user_memory;
    screen->resource_get_handle = llvmpipe_resource_get_handle;
    screen->can_create_resource = llvmpipe_can_create_resource;
 }
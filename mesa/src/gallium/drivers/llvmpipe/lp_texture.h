@@ -31,6 +31,7 @@
 
 #include "pipe/p_state.h"
 #include "util/u_debug.h"
+#include "util/u_math.h"
 #include "lp_limits.h"
 
 
@@ -45,6 +46,7 @@ enum lp_texture_usage
 struct pipe_context;
 struct pipe_screen;
 struct llvmpipe_context;
+struct llvmpipe_screen;
 
 struct sw_displaytarget;
 
@@ -75,6 +77,12 @@ struct llvmpipe_resource
    unsigned num_slices_faces[LP_MAX_TEXTURE_LEVELS];
    /** Offset to start of mipmap level, in bytes */
    unsigned linear_mip_offsets[LP_MAX_TEXTURE_LEVELS];
+   /**
+    * Multisampled resources only: distance in bytes between the planes
+    * holding sample 0, 1, 2, ...  Sample 0 is the plane everything
+    * which doesn't know about samples (transfers, sampling) sees.
+    */
+   unsigned sample_stride;
 
    /**
     * Display target, for textures with the PIPE_BIND_DISPLAY_TARGET
@@ -92,9 +100,25 @@ struct llvmpipe_resource
     */
    void *data;
 
-   boolean userBuffer;  /** Is this a user-space buffer? */
+   /**
+    * Multisampled color resources only: one flag per tile and layer, set when
+    * all samples of every pixel in the tile hold the same color, in which
+    * case only the sample 0 plane is up to date.
+    */
+   uint8_t *ms_compressed;
+   unsigned ms_tiles_x, ms_tiles_y;
+
+   boolean userBuffer;  /** Is the storage user memory? */
    unsigned timestamp;
 
+   /**
+    * Number of scenes, of any context, referencing the resource, and of
+    * vertex/geometry shader constant buffer bindings which handed its
+    * storage to a draw module.  Updated atomically.
+    */
+   int32_t scene_refs;
+   int32_t draw_constant_refs;
+
    unsigned id;  /**< temporary, for debugging */
 
 #ifdef DEBUG
@@ -180,6 +204,31 @@ llvmpipe_resource_is_1d(const struct pipe_resource *resource)
 }
 
 
+/**
+ * Number of samples per pixel, with zero meaning one.
+ */
+static INLINE unsigned
+llvmpipe_resource_nr_samples(const struct pipe_resource *resource)
+{
+   return MAX2(1, resource->nr_samples);
+}
+
+
+/**
+ * Return the compressed flag of tile (tx, ty) of the given layer of a
+ * multisampled resource.
+ */
+static INLINE uint8_t *
+llvmpipe_resource_ms_tile(struct llvmpipe_resource *lpr,
+                          unsigned layer, unsigned tx, unsigned ty)
+{
+   assert(lpr->ms_compressed);
+   assert(tx < lpr->ms_tiles_x);
+   assert(ty < lpr->ms_tiles_y);
+   return &lpr->ms_compressed[(layer * lpr->ms_tiles_y + ty) * lpr->ms_tiles_x + tx];
+}
+
+
 static INLINE unsigned
 llvmpipe_layer_stride(struct pipe_resource *resource,
                       unsigned level)
@@ -257,4 +306,15 @@ llvmpipe_is_resource_referenced( struct pipe_context *pipe,
 unsigned
 llvmpipe_get_format_alignment(enum pipe_format format);
 
+
+void *
+llvmpipe_buffer_storage_alloc(struct llvmpipe_screen *screen, unsigned size);
+
+void
+llvmpipe_buffer_storage_free(struct llvmpipe_screen *screen,
+                             void *data, unsigned size);
+
+void
+llvmpipe_buffer_pool_destroy(struct llvmpipe_screen *screen);
+
 #endif /* LP_TEXTURE_H */
@@ -54,12 +54,70 @@
 #include "sp_tex_sample.h"
 
 
+static double
+hit_rate(uint64_t hits, uint64_t misses)
+{
+   return hits + misses ? 100.0 * hits / (hits + misses) : 0.0;
+}
+
+
+/**
+ * Print the tile cache counters, for SOFTPIPE_DUMP_TILE_CACHE.
+ * Lookups that hit the most recently used tile aren't counted.
+ */
+static void
+softpipe_dump_tile_cache_stats(struct softpipe_context *softpipe)
+{
+   uint64_t hits = 0, misses = 0, write_backs = 0;
+   uint i, sh;
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      if (softpipe->cbuf_cache[i]) {
+         hits += softpipe->cbuf_cache[i]->hits;
+         misses += softpipe->cbuf_cache[i]->misses;
+         write_backs += softpipe->cbuf_cache[i]->write_backs;
+      }
+   }
+   debug_printf("softpipe: color tile cache: %llu hits, %llu misses "
+                "(%.1f%% hits), %llu tile write-backs\n",
+                (unsigned long long) hits, (unsigned long long) misses,
+                hit_rate(hits, misses), (unsigned long long) write_backs);
+
+   if (softpipe->zsbuf_cache) {
+      hits = softpipe->zsbuf_cache->hits;
+      misses = softpipe->zsbuf_cache->misses;
+      write_backs = softpipe->zsbuf_cache->write_backs;
+      debug_printf("softpipe: depth/stencil tile cache: %llu hits, %llu misses "
+                   "(%.1f%% hits), %llu tile write-backs\n",
+                   (unsigned long long) hits, (unsigned long long) misses,
+                   hit_rate(hits, misses), (unsigned long long) write_backs);
+   }
+
+   hits = misses = 0;
+   for (sh = 0; sh < Elements(softpipe->tex_cache); sh++) {
+      for (i = 0; i < Elements(softpipe->tex_cache[0]); i++) {
+         if (softpipe->tex_cache[sh][i]) {
+            hits += softpipe->tex_cache[sh][i]->hits;
+            misses += softpipe->tex_cache[sh][i]->misses;
+         }
+      }
+   }
+   debug_printf("softpipe: texture tile cache: %llu hits, %llu misses "
+                "(%.1f%% hits)\n",
+                (unsigned long long) hits, (unsigned long long) misses,
+                hit_rate(hits, misses));
+}
+
+
 static void
 softpipe_destroy( struct pipe_context *pipe )
 {
    struct softpipe_context *softpipe = softpipe_context( pipe );
    uint i, sh;
 
+   if (softpipe->dump_tile_cache)
+      softpipe_dump_tile_cache_stats(softpipe);
+
 #if DO_PSTIPPLE_IN_HELPER_MODULE
    if (softpipe->pstipple.sampler)
       pipe->delete_sampler_state(pipe, softpipe->pstipple.sampler);
@@ -203,6 +261,8 @@ softpipe_create_context( struct pipe_screen *screen,
 
    softpipe->dump_fs = debug_get_bool_option( "SOFTPIPE_DUMP_FS", FALSE );
    softpipe->dump_gs = debug_get_bool_option( "SOFTPIPE_DUMP_GS", FALSE );
+   softpipe->dump_tile_cache =
+      debug_get_bool_option( "SOFTPIPE_DUMP_TILE_CACHE", FALSE );
 
    softpipe->pipe.screen = screen;
    softpipe->pipe.destroy = softpipe_destroy;
@@ -195,6 +195,7 @@ struct softpipe_context {
 
    unsigned dump_fs : 1;
    unsigned dump_gs : 1;
+   unsigned dump_tile_cache : 1;
    unsigned no_rast : 1;
 };
 
@@ -41,13 +41,51 @@
 #include "sp_texture.h"
 #include "sp_tex_tile_cache.h"
 
-   
+
+/**
+ * Mark all entries as invalid/empty.
+ */
+static void
+sp_tex_tile_cache_invalidate(struct softpipe_tex_tile_cache *tc)
+{
+   unsigned pos;
+
+   for (pos = 0; pos < tc->num_sets * TEX_TILE_CACHE_WAYS; pos++) {
+      tc->entries[pos].addr.bits.invalid = 1;
+   }
+}
+
+
+/**
+ * (Re)allocate the cache entries for the given number of sets.
+ * On failure the cache just keeps its current size.
+ */
+static void
+sp_tex_tile_cache_resize(struct softpipe_tex_tile_cache *tc,
+                         unsigned num_sets)
+{
+   struct softpipe_tex_cached_tile *entries;
+
+   if (num_sets == tc->num_sets)
+      return;
+
+   entries = MALLOC(num_sets * TEX_TILE_CACHE_WAYS * sizeof *entries);
+   if (!entries)
+      return;
+
+   FREE(tc->entries);
+   tc->entries = entries;
+   tc->num_sets = num_sets;
+
+   sp_tex_tile_cache_invalidate(tc);
+   tc->last_tile = &tc->entries[0]; /* any tile */
+}
+
 
 struct softpipe_tex_tile_cache *
 sp_create_tex_tile_cache( struct pipe_context *pipe )
 {
    struct softpipe_tex_tile_cache *tc;
-   uint pos;
 
    /* make sure max texture size works */
    assert((TEX_TILE_SIZE << TEX_ADDR_BITS) >= (1 << (SP_MAX_TEXTURE_2D_LEVELS-1)));
@@ -55,10 +93,11 @@ sp_create_tex_tile_cache( struct pipe_context *pipe )
    tc = CALLOC_STRUCT( softpipe_tex_tile_cache );
    if (tc) {
       tc->pipe = pipe;
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         tc->entries[pos].addr.bits.invalid = 1;
+      sp_tex_tile_cache_resize(tc, TEX_TILE_CACHE_MIN_SETS);
+      if (!tc->entries) {
+         FREE(tc);
+         return NULL;
       }
-      tc->last_tile = &tc->entries[0]; /* any tile */
    }
    return tc;
 }
@@ -68,11 +107,7 @@ void
 sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 {
    if (tc) {
-      uint pos;
-
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         /*assert(tc->entries[pos].x < 0);*/
-      }
+      FREE(tc->entries);
       if (tc->transfer) {
          tc->pipe->transfer_unmap(tc->pipe, tc->transfer);
       }
@@ -92,14 +127,10 @@ sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 void
 sp_tex_tile_cache_validate_texture(struct softpipe_tex_tile_cache *tc)
 {
-   unsigned i;
-
    assert(tc);
    assert(tc->texture);
 
-   for (i = 0; i < Elements(tc->entries); i++) {
-      tc->entries[i].addr.bits.invalid = 1;
-   }
+   sp_tex_tile_cache_invalidate(tc);
 }
 
 static boolean
@@ -124,7 +155,6 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
                                    struct pipe_sampler_view *view)
 {
    struct pipe_resource *texture = view ? view->texture : NULL;
-   uint i;
 
    assert(!tc->transfer);
 
@@ -145,11 +175,23 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
          tc->format = view->format;
       }
 
+      if (texture && texture->target != PIPE_BUFFER) {
+         /* enough sets for the base level, within limits */
+         unsigned height = texture->target == PIPE_TEXTURE_1D_ARRAY ?
+            texture->array_size : texture->height0;
+         unsigned tiles =
+            ((texture->width0 + TEX_TILE_SIZE - 1) / TEX_TILE_SIZE) *
+            ((height + TEX_TILE_SIZE - 1) / TEX_TILE_SIZE);
+         unsigned sets = util_next_power_of_two((tiles + TEX_TILE_CACHE_WAYS - 1) /
+                                                TEX_TILE_CACHE_WAYS);
+
+         sp_tex_tile_cache_resize(tc, CLAMP(sets, TEX_TILE_CACHE_MIN_SETS,
+                                            TEX_TILE_CACHE_MAX_SETS));
+      }
+
       /* mark as entries as invalid/empty */
       /* XXX we should try to avoid this when the teximage hasn't changed */
-      for (i = 0; i < Elements(tc->entries); i++) {
-         tc->entries[i].addr.bits.invalid = 1;
-      }
+      sp_tex_tile_cache_invalidate(tc);
 
       tc->tex_face = -1; /* any invalid value here */
    }
@@ -165,13 +207,9 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
 void
 sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 {
-   int pos;
-
    if (tc->texture) {
       /* caching a texture, mark all entries as empty */
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         tc->entries[pos].addr.bits.invalid = 1;
-      }
+      sp_tex_tile_cache_invalidate(tc);
       tc->tex_face = -1;
    }
 
@@ -180,13 +218,11 @@ sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 
 /**
  * Given the texture face, level, zslice, x and y values, compute
- * the cache entry position/index where we'd hope to find the
- * cached texture tile.
- * This is basically a direct-map cache.
- * XXX There's probably lots of ways in which we can improve this.
+ * the cache set where we'd hope to find the cached texture tile.
  */
 static INLINE uint
-tex_cache_pos( union tex_tile_address addr )
+tex_cache_set( const struct softpipe_tex_tile_cache *tc,
+               union tex_tile_address addr )
 {
    uint entry = (addr.bits.x + 
                  addr.bits.y * 9 + 
@@ -194,7 +230,7 @@ tex_cache_pos( union tex_tile_address addr )
                  addr.bits.face + 
                  addr.bits.level * 7);
 
-   return entry % NUM_TEX_TILE_ENTRIES;
+   return entry & (tc->num_sets - 1);
 }
 
 /**
@@ -205,12 +241,31 @@ const struct softpipe_tex_cached_tile *
 sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc, 
                         union tex_tile_address addr )
 {
-   struct softpipe_tex_cached_tile *tile;
+   struct softpipe_tex_cached_tile *set, *tile;
    boolean zs = util_format_is_depth_or_stencil(tc->format);
+   unsigned way;
+
+   set = tc->entries + tex_cache_set( tc, addr ) * TEX_TILE_CACHE_WAYS;
+   tile = set;
+
+   for (way = 0; way < TEX_TILE_CACHE_WAYS; way++) {
+      if (set[way].addr.value == addr.value) {
+         tile = &set[way];
+         break;
+      }
 
-   tile = tc->entries + tex_cache_pos( addr );
+      /* prefer empty entries, otherwise the least recently used one */
+      if (!tile->addr.bits.invalid &&
+          (set[way].addr.bits.invalid ||
+           set[way].last_used < tile->last_used))
+         tile = &set[way];
+   }
 
-   if (addr.value != tile->addr.value) {
+   if (way < TEX_TILE_CACHE_WAYS) {
+      tc->hits++;
+   }
+   else {
+      tc->misses++;
 
       /* cache miss.  Most misses are because we've invalidated the
        * texture cache previously -- most commonly on binding a new
@@ -291,6 +346,8 @@ sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc,
       tile->addr = addr;
    }
 
+   tile->last_used = ++tc->use_count;
+
    tc->last_tile = tile;
    return tile;
 }
@@ -66,6 +66,7 @@ union tex_tile_address {
 struct softpipe_tex_cached_tile
 {
    union tex_tile_address addr;
+   unsigned last_used;  /**< for LRU replacement */
    union {
       float color[TEX_TILE_SIZE][TEX_TILE_SIZE][4];
       unsigned int colorui[TEX_TILE_SIZE][TEX_TILE_SIZE][4];
@@ -74,12 +75,13 @@ struct softpipe_tex_cached_tile
 };
 
 /*
- * The number of cache entries.
- * Should not be decreased to lower than 16, and even that
- * seems too low to avoid cache thrashing in some cases (because
- * the cache is direct mapped, see tex_cache_pos() function).
+ * The cache is set associative with LRU replacement within a set.
+ * The number of sets is chosen from the size of the texture when a
+ * sampler view is bound, between the min and max below.
  */
-#define NUM_TEX_TILE_ENTRIES 16
+#define TEX_TILE_CACHE_WAYS 4
+#define TEX_TILE_CACHE_MIN_SETS 4
+#define TEX_TILE_CACHE_MAX_SETS 32
 
 struct softpipe_tex_tile_cache
 {
@@ -90,7 +92,9 @@ struct softpipe_tex_tile_cache
    struct pipe_resource *texture;  /**< if caching a texture */
    unsigned timestamp;
 
-   struct softpipe_tex_cached_tile entries[NUM_TEX_TILE_ENTRIES];
+   struct softpipe_tex_cached_tile *entries;
+   unsigned num_sets;  /**< a power of two */
+   unsigned use_count;
 
    struct pipe_transfer *tex_trans;
    void *tex_trans_map;
@@ -103,6 +107,9 @@ struct softpipe_tex_tile_cache
    enum pipe_format format;
 
    struct softpipe_tex_cached_tile *last_tile;  /**< most recently retrieved tile */
+
+   /** Lookups which missed last_tile, see SOFTPIPE_DUMP_TILE_CACHE */
+   uint64_t hits, misses;
 };
 
 
@@ -32,24 +32,29 @@
  *    Brian Paul
  */
 
+#include <stdlib.h>
+
 #include "util/u_inlines.h"
 #include "util/u_format.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_tile.h"
 #include "sp_tile_cache.h"
 
+#if defined(PIPE_ARCH_SSE)
+#include <emmintrin.h>
+#endif
+
 static struct softpipe_cached_tile *
 sp_alloc_tile(struct softpipe_tile_cache *tc);
 
 
 /**
- * Return the position in the cache for the tile that contains win pos (x,y).
- * We currently use a direct mapped cache so this is like a hack key.
- * At some point we should investige something more sophisticated, like
- * a LRU replacement policy.
+ * Return the set in the cache for the tile that contains win pos (x,y).
+ * The odd multiplier spreads both rows and columns of tiles over the sets.
  */
-#define CACHE_POS(x, y) \
-   (((x) + (y) * 5) % NUM_ENTRIES)
+#define CACHE_SET(tc, x, y) \
+   (((x) + (y) * 5) & ((tc)->num_sets - 1))
 
 
 
@@ -102,6 +107,7 @@ sp_create_tile_cache( struct pipe_context *pipe )
       for (pos = 0; pos < Elements(tc->tile_addrs); pos++) {
          tc->tile_addrs[pos].bits.invalid = 1;
       }
+      tc->num_sets = 1;
       tc->last_tile_addr.bits.invalid = 1;
 
       /* this allocation allows us to guarantee that allocation
@@ -170,6 +176,24 @@ sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
    tc->surface = ps;
 
    if (ps) {
+      unsigned tiles_x = (ps->width + TILE_SIZE - 1) / TILE_SIZE;
+      unsigned tiles_y = (ps->height + TILE_SIZE - 1) / TILE_SIZE;
+      unsigned sets, pos;
+
+      /* Enough sets to hold the whole surface, if that's not too much.
+       * Tiles beyond the sets in use are freed, they're all flushed by now.
+       */
+      sets = util_next_power_of_two((tiles_x * tiles_y + TILE_CACHE_WAYS - 1) /
+                                    TILE_CACHE_WAYS);
+      tc->num_sets = MIN2(sets, TILE_CACHE_MAX_SETS);
+
+      for (pos = tc->num_sets * TILE_CACHE_WAYS;
+           pos < Elements(tc->entries); pos++) {
+         assert(tc->tile_addrs[pos].bits.invalid);
+         FREE(tc->entries[pos]);
+         tc->entries[pos] = NULL;
+      }
+
       if (ps->texture->target != PIPE_BUFFER) {
          tc->transfer_map = pipe_transfer_map(pipe, ps->texture,
                                               ps->u.tex.level, ps->u.tex.first_layer,
@@ -303,145 +327,339 @@ clear_tile(struct softpipe_cached_tile *tile,
 }
 
 
+#if defined(PIPE_ARCH_SSE)
+
+/**
+ * Return 0 if the format is R8G8B8A8_UNORM laid out in memory, 1 if
+ * B8G8R8A8_UNORM, and -1 for anything else.  Those get converted with
+ * SSE2 below, producing the same results as the generated pack/unpack
+ * functions.
+ */
+static int
+unorm8_swizzle(enum pipe_format format)
+{
+   switch (format) {
+   case PIPE_FORMAT_R8G8B8A8_UNORM:
+      return 0;
+   case PIPE_FORMAT_B8G8R8A8_UNORM:
+      return 1;
+   default:
+      return -1;
+   }
+}
+
+
+/**
+ * Pack a float tile into R8G8B8A8/B8G8R8A8 rows, as float_to_ubyte() does.
+ */
+void
+sp_pack_unorm8_sse2(uint8_t *dst, unsigned dst_stride,
+                    const float *src, unsigned src_stride,
+                    unsigned w, unsigned h, boolean swap_rb)
+{
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 scale = _mm_set1_ps(255.0f / 256.0f);
+   const __m128 bias = _mm_set1_ps(32768.0f);
+   const __m128i mask = _mm_set1_epi32(0xff);
+   unsigned x, y, i;
+
+   for (y = 0; y < h; y++) {
+      const float *s = src;
+      uint32_t *d = (uint32_t *) dst;
+
+      for (x = 0; x < w; x += 4) {
+         __m128i pixel[4];
+         __m128i packed;
+
+         for (i = 0; i < 4; i++) {
+            __m128 v = _mm_loadu_ps(s + 4 * MIN2(x + i, w - 1));
+            __m128i sign;
+
+            if (swap_rb)
+               v = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 1, 2));
+            /* Like float_to_ubyte(), anything with the sign bit set,
+             * NaN included, becomes 0.  maxps/minps return their second
+             * operand for NaN, so a positive NaN ends up as 1.0.
+             */
+            sign = _mm_srai_epi32(_mm_castps_si128(v), 31);
+            v = _mm_andnot_ps(_mm_castsi128_ps(sign), v);
+            v = _mm_min_ps(_mm_max_ps(zero, v), one);
+            v = _mm_add_ps(_mm_mul_ps(v, scale), bias);
+            pixel[i] = _mm_and_si128(_mm_castps_si128(v), mask);
+         }
+
+         packed = _mm_packus_epi16(_mm_packs_epi32(pixel[0], pixel[1]),
+                                   _mm_packs_epi32(pixel[2], pixel[3]));
+
+         if (x + 4 <= w) {
+            _mm_storeu_si128((__m128i *) (d + x), packed);
+         }
+         else {
+            uint32_t tmp[4];
+            _mm_storeu_si128((__m128i *) tmp, packed);
+            for (i = 0; x + i < w; i++)
+               d[x + i] = tmp[i];
+         }
+      }
+
+      src += src_stride / sizeof(float);
+      dst += dst_stride;
+   }
+}
+
+
 /**
- * Actually clear the tiles which were flagged as being in a clear state.
+ * Unpack R8G8B8A8/B8G8R8A8 rows into a float tile, as ubyte_to_float() does.
+ */
+void
+sp_unpack_unorm8_sse2(float *dst, unsigned dst_stride,
+                      const uint8_t *src, unsigned src_stride,
+                      unsigned w, unsigned h, boolean swap_rb)
+{
+   const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+   const __m128i zero = _mm_setzero_si128();
+   unsigned x, y;
+
+   for (y = 0; y < h; y++) {
+      const uint32_t *s = (const uint32_t *) src;
+      float *d = dst;
+
+      for (x = 0; x < w; x++) {
+         __m128i p = _mm_cvtsi32_si128(s[x]);
+         __m128 v;
+
+         p = _mm_unpacklo_epi16(_mm_unpacklo_epi8(p, zero), zero);
+         v = _mm_mul_ps(_mm_cvtepi32_ps(p), scale);
+         if (swap_rb)
+            v = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 1, 2));
+         _mm_storeu_ps(d + 4 * x, v);
+      }
+
+      src += src_stride;
+      dst += dst_stride / sizeof(float);
+   }
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
+/**
+ * Write a tile to the surface at the given tile address.
+ * Color tiles are converted straight into the mapped surface, without
+ * a temporary.
  */
 static void
-sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
+sp_tile_put(struct softpipe_tile_cache *tc,
+            const struct softpipe_cached_tile *tile,
+            union tile_address addr)
 {
    struct pipe_transfer *pt = tc->transfer;
-   const uint w = tc->transfer->box.width;
-   const uint h = tc->transfer->box.height;
-   uint x, y;
-   uint numCleared = 0;
-
-   assert(pt->resource);
-   if (!tc->tile)
-      tc->tile = sp_alloc_tile(tc);
+   enum pipe_format format = tc->surface->format;
+   unsigned x = addr.bits.x * TILE_SIZE;
+   unsigned y = addr.bits.y * TILE_SIZE;
+   unsigned w = TILE_SIZE, h = TILE_SIZE;
 
-   /* clear the scratch tile to the clear value */
    if (tc->depth_stencil) {
-      clear_tile(tc->tile, pt->resource->format, tc->clear_val);
-   } else {
-      clear_tile_rgba(tc->tile, pt->resource->format, &tc->clear_color);
+      pipe_put_tile_raw(pt, tc->transfer_map, x, y, w, h,
+                        tile->data.any, 0/*STRIDE*/);
+      return;
    }
 
-   /* push the tile to all positions marked as clear */
-   for (y = 0; y < h; y += TILE_SIZE) {
-      for (x = 0; x < w; x += TILE_SIZE) {
-         union tile_address addr = tile_address(x, y);
-
-         if (is_clear_flag_set(tc->clear_flags, addr)) {
-            /* write the scratch tile to the surface */
-            if (tc->depth_stencil) {
-               pipe_put_tile_raw(pt, tc->transfer_map,
-                                 x, y, TILE_SIZE, TILE_SIZE,
-                                 tc->tile->data.any, 0/*STRIDE*/);
-            }
-            else {
-               if (util_format_is_pure_uint(tc->surface->format)) {
-                  pipe_put_tile_ui_format(pt, tc->transfer_map,
-                                          x, y, TILE_SIZE, TILE_SIZE,
-                                          pt->resource->format,
-                                          (unsigned *) tc->tile->data.colorui128);
-               } else if (util_format_is_pure_sint(tc->surface->format)) {
-                  pipe_put_tile_i_format(pt, tc->transfer_map,
-                                         x, y, TILE_SIZE, TILE_SIZE,
-                                         pt->resource->format,
-                                         (int *) tc->tile->data.colori128);
-               } else {
-                  pipe_put_tile_rgba(pt, tc->transfer_map,
-                                     x, y, TILE_SIZE, TILE_SIZE,
-                                     (float *) tc->tile->data.color);
-               }
-            }
-            numCleared++;
-         }
-      }
+   if (u_clip_tile(x, y, &w, &h, &pt->box))
+      return;
+
+   if (util_format_is_pure_uint(format)) {
+      util_format_write_4ui(format, (const unsigned *) tile->data.colorui128,
+                            sizeof(tile->data.colorui128[0]),
+                            tc->transfer_map, pt->stride, x, y, w, h);
+   }
+   else if (util_format_is_pure_sint(format)) {
+      util_format_write_4i(format, (const int *) tile->data.colori128,
+                           sizeof(tile->data.colori128[0]),
+                           tc->transfer_map, pt->stride, x, y, w, h);
+   }
+#if defined(PIPE_ARCH_SSE)
+   else if (unorm8_swizzle(format) >= 0) {
+      sp_pack_unorm8_sse2((uint8_t *) tc->transfer_map + y * pt->stride + x * 4,
+                          pt->stride, (const float *) tile->data.color,
+                          sizeof(tile->data.color[0]), w, h,
+                          unorm8_swizzle(format));
+   }
+#endif
+   else {
+      util_format_write_4f(format, (const float *) tile->data.color,
+                           sizeof(tile->data.color[0]),
+                           tc->transfer_map, pt->stride, x, y, w, h);
    }
+}
 
-   /* reset all clear flags to zero */
-   memset(tc->clear_flags, 0, sizeof(tc->clear_flags));
 
-#if 0
-   debug_printf("num cleared: %u\n", numCleared);
+/**
+ * Read a tile from the surface at the given tile address.
+ */
+static void
+sp_tile_get(struct softpipe_tile_cache *tc,
+            struct softpipe_cached_tile *tile,
+            union tile_address addr)
+{
+   struct pipe_transfer *pt = tc->transfer;
+   enum pipe_format format = tc->surface->format;
+   unsigned x = addr.bits.x * TILE_SIZE;
+   unsigned y = addr.bits.y * TILE_SIZE;
+   unsigned w = TILE_SIZE, h = TILE_SIZE;
+
+   if (tc->depth_stencil) {
+      pipe_get_tile_raw(pt, tc->transfer_map, x, y, w, h,
+                        tile->data.any, 0/*STRIDE*/);
+      return;
+   }
+
+   if (u_clip_tile(x, y, &w, &h, &pt->box))
+      return;
+
+   if (util_format_is_pure_uint(format)) {
+      util_format_read_4ui(format, (unsigned *) tile->data.colorui128,
+                           sizeof(tile->data.colorui128[0]),
+                           tc->transfer_map, pt->stride, x, y, w, h);
+   }
+   else if (util_format_is_pure_sint(format)) {
+      util_format_read_4i(format, (int *) tile->data.colori128,
+                          sizeof(tile->data.colori128[0]),
+                          tc->transfer_map, pt->stride, x, y, w, h);
+   }
+#if defined(PIPE_ARCH_SSE)
+   else if (unorm8_swizzle(format) >= 0) {
+      sp_unpack_unorm8_sse2((float *) tile->data.color,
+                            sizeof(tile->data.color[0]),
+                            (const uint8_t *) tc->transfer_map +
+                            y * pt->stride + x * 4,
+                            pt->stride, w, h, unorm8_swizzle(format));
+   }
 #endif
+   else {
+      util_format_read_4f(format, (float *) tile->data.color,
+                          sizeof(tile->data.color[0]),
+                          tc->transfer_map, pt->stride, x, y, w, h);
+   }
+}
+
+
+/**
+ * Set the scratch tile to the clear value, on first use during a flush.
+ */
+static void
+sp_tile_cache_prepare_clear_tile(struct softpipe_tile_cache *tc)
+{
+   if (tc->depth_stencil) {
+      clear_tile(tc->tile, tc->transfer->resource->format, tc->clear_val);
+   } else {
+      clear_tile_rgba(tc->tile, tc->transfer->resource->format,
+                      &tc->clear_color);
+   }
 }
 
+
 static void
 sp_flush_tile(struct softpipe_tile_cache* tc, unsigned pos)
 {
    if (!tc->tile_addrs[pos].bits.invalid) {
-      if (tc->depth_stencil) {
-         pipe_put_tile_raw(tc->transfer, tc->transfer_map,
-                           tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                           tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                           TILE_SIZE, TILE_SIZE,
-                           tc->entries[pos]->data.depth32, 0/*STRIDE*/);
-      }
-      else {
-         if (util_format_is_pure_uint(tc->surface->format)) {
-            pipe_put_tile_ui_format(tc->transfer, tc->transfer_map,
-                                    tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                    tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                    TILE_SIZE, TILE_SIZE,
-                                    tc->surface->format,
-                                    (unsigned *) tc->entries[pos]->data.colorui128);
-         } else if (util_format_is_pure_sint(tc->surface->format)) {
-            pipe_put_tile_i_format(tc->transfer, tc->transfer_map,
-                                   tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                   tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                   TILE_SIZE, TILE_SIZE,
-                                   tc->surface->format,
-                                   (int *) tc->entries[pos]->data.colori128);
-         } else {
-            pipe_put_tile_rgba_format(tc->transfer, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (float *) tc->entries[pos]->data.color);
-         }
-      }
+      sp_tile_put(tc, tc->entries[pos], tc->tile_addrs[pos]);
       tc->tile_addrs[pos].bits.invalid = 1;  /* mark as empty */
+      tc->write_backs++;
    }
 }
 
+
+static int
+compare_tile_addr(const void *a, const void *b)
+{
+   const union tile_address *ta = (const union tile_address *) a;
+   const union tile_address *tb = (const union tile_address *) b;
+   unsigned ka = (ta->bits.y << TILE_ADDR_BITS) | ta->bits.x;
+   unsigned kb = (tb->bits.y << TILE_ADDR_BITS) | tb->bits.x;
+
+   return ka < kb ? -1 : ka > kb;
+}
+
+
 /**
  * Flush the tile cache: write all dirty tiles back to the transfer.
  * any tiles "flagged" as cleared will be "really" cleared.
+ *
+ * Cached and cleared tiles are written in a single pass in surface order,
+ * so the surface is written front to back rather than in cache order.
  */
 void
 sp_flush_tile_cache(struct softpipe_tile_cache *tc)
 {
    struct pipe_transfer *pt = tc->transfer;
-   int inuse = 0, pos;
 
    if (pt) {
       /* caching a drawing transfer */
+      union tile_address order[TILE_CACHE_MAX_ENTRIES];
+      struct softpipe_cached_tile *tiles[TILE_CACHE_MAX_ENTRIES];
+      const uint w = pt->box.width;
+      const uint h = pt->box.height;
+      boolean clear_tile_ready = FALSE;
+      unsigned num = 0, next = 0, pos;
+      uint x, y;
+
+      if (!tc->tile)
+         tc->tile = sp_alloc_tile(tc);
+
       for (pos = 0; pos < Elements(tc->entries); pos++) {
-         struct softpipe_cached_tile *tile = tc->entries[pos];
-         if (!tile)
-         {
+         if (!tc->entries[pos]) {
             assert(tc->tile_addrs[pos].bits.invalid);
             continue;
          }
+         if (!tc->tile_addrs[pos].bits.invalid) {
+            /* stash the position in the padding bits for the sort */
+            order[num] = tc->tile_addrs[pos];
+            order[num].bits.pad = pos;
+            num++;
+         }
+      }
 
-         sp_flush_tile(tc, pos);
-         ++inuse;
+      qsort(order, num, sizeof order[0], compare_tile_addr);
+      for (pos = 0; pos < num; pos++)
+         tiles[pos] = tc->entries[order[pos].bits.pad];
+
+      for (y = 0; y < h; y += TILE_SIZE) {
+         for (x = 0; x < w; x += TILE_SIZE) {
+            union tile_address addr = tile_address(x, y);
+
+            if (next < num &&
+                order[next].bits.x == addr.bits.x &&
+                order[next].bits.y == addr.bits.y) {
+               /* cached tiles are never in cleared state */
+               sp_tile_put(tc, tiles[next], addr);
+               tc->write_backs++;
+               next++;
+            }
+            else if (is_clear_flag_set(tc->clear_flags, addr)) {
+               if (!clear_tile_ready) {
+                  sp_tile_cache_prepare_clear_tile(tc);
+                  clear_tile_ready = TRUE;
+               }
+               sp_tile_put(tc, tc->tile, addr);
+            }
+         }
       }
 
-      sp_tile_cache_flush_clear(tc);
+      /* every cached tile is within the surface */
+      assert(next == num);
 
+      for (pos = 0; pos < Elements(tc->tile_addrs); pos++) {
+         tc->tile_addrs[pos].bits.invalid = 1;
+      }
+
+      /* reset all clear flags to zero */
+      memset(tc->clear_flags, 0, sizeof(tc->clear_flags));
 
       tc->last_tile_addr.bits.invalid = 1;
    }
-
-#if 0
-   debug_printf("flushed tiles in use: %d\n", inuse);
-#endif
 }
-
 static struct softpipe_cached_tile *
 sp_alloc_tile(struct softpipe_tile_cache *tc)
 {
@@ -484,52 +702,42 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
                     union tile_address addr )
 {
    struct pipe_transfer *pt = tc->transfer;
-   /* cache pos/entry: */
-   const int pos = CACHE_POS(addr.bits.x,
-                             addr.bits.y);
-   struct softpipe_cached_tile *tile = tc->entries[pos];
-
-   if (!tile) {
-      tile = sp_alloc_tile(tc);
-      tc->entries[pos] = tile;
+   /* cache set and the entry to use if the tile isn't cached */
+   const unsigned first = CACHE_SET(tc, addr.bits.x, addr.bits.y) *
+                          TILE_CACHE_WAYS;
+   unsigned pos, victim = first;
+   struct softpipe_cached_tile *tile;
+
+   for (pos = first; pos < first + TILE_CACHE_WAYS; pos++) {
+      if (tc->tile_addrs[pos].value == addr.value)
+         break;
+
+      /* prefer empty entries, otherwise the least recently used one */
+      if (!tc->tile_addrs[victim].bits.invalid &&
+          (tc->tile_addrs[pos].bits.invalid ||
+           tc->last_used[pos] < tc->last_used[victim]))
+         victim = pos;
    }
 
-   if (addr.value != tc->tile_addrs[pos].value) {
+   if (pos < first + TILE_CACHE_WAYS) {
+      tc->hits++;
+      tile = tc->entries[pos];
+   }
+   else {
+      tc->misses++;
+      pos = victim;
+
+      tile = tc->entries[pos];
+      if (!tile) {
+         tile = sp_alloc_tile(tc);
+         tc->entries[pos] = tile;
+      }
 
       assert(pt->resource);
       if (tc->tile_addrs[pos].bits.invalid == 0) {
          /* put dirty tile back in framebuffer */
-         if (tc->depth_stencil) {
-            pipe_put_tile_raw(pt, tc->transfer_map,
-                              tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                              tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                              TILE_SIZE, TILE_SIZE,
-                              tile->data.depth32, 0/*STRIDE*/);
-         }
-         else {
-            if (util_format_is_pure_uint(tc->surface->format)) {
-               pipe_put_tile_ui_format(pt, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (unsigned *) tile->data.colorui128);
-            } else if (util_format_is_pure_sint(tc->surface->format)) {
-               pipe_put_tile_i_format(pt, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (int *) tile->data.colori128);
-            } else {
-               pipe_put_tile_rgba_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (float *) tile->data.color);
-            }
-         }
+         sp_tile_put(tc, tile, tc->tile_addrs[pos]);
+         tc->write_backs++;
       }
 
       tc->tile_addrs[pos] = addr;
@@ -546,40 +754,12 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
       }
       else {
          /* get new tile data from transfer */
-         if (tc->depth_stencil) {
-            pipe_get_tile_raw(pt, tc->transfer_map,
-                              tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                              tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                              TILE_SIZE, TILE_SIZE,
-                              tile->data.depth32, 0/*STRIDE*/);
-         }
-         else {
-            if (util_format_is_pure_uint(tc->surface->format)) {
-               pipe_get_tile_ui_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (unsigned *) tile->data.colorui128);
-            } else if (util_format_is_pure_sint(tc->surface->format)) {
-               pipe_get_tile_i_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (int *) tile->data.colori128);
-            } else {
-               pipe_get_tile_rgba_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (float *) tile->data.color);
-            }
-         }
+         sp_tile_get(tc, tile, addr);
       }
    }
 
+   tc->last_used[pos] = ++tc->use_count;
+
    tc->last_tile = tile;
    tc->last_tile_addr = addr;
    return tile;
@@ -75,7 +75,14 @@ struct softpipe_cached_tile
    } data;
 };
 
-#define NUM_ENTRIES 50
+/**
+ * The cache is set associative with LRU replacement within a set.  The
+ * number of sets is chosen from the size of the surface being cached, up
+ * to TILE_CACHE_MAX_SETS; tiles are only allocated once they're used.
+ */
+#define TILE_CACHE_WAYS 4
+#define TILE_CACHE_MAX_SETS 64
+#define TILE_CACHE_MAX_ENTRIES (TILE_CACHE_WAYS * TILE_CACHE_MAX_SETS)
 
 
 struct softpipe_tile_cache
@@ -85,8 +92,11 @@ struct softpipe_tile_cache
    struct pipe_transfer *transfer;
    void *transfer_map;
 
-   union tile_address tile_addrs[NUM_ENTRIES];
-   struct softpipe_cached_tile *entries[NUM_ENTRIES];
+   union tile_address tile_addrs[TILE_CACHE_MAX_ENTRIES];
+   struct softpipe_cached_tile *entries[TILE_CACHE_MAX_ENTRIES];
+   unsigned last_used[TILE_CACHE_MAX_ENTRIES];  /**< for LRU replacement */
+   unsigned num_sets;  /**< number of sets in use, a power of two */
+   unsigned use_count;
    uint clear_flags[(MAX_WIDTH / TILE_SIZE) * (MAX_HEIGHT / TILE_SIZE) / 32];
    union pipe_color_union clear_color; /**< for color bufs */
    uint64_t clear_val;        /**< for z+stencil */
@@ -96,6 +106,9 @@ struct softpipe_tile_cache
 
    union tile_address last_tile_addr;
    struct softpipe_cached_tile *last_tile;  /**< most recently retrieved tile */
+
+   /** Lookups which missed last_tile, see SOFTPIPE_DUMP_TILE_CACHE */
+   uint64_t hits, misses, write_backs;
 };
 
 
@@ -124,6 +137,20 @@ extern struct softpipe_cached_tile *
 sp_find_cached_tile(struct softpipe_tile_cache *tc, 
                     union tile_address addr );
 
+#if defined(PIPE_ARCH_SSE)
+
+extern void
+sp_pack_unorm8_sse2(uint8_t *dst, unsigned dst_stride,
+                    const float *src, unsigned src_stride,
+                    unsigned w, unsigned h, boolean swap_rb);
+
+extern void
+sp_unpack_unorm8_sse2(float *dst, unsigned dst_stride,
+                      const uint8_t *src, unsigned src_stride,
+                      unsigned w, unsigned h, boolean swap_rb);
+
+#endif
+
 
 static INLINE union tile_address
 tile_address( unsigned x,
@@ -91,6 +91,14 @@ struct pipe_context {
    /*@{*/
    void (*draw_vbo)( struct pipe_context *pipe,
                      const struct pipe_draw_info *info );
+
+   /**
+    * Optional.  Same as calling draw_vbo() for each of the \p num_draws
+    * elements of \p info in turn, without any state change in between.
+    */
+   void (*multi_draw_vbo)( struct pipe_context *pipe,
+                           const struct pipe_draw_info *info,
+                           unsigned num_draws );
    /*@}*/
 
    /**
@@ -313,6 +321,20 @@ struct pipe_context {
    void (*blit)(struct pipe_context *pipe,
                 const struct pipe_blit_info *info);
 
+   /**
+    * Generate mipmap levels base_level + 1 .. last_level of the given layers
+    * by downsampling the previous level, interpreting the texels as format.
+    * Optional; returns FALSE when the driver can't do it for this resource,
+    * in which case the caller must generate the levels some other way.
+    */
+   boolean (*generate_mipmap)(struct pipe_context *pipe,
+                              struct pipe_resource *resource,
+                              enum pipe_format format,
+                              unsigned base_level,
+                              unsigned last_level,
+                              unsigned first_layer,
+                              unsigned last_layer);
+
    /*@}*/
 
    /**
@@ -160,6 +160,20 @@ struct pipe_screen {
 						  const struct pipe_resource *templat,
 						  struct winsys_handle *handle);
 
+   /**
+    * Create a resource whose storage is existing user memory, without
+    * copying it.  For textures the memory holds the single mip level with
+    * rows \p stride bytes apart; for buffers \p stride is ignored.
+    * The memory must stay valid until the resource is destroyed.
+    *
+    * Optional; returns NULL if the driver cannot use the memory in place,
+    * in which case the caller must fall back to resource_create.
+    */
+   struct pipe_resource * (*resource_from_user_memory)(struct pipe_screen *,
+                                                       const struct pipe_resource *templat,
+                                                       void *user_memory,
+                                                       unsigned stride);
+
    /**
     * Get a winsys_handle from a texture. Some platforms/winsys requires
     * that the texture is created with a special usage flag like
@@ -37,6 +37,7 @@
 #include "util/u_inlines.h"
 #include "util/u_sampler.h"
 #include "util/u_format.h"
+#include "os/os_time.h"
 #include "tgsi/tgsi_text.h"
 #include "pipe-loader/pipe_loader.h"
 
@@ -1571,6 +1572,141 @@ static void test_atom_race(struct context *ctx, bool global)
         destroy_prog(ctx);
 }
 
+static void wait_idle(struct context *ctx)
+{
+        struct pipe_context *pipe = ctx->pipe;
+        struct pipe_fence_handle *fence = NULL;
+
+        pipe->flush(pipe, &fence, 0);
+        if (fence) {
+                ctx->screen->fence_finish(ctx->screen, fence,
+                                          PIPE_TIMEOUT_INFINITE);
+                ctx->screen->fence_reference(ctx->screen, &fence, NULL);
+        }
+}
+
+static void test_bench(struct context *ctx)
+{
+        const char *stream_src = "COMP\n"
+                "DCL RES[0], BUFFER, RAW\n"
+                "DCL RES[1], BUFFER, RAW, WR\n"
+                "DCL SV[0], BLOCK_ID[0]\n"
+                "DCL SV[1], BLOCK_SIZE[0]\n"
+                "DCL SV[2], THREAD_ID[0]\n"
+                "DCL TEMP[0], LOCAL\n"
+                "DCL TEMP[1], LOCAL\n"
+                "IMM UINT32 { 4, 3, 1, 0 }\n"
+                "\n"
+                "    BGNSUB\n"
+                "       UMAD TEMP[0].x, SV[0], SV[1], SV[2]\n"
+                "       UMUL TEMP[0].x, TEMP[0], IMM[0]\n"
+                "       LOAD TEMP[1].x, RES[0], TEMP[0]\n"
+                "       UMAD TEMP[1].x, TEMP[1], IMM[0].yyyy, IMM[0].zzzz\n"
+                "       STORE RES[1].x, TEMP[0], TEMP[1]\n"
+                "       RET\n"
+                "    ENDSUB\n";
+        const char *reduce_src = "COMP\n"
+                "DCL RES[0], BUFFER, RAW\n"
+                "DCL RES[1], BUFFER, RAW, WR\n"
+                "DCL SV[0], BLOCK_ID[0]\n"
+                "DCL SV[1], BLOCK_SIZE[0]\n"
+                "DCL SV[2], THREAD_ID[0]\n"
+                "DCL TEMP[0], LOCAL\n"
+                "DCL TEMP[1], LOCAL\n"
+                "DCL TEMP[2], LOCAL\n"
+                "DCL TEMP[3], LOCAL\n"
+                "IMM UINT32 { 4, 1, 0, 0 }\n"
+                "\n"
+                "    BGNSUB\n"
+                "       UMAD TEMP[0].x, SV[0], SV[1], SV[2]\n"
+                "       UMUL TEMP[0].x, TEMP[0], IMM[0]\n"
+                "       LOAD TEMP[1].x, RES[0], TEMP[0]\n"
+                "       UMUL TEMP[0].x, SV[2], IMM[0]\n"
+                "       STORE RLOCAL.x, TEMP[0], TEMP[1]\n"
+                "       BARRIER\n"
+                "       USEQ TEMP[0].x, SV[2], IMM[0].zzzz\n"
+                "       IF TEMP[0]\n"
+                "               MOV TEMP[1].x, IMM[0].zzzz\n"
+                "               MOV TEMP[2].x, IMM[0].zzzz\n"
+                "               BGNLOOP\n"
+                "                       USEQ TEMP[3].x, TEMP[2], SV[1]\n"
+                "                       IF TEMP[3]\n"
+                "                               BRK\n"
+                "                       ENDIF\n"
+                "                       UMUL TEMP[3].x, TEMP[2], IMM[0]\n"
+                "                       LOAD TEMP[3].x, RLOCAL, TEMP[3]\n"
+                "                       UADD TEMP[1].x, TEMP[1], TEMP[3]\n"
+                "                       UADD TEMP[2].x, TEMP[2], IMM[0].yyyy\n"
+                "               ENDLOOP\n"
+                "               UMUL TEMP[0].x, SV[0], IMM[0]\n"
+                "               STORE RES[1].x, TEMP[0], TEMP[1]\n"
+                "       ENDIF\n"
+                "       RET\n"
+                "    ENDSUB\n";
+        const int n = 65536, block = 64, iters = 100;
+        void init(void *p, int s, int x, int y) {
+                *(uint32_t *)p = s == 0 ? x : 0xdeadbeef;
+        }
+        void expect_stream(void *p, int s, int x, int y) {
+                *(uint32_t *)p = 3 * x + 1;
+        }
+        void expect_reduce(void *p, int s, int x, int y) {
+                *(uint32_t *)p = block * block * x + block * (block - 1) / 2;
+        }
+        int64_t t0, t1;
+        int i;
+
+        printf("- %s\n", __func__);
+
+        init_tex(ctx, 0, PIPE_BUFFER, false, PIPE_FORMAT_R32_FLOAT,
+                 n * 4, 0, init);
+        init_tex(ctx, 1, PIPE_BUFFER, true, PIPE_FORMAT_R32_FLOAT,
+                 n * 4, 0, init);
+        init_compute_resources(ctx, (int []) { 0, 1, -1 });
+
+        init_prog(ctx, 0, 0, 0, stream_src, NULL);
+        launch_grid(ctx, (uint []){block, 1, 1},
+                    (uint []){n / block, 1, 1}, 0, NULL);
+        check_tex(ctx, 1, expect_stream, NULL);
+
+        wait_idle(ctx);
+        t0 = os_time_get();
+        for (i = 0; i < iters; ++i)
+                launch_grid(ctx, (uint []){block, 1, 1},
+                            (uint []){n / block, 1, 1}, 0, NULL);
+        wait_idle(ctx);
+        t1 = os_time_get();
+        printf("stream: %d threads, %.3f ms/launch\n",
+               n, (t1 - t0) / 1000.0 / iters);
+        destroy_prog(ctx);
+
+        /* One partial sum per block. */
+        destroy_compute_resources(ctx);
+        pipe_resource_reference(&ctx->tex[1], NULL);
+        init_tex(ctx, 1, PIPE_BUFFER, true, PIPE_FORMAT_R32_FLOAT,
+                 n / block * 4, 0, init);
+        init_compute_resources(ctx, (int []) { 0, 1, -1 });
+
+        init_prog(ctx, block * 4, 0, 0, reduce_src, NULL);
+        launch_grid(ctx, (uint []){block, 1, 1},
+                    (uint []){n / block, 1, 1}, 0, NULL);
+        check_tex(ctx, 1, expect_reduce, NULL);
+
+        wait_idle(ctx);
+        t0 = os_time_get();
+        for (i = 0; i < iters; ++i)
+                launch_grid(ctx, (uint []){block, 1, 1},
+                            (uint []){n / block, 1, 1}, 0, NULL);
+        wait_idle(ctx);
+        t1 = os_time_get();
+        printf("reduce: %d threads, %.3f ms/launch\n",
+               n, (t1 - t0) / 1000.0 / iters);
+
+        destroy_compute_resources(ctx);
+        destroy_tex(ctx);
+        destroy_prog(ctx);
+}
+
 int main(int argc, char *argv[])
 {
         struct context *ctx = CALLOC_STRUCT(context);
@@ -1613,6 +1749,8 @@ int main(int argc, char *argv[])
            test_atom_ops(ctx, false);
         if (tests & (1 << 16))
            test_atom_race(ctx, false);
+        if (tests & (1 << 17))
+           test_bench(ctx);
 
         destroy_ctx(ctx);
 
@@ -0,0 +1,357 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Map a vertex shader constant buffer with DISCARD_WHOLE_RESOURCE while
+ * the unflushed scene reads it through a sampler view, and check that
+ * the draw after the map sees the new constants and the draw before it
+ * the old ones.  Drivers may give the buffer new storage instead of
+ * flushing there.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* pipe_*_state structs */
+#include "pipe/p_state.h"
+/* pipe_context */
+#include "pipe/p_context.h"
+/* pipe_screen */
+#include "pipe/p_screen.h"
+/* PIPE_* */
+#include "pipe/p_defines.h"
+/* TGSI_SEMANTIC_{POSITION|COLOR} */
+#include "pipe/p_shader_tokens.h"
+/* pipe_buffer_* helpers */
+#include "util/u_inlines.h"
+
+/* constant state object helper */
+#include "cso_cache/cso_context.h"
+
+/* util_draw_init_info */
+#include "util/u_draw.h"
+/* FREE & CALLOC_STRUCT */
+#include "util/u_memory.h"
+/* util_make_fragment_passthrough_shader */
+#include "util/u_simple_shaders.h"
+/* tgsi_text_translate */
+#include "tgsi/tgsi_text.h"
+/* to get a hardware pipe driver */
+#include "pipe-loader/pipe_loader.h"
+
+#define WIDTH 64
+#define HEIGHT 64
+
+struct program
+{
+	struct pipe_loader_device *dev;
+	struct pipe_screen *screen;
+	struct pipe_context *pipe;
+	struct cso_context *cso;
+
+	struct pipe_blend_state blend;
+	struct pipe_depth_stencil_alpha_state depthstencil;
+	struct pipe_rasterizer_state rasterizer;
+	struct pipe_viewport_state viewport;
+	struct pipe_framebuffer_state framebuffer;
+	struct pipe_vertex_element velem;
+
+	void *vs;
+	void *fs;
+
+	union pipe_color_union clear_color;
+
+	struct pipe_resource *vbuf;
+	struct pipe_resource *cbuf;
+	struct pipe_resource *target;
+	struct pipe_sampler_view *view;
+};
+
+static const char vs_text[] =
+	"VERT\n"
+	"DCL IN[0]\n"
+	"DCL OUT[0], POSITION\n"
+	"DCL OUT[1], COLOR\n"
+	"DCL CONST[0]\n"
+	"  0: MOV OUT[0], IN[0]\n"
+	"  1: MOV OUT[1], CONST[0]\n"
+	"  2: END\n";
+
+static const float red[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+static const float green[4] = { 0.0f, 1.0f, 0.0f, 1.0f };
+
+static void init_prog(struct program *p)
+{
+	struct pipe_surface surf_tmpl;
+	struct pipe_sampler_view view_tmpl;
+	struct pipe_shader_state vs;
+	struct tgsi_token tokens[256];
+	/* left half, then right half, as strips */
+	static const float vertices[8][4] = {
+		{ -1.0f, -1.0f, 0.0f, 1.0f },
+		{  0.0f, -1.0f, 0.0f, 1.0f },
+		{ -1.0f,  1.0f, 0.0f, 1.0f },
+		{  0.0f,  1.0f, 0.0f, 1.0f },
+		{  0.0f, -1.0f, 0.0f, 1.0f },
+		{  1.0f, -1.0f, 0.0f, 1.0f },
+		{  0.0f,  1.0f, 0.0f, 1.0f },
+		{  1.0f,  1.0f, 0.0f, 1.0f },
+	};
+	int ret;
+
+	/* find a hardware device */
+	ret = pipe_loader_probe(&p->dev, 1);
+	assert(ret);
+
+	/* init a pipe screen */
+	p->screen = pipe_loader_create_screen(p->dev, PIPE_SEARCH_DIR);
+	assert(p->screen);
+
+	/* create the pipe driver context and cso context */
+	p->pipe = p->screen->context_create(p->screen, NULL);
+	p->cso = cso_create_context(p->pipe);
+
+	/* set clear color */
+	p->clear_color.f[0] = 0.0;
+	p->clear_color.f[1] = 0.0;
+	p->clear_color.f[2] = 1.0;
+	p->clear_color.f[3] = 1.0;
+
+	p->vbuf = pipe_buffer_create(p->screen, PIPE_BIND_VERTEX_BUFFER,
+				     PIPE_USAGE_STATIC, sizeof(vertices));
+	pipe_buffer_write(p->pipe, p->vbuf, 0, sizeof(vertices), vertices);
+
+	/* constant buffer, also sampled so that the scene references it */
+	p->cbuf = pipe_buffer_create(p->screen,
+				     PIPE_BIND_CONSTANT_BUFFER |
+				     PIPE_BIND_SAMPLER_VIEW,
+				     PIPE_USAGE_DYNAMIC, sizeof(red));
+
+	memset(&view_tmpl, 0, sizeof(view_tmpl));
+	view_tmpl.format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+	view_tmpl.u.buf.first_element = 0;
+	view_tmpl.u.buf.last_element = 0;
+	view_tmpl.swizzle_r = PIPE_SWIZZLE_RED;
+	view_tmpl.swizzle_g = PIPE_SWIZZLE_GREEN;
+	view_tmpl.swizzle_b = PIPE_SWIZZLE_BLUE;
+	view_tmpl.swizzle_a = PIPE_SWIZZLE_ALPHA;
+	p->view = p->pipe->create_sampler_view(p->pipe, p->cbuf, &view_tmpl);
+
+	/* render target texture */
+	{
+		struct pipe_resource tmplt;
+		memset(&tmplt, 0, sizeof(tmplt));
+		tmplt.target = PIPE_TEXTURE_2D;
+		tmplt.format = PIPE_FORMAT_B8G8R8A8_UNORM; /* All drivers support this */
+		tmplt.width0 = WIDTH;
+		tmplt.height0 = HEIGHT;
+		tmplt.depth0 = 1;
+		tmplt.array_size = 1;
+		tmplt.last_level = 0;
+		tmplt.bind = PIPE_BIND_RENDER_TARGET;
+
+		p->target = p->screen->resource_create(p->screen, &tmplt);
+	}
+
+	/* disabled blending/masking */
+	memset(&p->blend, 0, sizeof(p->blend));
+	p->blend.rt[0].colormask = PIPE_MASK_RGBA;
+
+	/* no-op depth/stencil/alpha */
+	memset(&p->depthstencil, 0, sizeof(p->depthstencil));
+
+	/* rasterizer */
+	memset(&p->rasterizer, 0, sizeof(p->rasterizer));
+	p->rasterizer.cull_face = PIPE_FACE_NONE;
+	p->rasterizer.half_pixel_center = 1;
+	p->rasterizer.bottom_edge_rule = 1;
+	p->rasterizer.depth_clip = 1;
+
+	surf_tmpl.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+	surf_tmpl.u.tex.level = 0;
+	surf_tmpl.u.tex.first_layer = 0;
+	surf_tmpl.u.tex.last_layer = 0;
+	/* drawing destination */
+	memset(&p->framebuffer, 0, sizeof(p->framebuffer));
+	p->framebuffer.width = WIDTH;
+	p->framebuffer.height = HEIGHT;
+	p->framebuffer.nr_cbufs = 1;
+	p->framebuffer.cbufs[0] = p->pipe->create_surface(p->pipe, p->target, &surf_tmpl);
+
+	/* viewport, no depth */
+	p->viewport.scale[0] = WIDTH / 2.0f;
+	p->viewport.scale[1] = HEIGHT / 2.0f;
+	p->viewport.scale[2] = 1.0f;
+	p->viewport.scale[3] = 1.0f;
+	p->viewport.translate[0] = WIDTH / 2.0f;
+	p->viewport.translate[1] = HEIGHT / 2.0f;
+	p->viewport.translate[2] = 0.0f;
+	p->viewport.translate[3] = 0.0f;
+
+	/* vertex elements state */
+	memset(&p->velem, 0, sizeof(p->velem));
+	p->velem.src_offset = 0;
+	p->velem.instance_divisor = 0;
+	p->velem.vertex_buffer_index = 0;
+	p->velem.src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+	/* vertex shader, color from the constant buffer */
+	ret = tgsi_text_translate(vs_text, tokens, Elements(tokens));
+	assert(ret);
+	memset(&vs, 0, sizeof(vs));
+	vs.tokens = tokens;
+	p->vs = p->pipe->create_vs_state(p->pipe, &vs);
+
+	/* fragment shader */
+	p->fs = util_make_fragment_passthrough_shader(p->pipe,
+		TGSI_SEMANTIC_COLOR, TGSI_INTERPOLATE_PERSPECTIVE, TRUE);
+}
+
+static void close_prog(struct program *p)
+{
+	/* unset all state */
+	cso_release_all(p->cso);
+
+	p->pipe->set_constant_buffer(p->pipe, PIPE_SHADER_VERTEX, 0, NULL);
+
+	p->pipe->delete_vs_state(p->pipe, p->vs);
+	p->pipe->delete_fs_state(p->pipe, p->fs);
+
+	pipe_sampler_view_reference(&p->view, NULL);
+	pipe_surface_reference(&p->framebuffer.cbufs[0], NULL);
+	pipe_resource_reference(&p->target, NULL);
+	pipe_resource_reference(&p->cbuf, NULL);
+	pipe_resource_reference(&p->vbuf, NULL);
+
+	cso_destroy_context(p->cso);
+	p->pipe->destroy(p->pipe);
+	p->screen->destroy(p->screen);
+	pipe_loader_release(&p->dev, 1);
+
+	FREE(p);
+}
+
+static void set_state(struct program *p)
+{
+	struct pipe_vertex_buffer vbuffer;
+	struct pipe_constant_buffer cb;
+
+	cso_set_framebuffer(p->cso, &p->framebuffer);
+	cso_set_blend(p->cso, &p->blend);
+	cso_set_depth_stencil_alpha(p->cso, &p->depthstencil);
+	cso_set_rasterizer(p->cso, &p->rasterizer);
+	cso_set_viewport(p->cso, &p->viewport);
+	cso_set_fragment_shader_handle(p->cso, p->fs);
+	cso_set_vertex_shader_handle(p->cso, p->vs);
+	cso_set_vertex_elements(p->cso, 1, &p->velem);
+	cso_set_sampler_views(p->cso, PIPE_SHADER_FRAGMENT, 1, &p->view);
+
+	memset(&vbuffer, 0, sizeof(vbuffer));
+	vbuffer.buffer = p->vbuf;
+	vbuffer.stride = 4 * sizeof(float);
+	cso_set_vertex_buffers(p->cso, 0, 1, &vbuffer);
+
+	memset(&cb, 0, sizeof(cb));
+	cb.buffer = p->cbuf;
+	cb.buffer_size = sizeof(red);
+	p->pipe->set_constant_buffer(p->pipe, PIPE_SHADER_VERTEX, 0, &cb);
+}
+
+static void draw_half(struct program *p, unsigned half)
+{
+	struct pipe_draw_info info;
+
+	util_draw_init_info(&info);
+	info.mode = PIPE_PRIM_TRIANGLE_STRIP;
+	info.start = half * 4;
+	info.count = 4;
+	info.min_index = info.start;
+	info.max_index = info.start + 3;
+	p->pipe->draw_vbo(p->pipe, &info);
+}
+
+/* compare a B8G8R8A8 pixel against a color */
+static boolean check_pixel(const uint8_t *map, unsigned stride,
+			   unsigned x, unsigned y, const float color[4],
+			   const char *what)
+{
+	const uint8_t *pixel = map + y * stride + x * 4;
+	boolean pass = pixel[2] == (uint8_t)(color[0] * 255.0f) &&
+		       pixel[1] == (uint8_t)(color[1] * 255.0f) &&
+		       pixel[0] == (uint8_t)(color[2] * 255.0f);
+
+	printf("%s %s: got %u %u %u, expected %u %u %u\n",
+	       pass ? "PASS" : "FAIL", what,
+	       pixel[2], pixel[1], pixel[0],
+	       (uint8_t)(color[0] * 255.0f), (uint8_t)(color[1] * 255.0f),
+	       (uint8_t)(color[2] * 255.0f));
+
+	return pass;
+}
+
+int main(int argc, char** argv)
+{
+	struct program *p = CALLOC_STRUCT(program);
+	struct pipe_fence_handle *fence = NULL;
+	struct pipe_transfer *t;
+	boolean success;
+	uint8_t *map;
+	float *constants;
+
+	init_prog(p);
+	set_state(p);
+
+	pipe_buffer_write(p->pipe, p->cbuf, 0, sizeof(red), red);
+
+	p->pipe->clear(p->pipe, PIPE_CLEAR_COLOR, &p->clear_color, 0, 0);
+	draw_half(p, 0);
+
+	/* the scene hasn't been flushed and still references cbuf */
+	constants = pipe_buffer_map(p->pipe, p->cbuf,
+				    PIPE_TRANSFER_WRITE |
+				    PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE, &t);
+	memcpy(constants, green, sizeof(green));
+	pipe_buffer_unmap(p->pipe, t);
+
+	draw_half(p, 1);
+
+	p->pipe->flush(p->pipe, &fence, 0);
+	p->screen->fence_finish(p->screen, fence, PIPE_TIMEOUT_INFINITE);
+	p->screen->fence_reference(p->screen, &fence, NULL);
+
+	map = pipe_transfer_map(p->pipe, p->target, 0, 0, PIPE_TRANSFER_READ,
+				0, 0, WIDTH, HEIGHT, &t);
+	success = check_pixel(map, t->stride, WIDTH / 4, HEIGHT / 2, red,
+			      "draw before the map");
+	success = check_pixel(map, t->stride, 3 * WIDTH / 4, HEIGHT / 2, green,
+			      "draw after the map") && success;
+	p->pipe->transfer_unmap(p->pipe, t);
+
+	close_prog(p);
+
+	return success ? 0 : 1;
+}
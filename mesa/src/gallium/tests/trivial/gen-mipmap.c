@@ -0,0 +1,272 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Time util_gen_mipmap() with and without the driver's generate_mipmap
+ * hook, and check that both paths produce (nearly) the same first level.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* pipe_*_state structs */
+#include "pipe/p_state.h"
+/* pipe_context */
+#include "pipe/p_context.h"
+/* pipe_screen */
+#include "pipe/p_screen.h"
+/* PIPE_* */
+#include "pipe/p_defines.h"
+/* pipe_transfer_map helpers */
+#include "util/u_inlines.h"
+
+/* constant state object helper */
+#include "cso_cache/cso_context.h"
+
+/* pipe_[get|put]_tile_rgba */
+#include "util/u_tile.h"
+/* util_format_short_name */
+#include "util/u_format.h"
+/* util_gen_mipmap */
+#include "util/u_gen_mipmap.h"
+/* u_sampler_view_default_template */
+#include "util/u_sampler.h"
+/* FREE & CALLOC_STRUCT */
+#include "util/u_memory.h"
+/* MAX2 */
+#include "util/u_math.h"
+/* os_time_get */
+#include "os/os_time.h"
+/* to get a hardware pipe driver */
+#include "pipe-loader/pipe_loader.h"
+
+struct program
+{
+	struct pipe_loader_device *dev;
+	struct pipe_screen *screen;
+	struct pipe_context *pipe;
+	struct cso_context *cso;
+	struct gen_mipmap_state *gen_mipmap;
+};
+
+static const struct {
+	enum pipe_texture_target target;
+	enum pipe_format format;
+	unsigned size;
+	unsigned layers;
+} cases[] = {
+	{ PIPE_TEXTURE_2D, PIPE_FORMAT_B8G8R8A8_UNORM, 4096, 1 },
+	{ PIPE_TEXTURE_2D, PIPE_FORMAT_B8G8R8A8_SRGB, 2048, 1 },
+	{ PIPE_TEXTURE_2D, PIPE_FORMAT_R16G16B16A16_FLOAT, 2048, 1 },
+	{ PIPE_TEXTURE_2D_ARRAY, PIPE_FORMAT_R8G8B8A8_UNORM, 1024, 16 },
+};
+
+static void init_prog(struct program *p)
+{
+	int ret;
+
+	/* find a hardware device */
+	ret = pipe_loader_probe(&p->dev, 1);
+	assert(ret);
+
+	/* init a pipe screen */
+	p->screen = pipe_loader_create_screen(p->dev, PIPE_SEARCH_DIR);
+	assert(p->screen);
+
+	/* create the pipe driver context and cso context */
+	p->pipe = p->screen->context_create(p->screen, NULL);
+	p->cso = cso_create_context(p->pipe);
+	p->gen_mipmap = util_create_gen_mipmap(p->pipe, p->cso);
+}
+
+static void close_prog(struct program *p)
+{
+	util_destroy_gen_mipmap(p->gen_mipmap);
+	cso_destroy_context(p->cso);
+	p->pipe->destroy(p->pipe);
+	p->screen->destroy(p->screen);
+	pipe_loader_release(&p->dev, 1);
+
+	FREE(p);
+}
+
+static struct pipe_resource *
+create_texture(struct program *p, unsigned i)
+{
+	struct pipe_resource tmplt;
+	struct pipe_resource *tex;
+	unsigned layer;
+	float *rgba;
+	unsigned j;
+
+	memset(&tmplt, 0, sizeof(tmplt));
+	tmplt.target = cases[i].target;
+	tmplt.format = cases[i].format;
+	tmplt.width0 = cases[i].size;
+	tmplt.height0 = cases[i].size;
+	tmplt.depth0 = 1;
+	tmplt.array_size = cases[i].layers;
+	tmplt.last_level = util_logbase2(cases[i].size);
+	tmplt.bind = PIPE_BIND_SAMPLER_VIEW | PIPE_BIND_RENDER_TARGET;
+
+	tex = p->screen->resource_create(p->screen, &tmplt);
+	if (!tex)
+		return NULL;
+
+	/* smooth gradients plus some noise, one row at a time */
+	rgba = MALLOC(cases[i].size * 4 * sizeof *rgba);
+	for (layer = 0; layer < cases[i].layers; layer++) {
+		struct pipe_transfer *t;
+		uint8_t *map;
+		unsigned y;
+
+		map = pipe_transfer_map(p->pipe, tex, 0, layer,
+					PIPE_TRANSFER_WRITE, 0, 0,
+					cases[i].size, cases[i].size, &t);
+		for (y = 0; y < cases[i].size; y++) {
+			for (j = 0; j < cases[i].size; j++) {
+				float noise = (float)rand() / RAND_MAX;
+				rgba[j * 4 + 0] = (float)j / cases[i].size;
+				rgba[j * 4 + 1] = (float)y / cases[i].size;
+				rgba[j * 4 + 2] = noise;
+				rgba[j * 4 + 3] = 1.0f - noise * 0.5f;
+			}
+			pipe_put_tile_rgba(t, map, 0, y, cases[i].size, 1, rgba);
+		}
+		p->pipe->transfer_unmap(p->pipe, t);
+	}
+	FREE(rgba);
+
+	return tex;
+}
+
+static int64_t
+time_gen_mipmap(struct program *p, struct pipe_resource *tex,
+		boolean use_hook, float *level1)
+{
+	struct pipe_sampler_view v_tmplt, *view;
+	struct pipe_fence_handle *fence = NULL;
+	struct pipe_transfer *t;
+	unsigned size = tex->width0 / 2;
+	int64_t start, end;
+	unsigned layer;
+	uint8_t *map;
+	boolean (*hook)(struct pipe_context *, struct pipe_resource *,
+			enum pipe_format, unsigned, unsigned,
+			unsigned, unsigned) = p->pipe->generate_mipmap;
+
+	u_sampler_view_default_template(&v_tmplt, tex, tex->format);
+	view = p->pipe->create_sampler_view(p->pipe, tex, &v_tmplt);
+
+	if (!use_hook)
+		p->pipe->generate_mipmap = NULL;
+
+	start = os_time_get();
+	if (tex->target == PIPE_TEXTURE_2D_ARRAY) {
+		/* the hook does all layers at once, the draw path one per call */
+		for (layer = 0; layer < tex->array_size; layer++) {
+			util_gen_mipmap(p->gen_mipmap, view, layer, 0,
+					tex->last_level, PIPE_TEX_FILTER_LINEAR);
+			if (use_hook && hook)
+				break;
+		}
+	}
+	else {
+		util_gen_mipmap(p->gen_mipmap, view, 0, 0, tex->last_level,
+				PIPE_TEX_FILTER_LINEAR);
+	}
+	p->pipe->flush(p->pipe, &fence, 0);
+	p->screen->fence_finish(p->screen, fence, PIPE_TIMEOUT_INFINITE);
+	end = os_time_get();
+
+	p->screen->fence_reference(p->screen, &fence, NULL);
+	p->pipe->generate_mipmap = hook;
+
+	map = pipe_transfer_map(p->pipe, tex, 1, 0, PIPE_TRANSFER_READ,
+				0, 0, size, size, &t);
+	pipe_get_tile_rgba(t, map, 0, 0, size, size, level1);
+	p->pipe->transfer_unmap(p->pipe, t);
+
+	pipe_sampler_view_reference(&view, NULL);
+
+	return end - start;
+}
+
+int main(int argc, char** argv)
+{
+	struct program *p = CALLOC_STRUCT(program);
+	boolean success = TRUE;
+	unsigned i, j;
+
+	init_prog(p);
+
+	if (!p->pipe->generate_mipmap)
+		printf("driver has no generate_mipmap hook\n");
+
+	for (i = 0; i < Elements(cases); i++) {
+		struct pipe_resource *tex = create_texture(p, i);
+		unsigned n = cases[i].size / 2 * cases[i].size / 2 * 4;
+		float *hook_level1, *draw_level1;
+		int64_t hook_time, draw_time;
+		float max_diff = 0.0f;
+
+		if (!tex) {
+			printf("SKIP %s\n", util_format_short_name(cases[i].format));
+			continue;
+		}
+
+		hook_level1 = MALLOC(n * sizeof(float));
+		draw_level1 = MALLOC(n * sizeof(float));
+
+		hook_time = time_gen_mipmap(p, tex, TRUE, hook_level1);
+		draw_time = time_gen_mipmap(p, tex, FALSE, draw_level1);
+
+		/* linear sampling at the texel centers of the next level is a
+		 * 2x2 box filter, so the results may only differ by rounding
+		 */
+		for (j = 0; j < n; j++)
+			max_diff = MAX2(max_diff, fabsf(hook_level1[j] - draw_level1[j]));
+
+		if (max_diff > 2.0f / 255.0f)
+			success = FALSE;
+
+		printf("%s %-20s %5ux%-5u x%-2u hook %8.2f ms, draw %8.2f ms (max diff %f)\n",
+		       max_diff > 2.0f / 255.0f ? "FAIL" : "PASS",
+		       util_format_short_name(cases[i].format),
+		       cases[i].size, cases[i].size, cases[i].layers,
+		       hook_time / 1000.0, draw_time / 1000.0, max_diff);
+
+		FREE(hook_level1);
+		FREE(draw_level1);
+		pipe_resource_reference(&tex, NULL);
+	}
+
+	close_prog(p);
+
+	return success ? 0 : 1;
+}
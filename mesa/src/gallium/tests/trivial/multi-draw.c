@@ -0,0 +1,365 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Time a grid of small triangles drawn with one draw_vbo per triangle,
+ * with a single multi_draw_vbo call and as one big draw, and check that
+ * the first two render the same image.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* pipe_*_state structs */
+#include "pipe/p_state.h"
+/* pipe_context */
+#include "pipe/p_context.h"
+/* pipe_screen */
+#include "pipe/p_screen.h"
+/* PIPE_* */
+#include "pipe/p_defines.h"
+/* TGSI_SEMANTIC_{POSITION|GENERIC} */
+#include "pipe/p_shader_tokens.h"
+/* pipe_buffer_* helpers */
+#include "util/u_inlines.h"
+
+/* constant state object helper */
+#include "cso_cache/cso_context.h"
+
+/* util_draw_init_info */
+#include "util/u_draw.h"
+/* FREE & CALLOC_STRUCT */
+#include "util/u_memory.h"
+/* MIN2 */
+#include "util/u_math.h"
+/* util_make_[fragment|vertex]_passthrough_shader */
+#include "util/u_simple_shaders.h"
+/* os_time_get */
+#include "os/os_time.h"
+/* to get a hardware pipe driver */
+#include "pipe-loader/pipe_loader.h"
+
+#define WIDTH 512
+#define HEIGHT 512
+#define GRID 100
+#define NUM_DRAWS (GRID * GRID)
+
+struct program
+{
+	struct pipe_loader_device *dev;
+	struct pipe_screen *screen;
+	struct pipe_context *pipe;
+	struct cso_context *cso;
+
+	struct pipe_blend_state blend;
+	struct pipe_depth_stencil_alpha_state depthstencil;
+	struct pipe_rasterizer_state rasterizer;
+	struct pipe_viewport_state viewport;
+	struct pipe_framebuffer_state framebuffer;
+	struct pipe_vertex_element velem[2];
+
+	void *vs;
+	void *fs;
+
+	union pipe_color_union clear_color;
+
+	struct pipe_resource *vbuf;
+	struct pipe_resource *target;
+
+	struct pipe_draw_info draws[NUM_DRAWS];
+};
+
+static void init_prog(struct program *p)
+{
+	struct pipe_surface surf_tmpl;
+	float (*vertices)[2][4];
+	unsigned size = NUM_DRAWS * 3 * sizeof(*vertices);
+	unsigned x, y, i, j;
+	int ret;
+
+	/* find a hardware device */
+	ret = pipe_loader_probe(&p->dev, 1);
+	assert(ret);
+
+	/* init a pipe screen */
+	p->screen = pipe_loader_create_screen(p->dev, PIPE_SEARCH_DIR);
+	assert(p->screen);
+
+	/* create the pipe driver context and cso context */
+	p->pipe = p->screen->context_create(p->screen, NULL);
+	p->cso = cso_create_context(p->pipe);
+
+	/* set clear color */
+	p->clear_color.f[0] = 0.3;
+	p->clear_color.f[1] = 0.1;
+	p->clear_color.f[2] = 0.3;
+	p->clear_color.f[3] = 1.0;
+
+	/* one small triangle per grid cell, each its own draw */
+	vertices = MALLOC(size);
+	for (y = 0; y < GRID; y++) {
+		for (x = 0; x < GRID; x++) {
+			float x0 = -1.0f + 2.0f * x / GRID;
+			float y0 = -1.0f + 2.0f * y / GRID;
+			float d = 1.8f / GRID;
+
+			i = (y * GRID + x) * 3;
+			vertices[i + 0][0][0] = x0;
+			vertices[i + 0][0][1] = y0;
+			vertices[i + 1][0][0] = x0 + d;
+			vertices[i + 1][0][1] = y0;
+			vertices[i + 2][0][0] = x0;
+			vertices[i + 2][0][1] = y0 + d;
+			for (j = 0; j < 3; j++) {
+				vertices[i + j][0][2] = 0.0f;
+				vertices[i + j][0][3] = 1.0f;
+				vertices[i + j][1][0] = (float)x / GRID;
+				vertices[i + j][1][1] = (float)y / GRID;
+				vertices[i + j][1][2] = (float)j / 2;
+				vertices[i + j][1][3] = 1.0f;
+			}
+
+			util_draw_init_info(&p->draws[i / 3]);
+			p->draws[i / 3].mode = PIPE_PRIM_TRIANGLES;
+			p->draws[i / 3].start = i;
+			p->draws[i / 3].count = 3;
+			p->draws[i / 3].min_index = i;
+			p->draws[i / 3].max_index = i + 2;
+		}
+	}
+
+	p->vbuf = pipe_buffer_create(p->screen, PIPE_BIND_VERTEX_BUFFER,
+				     PIPE_USAGE_STATIC, size);
+	pipe_buffer_write(p->pipe, p->vbuf, 0, size, vertices);
+	FREE(vertices);
+
+	/* render target texture */
+	{
+		struct pipe_resource tmplt;
+		memset(&tmplt, 0, sizeof(tmplt));
+		tmplt.target = PIPE_TEXTURE_2D;
+		tmplt.format = PIPE_FORMAT_B8G8R8A8_UNORM; /* All drivers support this */
+		tmplt.width0 = WIDTH;
+		tmplt.height0 = HEIGHT;
+		tmplt.depth0 = 1;
+		tmplt.array_size = 1;
+		tmplt.last_level = 0;
+		tmplt.bind = PIPE_BIND_RENDER_TARGET;
+
+		p->target = p->screen->resource_create(p->screen, &tmplt);
+	}
+
+	/* disabled blending/masking */
+	memset(&p->blend, 0, sizeof(p->blend));
+	p->blend.rt[0].colormask = PIPE_MASK_RGBA;
+
+	/* no-op depth/stencil/alpha */
+	memset(&p->depthstencil, 0, sizeof(p->depthstencil));
+
+	/* rasterizer */
+	memset(&p->rasterizer, 0, sizeof(p->rasterizer));
+	p->rasterizer.cull_face = PIPE_FACE_NONE;
+	p->rasterizer.half_pixel_center = 1;
+	p->rasterizer.bottom_edge_rule = 1;
+	p->rasterizer.depth_clip = 1;
+
+	surf_tmpl.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+	surf_tmpl.u.tex.level = 0;
+	surf_tmpl.u.tex.first_layer = 0;
+	surf_tmpl.u.tex.last_layer = 0;
+	/* drawing destination */
+	memset(&p->framebuffer, 0, sizeof(p->framebuffer));
+	p->framebuffer.width = WIDTH;
+	p->framebuffer.height = HEIGHT;
+	p->framebuffer.nr_cbufs = 1;
+	p->framebuffer.cbufs[0] = p->pipe->create_surface(p->pipe, p->target, &surf_tmpl);
+
+	/* viewport, no depth */
+	p->viewport.scale[0] = WIDTH / 2.0f;
+	p->viewport.scale[1] = HEIGHT / 2.0f;
+	p->viewport.scale[2] = 1.0f;
+	p->viewport.scale[3] = 1.0f;
+	p->viewport.translate[0] = WIDTH / 2.0f;
+	p->viewport.translate[1] = HEIGHT / 2.0f;
+	p->viewport.translate[2] = 0.0f;
+	p->viewport.translate[3] = 0.0f;
+
+	/* vertex elements state */
+	memset(p->velem, 0, sizeof(p->velem));
+	p->velem[0].src_offset = 0 * 4 * sizeof(float); /* offset 0, first element */
+	p->velem[0].instance_divisor = 0;
+	p->velem[0].vertex_buffer_index = 0;
+	p->velem[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+	p->velem[1].src_offset = 1 * 4 * sizeof(float); /* offset 16, second element */
+	p->velem[1].instance_divisor = 0;
+	p->velem[1].vertex_buffer_index = 0;
+	p->velem[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+	/* vertex shader */
+	{
+		const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+						TGSI_SEMANTIC_COLOR };
+		const uint semantic_indexes[] = { 0, 0 };
+		p->vs = util_make_vertex_passthrough_shader(p->pipe, 2, semantic_names, semantic_indexes);
+	}
+
+	/* fragment shader */
+	p->fs = util_make_fragment_passthrough_shader(p->pipe,
+		TGSI_SEMANTIC_COLOR, TGSI_INTERPOLATE_PERSPECTIVE, TRUE);
+}
+
+static void close_prog(struct program *p)
+{
+	/* unset all state */
+	cso_release_all(p->cso);
+
+	p->pipe->delete_vs_state(p->pipe, p->vs);
+	p->pipe->delete_fs_state(p->pipe, p->fs);
+
+	pipe_surface_reference(&p->framebuffer.cbufs[0], NULL);
+	pipe_resource_reference(&p->target, NULL);
+	pipe_resource_reference(&p->vbuf, NULL);
+
+	cso_destroy_context(p->cso);
+	p->pipe->destroy(p->pipe);
+	p->screen->destroy(p->screen);
+	pipe_loader_release(&p->dev, 1);
+
+	FREE(p);
+}
+
+static void set_state(struct program *p)
+{
+	struct pipe_vertex_buffer vbuffer;
+
+	cso_set_framebuffer(p->cso, &p->framebuffer);
+	cso_set_blend(p->cso, &p->blend);
+	cso_set_depth_stencil_alpha(p->cso, &p->depthstencil);
+	cso_set_rasterizer(p->cso, &p->rasterizer);
+	cso_set_viewport(p->cso, &p->viewport);
+	cso_set_fragment_shader_handle(p->cso, p->fs);
+	cso_set_vertex_shader_handle(p->cso, p->vs);
+	cso_set_vertex_elements(p->cso, 2, p->velem);
+
+	memset(&vbuffer, 0, sizeof(vbuffer));
+	vbuffer.buffer = p->vbuf;
+	vbuffer.stride = 2 * 4 * sizeof(float);
+	cso_set_vertex_buffers(p->cso, 0, 1, &vbuffer);
+}
+
+enum method {
+	SEPARATE,
+	MULTI,
+	SINGLE
+};
+
+static int64_t
+time_draws(struct program *p, enum method method, uint8_t *image)
+{
+	struct pipe_fence_handle *fence = NULL;
+	struct pipe_transfer *t;
+	struct pipe_draw_info info;
+	int64_t start, end;
+	uint8_t *map;
+	unsigned i;
+
+	p->pipe->clear(p->pipe, PIPE_CLEAR_COLOR, &p->clear_color, 0, 0);
+	p->pipe->flush(p->pipe, &fence, 0);
+	p->screen->fence_finish(p->screen, fence, PIPE_TIMEOUT_INFINITE);
+	p->screen->fence_reference(p->screen, &fence, NULL);
+
+	start = os_time_get();
+	switch (method) {
+	case SEPARATE:
+		for (i = 0; i < NUM_DRAWS; i++)
+			p->pipe->draw_vbo(p->pipe, &p->draws[i]);
+		break;
+	case MULTI:
+		p->pipe->multi_draw_vbo(p->pipe, p->draws, NUM_DRAWS);
+		break;
+	case SINGLE:
+		info = p->draws[0];
+		info.count = NUM_DRAWS * 3;
+		info.max_index = info.count - 1;
+		p->pipe->draw_vbo(p->pipe, &info);
+		break;
+	}
+	p->pipe->flush(p->pipe, &fence, 0);
+	p->screen->fence_finish(p->screen, fence, PIPE_TIMEOUT_INFINITE);
+	end = os_time_get();
+
+	p->screen->fence_reference(p->screen, &fence, NULL);
+
+	map = pipe_transfer_map(p->pipe, p->target, 0, 0, PIPE_TRANSFER_READ,
+				0, 0, WIDTH, HEIGHT, &t);
+	for (i = 0; i < HEIGHT; i++)
+		memcpy(image + i * WIDTH * 4, map + i * t->stride, WIDTH * 4);
+	p->pipe->transfer_unmap(p->pipe, t);
+
+	return end - start;
+}
+
+int main(int argc, char** argv)
+{
+	struct program *p = CALLOC_STRUCT(program);
+	int64_t separate_time, multi_time, single_time;
+	uint8_t *separate_image, *multi_image;
+	boolean success;
+
+	init_prog(p);
+
+	if (!p->pipe->multi_draw_vbo) {
+		printf("SKIP driver has no multi_draw_vbo hook\n");
+		close_prog(p);
+		return 0;
+	}
+
+	set_state(p);
+
+	separate_image = MALLOC(WIDTH * HEIGHT * 4);
+	multi_image = MALLOC(WIDTH * HEIGHT * 4);
+
+	separate_time = time_draws(p, SEPARATE, separate_image);
+	multi_time = time_draws(p, MULTI, multi_image);
+	single_time = time_draws(p, SINGLE, multi_image);
+	multi_time = MIN2(multi_time, time_draws(p, MULTI, multi_image));
+
+	success = memcmp(separate_image, multi_image, WIDTH * HEIGHT * 4) == 0;
+
+	printf("%s %u triangles: separate %8.2f ms, multi %8.2f ms, "
+	       "single draw %8.2f ms\n",
+	       success ? "PASS" : "FAIL", NUM_DRAWS,
+	       separate_time / 1000.0, multi_time / 1000.0,
+	       single_time / 1000.0);
+
+	FREE(separate_image);
+	FREE(multi_image);
+	close_prog(p);
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Compare creating textures from page aligned memory with the screen's
+ * resource_from_user_memory hook against the usual resource_create plus
+ * upload, in time and in memory the driver had to allocate.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+/* pipe_*_state structs */
+#include "pipe/p_state.h"
+/* pipe_context */
+#include "pipe/p_context.h"
+/* pipe_screen */
+#include "pipe/p_screen.h"
+/* PIPE_* */
+#include "pipe/p_defines.h"
+/* pipe_transfer_map helpers */
+#include "util/u_inlines.h"
+/* u_box_2d */
+#include "util/u_box.h"
+/* util_format_get_stride */
+#include "util/u_format.h"
+/* FREE & CALLOC_STRUCT */
+#include "util/u_memory.h"
+/* os_time_get */
+#include "os/os_time.h"
+/* to get a hardware pipe driver */
+#include "pipe-loader/pipe_loader.h"
+
+#define NUM_TEXTURES 16
+#define SIZE 2048
+
+struct program
+{
+	struct pipe_loader_device *dev;
+	struct pipe_screen *screen;
+	struct pipe_context *pipe;
+};
+
+static void init_prog(struct program *p)
+{
+	int ret;
+
+	/* find a hardware device */
+	ret = pipe_loader_probe(&p->dev, 1);
+	assert(ret);
+
+	/* init a pipe screen */
+	p->screen = pipe_loader_create_screen(p->dev, PIPE_SEARCH_DIR);
+	assert(p->screen);
+
+	/* create the pipe driver context */
+	p->pipe = p->screen->context_create(p->screen, NULL);
+}
+
+static void close_prog(struct program *p)
+{
+	p->pipe->destroy(p->pipe);
+	p->screen->destroy(p->screen);
+	pipe_loader_release(&p->dev, 1);
+
+	FREE(p);
+}
+
+static long max_rss_kb(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+static void init_template(struct pipe_resource *tmplt)
+{
+	memset(tmplt, 0, sizeof(*tmplt));
+	tmplt->target = PIPE_TEXTURE_2D;
+	tmplt->format = PIPE_FORMAT_B8G8R8A8_UNORM;
+	tmplt->width0 = SIZE;
+	tmplt->height0 = SIZE;
+	tmplt->depth0 = 1;
+	tmplt->array_size = 1;
+	tmplt->last_level = 0;
+	tmplt->bind = PIPE_BIND_SAMPLER_VIEW;
+}
+
+static boolean check_texture(struct program *p, struct pipe_resource *tex,
+			     const uint8_t *data, unsigned stride)
+{
+	struct pipe_transfer *t;
+	boolean ok = TRUE;
+	uint8_t *map;
+	unsigned y;
+
+	map = pipe_transfer_map(p->pipe, tex, 0, 0, PIPE_TRANSFER_READ,
+				0, 0, SIZE, SIZE, &t);
+	for (y = 0; y < SIZE && ok; y++)
+		ok = memcmp(map + y * t->stride, data + y * stride, stride) == 0;
+	p->pipe->transfer_unmap(p->pipe, t);
+
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	struct program *p = CALLOC_STRUCT(program);
+	struct pipe_resource *copy[NUM_TEXTURES], *wrap[NUM_TEXTURES];
+	struct pipe_resource tmplt;
+	unsigned stride = util_format_get_stride(PIPE_FORMAT_B8G8R8A8_UNORM,
+						 SIZE);
+	size_t size = (size_t)stride * SIZE * NUM_TEXTURES;
+	int64_t start, copy_time, wrap_time;
+	long rss_before, copy_rss, wrap_rss;
+	boolean success = TRUE;
+	uint8_t *images;
+	size_t j;
+	unsigned i;
+
+	init_prog(p);
+
+	if (!p->screen->resource_from_user_memory) {
+		printf("SKIP driver has no resource_from_user_memory hook\n");
+		close_prog(p);
+		return 0;
+	}
+
+	/* stands in for image files mapped by the application */
+	images = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	assert(images != MAP_FAILED);
+	for (j = 0; j < size; j++)
+		images[j] = (uint8_t)(j * 7 + j / stride);
+
+	init_template(&tmplt);
+
+	rss_before = max_rss_kb();
+	start = os_time_get();
+	for (i = 0; i < NUM_TEXTURES; i++)
+		wrap[i] = p->screen->resource_from_user_memory(
+			p->screen, &tmplt, images + (size_t)i * stride * SIZE,
+			stride);
+	wrap_time = os_time_get() - start;
+	wrap_rss = max_rss_kb() - rss_before;
+
+	rss_before = max_rss_kb();
+	start = os_time_get();
+	for (i = 0; i < NUM_TEXTURES; i++) {
+		struct pipe_box box;
+
+		copy[i] = p->screen->resource_create(p->screen, &tmplt);
+		u_box_2d(0, 0, SIZE, SIZE, &box);
+		p->pipe->transfer_inline_write(p->pipe, copy[i], 0,
+					       PIPE_TRANSFER_WRITE, &box,
+					       images + (size_t)i * stride * SIZE,
+					       stride, 0);
+	}
+	copy_time = os_time_get() - start;
+	copy_rss = max_rss_kb() - rss_before;
+
+	for (i = 0; i < NUM_TEXTURES; i++) {
+		const uint8_t *data = images + (size_t)i * stride * SIZE;
+
+		if (!wrap[i] || !check_texture(p, wrap[i], data, stride) ||
+		    !check_texture(p, copy[i], data, stride))
+			success = FALSE;
+
+		pipe_resource_reference(&wrap[i], NULL);
+		pipe_resource_reference(&copy[i], NULL);
+	}
+
+	printf("%s %u x %ux%u B8G8R8A8: copy %8.2f ms +%6ld KB, "
+	       "user memory %8.2f ms +%6ld KB\n",
+	       success ? "PASS" : "FAIL", NUM_TEXTURES, SIZE, SIZE,
+	       copy_time / 1000.0, copy_rss,
+	       wrap_time / 1000.0, wrap_rss);
+
+	munmap(images, size);
+	close_prog(p);
+
+	return success ? 0 : 1;
+}
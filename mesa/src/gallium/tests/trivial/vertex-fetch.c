@@ -0,0 +1,344 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Time the vertex fetch of a pass through vertex shader with four
+ * attributes of various formats, both interleaved in one buffer and in
+ * separate buffers.  Rasterization is discarded so that the time per
+ * vertex is mostly spent fetching and shading.  Run it again with
+ * DRAW_NO_SOA_FETCH=1 to compare with the draw module's generic fetch.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* pipe_*_state structs */
+#include "pipe/p_state.h"
+/* pipe_context */
+#include "pipe/p_context.h"
+/* pipe_screen */
+#include "pipe/p_screen.h"
+/* PIPE_* */
+#include "pipe/p_defines.h"
+/* TGSI_SEMANTIC_{POSITION|GENERIC} */
+#include "pipe/p_shader_tokens.h"
+/* pipe_buffer_* helpers */
+#include "util/u_inlines.h"
+
+/* constant state object helper */
+#include "cso_cache/cso_context.h"
+
+/* util_draw_init_info */
+#include "util/u_draw.h"
+/* util_format_write_4f & util_format_name */
+#include "util/u_format.h"
+/* FREE & CALLOC_STRUCT */
+#include "util/u_memory.h"
+/* MIN2 */
+#include "util/u_math.h"
+/* util_make_[fragment|vertex]_passthrough_shader */
+#include "util/u_simple_shaders.h"
+/* os_time_get */
+#include "os/os_time.h"
+/* to get a hardware pipe driver */
+#include "pipe-loader/pipe_loader.h"
+
+#define WIDTH 64
+#define HEIGHT 64
+#define NUM_ATTRIBS 4
+#define NUM_VERTICES (256 * 1024)
+
+static const enum pipe_format formats[] = {
+	PIPE_FORMAT_R32G32B32A32_FLOAT,
+	PIPE_FORMAT_R32G32B32_FLOAT,
+	PIPE_FORMAT_R32G32_FLOAT,
+	PIPE_FORMAT_R16G16B16A16_FLOAT,
+	PIPE_FORMAT_R8G8B8A8_UNORM,
+	PIPE_FORMAT_R16G16B16A16_SNORM,
+	PIPE_FORMAT_R16G16_UNORM,
+};
+
+struct program
+{
+	struct pipe_loader_device *dev;
+	struct pipe_screen *screen;
+	struct pipe_context *pipe;
+	struct cso_context *cso;
+
+	struct pipe_blend_state blend;
+	struct pipe_depth_stencil_alpha_state depthstencil;
+	struct pipe_rasterizer_state rasterizer;
+	struct pipe_viewport_state viewport;
+	struct pipe_framebuffer_state framebuffer;
+
+	void *vs;
+	void *fs;
+
+	struct pipe_resource *target;
+};
+
+static void init_prog(struct program *p)
+{
+	struct pipe_surface surf_tmpl;
+	int ret;
+
+	/* find a hardware device */
+	ret = pipe_loader_probe(&p->dev, 1);
+	assert(ret);
+
+	/* init a pipe screen */
+	p->screen = pipe_loader_create_screen(p->dev, PIPE_SEARCH_DIR);
+	assert(p->screen);
+
+	/* create the pipe driver context and cso context */
+	p->pipe = p->screen->context_create(p->screen, NULL);
+	p->cso = cso_create_context(p->pipe);
+
+	/* render target texture */
+	{
+		struct pipe_resource tmplt;
+		memset(&tmplt, 0, sizeof(tmplt));
+		tmplt.target = PIPE_TEXTURE_2D;
+		tmplt.format = PIPE_FORMAT_B8G8R8A8_UNORM; /* All drivers support this */
+		tmplt.width0 = WIDTH;
+		tmplt.height0 = HEIGHT;
+		tmplt.depth0 = 1;
+		tmplt.array_size = 1;
+		tmplt.last_level = 0;
+		tmplt.bind = PIPE_BIND_RENDER_TARGET;
+
+		p->target = p->screen->resource_create(p->screen, &tmplt);
+	}
+
+	/* disabled blending/masking */
+	memset(&p->blend, 0, sizeof(p->blend));
+	p->blend.rt[0].colormask = PIPE_MASK_RGBA;
+
+	/* no-op depth/stencil/alpha */
+	memset(&p->depthstencil, 0, sizeof(p->depthstencil));
+
+	/* rasterizer, throw away everything after the vertex shader */
+	memset(&p->rasterizer, 0, sizeof(p->rasterizer));
+	p->rasterizer.cull_face = PIPE_FACE_NONE;
+	p->rasterizer.half_pixel_center = 1;
+	p->rasterizer.bottom_edge_rule = 1;
+	p->rasterizer.depth_clip = 1;
+	p->rasterizer.rasterizer_discard = 1;
+
+	surf_tmpl.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+	surf_tmpl.u.tex.level = 0;
+	surf_tmpl.u.tex.first_layer = 0;
+	surf_tmpl.u.tex.last_layer = 0;
+	/* drawing destination */
+	memset(&p->framebuffer, 0, sizeof(p->framebuffer));
+	p->framebuffer.width = WIDTH;
+	p->framebuffer.height = HEIGHT;
+	p->framebuffer.nr_cbufs = 1;
+	p->framebuffer.cbufs[0] = p->pipe->create_surface(p->pipe, p->target, &surf_tmpl);
+
+	/* viewport, no depth */
+	p->viewport.scale[0] = WIDTH / 2.0f;
+	p->viewport.scale[1] = HEIGHT / 2.0f;
+	p->viewport.scale[2] = 1.0f;
+	p->viewport.scale[3] = 1.0f;
+	p->viewport.translate[0] = WIDTH / 2.0f;
+	p->viewport.translate[1] = HEIGHT / 2.0f;
+	p->viewport.translate[2] = 0.0f;
+	p->viewport.translate[3] = 0.0f;
+
+	/* vertex shader */
+	{
+		const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+						TGSI_SEMANTIC_GENERIC,
+						TGSI_SEMANTIC_GENERIC,
+						TGSI_SEMANTIC_GENERIC };
+		const uint semantic_indexes[] = { 0, 0, 1, 2 };
+		p->vs = util_make_vertex_passthrough_shader(p->pipe, NUM_ATTRIBS, semantic_names, semantic_indexes);
+	}
+
+	/* fragment shader */
+	p->fs = util_make_fragment_passthrough_shader(p->pipe,
+		TGSI_SEMANTIC_GENERIC, TGSI_INTERPOLATE_PERSPECTIVE, TRUE);
+}
+
+static void close_prog(struct program *p)
+{
+	/* unset all state */
+	cso_release_all(p->cso);
+
+	p->pipe->delete_vs_state(p->pipe, p->vs);
+	p->pipe->delete_fs_state(p->pipe, p->fs);
+
+	pipe_surface_reference(&p->framebuffer.cbufs[0], NULL);
+	pipe_resource_reference(&p->target, NULL);
+
+	cso_destroy_context(p->cso);
+	p->pipe->destroy(p->pipe);
+	p->screen->destroy(p->screen);
+	pipe_loader_release(&p->dev, 1);
+
+	FREE(p);
+}
+
+static void set_state(struct program *p)
+{
+	cso_set_framebuffer(p->cso, &p->framebuffer);
+	cso_set_blend(p->cso, &p->blend);
+	cso_set_depth_stencil_alpha(p->cso, &p->depthstencil);
+	cso_set_rasterizer(p->cso, &p->rasterizer);
+	cso_set_viewport(p->cso, &p->viewport);
+	cso_set_fragment_shader_handle(p->cso, p->fs);
+	cso_set_vertex_shader_handle(p->cso, p->vs);
+}
+
+/*
+ * Bind NUM_ATTRIBS attributes of the given format stored in vbuf, either
+ * interleaved or one after the other.
+ */
+static void set_vertex_state(struct program *p, struct pipe_resource *vbuf,
+			     enum pipe_format format, boolean interleaved)
+{
+	struct pipe_vertex_element velem[NUM_ATTRIBS];
+	struct pipe_vertex_buffer vbuffer[NUM_ATTRIBS];
+	unsigned blocksize = util_format_get_blocksize(format);
+	unsigned i;
+
+	memset(velem, 0, sizeof(velem));
+	memset(vbuffer, 0, sizeof(vbuffer));
+
+	for (i = 0; i < NUM_ATTRIBS; i++) {
+		velem[i].src_format = format;
+		if (interleaved) {
+			velem[i].src_offset = i * blocksize;
+			velem[i].vertex_buffer_index = 0;
+		} else {
+			velem[i].vertex_buffer_index = i;
+			vbuffer[i].buffer = vbuf;
+			vbuffer[i].buffer_offset = i * NUM_VERTICES * blocksize;
+			vbuffer[i].stride = blocksize;
+		}
+	}
+
+	if (interleaved) {
+		vbuffer[0].buffer = vbuf;
+		vbuffer[0].stride = NUM_ATTRIBS * blocksize;
+	}
+
+	cso_set_vertex_elements(p->cso, NUM_ATTRIBS, velem);
+	cso_set_vertex_buffers(p->cso, 0, interleaved ? 1 : NUM_ATTRIBS,
+			       vbuffer);
+}
+
+static int64_t time_draw(struct program *p)
+{
+	struct pipe_fence_handle *fence = NULL;
+	struct pipe_draw_info info;
+	int64_t start, end;
+
+	util_draw_init_info(&info);
+	info.mode = PIPE_PRIM_POINTS;
+	info.count = NUM_VERTICES;
+	info.max_index = NUM_VERTICES - 1;
+
+	start = os_time_get();
+	p->pipe->draw_vbo(p->pipe, &info);
+	p->pipe->flush(p->pipe, &fence, 0);
+	p->screen->fence_finish(p->screen, fence, PIPE_TIMEOUT_INFINITE);
+	end = os_time_get();
+
+	p->screen->fence_reference(p->screen, &fence, NULL);
+
+	return end - start;
+}
+
+int main(int argc, char** argv)
+{
+	struct program *p = CALLOC_STRUCT(program);
+	float (*values)[4];
+	unsigned f, i;
+
+	init_prog(p);
+	set_state(p);
+
+	/* small positive values, representable in all the formats */
+	values = MALLOC(NUM_ATTRIBS * NUM_VERTICES * sizeof(*values));
+	for (i = 0; i < NUM_ATTRIBS * NUM_VERTICES; i++) {
+		values[i][0] = (float)(i % 256) / 256;
+		values[i][1] = (float)(i % 16) / 16;
+		values[i][2] = 0.5f;
+		values[i][3] = 1.0f;
+	}
+
+	for (f = 0; f < Elements(formats); f++) {
+		enum pipe_format format = formats[f];
+		unsigned size = NUM_ATTRIBS * NUM_VERTICES *
+				util_format_get_blocksize(format);
+		struct pipe_resource *vbuf;
+		struct pipe_transfer *t;
+		int64_t interleaved_time, separate_time;
+		uint8_t *map;
+
+		if (!p->screen->is_format_supported(p->screen, format,
+						    PIPE_BUFFER, 0,
+						    PIPE_BIND_VERTEX_BUFFER)) {
+			printf("SKIP %s\n", util_format_name(format));
+			continue;
+		}
+
+		vbuf = pipe_buffer_create(p->screen, PIPE_BIND_VERTEX_BUFFER,
+					  PIPE_USAGE_STATIC, size);
+		map = pipe_buffer_map(p->pipe, vbuf, PIPE_TRANSFER_WRITE, &t);
+		util_format_write_4f(format, &values[0][0], 0, map, 0,
+				     0, 0, NUM_ATTRIBS * NUM_VERTICES, 1);
+		pipe_buffer_unmap(p->pipe, t);
+
+		/* the first draw of each layout compiles the shaders */
+		set_vertex_state(p, vbuf, format, TRUE);
+		time_draw(p);
+		interleaved_time = time_draw(p);
+		interleaved_time = MIN2(interleaved_time, time_draw(p));
+
+		set_vertex_state(p, vbuf, format, FALSE);
+		time_draw(p);
+		separate_time = time_draw(p);
+		separate_time = MIN2(separate_time, time_draw(p));
+
+		printf("PASS %-20s interleaved %6.2f ns/vertex, "
+		       "separate %6.2f ns/vertex\n",
+		       util_format_name(format) + strlen("PIPE_FORMAT_"),
+		       interleaved_time * 1000.0 / NUM_VERTICES,
+		       separate_time * 1000.0 / NUM_VERTICES);
+
+		cso_set_vertex_buffers(p->cso, 0, NUM_ATTRIBS, NULL);
+		pipe_resource_reference(&vbuf, NULL);
+	}
+
+	FREE(values);
+	close_prog(p);
+
+	return 0;
+}
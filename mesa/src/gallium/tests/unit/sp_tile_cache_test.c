@@ -0,0 +1,100 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <float.h>
+
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "softpipe/sp_tile_cache.h"
+
+int
+main(int argc, char **argv)
+{
+#if defined(PIPE_ARCH_SSE)
+   static const uint32_t values[] = {
+      0x00000000, /* 0.0 */
+      0x80000000, /* -0.0 */
+      0x3f800000, /* 1.0 */
+      0x3f000000, /* 0.5 */
+      0x3f7fffff, /* largest float below 1.0 */
+      0x3b808081, /* 1/255 */
+      0x00000001, /* smallest denormal */
+      0xbf800000, /* -1.0 */
+      0x40000000, /* 2.0 */
+      0x7f800000, /* +inf */
+      0xff800000, /* -inf */
+      0x7fc00000, /* NaN */
+      0xffc00000, /* NaN with the sign bit set, as 0.0/0.0 gives on x86 */
+      0x7f800001, /* signaling NaN */
+   };
+   const unsigned n = Elements(values);
+   float src[Elements(values) * 4];
+   uint8_t dst[Elements(values) * 4];
+   unsigned fails = 0;
+   unsigned swap_rb, i;
+
+   for (i = 0; i < n * 4; i++) {
+      union fi f;
+      f.ui = values[(i / 4 + i) % n];
+      src[i] = f.f;
+   }
+
+   /* n is not a multiple of four, which covers the partial last group */
+   for (swap_rb = 0; swap_rb < 2; swap_rb++) {
+      sp_pack_unorm8_sse2(dst, sizeof dst, src, sizeof src, n, 1, swap_rb);
+
+      for (i = 0; i < n * 4; i++) {
+         unsigned c = i % 4;
+         unsigned src_c = swap_rb && c != 3 ? 2 - c : c;
+         union fi f;
+         ubyte expected;
+
+         f.f = src[i - c + src_c];
+         expected = float_to_ubyte(f.f);
+
+         if (dst[i] != expected) {
+            printf("Pack failed: %08x -> %u, expected %u%s\n",
+                   f.ui, dst[i], expected, swap_rb ? " (swap_rb)" : "");
+            ++fails;
+         }
+      }
+   }
+
+   if (fails)
+      printf("Failure! %u conversions differ from float_to_ubyte().\n", fails);
+   else
+      printf("Success!\n");
+
+   return fails ? 1 : 0;
+#else
+   printf("Skipped, SSE2 only.\n");
+   return 0;
+#endif
+}
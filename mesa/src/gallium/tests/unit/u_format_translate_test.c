@@ -0,0 +1,174 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Check util_format_translate() against a plain unpack/pack round trip,
+ * and print the throughput of both for common format pairs.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_format.h"
+#include "os/os_time.h"
+
+
+#define WIDTH 256
+#define HEIGHT 256
+#define ITERATIONS 64
+
+
+static const struct {
+   enum pipe_format src;
+   enum pipe_format dst;
+} pairs[] = {
+   { PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_R8G8B8A8_UNORM },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, PIPE_FORMAT_R8G8B8A8_UNORM },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_B8G8R8X8_UNORM },
+   { PIPE_FORMAT_A8R8G8B8_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM },
+   { PIPE_FORMAT_B10G10R10A2_UNORM, PIPE_FORMAT_R10G10B10A2_UNORM },
+   { PIPE_FORMAT_R10G10B10A2_UNORM, PIPE_FORMAT_B10G10R10A2_UNORM },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_R16G16B16A16_FLOAT },
+   { PIPE_FORMAT_R16G16B16A16_FLOAT, PIPE_FORMAT_R8G8B8A8_UNORM },
+   { PIPE_FORMAT_R16G16B16A16_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+   { PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_FORMAT_R16G16B16A16_FLOAT },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_R32G32B32A32_FLOAT },
+};
+
+
+/**
+ * What util_format_translate() did for all color formats before it learnt
+ * any shortcuts: unpack to 8 bit unorm or float, and pack again.
+ */
+static void
+reference_translate(const struct util_format_description *dst_desc,
+                    uint8_t *dst, unsigned dst_stride,
+                    const struct util_format_description *src_desc,
+                    const uint8_t *src, unsigned src_stride,
+                    unsigned width, unsigned height)
+{
+   if (util_format_fits_8unorm(src_desc) ||
+       util_format_fits_8unorm(dst_desc)) {
+      uint8_t *tmp = MALLOC(width * height * 4);
+      src_desc->unpack_rgba_8unorm(tmp, width * 4, src, src_stride,
+                                   width, height);
+      dst_desc->pack_rgba_8unorm(dst, dst_stride, tmp, width * 4,
+                                 width, height);
+      FREE(tmp);
+   }
+   else {
+      float *tmp = MALLOC(width * height * 4 * sizeof *tmp);
+      src_desc->unpack_rgba_float(tmp, width * 4 * sizeof *tmp, src,
+                                  src_stride, width, height);
+      dst_desc->pack_rgba_float(dst, dst_stride, tmp,
+                                width * 4 * sizeof *tmp, width, height);
+      FREE(tmp);
+   }
+}
+
+
+static boolean
+test_pair(enum pipe_format src_format, enum pipe_format dst_format)
+{
+   const struct util_format_description *src_desc =
+      util_format_description(src_format);
+   const struct util_format_description *dst_desc =
+      util_format_description(dst_format);
+   unsigned src_stride = WIDTH * util_format_get_blocksize(src_format);
+   unsigned dst_stride = WIDTH * util_format_get_blocksize(dst_format);
+   uint8_t *src = MALLOC(src_stride * HEIGHT);
+   uint8_t *dst = MALLOC(dst_stride * HEIGHT);
+   uint8_t *ref = MALLOC(dst_stride * HEIGHT);
+   float *rgba = MALLOC(WIDTH * HEIGHT * 4 * sizeof *rgba);
+   int64_t start, fast_time, ref_time;
+   double megapixels;
+   boolean success;
+   unsigned i;
+
+   /* Plausible color values rather than random bits, which would make
+    * float formats hit denormal and NaN slow paths.
+    */
+   for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+      rgba[i] = (float) rand() / RAND_MAX;
+   src_desc->pack_rgba_float(src, src_stride, rgba, WIDTH * 4 * sizeof *rgba,
+                             WIDTH, HEIGHT);
+
+   /* Odd widths exercise the tails of vectorized loops */
+   reference_translate(dst_desc, ref, dst_stride, src_desc, src, src_stride,
+                       WIDTH - 3, HEIGHT);
+   memcpy(dst, ref, dst_stride * HEIGHT);
+   util_format_translate(dst_format, dst, dst_stride, 0, 0,
+                         src_format, src, src_stride, 0, 0,
+                         WIDTH - 3, HEIGHT);
+   success = memcmp(dst, ref, dst_stride * HEIGHT) == 0;
+
+   start = os_time_get();
+   for (i = 0; i < ITERATIONS; i++)
+      util_format_translate(dst_format, dst, dst_stride, 0, 0,
+                            src_format, src, src_stride, 0, 0,
+                            WIDTH, HEIGHT);
+   fast_time = os_time_get() - start;
+
+   start = os_time_get();
+   for (i = 0; i < ITERATIONS; i++)
+      reference_translate(dst_desc, ref, dst_stride, src_desc, src,
+                          src_stride, WIDTH, HEIGHT);
+   ref_time = os_time_get() - start;
+
+   megapixels = (double) WIDTH * HEIGHT * ITERATIONS / 1e6;
+   printf("%s %-22s -> %-22s %8.1f Mpix/s (unpack/pack %8.1f Mpix/s)\n",
+          success ? "PASS" : "FAIL",
+          src_desc->short_name, dst_desc->short_name,
+          megapixels / (MAX2(fast_time, 1) / 1e6),
+          megapixels / (MAX2(ref_time, 1) / 1e6));
+
+   FREE(src);
+   FREE(dst);
+   FREE(ref);
+   FREE(rgba);
+
+   return success;
+}
+
+
+int main(int argc, char **argv)
+{
+   boolean success = TRUE;
+   unsigned i;
+
+   for (i = 0; i < Elements(pairs); i++)
+      success = test_pair(pairs[i].src, pairs[i].dst) && success;
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,448 @@
+#!/usr/bin/env python
+
+# Copyright (C) 2013 VMware, Inc.
+# All Rights Reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+# This script generates the file marshal_generated.c, which contains the
+# "marshal" dispatch table used by the application thread when threaded
+# GL dispatch is enabled (see main/glthread.h), and the code run by the
+# driver thread to execute the queued commands.
+#
+# Every GL function is either queued ("async") or executed synchronously
+# on the application thread once the driver thread is idle ("sync").  A
+# function is queued when it returns nothing, writes no client memory and
+# every pointer it takes refers to an amount of memory that can be
+# computed from its other parameters, so that the data can be copied into
+# the command.  Vertex array pointers and draw calls are queued as long
+# as they don't refer to client memory, see is_vertex_pointer() below.
+
+import license
+import gl_XML
+import re
+import sys, getopt
+
+
+header = """
+#include <string.h>
+
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/dispatch.h"
+#include "main/glthread.h"
+#include "main/marshal.h"
+"""
+
+
+# Functions that are always executed synchronously, although their
+# parameters would allow queueing them.
+sync_functions = [
+    # The application expects rendering to be complete on return.
+    'Finish',
+]
+
+# Functions after which the current batch is handed to the driver thread
+# right away.
+flush_functions = [
+    'Flush',
+]
+
+# Functions that update the client-side state tracked by the application
+# thread.  The hook is called on the application thread, with the same
+# parameters (ctx first), before the command is queued.
+hook_functions = {
+    'BindBuffer': '_mesa_glthread_BindBuffer',
+    'BindVertexArray': '_mesa_glthread_BindVertexArray',
+    'BindVertexArrayAPPLE': '_mesa_glthread_BindVertexArray',
+    'DeleteBuffers': '_mesa_glthread_DeleteBuffers',
+    'DeleteVertexArrays': '_mesa_glthread_DeleteVertexArrays',
+    'PushClientAttrib': '_mesa_glthread_PushClientAttrib',
+    'PopClientAttrib': '_mesa_glthread_PopClientAttrib',
+}
+
+
+def hook_call(func):
+    """The call to the client-state hook of func, if any."""
+    hook = hook_functions.get(func.name)
+    if not hook:
+        return None
+    args = ['ctx']
+    if func.get_called_parameter_string():
+        args.append(func.get_called_parameter_string())
+    return '%s(%s);' % (hook, ', '.join(args))
+
+
+def is_vertex_pointer(func):
+    """Whether func specifies a vertex array, whose pointer is an offset
+    into the bound GL_ARRAY_BUFFER if any."""
+    if func.name != 'InterleavedArrays' and \
+       not re.search('Pointer(EXT|NV|OES)?$', func.name):
+        return False
+    pointers = [p for p in func.parameterIterator() if p.is_pointer()]
+    return len(pointers) == 1 and pointers[0].name == 'pointer'
+
+
+def is_array_draw(func):
+    """Whether func sources vertices from the enabled vertex arrays."""
+    return re.search('DrawArrays|DrawTransformFeedback|ArrayElement',
+                     func.name) != None
+
+
+def is_elements_draw(func):
+    """Whether func additionally sources indices from the bound element
+    array buffer, or client memory if none is bound."""
+    if not re.match('Draw(Range)?Elements', func.name):
+        return False
+    pointers = [p for p in func.parameterIterator() if p.is_pointer()]
+    return len(pointers) == 1 and pointers[0].name == 'indices'
+
+
+class marshal_param(object):
+    """How a parameter of a queued function is stored in the command."""
+
+    def __init__(self, func, p):
+        self.p = p
+        self.name = p.name
+        self.by_value = not p.is_pointer()
+        self.fixed_size = False
+        self.variable_size = False
+        self.counter = None
+
+        if p.is_pointer() and (is_vertex_pointer(func) or
+                               is_elements_draw(func)):
+            # Pointer value, not dereferenced by the application thread.
+            self.by_value = True
+        elif p.is_pointer() and p.count:
+            self.fixed_size = True
+        elif p.is_pointer():
+            self.variable_size = True
+            self.counter = p.counter
+
+    def field(self):
+        if self.by_value:
+            return '%s %s;' % (self.p.type_string(), self.name)
+        elif self.fixed_size:
+            return '%s %s[%d];' % (self.element_type(), self.name,
+                                   self.p.size() / self.element_size())
+        else:
+            return 'GLboolean %s_null;' % (self.name)
+
+    def element_type(self):
+        base = self.p.get_base_type_string()
+        if base == 'GLvoid':
+            return 'GLubyte'
+        return base
+
+    def element_size(self):
+        if self.p.get_base_type_string() == 'GLvoid':
+            return 1
+        return self.p.size() / (self.p.count * self.p.count_scale)
+
+
+def can_marshal(func):
+    """Whether calls to func can be queued, if only conditionally."""
+    if func.return_type != 'void':
+        return False
+    if func.name in sync_functions:
+        return False
+    # Pixel data may come from a pixel buffer object.
+    if re.match('(Compressed|PixelMap)', func.name):
+        return False
+
+    scalars = [p.name for p in func.parameterIterator()
+               if not p.is_pointer()]
+    for p in func.parameterIterator():
+        if p.is_padding or p.is_output:
+            return False
+        if not p.is_pointer():
+            continue
+        if is_vertex_pointer(func) or is_elements_draw(func):
+            continue
+        if not p.type_string().startswith('const ') or \
+           p.type_string().count('*') != 1:
+            return False
+        if p.is_image() or p.count_parameter_list:
+            return False
+        if not p.count and p.counter not in scalars:
+            return False
+
+    if is_array_draw(func):
+        return len([p for p in func.parameterIterator()
+                    if p.is_pointer()]) == 0
+    if re.search('Draw(Range)?Elements', func.name):
+        return is_elements_draw(func)
+
+    return True
+
+
+class PrintCode(gl_XML.gl_print_base):
+
+    def __init__(self):
+        gl_XML.gl_print_base.__init__(self)
+
+        self.name = 'gl_marshal.py'
+        self.license = license.bsd_license_template % (
+            'Copyright (C) 2013 VMware, Inc.', 'VMware')
+
+    def printRealHeader(self):
+        print header
+
+    def printRealFooter(self):
+        pass
+
+    def print_sync_call(self, func, indent):
+        call = 'CALL_%s(ctx->CurrentDispatch, (%s))' % (
+            func.name, func.get_called_parameter_string())
+        print '%s_mesa_glthread_finish(ctx);' % (indent)
+        if func.return_type == 'void':
+            print '%s%s;' % (indent, call)
+            print '%s_mesa_glthread_restore_dispatch(ctx);' % (indent)
+        else:
+            print '%sretval = %s;' % (indent, call)
+            print '%s_mesa_glthread_restore_dispatch(ctx);' % (indent)
+            print '%sreturn retval;' % (indent)
+
+    def print_sync_function(self, func):
+        print 'static %s GLAPIENTRY' % (func.return_type)
+        print '_mesa_marshal_%s(%s)' % (
+            func.name, func.get_parameter_string())
+        print '{'
+        print '   GET_CURRENT_CONTEXT(ctx);'
+        if func.return_type != 'void':
+            print '   %s retval;' % (func.return_type)
+        hook = hook_call(func)
+        if hook:
+            print '   %s' % (hook)
+        self.print_sync_call(func, '   ')
+        print '}'
+        print ''
+
+    def print_async_function(self, func):
+        params = [marshal_param(func, p) for p in func.parameterIterator()]
+        variable = [m for m in params if m.variable_size]
+
+        # Command structure
+        print 'struct marshal_cmd_%s' % (func.name)
+        print '{'
+        print '   struct marshal_cmd_base cmd_base;'
+        for m in params:
+            print '   %s' % (m.field())
+        for m in variable:
+            print '   /* Next %s bytes are %s %s[%s] */' % (
+                m.p.size_string(), m.p.get_base_type_string(),
+                m.name, m.counter)
+        print '};'
+        print ''
+
+        # Driver thread side
+        print 'static inline void'
+        print '_mesa_unmarshal_%s(struct gl_context *ctx,' % (func.name)
+        print '%sconst struct marshal_cmd_%s *cmd)' % (
+            ' ' * len('_mesa_unmarshal_%s(' % (func.name)), func.name)
+        print '{'
+        if variable:
+            print '   const GLubyte *variable_data = ' \
+                  '(const GLubyte *) cmd + marshal_cmd_header_size(*cmd);'
+        for m in variable:
+            print '   const %s *%s = NULL;' % (
+                m.p.get_base_type_string(), m.name)
+        for m in variable:
+            print '   if (!cmd->%s_null) {' % (m.name)
+            print '      %s = (const %s *) variable_data;' % (
+                m.name, m.p.get_base_type_string())
+            print '      variable_data += marshal_size(cmd->%s, %d);' % (
+                m.counter, m.p.size())
+            print '   }'
+        args = []
+        for m in params:
+            if m.variable_size:
+                args.append(m.name)
+            else:
+                args.append('cmd->%s' % (m.name))
+        print '   CALL_%s(ctx->CurrentDispatch, (%s));' % (
+            func.name, ', '.join(args))
+        print '}'
+        print ''
+
+        # Application thread side
+        print 'static void GLAPIENTRY'
+        print '_mesa_marshal_%s(%s)' % (
+            func.name, func.get_parameter_string())
+        print '{'
+        print '   GET_CURRENT_CONTEXT(ctx);'
+        print '   struct glthread_state *glthread = ctx->GLThread;'
+        size = ['marshal_cmd_header_size(struct marshal_cmd_%s)' % (
+            func.name)]
+        for m in variable:
+            print '   const size_t %s_size = %s ? marshal_size(%s, %d) : 0;' % (
+                m.name, m.name, m.counter, m.p.size())
+            size.append('%s_size' % (m.name))
+        print '   const size_t cmd_size = %s;' % (' + '.join(size))
+        if params:
+            print '   struct marshal_cmd_%s *cmd;' % (func.name)
+        if variable:
+            print '   GLubyte *variable_data;'
+        print ''
+
+        hook = hook_call(func)
+        if hook:
+            print '   %s' % (hook)
+            print ''
+
+        condition = []
+        if variable:
+            condition.append('cmd_size <= MARSHAL_MAX_CMD_SIZE')
+        if is_vertex_pointer(func):
+            condition.append('_mesa_glthread_is_vbo_pointer(ctx)')
+        elif is_elements_draw(func):
+            condition.append('_mesa_glthread_has_vbo_indices(ctx)')
+        elif is_array_draw(func):
+            condition.append('!glthread->has_user_pointers')
+
+        indent = '   '
+        if condition:
+            print '   if (%s) {' % (' &&\n       '.join(condition))
+            indent = '      '
+        assign = ''
+        if params:
+            assign = 'cmd = '
+        align = ' ' * len(assign + '_mesa_glthread_allocate_command(')
+        print '%s%s_mesa_glthread_allocate_command(ctx, glthread,' % (
+            indent, assign)
+        print '%s%sDISPATCH_CMD_%s,' % (indent, align, func.name)
+        print '%s%scmd_size);' % (indent, align)
+        if variable:
+            print '%svariable_data = ' \
+                  '(GLubyte *) cmd + marshal_cmd_header_size(*cmd);' % (
+                      indent)
+        for m in params:
+            if m.by_value:
+                print '%scmd->%s = %s;' % (indent, m.name, m.name)
+            elif m.fixed_size:
+                print '%smemcpy(cmd->%s, %s, sizeof(cmd->%s));' % (
+                    indent, m.name, m.name, m.name)
+            else:
+                print '%scmd->%s_null = !%s;' % (indent, m.name, m.name)
+        for m in variable:
+            print '%sif (%s) {' % (indent, m.name)
+            print '%s   memcpy(variable_data, %s, %s_size);' % (
+                indent, m.name, m.name)
+            print '%s   variable_data += %s_size;' % (indent, m.name)
+            print '%s}' % (indent)
+        if func.name in flush_functions:
+            print '%s_mesa_glthread_flush_batch(ctx);' % (indent)
+        if condition:
+            print '      return;'
+            print '   }'
+            print ''
+            self.print_sync_call(func, '   ')
+        print '}'
+        print ''
+
+    def printBody(self, api):
+        async_funcs = []
+        sync_funcs = []
+        for func in api.functionIterateByOffset():
+            if can_marshal(func):
+                async_funcs.append(func)
+            else:
+                sync_funcs.append(func)
+
+        print 'enum marshal_dispatch_cmd_id'
+        print '{'
+        for func in async_funcs:
+            print '   DISPATCH_CMD_%s,' % (func.name)
+        print '};'
+        print ''
+
+        for func in async_funcs:
+            self.print_async_function(func)
+
+        for func in sync_funcs:
+            self.print_sync_function(func)
+
+        print ''
+        print '/**'
+        print ' * Execute the command at \\c cmd on the driver thread.'
+        print ' * \\return the size of the command in bytes'
+        print ' */'
+        print 'size_t'
+        print '_mesa_unmarshal_dispatch_cmd(struct gl_context *ctx, ' \
+              'const void *cmd)'
+        print '{'
+        print '   const struct marshal_cmd_base *cmd_base = cmd;'
+        print '   switch (cmd_base->cmd_id) {'
+        for func in async_funcs:
+            print '   case DISPATCH_CMD_%s:' % (func.name)
+            print '      _mesa_unmarshal_%s(ctx, ' \
+                  '(const struct marshal_cmd_%s *) cmd);' % (
+                      func.name, func.name)
+            print '      break;'
+        print '   default:'
+        print '      assert(!"Unrecognized command ID");'
+        print '      break;'
+        print '   }'
+        print ''
+        print '   return cmd_base->cmd_size;'
+        print '}'
+        print ''
+        print ''
+        print '/**'
+        print ' * Create the dispatch table used by the application thread.'
+        print ' */'
+        print 'struct _glapi_table *'
+        print '_mesa_create_marshal_table(const struct gl_context *ctx)'
+        print '{'
+        print '   struct _glapi_table *table;'
+        print ''
+        print '   table = _mesa_alloc_dispatch_table();'
+        print '   if (table == NULL)'
+        print '      return NULL;'
+        print ''
+        for func in api.functionIterateByOffset():
+            print '   SET_%s(table, _mesa_marshal_%s);' % (
+                func.name, func.name)
+        print ''
+        print '   return table;'
+        print '}'
+
+
+def show_usage():
+    print "Usage: %s [-f input_file_name]" % sys.argv[0]
+    sys.exit(1)
+
+
+if __name__ == '__main__':
+    file_name = "gl_and_es_API.xml"
+
+    try:
+        (args, trail) = getopt.getopt(sys.argv[1:], "m:f:")
+    except Exception,e:
+        show_usage()
+
+    for (arg,val) in args:
+        if arg == "-f":
+            file_name = val
+
+    printer = PrintCode()
+
+    api = gl_XML.parse_GL_API(file_name)
+    printer.Print(api)
@@ -30,6 +30,7 @@
 #include "imports.h"
 #include "mtypes.h"
 #include "enums.h"
+#include "state.h"
 #include "vbo/vbo.h"
 #include "transformfeedback.h"
 #include <stdbool.h>
@@ -100,15 +101,13 @@ _mesa_max_buffer_index(struct gl_context *ctx, GLuint count, GLenum type,
 
 
 /**
- * Check if OK to draw arrays/elements.
+ * Check if the current vertex array/program state gives a draw call any
+ * vertices to work with.  A draw without them is not an error, it just
+ * renders nothing.
  */
 static GLboolean
-check_valid_to_render(struct gl_context *ctx, const char *function)
+have_vertex_data(const struct gl_context *ctx)
 {
-   if (!_mesa_valid_to_render(ctx, function)) {
-      return GL_FALSE;
-   }
-
    switch (ctx->API) {
    case API_OPENGLES2:
       /* For ES2, we can draw if any vertex array is enabled (and we
@@ -148,13 +147,27 @@ check_valid_to_render(struct gl_context *ctx, const char *function)
       break;
 
    default:
-      assert(!"Invalid API value in check_valid_to_render()");
+      assert(!"Invalid API value in have_vertex_data()");
    }
 
    return GL_TRUE;
 }
 
 
+/**
+ * Check if OK to draw arrays/elements.
+ */
+static GLboolean
+check_valid_to_render(struct gl_context *ctx, const char *function)
+{
+   if (!_mesa_valid_to_render(ctx, function)) {
+      return GL_FALSE;
+   }
+
+   return have_vertex_data(ctx);
+}
+
+
 /**
  * Do bounds checking on array element indexes.  Check that the vertices
  * pointed to by the indices don't lie outside buffer object bounds.
@@ -372,6 +385,35 @@ _mesa_validate_DrawElements(struct gl_context *ctx,
 }
 
 
+/**
+ * glDrawElements() setup for contexts created with MESA_NO_ERROR.  The
+ * parameters are assumed to be valid, so only the state update and the
+ * checks for calls which legitimately draw nothing are kept.
+ * \return GL_TRUE if there is something to render
+ */
+GLboolean
+_mesa_validate_DrawElements_no_error(struct gl_context *ctx,
+                                     GLsizei count, const GLvoid *indices)
+{
+   FLUSH_CURRENT(ctx, 0);
+
+   if (count == 0)
+      return GL_FALSE;
+
+   if (ctx->NewState)
+      _mesa_update_state(ctx);
+
+   if (!have_vertex_data(ctx))
+      return GL_FALSE;
+
+   if (!_mesa_is_bufferobj(ctx->Array.ArrayObj->ElementArrayBufferObj) &&
+       !indices)
+      return GL_FALSE;
+
+   return GL_TRUE;
+}
+
+
 /**
  * Error checking for glMultiDrawElements().  Includes parameter checking
  * and VBO bounds checking.
@@ -57,6 +57,10 @@ _mesa_validate_DrawElements(struct gl_context *ctx,
 			    GLenum mode, GLsizei count, GLenum type,
 			    const GLvoid *indices, GLint basevertex);
 
+extern GLboolean
+_mesa_validate_DrawElements_no_error(struct gl_context *ctx,
+                                     GLsizei count, const GLvoid *indices);
+
 extern GLboolean
 _mesa_validate_MultiDrawElements(struct gl_context *ctx,
                                  GLenum mode, const GLsizei *count,
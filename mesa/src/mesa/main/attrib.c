@@ -1278,6 +1278,7 @@ _mesa_PopAttrib(void)
                   = (struct texture_state *) attr->data;
                pop_texture_group(ctx, texstate);
 	       ctx->NewState |= _NEW_TEXTURE;
+               _mesa_dirty_all_texture_units(ctx);
             }
             break;
          case GL_VIEWPORT_BIT:
@@ -1345,6 +1346,7 @@ copy_pixelstore(struct gl_context *ctx,
    dst->SwapBytes = src->SwapBytes;
    dst->LsbFirst = src->LsbFirst;
    dst->Invert = src->Invert;
+   dst->ClientStorage = src->ClientStorage;
    _mesa_reference_buffer_object(ctx, &dst->BufferObj, src->BufferObj);
 }
 
@@ -43,6 +43,7 @@
 #include "texobj.h"
 #include "transformfeedback.h"
 #include "dispatch.h"
+#include "vbo/vbo.h"
 
 
 /* Debug flags */
@@ -305,6 +306,8 @@ _mesa_reference_buffer_object_(struct gl_context *ctx,
 	 ASSERT(ctx->Array.ArrayObj->Vertex.BufferObj != bufObj);
 #endif
 
+         vbo_delete_minmax_cache(oldObj);
+
 	 ASSERT(ctx->Driver.DeleteBuffer);
          ctx->Driver.DeleteBuffer(ctx, oldObj);
       }
@@ -347,6 +350,7 @@ _mesa_initialize_buffer_object( struct gl_context *ctx,
 
    memset(obj, 0, sizeof(struct gl_buffer_object));
    _glthread_INIT_MUTEX(obj->Mutex);
+   _glthread_INIT_MUTEX(obj->MinMaxCacheMutex);
    obj->RefCount = 1;
    obj->Name = name;
    obj->Usage = GL_STATIC_DRAW_ARB;
@@ -721,6 +725,10 @@ bind_buffer_object(struct gl_context *ctx, GLenum target, GLuint buffer)
    /* bind new buffer */
    _mesa_reference_buffer_object(ctx, bindTarget, newBufObj);
 
+   /* glReadPixels and friends write into pixel pack buffers */
+   if (target == GL_PIXEL_PACK_BUFFER_EXT)
+      newBufObj->DeviceWritable = GL_TRUE;
+
    /* Pass BindBuffer call to device driver */
    if (ctx->Driver.BindBuffer)
       ctx->Driver.BindBuffer( ctx, target, newBufObj );
@@ -1057,6 +1065,7 @@ _mesa_BufferData(GLenum target, GLsizeiptrARB size,
    FLUSH_VERTICES(ctx, _NEW_BUFFER_OBJECT);
 
    bufObj->Written = GL_TRUE;
+   bufObj->MinMaxCacheDirty = GL_TRUE;
 
 #ifdef VBO_DEBUG
    printf("glBufferDataARB(%u, sz %ld, from %p, usage 0x%x)\n",
@@ -1092,6 +1101,7 @@ _mesa_BufferSubData(GLenum target, GLintptrARB offset,
       return;
 
    bufObj->Written = GL_TRUE;
+   bufObj->MinMaxCacheDirty = GL_TRUE;
 
    ASSERT(ctx->Driver.BufferSubData);
    ctx->Driver.BufferSubData( ctx, offset, size, data, bufObj );
@@ -1265,6 +1275,9 @@ _mesa_UnmapBuffer(GLenum target)
    }
 #endif
 
+   if (bufObj->AccessFlags & GL_MAP_WRITE_BIT)
+      bufObj->MinMaxCacheDirty = GL_TRUE;
+
    status = ctx->Driver.UnmapBuffer( ctx, bufObj );
    bufObj->AccessFlags = 0;
    ASSERT(bufObj->Pointer == NULL);
@@ -1470,6 +1483,8 @@ _mesa_CopyBufferSubData(GLenum readTarget, GLenum writeTarget,
       }
    }
 
+   dst->MinMaxCacheDirty = GL_TRUE;
+
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset, size);
 }
 
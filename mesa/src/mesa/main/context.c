@@ -98,6 +98,7 @@
 #include "fog.h"
 #include "formats.h"
 #include "framebuffer.h"
+#include "glthread.h"
 #include "hint.h"
 #include "hash.h"
 #include "light.h"
@@ -120,8 +121,10 @@
 #include "state.h"
 #include "stencil.h"
 #include "texcompress_s3tc.h"
+#include "texobj.h"
 #include "texstate.h"
 #include "transformfeedback.h"
+#include "uniforms.h"
 #include "mtypes.h"
 #include "varray.h"
 #include "version.h"
@@ -928,12 +931,29 @@ create_beginend_table(const struct gl_context *ctx)
    return table;
 }
 
+/**
+ * Route hot entry points of the exec table to variants which skip error
+ * checking, for contexts created with MESA_NO_ERROR.  glDrawElements is
+ * handled by vbo_initialize_exec_dispatch().
+ */
+static void
+install_no_error_dispatch(struct gl_context *ctx, struct _glapi_table *exec)
+{
+   SET_BindTexture(exec, _mesa_BindTexture_no_error);
+
+   if (ctx->API != API_OPENGLES)
+      SET_Uniform4fv(exec, _mesa_Uniform4fv_no_error);
+}
+
 void
 _mesa_initialize_dispatch_tables(struct gl_context *ctx)
 {
    /* Do the code-generated setup of the exec table in api_exec.c. */
    _mesa_initialize_exec_table(ctx);
 
+   if (ctx->NoError)
+      install_no_error_dispatch(ctx, ctx->Exec);
+
    if (ctx->Save)
       _mesa_initialize_save_table(ctx);
 }
@@ -1024,6 +1044,8 @@ _mesa_initialize_context(struct gl_context *ctx,
    ctx->FragmentProgram._MaintainTexEnvProgram
       = (_mesa_getenv("MESA_TEX_PROG") != NULL);
 
+   ctx->NoError = (_mesa_getenv("MESA_NO_ERROR") != NULL);
+
    ctx->VertexProgram._MaintainTnlProgram
       = (_mesa_getenv("MESA_TNL_PROG") != NULL);
    if (ctx->VertexProgram._MaintainTnlProgram) {
@@ -1132,6 +1154,8 @@ _mesa_create_context(gl_api api,
 void
 _mesa_free_context_data( struct gl_context *ctx )
 {
+   _mesa_glthread_destroy(ctx);
+
    if (!_mesa_get_current_context()){
       /* No current context, but we may need one in order to delete
        * texture objs, etc.  So temporarily bind the context now.
@@ -1448,6 +1472,14 @@ _mesa_make_current( struct gl_context *newCtx,
       }
    }
 
+   /* The driver thread must be done with the old context, and may not
+    * see its drawables change under it.
+    */
+   if (curCtx)
+      _mesa_glthread_finish(curCtx);
+   if (newCtx && newCtx != curCtx)
+      _mesa_glthread_finish(newCtx);
+
    if (curCtx && 
       (curCtx->WinSysDrawBuffer || curCtx->WinSysReadBuffer) &&
        /* make sure this context is valid for flushing */
@@ -1462,7 +1494,10 @@ _mesa_make_current( struct gl_context *newCtx,
       _glapi_set_dispatch(NULL);  /* none current */
    }
    else {
-      _glapi_set_dispatch(newCtx->CurrentDispatch);
+      if (newCtx->GLThread)
+         _glapi_set_dispatch(newCtx->MarshalExec);
+      else
+         _glapi_set_dispatch(newCtx->CurrentDispatch);
 
       if (drawBuffer && readBuffer) {
          ASSERT(_mesa_is_winsys_fbo(drawBuffer));
@@ -231,6 +231,25 @@ do {								\
    ctx->NewState |= newstate;					\
 } while (0)
 
+/**
+ * Like FLUSH_VERTICES, but lets the driver keep the buffered vertices
+ * if it can record the upcoming change of the \p newstate groups
+ * instead.  Doesn't update __struct gl_contextRec::NewState, the caller
+ * does that once the state actually changed.
+ *
+ * \param ctx GL context.
+ * \param newstate new state.
+ */
+#define FLUSH_VERTICES_DEFERRABLE(ctx, newstate)		\
+do {								\
+   if (MESA_VERBOSE & VERBOSE_STATE)				\
+      _mesa_debug(ctx, "FLUSH_VERTICES_DEFERRABLE in %s\n", MESA_FUNCTION);\
+   if ((ctx->Driver.NeedFlush & FLUSH_STORED_VERTICES) &&	\
+       !(ctx->Driver.DeferFlushVertices &&			\
+         ctx->Driver.DeferFlushVertices(ctx, newstate)))		\
+      ctx->Driver.FlushVertices(ctx, FLUSH_STORED_VERTICES);	\
+} while (0)
+
 /**
  * Flush current state.
  *
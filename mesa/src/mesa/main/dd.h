@@ -720,6 +720,15 @@ struct dd_function_table {
    void (*FlushVertices)( struct gl_context *ctx, GLuint flags );
    void (*SaveFlushVertices)( struct gl_context *ctx );
 
+   /**
+    * Called instead of FlushVertices() before a change of the state in
+    * \p newstate which the driver may be able to record between the
+    * buffered primitives, such as the modelview and projection matrices.
+    * Returns GL_TRUE if the buffered vertices don't need to be flushed.
+    */
+   GLboolean (*DeferFlushVertices)( struct gl_context *ctx,
+                                    GLbitfield newstate );
+
    /**
     * Give the driver the opportunity to hook in its own vtxfmt for
     * compiling optimized display lists.  This is called on each valid
@@ -82,6 +82,9 @@ struct gl_list_instruction
    void (*Execute)( struct gl_context *ctx, void *data );
    void (*Destroy)( struct gl_context *ctx, void *data );
    void (*Print)( struct gl_context *ctx, void *data );
+   GLuint (*Coalesce)( struct gl_context *ctx, void *dst,
+                       void **src, GLuint count );
+   GLbitfield64 (*CurrentAttribs)( struct gl_context *ctx, void *data );
 };
 
 
@@ -535,6 +538,12 @@ union uint64_pair
 static GLuint InstSize[OPCODE_END_OF_LIST + 1];
 
 
+/**
+ * Whether glEndList optimizes the new list, see optimize_list().
+ */
+static GLboolean OptimizeLists;
+
+
 void mesa_print_display_list(GLuint list);
 
 
@@ -1004,6 +1013,16 @@ _mesa_dlist_alloc(struct gl_context *ctx, GLuint opcode, GLuint bytes)
  * \param execute  function to execute the new display list command
  * \param destroy  function to destroy the new display list command
  * \param print  function to print the new display list command
+ * \param coalesce  optional function which merges as many as possible of
+ *                  the \c count commands in \c src, which are executed
+ *                  back to back, into the new command \c dst.  Returns
+ *                  the number of commands merged, or zero if the first
+ *                  two can't be merged.  The merged commands are left
+ *                  alone, the caller destroys them.
+ * \param current_attribs  optional function which returns the vertex
+ *                         attributes (VERT_BIT_x) whose current values
+ *                         the command may change.  Commands without it
+ *                         may change any state.
  * \return  the new opcode number or -1 if error
  */
 GLint
@@ -1011,7 +1030,11 @@ _mesa_dlist_alloc_opcode(struct gl_context *ctx,
                          GLuint size,
                          void (*execute) (struct gl_context *, void *),
                          void (*destroy) (struct gl_context *, void *),
-                         void (*print) (struct gl_context *, void *))
+                         void (*print) (struct gl_context *, void *),
+                         GLuint (*coalesce) (struct gl_context *, void *,
+                                             void **, GLuint),
+                         GLbitfield64 (*current_attribs) (struct gl_context *,
+                                                          void *))
 {
    if (ctx->ListExt->NumOpcodes < MAX_DLIST_EXT_OPCODES) {
       const GLuint i = ctx->ListExt->NumOpcodes++;
@@ -1020,6 +1043,8 @@ _mesa_dlist_alloc_opcode(struct gl_context *ctx,
       ctx->ListExt->Opcode[i].Execute = execute;
       ctx->ListExt->Opcode[i].Destroy = destroy;
       ctx->ListExt->Opcode[i].Print = print;
+      ctx->ListExt->Opcode[i].Coalesce = coalesce;
+      ctx->ListExt->Opcode[i].CurrentAttribs = current_attribs;
       return i + OPCODE_EXT_0;
    }
    return -1;
@@ -8652,6 +8677,403 @@ _mesa_NewList(GLuint name, GLenum mode)
 }
 
 
+/**
+ * Kinds of state set by the instructions which optimize_list() can find
+ * to be redundant.
+ */
+enum list_state_kind
+{
+   LIST_STATE_NONE,
+   LIST_STATE_ATTRIB,          /**< ATTR_xF_NV/ARB, keyed by VERT_ATTRIB_x */
+   LIST_STATE_ENABLE,          /**< ENABLE/DISABLE, keyed by capability */
+   LIST_STATE_BIND_TEXTURE,    /**< keyed by target */
+   LIST_STATE_ACTIVE_TEXTURE,
+   LIST_STATE_SHADE_MODEL,
+   LIST_STATE_LINE_WIDTH,
+   LIST_STATE_POINT_SIZE
+};
+
+#define MAX_LIST_STATE 64
+
+/**
+ * State of the display list optimizer.
+ */
+struct list_optimizer
+{
+   /** The last instruction which set each piece of known state */
+   struct {
+      enum list_state_kind Kind;
+      GLuint Key;
+      const Node *Inst;
+   } State[MAX_LIST_STATE];
+   GLuint NumState;
+
+   /** Run of extension instructions which may be coalesced */
+   Node **Run;
+   GLuint RunLength, RunMax;
+
+   /** Old instructions merged into new ones, destroyed on success */
+   Node **Merged;
+   GLuint NumMerged, MaxMerged;
+
+   /** New instructions created by coalescing, destroyed on failure */
+   Node **Created;
+   GLuint NumCreated, MaxCreated;
+
+   GLuint NumInsts, NumDropped;
+};
+
+
+/**
+ * Append a node pointer to a growable array.
+ */
+static GLboolean
+append_node(Node ***array, GLuint *num, GLuint *max, Node *n)
+{
+   if (*num == *max) {
+      GLuint new_max = MAX2(*max * 2, 64);
+      Node **new_array = realloc(*array, new_max * sizeof(Node *));
+      if (!new_array)
+         return GL_FALSE;
+      *array = new_array;
+      *max = new_max;
+   }
+   (*array)[(*num)++] = n;
+   return GL_TRUE;
+}
+
+
+/**
+ * Return which state the instruction sets, if it is one of those tracked.
+ */
+static enum list_state_kind
+list_state_kind(const Node *n, GLuint *key)
+{
+   *key = 0;
+
+   switch (n[0].opcode) {
+   case OPCODE_ATTR_1F_NV:
+   case OPCODE_ATTR_2F_NV:
+   case OPCODE_ATTR_3F_NV:
+   case OPCODE_ATTR_4F_NV:
+      /* attribute 0 emits a vertex */
+      *key = n[1].e;
+      return *key != 0 ? LIST_STATE_ATTRIB : LIST_STATE_NONE;
+   case OPCODE_ATTR_1F_ARB:
+   case OPCODE_ATTR_2F_ARB:
+   case OPCODE_ATTR_3F_ARB:
+   case OPCODE_ATTR_4F_ARB:
+      *key = VERT_ATTRIB_GENERIC(n[1].e);
+      return n[1].e != 0 ? LIST_STATE_ATTRIB : LIST_STATE_NONE;
+   case OPCODE_ENABLE:
+   case OPCODE_DISABLE:
+      *key = n[1].e;
+      return LIST_STATE_ENABLE;
+   case OPCODE_BIND_TEXTURE:
+      *key = n[1].e;
+      return LIST_STATE_BIND_TEXTURE;
+   case OPCODE_ACTIVE_TEXTURE:
+      return LIST_STATE_ACTIVE_TEXTURE;
+   case OPCODE_SHADE_MODEL:
+      return LIST_STATE_SHADE_MODEL;
+   case OPCODE_LINE_WIDTH:
+      return LIST_STATE_LINE_WIDTH;
+   case OPCODE_POINT_SIZE:
+      return LIST_STATE_POINT_SIZE;
+   default:
+      return LIST_STATE_NONE;
+   }
+}
+
+
+/**
+ * Forget the known state of the given kind, and for attributes only
+ * that of the attributes in \p attribs.
+ */
+static void
+forget_list_state(struct list_optimizer *opt, enum list_state_kind kind,
+                  GLbitfield64 attribs)
+{
+   GLuint i, j = 0;
+
+   for (i = 0; i < opt->NumState; i++) {
+      if (opt->State[i].Kind == kind &&
+          (kind != LIST_STATE_ATTRIB ||
+           (attribs & BITFIELD64_BIT(opt->State[i].Key))))
+         continue;
+      opt->State[j++] = opt->State[i];
+   }
+   opt->NumState = j;
+}
+
+
+/**
+ * Check whether a state setting instruction repeats the last one which
+ * set the same state, and otherwise remember it.
+ */
+static GLboolean
+is_redundant_state(struct list_optimizer *opt, enum list_state_kind kind,
+                   GLuint key, const Node *n)
+{
+   GLuint i, j;
+
+   for (i = 0; i < opt->NumState; i++) {
+      if (opt->State[i].Kind == kind && opt->State[i].Key == key)
+         break;
+   }
+
+   if (i < opt->NumState) {
+      const Node *prev = opt->State[i].Inst;
+
+      if (prev[0].opcode == n[0].opcode) {
+         /* all operands of the tracked instructions are 32 bit */
+         for (j = 1; j < InstSize[n[0].opcode]; j++) {
+            if (prev[j].ui != n[j].ui)
+               break;
+         }
+         if (j == InstSize[n[0].opcode])
+            return GL_TRUE;
+      }
+   }
+   else if (opt->NumState < MAX_LIST_STATE) {
+      opt->State[opt->NumState].Kind = kind;
+      opt->State[opt->NumState].Key = key;
+      opt->NumState++;
+   }
+   else {
+      return GL_FALSE;
+   }
+
+   opt->State[i].Inst = n;
+
+   /* enables and bindings of texture targets are per unit */
+   if (kind == LIST_STATE_ACTIVE_TEXTURE) {
+      forget_list_state(opt, LIST_STATE_ENABLE, 0);
+      forget_list_state(opt, LIST_STATE_BIND_TEXTURE, 0);
+   }
+
+   return GL_FALSE;
+}
+
+
+/**
+ * Copy an instruction of the old list to the end of the new one.
+ */
+static Node *
+copy_instruction(struct gl_context *ctx, const Node *n, GLuint size)
+{
+   Node *copy = dlist_alloc(ctx, n[0].opcode, (size - 1) * sizeof(Node));
+
+   if (copy)
+      memcpy(copy + 1, n + 1, (size - 1) * sizeof(Node));
+   return copy;
+}
+
+
+/**
+ * Emit the pending run of extension instructions, coalescing them where
+ * the extension can.
+ */
+static GLboolean
+flush_run(struct gl_context *ctx, struct list_optimizer *opt)
+{
+   GLuint i = 0;
+
+   while (i < opt->RunLength) {
+      const OpCode opcode = opt->Run[i][0].opcode;
+      const struct gl_list_instruction *ext =
+         &ctx->ListExt->Opcode[opcode - OPCODE_EXT_0];
+      Node *n = dlist_alloc(ctx, opcode,
+                            (ext->Size - 1) * sizeof(Node));
+      void *src[64];
+      GLuint count = MIN2(opt->RunLength - i, Elements(src));
+      GLuint j, merged;
+
+      if (!n)
+         return GL_FALSE;
+
+      for (j = 0; j < count; j++)
+         src[j] = &opt->Run[i + j][1];
+
+      merged = count > 1 ? ext->Coalesce(ctx, &n[1], src, count) : 0;
+      if (merged > 1) {
+         if (!append_node(&opt->Created, &opt->NumCreated,
+                          &opt->MaxCreated, n)) {
+            ext->Destroy(ctx, &n[1]);
+            return GL_FALSE;
+         }
+         for (j = 0; j < merged; j++) {
+            if (!append_node(&opt->Merged, &opt->NumMerged,
+                             &opt->MaxMerged, opt->Run[i + j]))
+               return GL_FALSE;
+         }
+         i += merged;
+      }
+      else {
+         memcpy(n + 1, opt->Run[i] + 1, (ext->Size - 1) * sizeof(Node));
+         i++;
+      }
+   }
+
+   opt->RunLength = 0;
+   return GL_TRUE;
+}
+
+
+/**
+ * Rewrite the display list just compiled into a new one, executing the
+ * same commands faster:
+ *
+ * - instructions which set state to the value the same kind of instruction
+ *   set earlier in the list are dropped,
+ * - runs of extension instructions (the vbo module's vertex lists), which
+ *   are then only separated by dropped instructions or none at all, are
+ *   coalesced into few instructions with larger draws.
+ *
+ * Instructions are copied to the new list, so their payload changes hands.
+ * On failure the old list is left as it was.
+ */
+static struct gl_display_list *
+optimize_list(struct gl_context *ctx, struct gl_display_list *dlist)
+{
+   struct gl_display_list *opt_list, *discard;
+   struct list_optimizer *opt;
+   Node *n, *block;
+   GLboolean ok = GL_TRUE;
+   GLuint i;
+
+   opt = CALLOC_STRUCT(list_optimizer);
+   if (!opt)
+      return dlist;
+
+   opt_list = make_list(dlist->Name, BLOCK_SIZE);
+   opt_list->Flags = dlist->Flags;
+
+   ctx->ListState.CurrentBlock = opt_list->Head;
+   ctx->ListState.CurrentPos = 0;
+
+   n = dlist->Head;
+   while (ok) {
+      const OpCode opcode = n[0].opcode;
+      enum list_state_kind kind;
+      GLuint key;
+
+      if (opcode == OPCODE_CONTINUE) {
+         n = (Node *) n[1].next;
+         continue;
+      }
+
+      if (opcode == OPCODE_END_OF_LIST) {
+         ok = flush_run(ctx, opt) &&
+              dlist_alloc(ctx, OPCODE_END_OF_LIST, 0) != NULL;
+         break;
+      }
+
+      opt->NumInsts++;
+
+      if (is_ext_opcode(opcode)) {
+         const struct gl_list_instruction *ext =
+            &ctx->ListExt->Opcode[opcode - OPCODE_EXT_0];
+
+         if (ext->CurrentAttribs) {
+            forget_list_state(opt, LIST_STATE_ATTRIB,
+                              ext->CurrentAttribs(ctx, &n[1]));
+         }
+         else {
+            opt->NumState = 0;
+         }
+
+         if (opt->RunLength && opt->Run[0][0].opcode != opcode)
+            ok = flush_run(ctx, opt);
+
+         if (ext->Coalesce)
+            ok = ok && append_node(&opt->Run, &opt->RunLength,
+                                   &opt->RunMax, n);
+         else
+            ok = ok && copy_instruction(ctx, n, ext->Size) != NULL;
+
+         n += ext->Size;
+         continue;
+      }
+
+      kind = list_state_kind(n, &key);
+      if (kind != LIST_STATE_NONE) {
+         if (is_redundant_state(opt, kind, key, n)) {
+            opt->NumDropped++;
+            n += InstSize[opcode];
+            continue;
+         }
+      }
+      else {
+         /* may change any state */
+         opt->NumState = 0;
+      }
+
+      ok = flush_run(ctx, opt) &&
+           copy_instruction(ctx, n, InstSize[opcode]) != NULL;
+      n += InstSize[opcode];
+   }
+
+   if (ok) {
+      /* The payload of the old instructions moved to the new list, except
+       * for the coalesced ones.
+       */
+      for (i = 0; i < opt->NumMerged; i++)
+         ext_opcode_destroy(ctx, opt->Merged[i]);
+
+      if (MESA_VERBOSE & VERBOSE_DISPLAY_LIST) {
+         _mesa_debug(ctx, "glEndList %u: %u instructions, %u redundant "
+                     "state changes dropped, %u vertex lists coalesced "
+                     "into %u\n", dlist->Name, opt->NumInsts,
+                     opt->NumDropped, opt->NumMerged, opt->NumCreated);
+      }
+
+      discard = dlist;
+      dlist = opt_list;
+   }
+   else {
+      for (i = 0; i < opt->NumCreated; i++)
+         ext_opcode_destroy(ctx, opt->Created[i]);
+
+      /* There is always room for this, see dlist_alloc(). */
+      ctx->ListState.CurrentBlock[ctx->ListState.CurrentPos].opcode =
+         OPCODE_END_OF_LIST;
+      discard = opt_list;
+   }
+
+   /* Free the blocks of the list which isn't kept.
+    */
+   n = block = discard->Head;
+   for (;;) {
+      const OpCode opcode = n[0].opcode;
+
+      if (opcode == OPCODE_CONTINUE) {
+         n = (Node *) n[1].next;
+         free(block);
+         block = n;
+      }
+      else if (opcode == OPCODE_END_OF_LIST) {
+         free(block);
+         break;
+      }
+      else if (is_ext_opcode(opcode)) {
+         n += ctx->ListExt->Opcode[opcode - OPCODE_EXT_0].Size;
+      }
+      else {
+         n += InstSize[opcode];
+      }
+   }
+   free(discard);
+
+   free(opt->Run);
+   free(opt->Merged);
+   free(opt->Created);
+   free(opt);
+
+   return dlist;
+}
+
+
 /**
  * End definition of current display list. 
  */
@@ -8683,6 +9105,10 @@ _mesa_EndList(void)
 
    (void) alloc_instruction(ctx, OPCODE_END_OF_LIST, 0);
 
+   if (OptimizeLists)
+      ctx->ListState.CurrentList =
+         optimize_list(ctx, ctx->ListState.CurrentList);
+
    /* Destroy old list, if any */
    destroy_list(ctx, ctx->ListState.CurrentList->Name);
 
@@ -9660,6 +10086,7 @@ _mesa_init_display_list(struct gl_context *ctx)
    /* zero-out the instruction size table, just once */
    if (!tableInitialized) {
       memset(InstSize, 0, sizeof(InstSize));
+      OptimizeLists = !_mesa_getenv("MESA_NO_DLIST_OPTIMIZE");
       tableInitialized = GL_TRUE;
    }
 
@@ -223,6 +223,7 @@ enable_texture(struct gl_context *ctx, GLboolean state, GLbitfield texBit)
        return GL_FALSE;
 
    FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+   _mesa_dirty_texture_unit(ctx, ctx->Texture.CurrentUnit);
    texUnit->Enabled = newenabled;
    return GL_TRUE;
 }
@@ -941,6 +942,7 @@ _mesa_set_enable(struct gl_context *ctx, GLenum cap, GLboolean state)
 	 CHECK_EXTENSION(ARB_seamless_cube_map, cap);
 	 if (ctx->Texture.CubeMapSeamless != state) {
 	    FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+            _mesa_dirty_all_texture_units(ctx);
 	    ctx->Texture.CubeMapSeamless = state;
 	 }
 	 break;
@@ -0,0 +1,327 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2013  VMware, Inc.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+
+/**
+ * \file glthread.c
+ * The driver thread of threaded GL dispatch, and the synchronization with
+ * the application thread.  See glthread.h.
+ */
+
+
+#include <stdio.h>
+
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/glthread.h"
+#include "main/hash.h"
+#include "main/imports.h"
+#include "main/marshal.h"
+#include "glapi/glapi.h"
+
+
+#ifdef HAVE_PTHREAD
+
+#include <pthread.h>
+
+
+struct glthread_os
+{
+   pthread_t thread;
+   pthread_mutex_t mutex;
+
+   /** Signalled when a batch is submitted or shutdown is requested */
+   pthread_cond_t new_work;
+
+   /** Signalled when the driver thread is done with a batch */
+   pthread_cond_t work_done;
+};
+
+
+static void
+glthread_unmarshal_batch(struct gl_context *ctx, struct glthread_batch *batch)
+{
+   GLuint pos = 0;
+
+   while (pos < batch->used)
+      pos += _mesa_unmarshal_dispatch_cmd(ctx, (GLubyte *) batch->buffer + pos);
+
+   assert(pos == batch->used);
+   batch->used = 0;
+}
+
+
+static void *
+glthread_worker(void *data)
+{
+   struct gl_context *ctx = (struct gl_context *) data;
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_os *os = (struct glthread_os *) glthread->os;
+
+   /* The context stays current in this thread for its whole lifetime.
+    * Code called by the commands may look up the current context and
+    * dispatch table, so set both.
+    */
+   _glapi_check_multithread();
+   _glapi_set_context(ctx);
+   _glapi_set_dispatch(ctx->CurrentDispatch);
+
+   pthread_mutex_lock(&os->mutex);
+   for (;;) {
+      while (glthread->processed == glthread->submitted &&
+             !glthread->shutdown)
+         pthread_cond_wait(&os->new_work, &os->mutex);
+
+      if (glthread->processed == glthread->submitted)
+         break;
+      pthread_mutex_unlock(&os->mutex);
+
+      glthread_unmarshal_batch(ctx, &glthread->batches[glthread->processed %
+                                                       MARSHAL_MAX_BATCHES]);
+
+      pthread_mutex_lock(&os->mutex);
+      glthread->processed++;
+      pthread_cond_broadcast(&os->work_done);
+   }
+   pthread_mutex_unlock(&os->mutex);
+
+   return NULL;
+}
+
+
+/**
+ * Start the driver thread of a context and create its marshal dispatch
+ * table, which _mesa_make_current() installs instead of the context's
+ * own dispatch table.
+ */
+void
+_mesa_glthread_init(struct gl_context *ctx)
+{
+   struct glthread_state *glthread;
+   struct glthread_os *os;
+
+   if (ctx->GLThread)
+      return;
+
+   glthread = CALLOC_STRUCT(glthread_state);
+   os = CALLOC_STRUCT(glthread_os);
+   ctx->MarshalExec = _mesa_create_marshal_table(ctx);
+   if (!glthread || !os || !ctx->MarshalExec)
+      goto fail;
+
+   glthread->vaos = _mesa_NewHashTable();
+   if (!glthread->vaos)
+      goto fail;
+   glthread->vao = &glthread->default_vao;
+   glthread->os = os;
+
+   pthread_mutex_init(&os->mutex, NULL);
+   pthread_cond_init(&os->new_work, NULL);
+   pthread_cond_init(&os->work_done, NULL);
+
+   ctx->GLThread = glthread;
+   if (pthread_create(&os->thread, NULL, glthread_worker, ctx) != 0) {
+      ctx->GLThread = NULL;
+      pthread_cond_destroy(&os->work_done);
+      pthread_cond_destroy(&os->new_work);
+      pthread_mutex_destroy(&os->mutex);
+      _mesa_DeleteHashTable(glthread->vaos);
+      goto fail;
+   }
+
+   if (_mesa_get_current_context() == ctx)
+      _glapi_set_dispatch(ctx->MarshalExec);
+   return;
+
+fail:
+   free(ctx->MarshalExec);
+   ctx->MarshalExec = NULL;
+   free(os);
+   free(glthread);
+}
+
+
+/**
+ * Execute all queued commands and stop the driver thread.
+ */
+void
+_mesa_glthread_destroy(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_os *os;
+
+   if (!glthread)
+      return;
+
+   os = (struct glthread_os *) glthread->os;
+
+   _mesa_glthread_flush_batch(ctx);
+
+   pthread_mutex_lock(&os->mutex);
+   glthread->shutdown = GL_TRUE;
+   pthread_cond_signal(&os->new_work);
+   pthread_mutex_unlock(&os->mutex);
+
+   pthread_join(os->thread, NULL);
+
+   if (_mesa_getenv("MESA_GLTHREAD_STATS")) {
+      fprintf(stderr, "Mesa: glthread: %llu commands, %llu batches, "
+              "%llu syncs, %llu stalls on a full ring\n",
+              (unsigned long long) glthread->stat_commands,
+              (unsigned long long) glthread->stat_batches,
+              (unsigned long long) glthread->stat_syncs,
+              (unsigned long long) glthread->stat_stalls);
+   }
+
+   pthread_cond_destroy(&os->work_done);
+   pthread_cond_destroy(&os->new_work);
+   pthread_mutex_destroy(&os->mutex);
+
+   _mesa_glthread_free_vaos(ctx);
+
+   if (_mesa_get_current_context() == ctx)
+      _glapi_set_dispatch(ctx->CurrentDispatch);
+
+   ctx->GLThread = NULL;
+   free(ctx->MarshalExec);
+   ctx->MarshalExec = NULL;
+   free(os);
+   free(glthread);
+}
+
+
+/**
+ * Hand the batch being filled to the driver thread, waiting for it to
+ * release the next batch of the ring if necessary.
+ */
+void
+_mesa_glthread_flush_batch(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_os *os;
+
+   if (!glthread)
+      return;
+
+   if (!glthread->batches[glthread->submitted % MARSHAL_MAX_BATCHES].used)
+      return;
+
+   os = (struct glthread_os *) glthread->os;
+
+   pthread_mutex_lock(&os->mutex);
+   glthread->submitted++;
+   glthread->stat_batches++;
+   pthread_cond_signal(&os->new_work);
+
+   if (glthread->submitted - glthread->processed >= MARSHAL_MAX_BATCHES) {
+      glthread->stat_stalls++;
+      do {
+         pthread_cond_wait(&os->work_done, &os->mutex);
+      } while (glthread->submitted - glthread->processed >=
+               MARSHAL_MAX_BATCHES);
+   }
+   pthread_mutex_unlock(&os->mutex);
+}
+
+
+/**
+ * Wait until the driver thread has executed all commands queued so far.
+ *
+ * Called before executing a function synchronously on the application
+ * thread, and by window system code (MakeCurrent, SwapBuffers) that
+ * accesses the context outside of the GL dispatch.
+ */
+void
+_mesa_glthread_finish(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_os *os;
+
+   if (!glthread)
+      return;
+
+   os = (struct glthread_os *) glthread->os;
+
+   /* Commands executed by the driver thread may call back in here, e.g.
+    * through a flush of the window system framebuffer.
+    */
+   if (pthread_equal(pthread_self(), os->thread))
+      return;
+
+   _mesa_glthread_flush_batch(ctx);
+
+   pthread_mutex_lock(&os->mutex);
+   glthread->stat_syncs++;
+   while (glthread->processed != glthread->submitted)
+      pthread_cond_wait(&os->work_done, &os->mutex);
+   pthread_mutex_unlock(&os->mutex);
+}
+
+
+#else /* HAVE_PTHREAD */
+
+
+void
+_mesa_glthread_init(struct gl_context *ctx)
+{
+   (void) ctx;
+}
+
+
+void
+_mesa_glthread_destroy(struct gl_context *ctx)
+{
+   (void) ctx;
+}
+
+
+void
+_mesa_glthread_flush_batch(struct gl_context *ctx)
+{
+   (void) ctx;
+}
+
+
+void
+_mesa_glthread_finish(struct gl_context *ctx)
+{
+   (void) ctx;
+}
+
+
+#endif /* HAVE_PTHREAD */
+
+
+/**
+ * Functions executed synchronously may install another dispatch table in
+ * the application thread (e.g. glCallList does).  Put the marshal table
+ * back, so that later calls keep being queued.
+ */
+void
+_mesa_glthread_restore_dispatch(struct gl_context *ctx)
+{
+   if (_glapi_get_dispatch() != ctx->MarshalExec)
+      _glapi_set_dispatch(ctx->MarshalExec);
+}
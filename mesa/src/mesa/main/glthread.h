@@ -0,0 +1,201 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2013  VMware, Inc.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file glthread.h
+ * Threaded GL dispatch.
+ *
+ * When enabled, the application thread's dispatch table is a "marshal"
+ * table whose functions pack their arguments into commands in a ring of
+ * batches.  A driver thread owned by the context unpacks the commands and
+ * calls the real ("server") dispatch table.  Functions that return values,
+ * write to client memory or read client memory of unknown size wait for
+ * the driver thread to go idle and then execute directly on the
+ * application thread.
+ */
+
+
+#ifndef _GLTHREAD_H
+#define _GLTHREAD_H
+
+
+#include "glheader.h"
+#include "config.h"
+#include "macros.h"
+
+
+struct gl_context;
+struct _mesa_HashTable;
+
+
+/** Size of a batch in bytes */
+#define MARSHAL_BATCH_SIZE (64 * 1024)
+
+/** Number of batches in the ring shared with the driver thread */
+#define MARSHAL_MAX_BATCHES 8
+
+
+/**
+ * Header of each command in a batch.
+ */
+struct marshal_cmd_base
+{
+   /** Command id, from the generated marshal code */
+   GLushort cmd_id;
+
+   /** Size of the command in bytes, including this header */
+   GLushort cmd_size;
+};
+
+
+/**
+ * Largest command that is queued.  Calls with more data than this are
+ * executed synchronously, which avoids copying it twice.
+ */
+#define MARSHAL_MAX_CMD_SIZE (8 * 1024)
+
+
+struct glthread_batch
+{
+   /** Bytes of the buffer filled with commands */
+   GLuint used;
+
+   /** Commands, 8-byte aligned */
+   GLuint64 buffer[MARSHAL_BATCH_SIZE / 8];
+};
+
+
+/**
+ * Client-side state the application thread needs to decide whether a call
+ * can be queued.  Only used on the application thread.
+ */
+struct glthread_vao
+{
+   GLuint name;
+
+   /** Name of the buffer bound to GL_ELEMENT_ARRAY_BUFFER */
+   GLuint element_array_buffer;
+};
+
+
+/** Tracked state saved by glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT) */
+struct glthread_client_attrib
+{
+   GLboolean valid;
+   GLuint array_buffer;
+   GLuint vao;
+   GLuint element_array_buffer;
+};
+
+
+struct glthread_state
+{
+   struct glthread_batch batches[MARSHAL_MAX_BATCHES];
+
+   /** Batches handed to / executed by the driver thread (free-running) */
+   GLuint submitted;
+   GLuint processed;
+
+   /** Whether the driver thread should exit once idle */
+   GLboolean shutdown;
+
+   /** Private to the implementation (thread, mutex, condition variables) */
+   void *os;
+
+   /** Name of the buffer bound to GL_ARRAY_BUFFER */
+   GLuint array_buffer;
+
+   /** Currently bound vertex array object and all the others by name */
+   struct glthread_vao *vao;
+   struct glthread_vao default_vao;
+   struct _mesa_HashTable *vaos;
+
+   struct glthread_client_attrib
+      client_attrib_stack[MAX_CLIENT_ATTRIB_STACK_DEPTH];
+   GLuint client_attrib_depth;
+
+   /**
+    * Set once a vertex array pointer has been specified in client memory.
+    * Draws that may source vertices from client memory are executed
+    * synchronously from then on, since the application may modify the
+    * memory as soon as the draw call returns.
+    */
+   GLboolean has_user_pointers;
+
+   /** Statistics, reported with MESA_GLTHREAD_STATS */
+   GLuint64 stat_commands;
+   GLuint64 stat_batches;
+   GLuint64 stat_syncs;
+   GLuint64 stat_stalls;
+};
+
+
+extern void
+_mesa_glthread_init(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_destroy(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_flush_batch(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_finish(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_restore_dispatch(struct gl_context *ctx);
+
+
+/**
+ * Reserve space for a command in the batch being filled, handing the batch
+ * to the driver thread first if it is full.
+ */
+static inline void *
+_mesa_glthread_allocate_command(struct gl_context *ctx,
+                                struct glthread_state *glthread,
+                                GLushort cmd_id, GLuint size)
+{
+   struct glthread_batch *next =
+      &glthread->batches[glthread->submitted % MARSHAL_MAX_BATCHES];
+   struct marshal_cmd_base *cmd;
+
+   size = ALIGN(size, 8);
+   assert(size <= MARSHAL_MAX_CMD_SIZE);
+
+   if (next->used + size > MARSHAL_BATCH_SIZE) {
+      _mesa_glthread_flush_batch(ctx);
+      next = &glthread->batches[glthread->submitted % MARSHAL_MAX_BATCHES];
+   }
+
+   cmd = (struct marshal_cmd_base *) ((GLubyte *) next->buffer + next->used);
+   next->used += size;
+   cmd->cmd_id = cmd_id;
+   cmd->cmd_size = (GLushort) size;
+   glthread->stat_commands++;
+   return cmd;
+}
+
+
+#endif /* _GLTHREAD_H */
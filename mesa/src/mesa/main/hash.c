@@ -3,7 +3,8 @@
  * Generic hash table. 
  *
  * Used for display lists, texture objects, vertex/fragment programs,
- * buffer objects, etc.  The hash functions are thread-safe.
+ * buffer objects, etc.  The hash functions are thread-safe; lookups of
+ * small keys don't lock.
  * 
  * \note key=0 is illegal.
  *
@@ -53,11 +54,45 @@
  */
 #define DELETED_KEY_VALUE 1
 
+/**
+ * Smallest and largest number of keys in the direct lookup array.
+ */
+#define DIRECT_MIN_SIZE 64
+#define DIRECT_MAX_SIZE (64 * 1024)
+
+/**
+ * Memory barrier for publishing entries to lock-free readers.  Without
+ * one the direct lookup array is never created and every lookup locks.
+ */
+#if defined(__GNUC__)
+#define HASH_MEMORY_BARRIER() __sync_synchronize()
+#define HAVE_HASH_MEMORY_BARRIER 1
+#else
+#define HASH_MEMORY_BARRIER()
+#define HAVE_HASH_MEMORY_BARRIER 0
+#endif
+
+/**
+ * Array mirroring the table entries for keys below Size, indexed by key.
+ *
+ * Names from glGen*() are small consecutive integers, so this covers
+ * nearly all lookups, which then read the array without taking the
+ * mutex.  The array is only written with the mutex held.  When it grows
+ * a new array is published and the old one is kept on the Retired list
+ * until the table is deleted, since readers may still be looking at it.
+ */
+struct hash_direct {
+   GLuint Size;
+   struct hash_direct *Retired;
+   void * volatile Data[1];
+};
+
 /**
  * The hash table data structure.  
  */
 struct _mesa_HashTable {
    struct hash_table *ht;
+   struct hash_direct * volatile Direct; /**< lock-free lookups, may be NULL */
    GLuint MaxKey;                        /**< highest key inserted so far */
    _glthread_Mutex Mutex;                /**< mutual exclusion lock */
    _glthread_Mutex WalkMutex;            /**< for _mesa_HashWalk() */
@@ -144,6 +179,12 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 
    _mesa_hash_table_destroy(table->ht, NULL);
 
+   while (table->Direct) {
+      struct hash_direct *direct = table->Direct;
+      table->Direct = direct->Retired;
+      free(direct);
+   }
+
    _glthread_DESTROY_MUTEX(table->Mutex);
    _glthread_DESTROY_MUTEX(table->WalkMutex);
    free(table);
@@ -174,8 +215,67 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 }
 
 
+/**
+ * Make the direct lookup array big enough for \p key.  Called with the
+ * mutex held.
+ */
+static void
+grow_direct(struct _mesa_HashTable *table, GLuint key)
+{
+   struct hash_direct *old = table->Direct;
+   struct hash_direct *direct;
+   GLuint size = old ? old->Size * 2 : DIRECT_MIN_SIZE;
+   GLuint i;
+
+   while (size <= key)
+      size *= 2;
+
+   direct = calloc(1, sizeof(*direct) + (size - 1) * sizeof(void *));
+   if (!direct)
+      return;
+
+   direct->Size = size;
+   direct->Retired = old;
+   if (old) {
+      for (i = 0; i < old->Size; i++)
+         direct->Data[i] = old->Data[i];
+   }
+   /* Keys which didn't fit in the old array are only in the hash table */
+   for (i = old ? old->Size : 1; i < size; i++)
+      direct->Data[i] = _mesa_HashLookup_unlocked(table, i);
+
+   HASH_MEMORY_BARRIER();
+   table->Direct = direct;
+}
+
+
+/**
+ * Update the direct lookup array after \p key was inserted or removed.
+ * Called with the mutex held.
+ */
+static void
+update_direct(struct _mesa_HashTable *table, GLuint key, void *data)
+{
+   if (!HAVE_HASH_MEMORY_BARRIER || key >= DIRECT_MAX_SIZE)
+      return;
+
+   if (!table->Direct || key >= table->Direct->Size) {
+      /* Not needed for removals; grow_direct() fills in the entry */
+      if (data)
+         grow_direct(table, key);
+      return;
+   }
+
+   /* The object must be complete before readers can see it */
+   HASH_MEMORY_BARRIER();
+   table->Direct->Data[key] = data;
+}
+
+
 /**
  * Lookup an entry in the hash table.
+ *
+ * Keys in the direct lookup array are looked up without locking.
  * 
  * \param table the hash table.
  * \param key the key.
@@ -185,8 +285,15 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
+   const struct hash_direct *direct;
    void *res;
    assert(table);
+   assert(key);
+
+   direct = table->Direct;
+   if (direct && key < direct->Size)
+      return direct->Data[key];
+
    _glthread_LOCK_MUTEX(table->Mutex);
    res = _mesa_HashLookup_unlocked(table, key);
    _glthread_UNLOCK_MUTEX(table->Mutex);
@@ -227,6 +334,8 @@ _mesa_HashInsert(struct _mesa_HashTable *table, GLuint key, void *data)
       }
    }
 
+   update_direct(table, key, data);
+
    _glthread_UNLOCK_MUTEX(table->Mutex);
 }
 
@@ -263,6 +372,7 @@ _mesa_HashRemove(struct _mesa_HashTable *table, GLuint key)
       entry = _mesa_hash_table_search(table->ht, uint_hash(key), uint_key(key));
       _mesa_hash_table_remove(table->ht, entry);
    }
+   update_direct(table, key, NULL);
    _glthread_UNLOCK_MUTEX(table->Mutex);
 }
 
@@ -296,6 +406,11 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
       callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
       table->deleted_key_data = NULL;
    }
+   if (table->Direct) {
+      GLuint i;
+      for (i = 0; i < table->Direct->Size; i++)
+         table->Direct->Data[i] = NULL;
+   }
    table->InDeleteAll = GL_FALSE;
    _glthread_UNLOCK_MUTEX(table->Mutex);
 }
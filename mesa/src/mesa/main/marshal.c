@@ -0,0 +1,191 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2013  VMware, Inc.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+
+/**
+ * \file marshal.c
+ * Client-side state tracked by the application thread when threaded GL
+ * dispatch is enabled.  The hooks are called by the generated marshal
+ * functions before the command is queued.
+ */
+
+
+#include "main/glheader.h"
+#include "main/hash.h"
+#include "main/imports.h"
+#include "main/marshal.h"
+
+
+void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   switch (target) {
+   case GL_ARRAY_BUFFER:
+      glthread->array_buffer = buffer;
+      break;
+   case GL_ELEMENT_ARRAY_BUFFER:
+      glthread->vao->element_array_buffer = buffer;
+      break;
+   default:
+      break;
+   }
+}
+
+
+void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLsizei i;
+
+   if (!buffers)
+      return;
+
+   /* Deleted buffers are unbound from the context and the current VAO */
+   for (i = 0; i < n; i++) {
+      if (buffers[i] == 0)
+         continue;
+      if (glthread->array_buffer == buffers[i])
+         glthread->array_buffer = 0;
+      if (glthread->vao->element_array_buffer == buffers[i])
+         glthread->vao->element_array_buffer = 0;
+   }
+}
+
+
+void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint array)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_vao *vao;
+
+   if (array == 0) {
+      glthread->vao = &glthread->default_vao;
+      return;
+   }
+
+   vao = (struct glthread_vao *) _mesa_HashLookup(glthread->vaos, array);
+   if (!vao) {
+      /* New (or invalid) name; the binding starts out empty. */
+      vao = CALLOC_STRUCT(glthread_vao);
+      if (!vao)
+         return;
+      vao->name = array;
+      _mesa_HashInsert(glthread->vaos, array, vao);
+   }
+   glthread->vao = vao;
+}
+
+
+void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *arrays)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLsizei i;
+
+   if (!arrays)
+      return;
+
+   for (i = 0; i < n; i++) {
+      struct glthread_vao *vao;
+
+      if (arrays[i] == 0)
+         continue;
+
+      vao = (struct glthread_vao *) _mesa_HashLookup(glthread->vaos,
+                                                     arrays[i]);
+      if (!vao)
+         continue;
+
+      /* Deleting the bound VAO binds the default one */
+      if (glthread->vao == vao)
+         glthread->vao = &glthread->default_vao;
+
+      _mesa_HashRemove(glthread->vaos, arrays[i]);
+      free(vao);
+   }
+}
+
+
+void
+_mesa_glthread_PushClientAttrib(struct gl_context *ctx, GLbitfield mask)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_client_attrib *attrib;
+
+   if (glthread->client_attrib_depth >= MAX_CLIENT_ATTRIB_STACK_DEPTH)
+      return;
+
+   attrib = &glthread->client_attrib_stack[glthread->client_attrib_depth++];
+   attrib->valid = (mask & GL_CLIENT_VERTEX_ARRAY_BIT) != 0;
+   attrib->array_buffer = glthread->array_buffer;
+   attrib->vao = glthread->vao->name;
+   attrib->element_array_buffer = glthread->vao->element_array_buffer;
+}
+
+
+void
+_mesa_glthread_PopClientAttrib(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_client_attrib *attrib;
+
+   if (glthread->client_attrib_depth == 0)
+      return;
+
+   attrib = &glthread->client_attrib_stack[--glthread->client_attrib_depth];
+   if (!attrib->valid)
+      return;
+
+   _mesa_glthread_BindVertexArray(ctx, attrib->vao);
+   glthread->array_buffer = attrib->array_buffer;
+   glthread->vao->element_array_buffer = attrib->element_array_buffer;
+}
+
+
+static void
+free_vao(GLuint key, void *data, void *userData)
+{
+   (void) key;
+   (void) userData;
+   free(data);
+}
+
+
+void
+_mesa_glthread_free_vaos(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   _mesa_HashDeleteAll(glthread->vaos, free_vao, NULL);
+   _mesa_DeleteHashTable(glthread->vaos);
+   glthread->vaos = NULL;
+   glthread->vao = &glthread->default_vao;
+}
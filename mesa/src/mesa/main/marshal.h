@@ -0,0 +1,126 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2013  VMware, Inc.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file marshal.h
+ * Helpers for the generated marshal code (marshal_generated.c) and the
+ * client-side state the application thread tracks to decide whether a
+ * call may be queued.
+ */
+
+
+#ifndef MARSHAL_H
+#define MARSHAL_H
+
+
+#include "main/glthread.h"
+#include "main/mtypes.h"
+
+
+/** Size of a command structure, where any variable-sized data begins */
+#define marshal_cmd_header_size(cmd) ALIGN(sizeof(cmd), 8)
+
+
+/**
+ * Number of bytes of an array of \p count elements of \p elem_size bytes,
+ * or more than MARSHAL_MAX_CMD_SIZE if \p count is out of range, so that
+ * the call is executed synchronously and errors are reported as usual.
+ */
+static inline size_t
+marshal_size(GLint64 count, size_t elem_size)
+{
+   if (count < 0 || count > (GLint64) (MARSHAL_MAX_CMD_SIZE / elem_size))
+      return MARSHAL_MAX_CMD_SIZE + 1;
+   return (size_t) count * elem_size;
+}
+
+
+/**
+ * Whether a vertex array pointer being specified is an offset into a
+ * buffer object.  Otherwise it points to client memory, and draws are
+ * executed synchronously from now on.
+ */
+static inline GLboolean
+_mesa_glthread_is_vbo_pointer(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (glthread->array_buffer != 0)
+      return GL_TRUE;
+
+   glthread->has_user_pointers = GL_TRUE;
+   return GL_FALSE;
+}
+
+
+/**
+ * Whether an indexed draw sources both vertices and indices from buffer
+ * objects only.
+ */
+static inline GLboolean
+_mesa_glthread_has_vbo_indices(const struct gl_context *ctx)
+{
+   const struct glthread_state *glthread = ctx->GLThread;
+
+   return !glthread->has_user_pointers &&
+          glthread->vao->element_array_buffer != 0;
+}
+
+
+extern void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer);
+
+extern void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers);
+
+extern void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint array);
+
+extern void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *arrays);
+
+extern void
+_mesa_glthread_PushClientAttrib(struct gl_context *ctx, GLbitfield mask);
+
+extern void
+_mesa_glthread_PopClientAttrib(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_free_vaos(struct gl_context *ctx);
+
+
+/* marshal_generated.c */
+
+extern size_t
+_mesa_unmarshal_dispatch_cmd(struct gl_context *ctx, const void *cmd);
+
+extern struct _glapi_table *
+_mesa_create_marshal_table(const struct gl_context *ctx);
+
+
+#endif /* MARSHAL_H */
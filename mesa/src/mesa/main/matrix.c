@@ -68,7 +68,7 @@ _mesa_Frustum( GLdouble left, GLdouble right,
 {
    GET_CURRENT_CONTEXT(ctx);
 
-   FLUSH_VERTICES(ctx, 0);
+   FLUSH_VERTICES_DEFERRABLE(ctx, ctx->CurrentStack->DirtyFlag);
 
    if (nearval <= 0.0 ||
        farval <= 0.0 ||
@@ -111,7 +111,7 @@ _mesa_Ortho( GLdouble left, GLdouble right,
 {
    GET_CURRENT_CONTEXT(ctx);
 
-   FLUSH_VERTICES(ctx, 0);
+   FLUSH_VERTICES_DEFERRABLE(ctx, ctx->CurrentStack->DirtyFlag);
 
    if (MESA_VERBOSE & VERBOSE_API)
       _mesa_debug(ctx, "glOrtho(%f, %f, %f, %f, %f, %f)\n",
@@ -151,7 +151,9 @@ _mesa_MatrixMode( GLenum mode )
 
    if (ctx->Transform.MatrixMode == mode && mode != GL_TEXTURE)
       return;
-   FLUSH_VERTICES(ctx, _NEW_TRANSFORM);
+   /* Only selects the stack later calls operate on */
+   FLUSH_VERTICES_DEFERRABLE(ctx, 0);
+   ctx->NewState |= _NEW_TRANSFORM;
 
    switch (mode) {
    case GL_MODELVIEW:
@@ -266,7 +268,7 @@ _mesa_PopMatrix( void )
    GET_CURRENT_CONTEXT(ctx);
    struct gl_matrix_stack *stack = ctx->CurrentStack;
 
-   FLUSH_VERTICES(ctx, 0);
+   FLUSH_VERTICES_DEFERRABLE(ctx, stack->DirtyFlag);
 
    if (MESA_VERBOSE&VERBOSE_API)
       _mesa_debug(ctx, "glPopMatrix %s\n",
@@ -304,7 +306,7 @@ _mesa_LoadIdentity( void )
 {
    GET_CURRENT_CONTEXT(ctx);
 
-   FLUSH_VERTICES(ctx, 0);
+   FLUSH_VERTICES_DEFERRABLE(ctx, ctx->CurrentStack->DirtyFlag);
 
    if (MESA_VERBOSE & VERBOSE_API)
       _mesa_debug(ctx, "glLoadIdentity()\n");
@@ -338,7 +340,7 @@ _mesa_LoadMatrixf( const GLfloat *m )
           m[2], m[6], m[10], m[14],
           m[3], m[7], m[11], m[15]);
 
-   FLUSH_VERTICES(ctx, 0);
+   FLUSH_VERTICES_DEFERRABLE(ctx, ctx->CurrentStack->DirtyFlag);
    _math_matrix_loadf( ctx->CurrentStack->Top, m );
    ctx->NewState |= ctx->CurrentStack->DirtyFlag;
 }
@@ -368,7 +370,7 @@ _mesa_MultMatrixf( const GLfloat *m )
           m[2], m[6], m[10], m[14],
           m[3], m[7], m[11], m[15]);
 
-   FLUSH_VERTICES(ctx, 0);
+   FLUSH_VERTICES_DEFERRABLE(ctx, ctx->CurrentStack->DirtyFlag);
    _math_matrix_mul_floats( ctx->CurrentStack->Top, m );
    ctx->NewState |= ctx->CurrentStack->DirtyFlag;
 }
@@ -393,7 +395,7 @@ _mesa_Rotatef( GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
 {
    GET_CURRENT_CONTEXT(ctx);
 
-   FLUSH_VERTICES(ctx, 0);
+   FLUSH_VERTICES_DEFERRABLE(ctx, ctx->CurrentStack->DirtyFlag);
    if (angle != 0.0F) {
       _math_matrix_rotate( ctx->CurrentStack->Top, angle, x, y, z);
       ctx->NewState |= ctx->CurrentStack->DirtyFlag;
@@ -419,7 +421,7 @@ _mesa_Scalef( GLfloat x, GLfloat y, GLfloat z )
 {
    GET_CURRENT_CONTEXT(ctx);
 
-   FLUSH_VERTICES(ctx, 0);
+   FLUSH_VERTICES_DEFERRABLE(ctx, ctx->CurrentStack->DirtyFlag);
    _math_matrix_scale( ctx->CurrentStack->Top, x, y, z);
    ctx->NewState |= ctx->CurrentStack->DirtyFlag;
 }
@@ -443,7 +445,7 @@ _mesa_Translatef( GLfloat x, GLfloat y, GLfloat z )
 {
    GET_CURRENT_CONTEXT(ctx);
 
-   FLUSH_VERTICES(ctx, 0);
+   FLUSH_VERTICES_DEFERRABLE(ctx, ctx->CurrentStack->DirtyFlag);
    _math_matrix_translate( ctx->CurrentStack->Top, x, y, z);
    ctx->NewState |= ctx->CurrentStack->DirtyFlag;
 }
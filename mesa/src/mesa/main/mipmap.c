@@ -34,6 +34,7 @@
 #include "mtypes.h"
 #include "teximage.h"
 #include "texobj.h"
+#include "texstate.h"
 #include "texstore.h"
 #include "image.h"
 #include "macros.h"
@@ -1872,6 +1873,7 @@ _mesa_prepare_mipmap_level(struct gl_context *ctx,
          _mesa_update_fbo_texture(ctx, texObj, face, level);
 
          ctx->NewState |= _NEW_TEXTURE;
+         _mesa_dirty_texobj_units(ctx, texObj);
       }
    }
 
@@ -74,12 +74,14 @@ struct gl_meta_state;
 struct gl_program_cache;
 struct gl_texture_object;
 struct gl_context;
+struct glthread_state;
 struct st_context;
 struct gl_uniform_storage;
 struct prog_instruction;
 struct gl_program_parameter_list;
 struct set;
 struct set_entry;
+struct hash_table;
 /*@}*/
 
 
@@ -1353,6 +1355,13 @@ struct gl_texture_attrib
 
    /** Bitwise-OR of all Texture.Unit[i]._GenFlags */
    GLbitfield _GenFlags;
+
+   /**
+    * Bitset of the texture units whose texture object, sampler object or
+    * sampler related unit state may have changed.  Drivers which update
+    * their samplers per unit clear the bits of the units they updated.
+    */
+   GLuint _DirtyUnits[(MAX_COMBINED_TEXTURE_IMAGE_UNITS + 31) / 32];
 };
 
 
@@ -1415,6 +1424,14 @@ struct gl_buffer_object
    GLboolean DeletePending;   /**< true if buffer object is removed from the hash */
    GLboolean Written;   /**< Ever written to? (for debugging) */
    GLboolean Purgeable; /**< Is the buffer purgeable under memory pressure? */
+   GLboolean DeviceWritable; /**< Ever bound for transform feedback or packing */
+
+   /** Index ranges found in the buffer, see vbo_minmax_index.c */
+   /*@{*/
+   _glthread_Mutex MinMaxCacheMutex;
+   struct hash_table *MinMaxCache;
+   GLboolean MinMaxCacheDirty; /**< Contents changed since the last lookup */
+   /*@}*/
 };
 
 
@@ -1432,6 +1449,7 @@ struct gl_pixelstore_attrib
    GLboolean SwapBytes;
    GLboolean LsbFirst;
    GLboolean Invert;        /**< GL_MESA_pack_invert */
+   GLboolean ClientStorage; /**< GL_APPLE_client_storage */
    struct gl_buffer_object *BufferObj; /**< GL_ARB_pixel_buffer_object */
 };
 
@@ -3097,6 +3115,7 @@ struct gl_extensions
    /* vendor extensions */
    GLboolean AMD_seamless_cubemap_per_texture;
    GLboolean AMD_vertex_shader_layer;
+   GLboolean APPLE_client_storage;
    GLboolean APPLE_object_purgeable;
    GLboolean ATI_envmap_bumpmap;
    GLboolean ATI_texture_compression_3dc;
@@ -3441,8 +3460,18 @@ struct gl_context
     * re-set on glXMakeCurrent().
     */
    struct _glapi_table *CurrentDispatch;
+
+   /**
+    * The dispatch table installed in the application thread when threaded
+    * dispatch is enabled (see glthread.h).  It queues commands that the
+    * driver thread executes with CurrentDispatch.
+    */
+   struct _glapi_table *MarshalExec;
    /*@}*/
 
+   /** Threaded dispatch state, NULL unless enabled */
+   struct glthread_state *GLThread;
+
    struct gl_config Visual;
    struct gl_framebuffer *DrawBuffer;	/**< buffer for writing */
    struct gl_framebuffer *ReadBuffer;	/**< buffer for reading */
@@ -3623,6 +3652,13 @@ struct gl_context
 
    GLboolean RasterDiscard;  /**< GL_RASTERIZER_DISCARD */
 
+   /**
+    * If set (MESA_NO_ERROR), the dispatch table routes a few hot entry
+    * points to variants which skip error checking.  Invalid calls then
+    * have undefined results instead of raising GL errors.
+    */
+   GLboolean NoError;
+
    /**
     * \name Hooks for module contexts.  
     *
@@ -215,6 +215,14 @@ _mesa_PixelStorei( GLenum pname, GLint param )
 	    return;
 	 ctx->Unpack.Alignment = param;
 	 break;
+      case GL_UNPACK_CLIENT_STORAGE_APPLE:
+         if (!_mesa_is_desktop_gl(ctx) ||
+             !ctx->Extensions.APPLE_client_storage)
+            goto invalid_enum_error;
+         if (ctx->Unpack.ClientStorage == param)
+            return;
+         ctx->Unpack.ClientStorage = param ? GL_TRUE : GL_FALSE;
+         break;
       default:
          goto invalid_enum_error;
    }
@@ -262,6 +270,7 @@ _mesa_init_pixelstore( struct gl_context *ctx )
    ctx->Unpack.SwapBytes = GL_FALSE;
    ctx->Unpack.LsbFirst = GL_FALSE;
    ctx->Unpack.Invert = GL_FALSE;
+   ctx->Unpack.ClientStorage = GL_FALSE;
    _mesa_reference_buffer_object(ctx, &ctx->Unpack.BufferObj,
                                  ctx->Shared->NullBufferObj);
 
@@ -38,6 +38,7 @@
 #include "main/macros.h"
 #include "main/mtypes.h"
 #include "main/samplerobj.h"
+#include "main/texstate.h"
 
 
 struct gl_sampler_object *
@@ -215,6 +216,7 @@ _mesa_DeleteSamplers(GLsizei count, const GLuint *samplers)
             for (j = 0; j < ctx->Const.MaxCombinedTextureImageUnits; j++) {
                if (ctx->Texture.Unit[j].Sampler == sampObj) {
                   FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+                  _mesa_dirty_texture_unit(ctx, j);
                   _mesa_reference_sampler_object(ctx, &ctx->Texture.Unit[j].Sampler, NULL);
                }
             }
@@ -276,6 +278,7 @@ _mesa_BindSampler(GLuint unit, GLuint sampler)
    
    if (ctx->Texture.Unit[unit].Sampler != sampObj) {
       FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+      _mesa_dirty_texture_unit(ctx, unit);
    }
 
    /* bind new sampler */
@@ -317,9 +320,10 @@ validate_texture_wrap_mode(struct gl_context *ctx, GLenum wrap)
  * This is called just prior to changing any sampler object state.
  */
 static inline void
-flush(struct gl_context *ctx)
+flush(struct gl_context *ctx, const struct gl_sampler_object *samp)
 {
    FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+   _mesa_dirty_sampler_units(ctx, samp);
 }
 
 
@@ -334,7 +338,7 @@ set_sampler_wrap_s(struct gl_context *ctx, struct gl_sampler_object *samp,
    if (samp->WrapS == param)
       return GL_FALSE;
    if (validate_texture_wrap_mode(ctx, param)) {
-      flush(ctx);
+      flush(ctx, samp);
       samp->WrapS = param;
       return GL_TRUE;
    }
@@ -349,7 +353,7 @@ set_sampler_wrap_t(struct gl_context *ctx, struct gl_sampler_object *samp,
    if (samp->WrapT == param)
       return GL_FALSE;
    if (validate_texture_wrap_mode(ctx, param)) {
-      flush(ctx);
+      flush(ctx, samp);
       samp->WrapT = param;
       return GL_TRUE;
    }
@@ -364,7 +368,7 @@ set_sampler_wrap_r(struct gl_context *ctx, struct gl_sampler_object *samp,
    if (samp->WrapR == param)
       return GL_FALSE;
    if (validate_texture_wrap_mode(ctx, param)) {
-      flush(ctx);
+      flush(ctx, samp);
       samp->WrapR = param;
       return GL_TRUE;
    }
@@ -386,7 +390,7 @@ set_sampler_min_filter(struct gl_context *ctx, struct gl_sampler_object *samp,
    case GL_LINEAR_MIPMAP_NEAREST:
    case GL_NEAREST_MIPMAP_LINEAR:
    case GL_LINEAR_MIPMAP_LINEAR:
-      flush(ctx);
+      flush(ctx, samp);
       samp->MinFilter = param;
       return GL_TRUE;
    default:
@@ -405,7 +409,7 @@ set_sampler_mag_filter(struct gl_context *ctx, struct gl_sampler_object *samp,
    switch (param) {
    case GL_NEAREST:
    case GL_LINEAR:
-      flush(ctx);
+      flush(ctx, samp);
       samp->MagFilter = param;
       return GL_TRUE;
    default:
@@ -421,7 +425,7 @@ set_sampler_lod_bias(struct gl_context *ctx, struct gl_sampler_object *samp,
    if (samp->LodBias == param)
       return GL_FALSE;
 
-   flush(ctx);
+   flush(ctx, samp);
    samp->LodBias = param;
    return GL_TRUE;
 }
@@ -432,7 +436,7 @@ set_sampler_border_colorf(struct gl_context *ctx,
                           struct gl_sampler_object *samp,
                           const GLfloat params[4])
 {
-   flush(ctx);
+   flush(ctx, samp);
    samp->BorderColor.f[RCOMP] = params[0];
    samp->BorderColor.f[GCOMP] = params[1];
    samp->BorderColor.f[BCOMP] = params[2];
@@ -446,7 +450,7 @@ set_sampler_border_colori(struct gl_context *ctx,
                           struct gl_sampler_object *samp,
                           const GLint params[4])
 {
-   flush(ctx);
+   flush(ctx, samp);
    samp->BorderColor.i[RCOMP] = params[0];
    samp->BorderColor.i[GCOMP] = params[1];
    samp->BorderColor.i[BCOMP] = params[2];
@@ -460,7 +464,7 @@ set_sampler_border_colorui(struct gl_context *ctx,
                            struct gl_sampler_object *samp,
                            const GLuint params[4])
 {
-   flush(ctx);
+   flush(ctx, samp);
    samp->BorderColor.ui[RCOMP] = params[0];
    samp->BorderColor.ui[GCOMP] = params[1];
    samp->BorderColor.ui[BCOMP] = params[2];
@@ -476,7 +480,7 @@ set_sampler_min_lod(struct gl_context *ctx, struct gl_sampler_object *samp,
    if (samp->MinLod == param)
       return GL_FALSE;
 
-   flush(ctx);
+   flush(ctx, samp);
    samp->MinLod = param;
    return GL_TRUE;
 }
@@ -489,7 +493,7 @@ set_sampler_max_lod(struct gl_context *ctx, struct gl_sampler_object *samp,
    if (samp->MaxLod == param)
       return GL_FALSE;
 
-   flush(ctx);
+   flush(ctx, samp);
    samp->MaxLod = param;
    return GL_TRUE;
 }
@@ -507,7 +511,7 @@ set_sampler_compare_mode(struct gl_context *ctx,
 
    if (param == GL_NONE ||
        param == GL_COMPARE_R_TO_TEXTURE_ARB) {
-      flush(ctx);
+      flush(ctx, samp);
       samp->CompareMode = param;
       return GL_TRUE;
    }
@@ -535,7 +539,7 @@ set_sampler_compare_func(struct gl_context *ctx,
    case GL_GREATER:
    case GL_ALWAYS:
    case GL_NEVER:
-      flush(ctx);
+      flush(ctx, samp);
       samp->CompareFunc = param;
       return GL_TRUE;
    default:
@@ -557,7 +561,7 @@ set_sampler_max_anisotropy(struct gl_context *ctx,
    if (param < 1.0)
       return INVALID_VALUE;
 
-   flush(ctx);
+   flush(ctx, samp);
    /* clamp to max, that's what NVIDIA does */
    samp->MaxAnisotropy = MIN2(param, ctx->Const.MaxTextureMaxAnisotropy);
    return GL_TRUE;
@@ -577,7 +581,7 @@ set_sampler_cube_map_seamless(struct gl_context *ctx,
    if (param != GL_TRUE && param != GL_FALSE)
       return INVALID_VALUE;
 
-   flush(ctx);
+   flush(ctx, samp);
    samp->CubeMapSeamless = param;
    return GL_TRUE;
 }
@@ -595,7 +599,7 @@ set_sampler_srgb_decode(struct gl_context *ctx,
    if (param != GL_DECODE_EXT && param != GL_SKIP_DECODE_EXT)
       return INVALID_VALUE;
 
-   flush(ctx);
+   flush(ctx, samp);
    samp->sRGBDecode = param;
    return GL_TRUE;
 }
@@ -40,6 +40,7 @@
  */
 
 #include <gtest/gtest.h>
+#include <stdlib.h>
 
 extern "C" {
 #include "GL/gl.h"
@@ -48,6 +49,8 @@ extern "C" {
 #include "main/api_exec.h"
 #include "main/context.h"
 #include "main/remap.h"
+#include "main/texobj.h"
+#include "main/uniforms.h"
 #include "main/vtxfmt.h"
 #include "glapi/glapi.h"
 #include "drivers/common/driverfuncs.h"
@@ -197,6 +200,23 @@ TEST_F(DispatchSanity_test, GLES3)
    validate_nops(&ctx);
 }
 
+TEST_F(DispatchSanity_test, GLES2_NO_ERROR)
+{
+   setenv("MESA_NO_ERROR", "1", 1);
+   SetUpCtx(API_OPENGLES2, 20);
+   unsetenv("MESA_NO_ERROR");
+
+   ASSERT_TRUE(ctx.NoError);
+   EXPECT_EQ((_glapi_proc) _mesa_BindTexture_no_error,
+             (_glapi_proc) GET_BindTexture(ctx.Exec));
+   EXPECT_EQ((_glapi_proc) _mesa_Uniform4fv_no_error,
+             (_glapi_proc) GET_Uniform4fv(ctx.Exec));
+
+   /* The no-error variants replace entries, they don't add any. */
+   validate_functions(&ctx, gles2_functions_possible);
+   validate_nops(&ctx);
+}
+
 const struct function gl_core_functions_possible[] = {
    { "glCullFace", 10, -1 },
    { "glFrontFace", 10, -1 },
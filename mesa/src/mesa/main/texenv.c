@@ -470,6 +470,7 @@ _mesa_TexEnvfv( GLenum target, GLenum pname, const GLfloat *param )
 	 if (texUnit->LodBias == param[0])
 	    return;
 	 FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+         _mesa_dirty_texture_unit(ctx, ctx->Texture.CurrentUnit);
          texUnit->LodBias = param[0];
       }
       else {
@@ -3333,6 +3333,7 @@ texsubimage(struct gl_context *ctx, GLuint dims, GLenum target, GLint level,
          check_gen_mipmap(ctx, target, texObj, level);
 
          ctx->NewState |= _NEW_TEXTURE;
+         _mesa_dirty_texobj_units(ctx, texObj);
       }
    }
    _mesa_unlock_texture(ctx, texObj);
@@ -3620,6 +3621,7 @@ copytexsubimage(struct gl_context *ctx, GLuint dims, GLenum target, GLint level,
          check_gen_mipmap(ctx, target, texObj, level);
 
          ctx->NewState |= _NEW_TEXTURE;
+         _mesa_dirty_texobj_units(ctx, texObj);
       }
    }
    _mesa_unlock_texture(ctx, texObj);
@@ -3845,6 +3847,7 @@ compressed_tex_sub_image(GLuint dims, GLenum target, GLint level,
          check_gen_mipmap(ctx, target, texObj, level);
 
          ctx->NewState |= _NEW_TEXTURE;
+         _mesa_dirty_texobj_units(ctx, texObj);
       }
    }
    _mesa_unlock_texture(ctx, texObj);
@@ -724,8 +724,10 @@ _mesa_dirty_texobj(struct gl_context *ctx, struct gl_texture_object *texObj,
 {
    texObj->_BaseComplete = GL_FALSE;
    texObj->_MipmapComplete = GL_FALSE;
-   if (invalidate_state)
+   if (invalidate_state) {
       ctx->NewState |= _NEW_TEXTURE;
+      _mesa_dirty_texobj_units(ctx, texObj);
+   }
 }
 
 
@@ -1141,6 +1143,7 @@ _mesa_DeleteTextures( GLsizei n, const GLuint *textures)
             /* Check if this texture is currently bound to any texture units.
              * If so, unbind it.
              */
+            _mesa_dirty_texobj_units(ctx, delObj);
             unbind_texobj_from_texunits(ctx, delObj);
 
             _mesa_unlock_texture(ctx, delObj);
@@ -1221,6 +1224,7 @@ target_enum_to_index(struct gl_context *ctx, GLenum target)
 /**
  * Bind a named texture to a texturing target.
  * 
+ * \param ctx GL context.
  * \param target texture target.
  * \param texName texture name.
  * 
@@ -1233,10 +1237,10 @@ target_enum_to_index(struct gl_context *ctx, GLenum target)
  * calls dd_function_table::BindTexture. Decrements the old texture reference
  * count and deletes it if it reaches zero.
  */
-void GLAPIENTRY
-_mesa_BindTexture( GLenum target, GLuint texName )
+static inline void
+bind_texture(struct gl_context *ctx, GLenum target, GLuint texName,
+             bool no_error)
 {
-   GET_CURRENT_CONTEXT(ctx);
    struct gl_texture_unit *texUnit = _mesa_get_current_tex_unit(ctx);
    struct gl_texture_object *newTexObj = NULL;
    GLint targetIndex;
@@ -1246,11 +1250,19 @@ _mesa_BindTexture( GLenum target, GLuint texName )
                   _mesa_lookup_enum_by_nr(target), (GLint) texName);
 
    targetIndex = target_enum_to_index(ctx, target);
-   if (targetIndex < 0) {
+   if (!no_error && targetIndex < 0) {
       _mesa_error(ctx, GL_INVALID_ENUM, "glBindTexture(target)");
       return;
    }
-   assert(targetIndex < NUM_TEXTURE_TARGETS);
+   assert(targetIndex >= 0 && targetIndex < NUM_TEXTURE_TARGETS);
+
+   /* Rebinding the texture that is already bound needs no lookup, as long
+    * as no other context could have deleted it in the meantime.
+    */
+   if (texName != 0 &&
+       texUnit->CurrentTex[targetIndex]->Name == texName &&
+       ctx->Shared->RefCount == 1)
+      return;
 
    /*
     * Get pointer to new texture object (newTexObj)
@@ -1264,7 +1276,8 @@ _mesa_BindTexture( GLenum target, GLuint texName )
       newTexObj = _mesa_lookup_texture(ctx, texName);
       if (newTexObj) {
          /* error checking */
-         if (newTexObj->Target != 0 && newTexObj->Target != target) {
+         if (!no_error &&
+             newTexObj->Target != 0 && newTexObj->Target != target) {
             /* the named texture object's target doesn't match the given target */
             _mesa_error( ctx, GL_INVALID_OPERATION,
                          "glBindTexture(target mismatch)" );
@@ -1275,7 +1288,7 @@ _mesa_BindTexture( GLenum target, GLuint texName )
          }
       }
       else {
-         if (ctx->API == API_OPENGL_CORE) {
+         if (!no_error && ctx->API == API_OPENGL_CORE) {
             _mesa_error(ctx, GL_INVALID_OPERATION, "glBindTexture(non-gen name)");
             return;
          }
@@ -1313,6 +1326,7 @@ _mesa_BindTexture( GLenum target, GLuint texName )
 
    /* flush before changing binding */
    FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+   _mesa_dirty_texture_unit(ctx, ctx->Texture.CurrentUnit);
 
    /* Do the actual binding.  The refcount on the previously bound
     * texture object will be decremented.  It'll be deleted if the
@@ -1327,6 +1341,27 @@ _mesa_BindTexture( GLenum target, GLuint texName )
 }
 
 
+void GLAPIENTRY
+_mesa_BindTexture( GLenum target, GLuint texName )
+{
+   GET_CURRENT_CONTEXT(ctx);
+   bind_texture(ctx, target, texName, false);
+}
+
+
+/**
+ * glBindTexture() variant for the MESA_NO_ERROR dispatch table.  The target
+ * and name are assumed to be valid, so the enum and target match checks
+ * are skipped.
+ */
+void GLAPIENTRY
+_mesa_BindTexture_no_error( GLenum target, GLuint texName )
+{
+   GET_CURRENT_CONTEXT(ctx);
+   bind_texture(ctx, target, texName, true);
+}
+
+
 /**
  * Set texture priorities.
  * 
@@ -1471,7 +1506,9 @@ _mesa_lock_context_textures( struct gl_context *ctx )
    _glthread_LOCK_MUTEX(ctx->Shared->TexMutex);
 
    if (ctx->Shared->TextureStateStamp != ctx->TextureStateTimestamp) {
+      /* some texture was changed by another context */
       ctx->NewState |= _NEW_TEXTURE;
+      _mesa_dirty_all_texture_units(ctx);
       ctx->TextureStateTimestamp = ctx->Shared->TextureStateStamp;
    }
 }
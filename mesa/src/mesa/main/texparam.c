@@ -239,9 +239,10 @@ set_swizzle_component(GLuint *swizzle, GLuint comp, GLuint swz)
  * will not effect texture completeness.
  */
 static inline void
-flush(struct gl_context *ctx)
+flush(struct gl_context *ctx, const struct gl_texture_object *texObj)
 {
    FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+   _mesa_dirty_texobj_units(ctx, texObj);
 }
 
 
@@ -293,7 +294,7 @@ set_tex_parameteri(struct gl_context *ctx,
       switch (params[0]) {
       case GL_NEAREST:
       case GL_LINEAR:
-         flush(ctx);
+         flush(ctx, texObj);
          texObj->Sampler.MinFilter = params[0];
          return GL_TRUE;
       case GL_NEAREST_MIPMAP_NEAREST:
@@ -302,7 +303,7 @@ set_tex_parameteri(struct gl_context *ctx,
       case GL_LINEAR_MIPMAP_LINEAR:
          if (texObj->Target != GL_TEXTURE_RECTANGLE_NV &&
              texObj->Target != GL_TEXTURE_EXTERNAL_OES) {
-            flush(ctx);
+            flush(ctx, texObj);
             texObj->Sampler.MinFilter = params[0];
             return GL_TRUE;
          }
@@ -321,7 +322,7 @@ set_tex_parameteri(struct gl_context *ctx,
       switch (params[0]) {
       case GL_NEAREST:
       case GL_LINEAR:
-         flush(ctx); /* does not effect completeness */
+         flush(ctx, texObj); /* does not effect completeness */
          texObj->Sampler.MagFilter = params[0];
          return GL_TRUE;
       default:
@@ -336,7 +337,7 @@ set_tex_parameteri(struct gl_context *ctx,
       if (texObj->Sampler.WrapS == params[0])
          return GL_FALSE;
       if (validate_texture_wrap_mode(ctx, texObj->Target, params[0])) {
-         flush(ctx);
+         flush(ctx, texObj);
          texObj->Sampler.WrapS = params[0];
          return GL_TRUE;
       }
@@ -349,7 +350,7 @@ set_tex_parameteri(struct gl_context *ctx,
       if (texObj->Sampler.WrapT == params[0])
          return GL_FALSE;
       if (validate_texture_wrap_mode(ctx, texObj->Target, params[0])) {
-         flush(ctx);
+         flush(ctx, texObj);
          texObj->Sampler.WrapT = params[0];
          return GL_TRUE;
       }
@@ -362,7 +363,7 @@ set_tex_parameteri(struct gl_context *ctx,
       if (texObj->Sampler.WrapR == params[0])
          return GL_FALSE;
       if (validate_texture_wrap_mode(ctx, texObj->Target, params[0])) {
-         flush(ctx);
+         flush(ctx, texObj);
          texObj->Sampler.WrapR = params[0];
          return GL_TRUE;
       }
@@ -426,7 +427,7 @@ set_tex_parameteri(struct gl_context *ctx,
             return GL_FALSE;
          if (params[0] == GL_NONE ||
              params[0] == GL_COMPARE_R_TO_TEXTURE_ARB) {
-            flush(ctx);
+            flush(ctx, texObj);
             texObj->Sampler.CompareMode = params[0];
             return GL_TRUE;
          }
@@ -452,7 +453,7 @@ set_tex_parameteri(struct gl_context *ctx,
          case GL_GREATER:
          case GL_ALWAYS:
          case GL_NEVER:
-            flush(ctx);
+            flush(ctx, texObj);
             texObj->Sampler.CompareFunc = params[0];
             return GL_TRUE;
          default:
@@ -472,7 +473,7 @@ set_tex_parameteri(struct gl_context *ctx,
              params[0] == GL_INTENSITY ||
              params[0] == GL_ALPHA ||
              (ctx->Extensions.ARB_texture_rg && params[0] == GL_RED)) {
-            flush(ctx);
+            flush(ctx, texObj);
             texObj->DepthMode = params[0];
             return GL_TRUE;
          }
@@ -505,7 +506,7 @@ set_tex_parameteri(struct gl_context *ctx,
          }
          ASSERT(comp < 4);
 
-         flush(ctx);
+         flush(ctx, texObj);
          texObj->Swizzle[comp] = params[0];
          set_swizzle_component(&texObj->_Swizzle, comp, swz);
          return GL_TRUE;
@@ -516,7 +517,7 @@ set_tex_parameteri(struct gl_context *ctx,
       if ((_mesa_is_desktop_gl(ctx) && ctx->Extensions.EXT_texture_swizzle)
           || _mesa_is_gles3(ctx)) {
          GLuint comp;
-         flush(ctx);
+         flush(ctx, texObj);
          for (comp = 0; comp < 4; comp++) {
             const GLint swz = comp_to_swizzle(params[comp]);
             if (swz >= 0) {
@@ -543,7 +544,7 @@ set_tex_parameteri(struct gl_context *ctx,
 
 	 if (decode == GL_DECODE_EXT || decode == GL_SKIP_DECODE_EXT) {
 	    if (texObj->Sampler.sRGBDecode != decode) {
-	       flush(ctx);
+	       flush(ctx, texObj);
 	       texObj->Sampler.sRGBDecode = decode;
 	    }
 	    return GL_TRUE;
@@ -563,7 +564,7 @@ set_tex_parameteri(struct gl_context *ctx,
             goto invalid_param;
          }
          if (param != texObj->Sampler.CubeMapSeamless) {
-            flush(ctx);
+            flush(ctx, texObj);
             texObj->Sampler.CubeMapSeamless = param;
          }
          return GL_TRUE;
@@ -610,7 +611,7 @@ set_tex_parameterf(struct gl_context *ctx,
 
       if (texObj->Sampler.MinLod == params[0])
          return GL_FALSE;
-      flush(ctx);
+      flush(ctx, texObj);
       texObj->Sampler.MinLod = params[0];
       return GL_TRUE;
 
@@ -623,7 +624,7 @@ set_tex_parameterf(struct gl_context *ctx,
 
       if (texObj->Sampler.MaxLod == params[0])
          return GL_FALSE;
-      flush(ctx);
+      flush(ctx, texObj);
       texObj->Sampler.MaxLod = params[0];
       return GL_TRUE;
 
@@ -631,7 +632,7 @@ set_tex_parameterf(struct gl_context *ctx,
       if (ctx->API != API_OPENGL_COMPAT)
          goto invalid_pname;
 
-      flush(ctx);
+      flush(ctx, texObj);
       texObj->Priority = CLAMP(params[0], 0.0F, 1.0F);
       return GL_TRUE;
 
@@ -646,7 +647,7 @@ set_tex_parameterf(struct gl_context *ctx,
             _mesa_error(ctx, GL_INVALID_VALUE, "glTexParameter(param)" );
             return GL_FALSE;
          }
-         flush(ctx);
+         flush(ctx, texObj);
          /* clamp to max, that's what NVIDIA does */
          texObj->Sampler.MaxAnisotropy = MIN2(params[0],
                                       ctx->Const.MaxTextureMaxAnisotropy);
@@ -668,7 +669,7 @@ set_tex_parameterf(struct gl_context *ctx,
          goto invalid_operation;
 
       if (texObj->Sampler.LodBias != params[0]) {
-	 flush(ctx);
+	 flush(ctx, texObj);
 	 texObj->Sampler.LodBias = params[0];
 	 return GL_TRUE;
       }
@@ -681,7 +682,7 @@ set_tex_parameterf(struct gl_context *ctx,
       if (!target_allows_setting_sampler_parameters(texObj->Target))
          goto invalid_operation;
 
-      flush(ctx);
+      flush(ctx, texObj);
       /* ARB_texture_float disables clamping */
       if (ctx->Extensions.ARB_texture_float) {
          texObj->Sampler.BorderColor.f[RCOMP] = params[0];
@@ -955,7 +956,7 @@ _mesa_TexParameterIiv(GLenum target, GLenum pname, const GLint *params)
 
    switch (pname) {
    case GL_TEXTURE_BORDER_COLOR:
-      FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+      flush(ctx, texObj);
       /* set the integer-valued border color */
       COPY_4V(texObj->Sampler.BorderColor.i, params);
       break;
@@ -984,7 +985,7 @@ _mesa_TexParameterIuiv(GLenum target, GLenum pname, const GLuint *params)
 
    switch (pname) {
    case GL_TEXTURE_BORDER_COLOR:
-      FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+      flush(ctx, texObj);
       /* set the unsigned integer-valued border color */
       COPY_4V(texObj->Sampler.BorderColor.ui, params);
       break;
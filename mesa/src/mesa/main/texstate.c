@@ -72,6 +72,7 @@ _mesa_copy_texture_state( const struct gl_context *src, struct gl_context *dst )
 
    dst->Texture.CurrentUnit = src->Texture.CurrentUnit;
    dst->Texture._GenFlags = src->Texture._GenFlags;
+   _mesa_dirty_all_texture_units(dst);
    dst->Texture._TexGenEnabled = src->Texture._TexGenEnabled;
    dst->Texture._TexMatEnabled = src->Texture._TexMatEnabled;
 
@@ -114,6 +115,50 @@ _mesa_copy_texture_state( const struct gl_context *src, struct gl_context *dst )
 }
 
 
+/**
+ * Flag the sampler and texture state of all texture units as changed.
+ */
+void
+_mesa_dirty_all_texture_units(struct gl_context *ctx)
+{
+   BITSET_ONES(ctx->Texture._DirtyUnits);
+}
+
+
+/**
+ * Flag the texture units which currently use the given texture object as
+ * changed.  Units where it only becomes complete later are flagged when
+ * their _Current texture changes.
+ */
+void
+_mesa_dirty_texobj_units(struct gl_context *ctx,
+                         const struct gl_texture_object *texObj)
+{
+   GLuint u;
+
+   for (u = 0; u < ctx->Const.MaxCombinedTextureImageUnits; u++) {
+      if (ctx->Texture.Unit[u]._Current == texObj)
+         _mesa_dirty_texture_unit(ctx, u);
+   }
+}
+
+
+/**
+ * Flag the texture units the given sampler object is bound to as changed.
+ */
+void
+_mesa_dirty_sampler_units(struct gl_context *ctx,
+                          const struct gl_sampler_object *sampObj)
+{
+   GLuint u;
+
+   for (u = 0; u < ctx->Const.MaxCombinedTextureImageUnits; u++) {
+      if (ctx->Texture.Unit[u].Sampler == sampObj)
+         _mesa_dirty_texture_unit(ctx, u);
+   }
+}
+
+
 /*
  * For debugging
  */
@@ -609,6 +654,8 @@ update_texture_state( struct gl_context *ctx )
             }
             if (_mesa_is_texture_complete(texObj, sampler)) {
                texUnit->_ReallyEnabled = 1 << texIndex;
+               if (texUnit->_Current != texObj)
+                  _mesa_dirty_texture_unit(ctx, unit);
                _mesa_reference_texobj(&texUnit->_Current, texObj);
                break;
             }
@@ -635,6 +682,8 @@ update_texture_state( struct gl_context *ctx )
                continue;
             }
 
+            if (texUnit->_Current != texObj)
+               _mesa_dirty_texture_unit(ctx, unit);
             _mesa_reference_texobj(&texUnit->_Current, texObj);
             texUnit->_ReallyEnabled = 1 << texTarget;
          }
@@ -803,6 +852,7 @@ _mesa_init_texture(struct gl_context *ctx)
    /* Texture group */
    ctx->Texture.CurrentUnit = 0;      /* multitexture */
    ctx->Texture._EnabledUnits = 0x0;
+   _mesa_dirty_all_texture_units(ctx);
 
    for (u = 0; u < Elements(ctx->Texture.Unit); u++)
       init_texture_unit(ctx, u);
@@ -33,6 +33,7 @@
 
 
 #include "compiler.h"
+#include "bitset.h"
 #include "mtypes.h"
 
 
@@ -55,6 +56,28 @@ extern void
 _mesa_print_texunit_state( struct gl_context *ctx, GLuint unit );
 
 
+/**
+ * Flag the sampler and texture state of a texture unit as changed.
+ * See gl_texture_attrib::_DirtyUnits.
+ */
+static inline void
+_mesa_dirty_texture_unit(struct gl_context *ctx, GLuint unit)
+{
+   BITSET_SET(ctx->Texture._DirtyUnits, unit);
+}
+
+extern void
+_mesa_dirty_all_texture_units(struct gl_context *ctx);
+
+extern void
+_mesa_dirty_texobj_units(struct gl_context *ctx,
+                         const struct gl_texture_object *texObj);
+
+extern void
+_mesa_dirty_sampler_units(struct gl_context *ctx,
+                          const struct gl_sampler_object *sampObj);
+
+
 
 /**
  * \name Called from API
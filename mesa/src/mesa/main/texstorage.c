@@ -37,6 +37,7 @@
 #include "macros.h"
 #include "teximage.h"
 #include "texobj.h"
+#include "texstate.h"
 #include "texstorage.h"
 #include "mtypes.h"
 
@@ -431,6 +432,7 @@ texstorage(GLuint dims, GLenum target, GLsizei levels, GLenum internalformat,
 
       texObj->Immutable = GL_TRUE;
       texObj->ImmutableLevels = levels;
+      _mesa_dirty_texobj_units(ctx, texObj);
    }
 }
 
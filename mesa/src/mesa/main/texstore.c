@@ -1529,7 +1529,44 @@ _mesa_texstore_argb2101010(TEXSTORE_PARAMS)
           dstFormat == MESA_FORMAT_XRGB2101010_UNORM);
    ASSERT(_mesa_get_format_bytes(dstFormat) == 4);
 
-   {
+   if (!ctx->_ImageTransferState &&
+       !srcPacking->SwapBytes &&
+       _mesa_little_endian() &&
+       baseInternalFormat == GL_RGBA &&
+       (srcFormat == GL_RGBA || srcFormat == GL_BGRA) &&
+       srcType == GL_UNSIGNED_INT_2_10_10_10_REV) {
+      /* 10 bit channels which only need reordering: skip the float
+       * round trip and swap red and blue in place.
+       */
+      const GLint srcRowStride =
+         _mesa_image_row_stride(srcPacking, srcWidth, srcFormat, srcType);
+      GLint img, row, col;
+
+      for (img = 0; img < srcDepth; img++) {
+         GLubyte *dstRow = dstSlices[img];
+         const GLubyte *srcRow = (const GLubyte *)
+            _mesa_image_address(dims, srcPacking, srcAddr, srcWidth,
+                                srcHeight, srcFormat, srcType, img, 0, 0);
+         for (row = 0; row < srcHeight; row++) {
+            const GLuint *srcUI = (const GLuint *) srcRow;
+            GLuint *dstUI = (GLuint *) dstRow;
+            if (srcFormat == GL_BGRA) {
+               memcpy(dstUI, srcUI, srcWidth * sizeof(GLuint));
+            }
+            else {
+               for (col = 0; col < srcWidth; col++) {
+                  GLuint p = srcUI[col];
+                  dstUI[col] = (p & 0xc00ffc00) |
+                               ((p & 0x3ff) << 20) |
+                               ((p >> 20) & 0x3ff);
+               }
+            }
+            dstRow += dstRowStride;
+            srcRow += srcRowStride;
+         }
+      }
+   }
+   else {
       /* general path */
       /* Hardcode GL_RGBA as the base format, which forces alpha to 1.0
        * if the internal format is RGB. */
@@ -464,6 +464,9 @@ bind_buffer_range(struct gl_context *ctx, GLuint index,
 
    obj->BufferNames[index] = bufObj->Name;
 
+   /* the buffer contents now change behind the API's back */
+   bufObj->DeviceWritable = GL_TRUE;
+
    obj->Offset[index] = offset;
    obj->RequestedSize[index] = size;
 }
@@ -511,6 +511,15 @@ _mesa_propagate_uniforms_to_driver_storage(struct gl_uniform_storage *uni,
 	 unsigned j;
 	 unsigned v;
 
+	 /* Tightly packed storage, such as arrays of vec4 or mat4 laid out
+	  * in the parameter list, takes a single copy.
+	  */
+	 if (store->vector_stride == src_vector_byte_stride &&
+	     extra_stride == 0) {
+	    memcpy(dst, src, src_vector_byte_stride * vectors * count);
+	    break;
+	 }
+
 	 for (j = 0; j < count; j++) {
 	    for (v = 0; v < vectors; v++) {
 	       memcpy(dst, src, src_vector_byte_stride);
@@ -573,6 +582,37 @@ _mesa_propagate_uniforms_to_driver_storage(struct gl_uniform_storage *uni,
    }
 }
 
+/**
+ * Note that the values of \c uni in the parameter lists of the linked
+ * shader stages have changed, so that only the stages that actually use the
+ * uniform get their constants uploaded again.
+ */
+static void
+flag_parameter_values_changed(struct gl_shader_program *shProg,
+			      const struct gl_uniform_storage *uni)
+{
+   for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
+      struct gl_shader *const sh = shProg->_LinkedShaders[i];
+
+      if (sh == NULL || sh->Program == NULL || sh->Program->Parameters == NULL)
+	 continue;
+
+      struct gl_program_parameter_list *const params = sh->Program->Parameters;
+      const uint8_t *const begin = (uint8_t *) params->ParameterValues;
+      const uint8_t *const end =
+	 begin + params->NumParameters * sizeof(params->ParameterValues[0]);
+
+      for (unsigned j = 0; j < uni->num_driver_storage; j++) {
+	 const uint8_t *const data = (uint8_t *) uni->driver_storage[j].data;
+
+	 if (data >= begin && data < end) {
+	    params->ValuesSerial++;
+	    break;
+	 }
+      }
+   }
+}
+
 /**
  * Called via glUniform*() functions.
  */
@@ -740,6 +780,17 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
       count = MIN2(count, (int) (uni->array_elements - offset));
    }
 
+   /* Applications often set uniforms to the values they already have.  Skip
+    * those, so that the constants of every stage aren't flushed and uploaded
+    * again.  Samplers and booleans go the long way.
+    */
+   if (!uni->type->is_sampler() && !uni->type->is_boolean() &&
+       memcmp(&uni->storage[components * offset], values,
+	      sizeof(uni->storage[0]) * components * count) == 0) {
+      uni->initialized = true;
+      return;
+   }
+
    FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
 
    /* Store the data in the "actual type" backing storage for the uniform.
@@ -766,6 +817,7 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
    uni->initialized = true;
 
    _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+   flag_parameter_values_changed(shProg, uni);
 
    /* If the uniform is a sampler, do the extra magic necessary to propagate
     * the changes through.
@@ -822,6 +874,58 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
    }
 }
 
+/**
+ * Called by glUniform*() functions when the context was created with
+ * MESA_NO_ERROR.  The program, location, count and type are assumed to be
+ * valid, so plain vector uniforms are stored without any checking.
+ * Samplers and booleans, which need more than a copy, and uniform logging
+ * go through _mesa_uniform().
+ */
+extern "C" void
+_mesa_uniform_no_error(struct gl_context *ctx,
+                       struct gl_shader_program *shProg,
+                       GLint location, GLsizei count,
+                       const GLvoid *values, GLenum type)
+{
+   unsigned loc, offset;
+   unsigned components;
+   struct gl_uniform_storage *uni;
+
+   if (location == -1)
+      return;
+
+   _mesa_uniform_split_location_offset(shProg, location, &loc, &offset);
+   uni = &shProg->UniformStorage[loc];
+
+   if (uni->type->is_sampler() || uni->type->is_boolean() ||
+       (ctx->Shader.Flags & GLSL_UNIFORMS)) {
+      _mesa_uniform(ctx, shProg, location, count, values, type);
+      return;
+   }
+
+   components = uni->type->vector_elements;
+
+   if (uni->array_elements != 0) {
+      count = MIN2(count, (int) (uni->array_elements - offset));
+   }
+
+   if (memcmp(&uni->storage[components * offset], values,
+	      sizeof(uni->storage[0]) * components * count) == 0) {
+      uni->initialized = true;
+      return;
+   }
+
+   FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
+
+   memcpy(&uni->storage[components * offset], values,
+	  sizeof(uni->storage[0]) * components * count);
+
+   uni->initialized = true;
+
+   _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+   flag_parameter_values_changed(shProg, uni);
+}
+
 /**
  * Called by glUniformMatrix*() functions.
  * Note: cols=2, rows=4  ==>  array[2] of vec4
@@ -893,11 +997,19 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
       count = MIN2(count, (int) (uni->array_elements - offset));
    }
 
+   elements = components * vectors;
+
+   if (!transpose &&
+       memcmp(&uni->storage[elements * offset], values,
+	      sizeof(uni->storage[0]) * elements * count) == 0) {
+      uni->initialized = true;
+      return;
+   }
+
    FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
 
    /* Store the data in the "actual type" backing storage for the uniform.
     */
-   elements = components * vectors;
 
    if (!transpose) {
       memcpy(&uni->storage[elements * offset], values,
@@ -923,6 +1035,7 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
    uni->initialized = true;
 
    _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+   flag_parameter_values_changed(shProg, uni);
 }
 
 
@@ -242,6 +242,16 @@ _mesa_Uniform4fv(GLint location, GLsizei count, const GLfloat * value)
    _mesa_uniform(ctx, ctx->Shader.ActiveProgram, location, count, value, GL_FLOAT_VEC4);
 }
 
+/** glUniform4fv() variant for the MESA_NO_ERROR dispatch table */
+void GLAPIENTRY
+_mesa_Uniform4fv_no_error(GLint location, GLsizei count,
+                          const GLfloat * value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_no_error(ctx, ctx->Shader.ActiveProgram, location, count,
+                          value, GL_FLOAT_VEC4);
+}
+
 void GLAPIENTRY
 _mesa_Uniform1iv(GLint location, GLsizei count, const GLint * value)
 {
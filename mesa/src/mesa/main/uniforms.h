@@ -64,6 +64,8 @@ _mesa_Uniform3fv(GLint, GLsizei, const GLfloat *);
 void GLAPIENTRY
 _mesa_Uniform4fv(GLint, GLsizei, const GLfloat *);
 void GLAPIENTRY
+_mesa_Uniform4fv_no_error(GLint, GLsizei, const GLfloat *);
+void GLAPIENTRY
 _mesa_Uniform1iv(GLint, GLsizei, const GLint *);
 void GLAPIENTRY
 _mesa_Uniform2iv(GLint, GLsizei, const GLint *);
@@ -181,6 +183,12 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shader_program,
 	      GLint location, GLsizei count,
               const GLvoid *values, GLenum type);
 
+void
+_mesa_uniform_no_error(struct gl_context *ctx,
+                       struct gl_shader_program *shProg,
+                       GLint location, GLsizei count,
+                       const GLvoid *values, GLenum type);
+
 void
 _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
 		     GLuint cols, GLuint rows,
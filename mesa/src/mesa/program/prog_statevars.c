@@ -671,7 +671,8 @@ _mesa_program_state_flags(const gl_state_index state[STATE_LENGTH])
 
    case STATE_FRAGMENT_PROGRAM:
    case STATE_VERTEX_PROGRAM:
-      return _NEW_PROGRAM;
+      /* env and local parameters are set with _NEW_PROGRAM_CONSTANTS */
+      return _NEW_PROGRAM | _NEW_PROGRAM_CONSTANTS;
 
    case STATE_NORMAL_SCALE:
       return _NEW_MODELVIEW;
@@ -28,13 +28,17 @@
 
 #include "main/glheader.h"
 #include "main/context.h"
+#include "main/bitset.h"
 
 #include "pipe/p_defines.h"
+#include "os/os_time.h"
+#include "util/u_debug.h"
 #include "st_context.h"
 #include "st_atom.h"
 #include "st_cb_bitmap.h"
 #include "st_program.h"
 #include "st_manager.h"
+#include "st_texture_threads.h"
 
 
 /**
@@ -73,15 +77,50 @@ static const struct st_tracked_state *atoms[] =
 };
 
 
+/**
+ * Per-atom cost accounting, enabled with ST_ATOM_STATS=1.
+ */
+struct st_atom_stats
+{
+   uint64_t validations;
+   uint64_t calls[Elements(atoms)];
+   int64_t nsecs[Elements(atoms)];
+};
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(atom_stats, "ST_ATOM_STATS", FALSE)
+
+
 void st_init_atoms( struct st_context *st )
 {
-   /* no-op */
+   if (debug_get_option_atom_stats())
+      st->atom_stats = CALLOC_STRUCT(st_atom_stats);
 }
 
 
 void st_destroy_atoms( struct st_context *st )
 {
-   /* no-op */
+   struct st_atom_stats *stats = st->atom_stats;
+   GLuint i;
+
+   if (!stats)
+      return;
+
+   debug_printf("st: %llu state validations\n",
+                (unsigned long long) stats->validations);
+   debug_printf("%-32s %12s %12s %10s\n", "atom", "calls", "total us",
+                "avg ns");
+   for (i = 0; i < Elements(atoms); i++) {
+      if (!stats->calls[i])
+         continue;
+      debug_printf("%-32s %12llu %12llu %10llu\n", atoms[i]->name,
+                   (unsigned long long) stats->calls[i],
+                   (unsigned long long) (stats->nsecs[i] / 1000),
+                   (unsigned long long) (stats->nsecs[i] / stats->calls[i]));
+   }
+
+   free(stats);
+   st->atom_stats = NULL;
 }
 
 
@@ -154,6 +193,9 @@ void st_validate_state( struct st_context *st )
    struct st_state_flags *state = &st->dirty;
    GLuint i;
 
+   /* Textures may be sampled or rendered to. */
+   st_wait_texture_uploads(st);
+
    /* Get Mesa driver state. */
    st->dirty.st |= st->ctx->NewDriverState;
    st->ctx->NewDriverState = 0;
@@ -215,6 +257,19 @@ void st_validate_state( struct st_context *st )
       /*printf("\n");*/
 
    }
+   else if (st->atom_stats) {
+      struct st_atom_stats *stats = st->atom_stats;
+
+      stats->validations++;
+      for (i = 0; i < Elements(atoms); i++) {
+	 if (check_state(state, &atoms[i]->dirty)) {
+	    int64_t start = os_time_get_nano();
+	    atoms[i]->update( st );
+	    stats->nsecs[i] += os_time_get_nano() - start;
+	    stats->calls[i]++;
+	 }
+      }
+   }
    else {
       for (i = 0; i < Elements(atoms); i++) {	 
 	 if (check_state(state, &atoms[i]->dirty))
@@ -222,6 +277,10 @@ void st_validate_state( struct st_context *st )
       }
    }
 
+   /* The sampler and texture atoms have seen the dirty texture units */
+   if (state->mesa & _NEW_TEXTURE)
+      BITSET_ZERO(st->ctx->Texture._DirtyUnits);
+
    memset(state, 0, sizeof(*state));
 }
 
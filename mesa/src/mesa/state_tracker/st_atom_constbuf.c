@@ -102,6 +102,7 @@ void st_upload_constants( struct st_context *st,
 
       st->state.constants[shader_type].ptr = params->ParameterValues;
       st->state.constants[shader_type].size = paramBytes;
+      st->state.constants[shader_type].serial = params->ValuesSerial;
    }
    else if (st->state.constants[shader_type].ptr) {
       /* Unbind. */
@@ -112,6 +113,32 @@ void st_upload_constants( struct st_context *st,
 }
 
 
+/**
+ * _NEW_PROGRAM_CONSTANTS is raised for every glUniform call, whichever
+ * stage uses the uniform.  Check whether the constants of this stage really
+ * need to be uploaded again: the program or its parameter storage changed,
+ * some fixed-function state it references changed, or glUniform wrote to
+ * its parameters since the last upload.
+ */
+static GLboolean
+constants_changed(const struct st_context *st,
+                  const struct gl_program_parameter_list *params,
+                  unsigned shader_type, GLuint new_program)
+{
+   if ((st->dirty.st & new_program) ||
+       !params ||
+       st->state.constants[shader_type].ptr != params->ParameterValues ||
+       st->state.constants[shader_type].size !=
+          params->NumParameters * sizeof(GLfloat) * 4)
+      return GL_TRUE;
+
+   if (st->dirty.mesa & params->StateFlags)
+      return GL_TRUE;
+
+   return st->state.constants[shader_type].serial != params->ValuesSerial;
+}
+
+
 /**
  * Vertex shader:
  */
@@ -120,6 +147,10 @@ static void update_vs_constants(struct st_context *st )
    struct st_vertex_program *vp = st->vp;
    struct gl_program_parameter_list *params = vp->Base.Base.Parameters;
 
+   if (!constants_changed(st, params, PIPE_SHADER_VERTEX,
+                          ST_NEW_VERTEX_PROGRAM))
+      return;
+
    st_upload_constants( st, params, PIPE_SHADER_VERTEX );
 }
 
@@ -143,6 +174,10 @@ static void update_fs_constants(struct st_context *st )
    struct st_fragment_program *fp = st->fp;
    struct gl_program_parameter_list *params = fp->Base.Base.Parameters;
 
+   if (!constants_changed(st, params, PIPE_SHADER_FRAGMENT,
+                          ST_NEW_FRAGMENT_PROGRAM))
+      return;
+
    st_upload_constants( st, params, PIPE_SHADER_FRAGMENT );
 }
 
@@ -165,7 +200,9 @@ static void update_gs_constants(struct st_context *st )
 
    if (gp) {
       params = gp->Base.Base.Parameters;
-      st_upload_constants( st, params, PIPE_SHADER_GEOMETRY );
+      if (constants_changed(st, params, PIPE_SHADER_GEOMETRY,
+                            ST_NEW_GEOMETRY_PROGRAM))
+         st_upload_constants( st, params, PIPE_SHADER_GEOMETRY );
    }
 }
 
@@ -34,6 +34,7 @@
 
 #include "main/macros.h"
 #include "main/mtypes.h"
+#include "main/bitset.h"
 #include "main/glformats.h"
 #include "main/samplerobj.h"
 #include "main/texobj.h"
@@ -234,6 +235,8 @@ update_shader_samplers(struct st_context *st,
                        struct pipe_sampler_state *samplers,
                        unsigned *num_samplers)
 {
+   const GLuint *dirty_units = st->ctx->Texture._DirtyUnits;
+   GLuint *sampler_units = st->state.sampler_units[shader_stage];
    GLuint unit;
    GLbitfield samplers_used;
    const GLuint old_max = *num_samplers;
@@ -252,13 +255,19 @@ update_shader_samplers(struct st_context *st,
       if (samplers_used & 1) {
          const GLuint texUnit = prog->SamplerUnits[unit];
 
-         convert_sampler(st, sampler, texUnit);
+         /* the sampler only changes with the unit's state */
+         if (texUnit != sampler_units[unit] ||
+             BITSET_TEST(dirty_units, texUnit)) {
+            convert_sampler(st, sampler, texUnit);
+            sampler_units[unit] = texUnit;
+         }
 
          *num_samplers = unit + 1;
 
          cso_single_sampler(st->cso_context, shader_stage, unit, sampler);
       }
       else if (samplers_used != 0 || unit < old_max) {
+         sampler_units[unit] = ~0u;
          cso_single_sampler(st->cso_context, shader_stage, unit, NULL);
       }
       else {
@@ -298,6 +307,13 @@ update_samplers(struct st_context *st)
                              st->state.samplers[PIPE_SHADER_GEOMETRY],
                              &st->state.num_samplers[PIPE_SHADER_GEOMETRY]);
    }
+   else {
+      /* The dirty units get cleared without the GS seeing them, so make it
+       * rebuild all its samplers once it is bound again.
+       */
+      memset(st->state.sampler_units[PIPE_SHADER_GEOMETRY], 0xff,
+             sizeof(st->state.sampler_units[PIPE_SHADER_GEOMETRY]));
+   }
 }
 
 
@@ -34,6 +34,7 @@
 
 #include "main/macros.h"
 #include "main/mtypes.h"
+#include "main/bitset.h"
 #include "main/samplerobj.h"
 #include "main/texobj.h"
 #include "program/prog_instruction.h"
@@ -267,6 +268,26 @@ update_single_texture(struct st_context *st,
 
 
 
+/**
+ * Whether the sampler view made earlier for a texture unit whose state
+ * hasn't changed can still be used.  The texture storage may have been
+ * reallocated meanwhile, e.g. when finalizing, and buffer textures follow
+ * their buffer object's storage.
+ */
+static GLboolean
+sampler_view_is_current(struct st_context *st,
+                        const struct pipe_sampler_view *sampler_view,
+                        GLuint texUnit)
+{
+   struct gl_texture_object *texObj = st->ctx->Texture.Unit[texUnit]._Current;
+
+   return sampler_view &&
+          texObj &&
+          texObj->Target != GL_TEXTURE_BUFFER &&
+          sampler_view->texture == st_texture_object(texObj)->pt;
+}
+
+
 static void
 update_textures(struct st_context *st,
                 unsigned shader_stage,
@@ -275,6 +296,8 @@ update_textures(struct st_context *st,
                 struct pipe_sampler_view **sampler_views,
                 unsigned *num_textures)
 {
+   const GLuint *dirty_units = st->ctx->Texture._DirtyUnits;
+   GLuint *view_units = st->state.sampler_view_units[shader_stage];
    const GLuint old_max = *num_textures;
    GLbitfield samplers_used = prog->SamplersUsed;
    GLuint unit, new_count;
@@ -292,9 +315,20 @@ update_textures(struct st_context *st,
          const GLuint texUnit = prog->SamplerUnits[unit];
          GLboolean retval;
 
-         retval = update_single_texture(st, &sampler_view, texUnit);
-         if (retval == GL_FALSE)
-            continue;
+         if (texUnit == view_units[unit] &&
+             !BITSET_TEST(dirty_units, texUnit) &&
+             sampler_view_is_current(st, sampler_views[unit], texUnit)) {
+            /* the unit's state hasn't changed */
+            sampler_view = sampler_views[unit];
+         }
+         else {
+            retval = update_single_texture(st, &sampler_view, texUnit);
+            if (retval == GL_FALSE) {
+               view_units[unit] = ~0u;
+               continue;
+            }
+            view_units[unit] = texUnit;
+         }
 
          *num_textures = unit + 1;
       }
@@ -302,6 +336,9 @@ update_textures(struct st_context *st,
          /* if we've reset all the old views and we have no more new ones */
          break;
       }
+      else {
+         view_units[unit] = ~0u;
+      }
 
       pipe_sampler_view_reference(&(sampler_views[unit]), sampler_view);
    }
@@ -364,6 +401,13 @@ update_geometry_textures(struct st_context *st)
                       st->state.sampler_views[PIPE_SHADER_GEOMETRY],
                       &st->state.num_sampler_views[PIPE_SHADER_GEOMETRY]);
    }
+   else {
+      /* The dirty units get cleared without the GS seeing them, so make it
+       * rebuild all its views once it is bound again.
+       */
+      memset(st->state.sampler_view_units[PIPE_SHADER_GEOMETRY], 0xff,
+             sizeof(st->state.sampler_view_units[PIPE_SHADER_GEOMETRY]));
+   }
 }
 
 
@@ -39,6 +39,7 @@
 #include "st_context.h"
 #include "st_cb_bufferobjects.h"
 #include "st_debug.h"
+#include "st_texture_threads.h"
 
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
@@ -121,6 +122,9 @@ st_bufferobj_subdata(struct gl_context *ctx,
       return;
    }
 
+   /* A queued texture upload may still be reading from the buffer */
+   st_wait_texture_uploads(st_context(ctx));
+
    /* Now that transfers are per-context, we don't have to figure out
     * flushing here.  Usually drivers won't need to flush in this case
     * even if the buffer is currently referenced by hardware - they
@@ -283,8 +287,11 @@ st_bufferobj_map_range(struct gl_context *ctx,
    struct st_buffer_object *st_obj = st_buffer_object(obj);
    enum pipe_transfer_usage flags = 0x0;
 
-   if (access & GL_MAP_WRITE_BIT)
+   if (access & GL_MAP_WRITE_BIT) {
+      /* A queued texture upload may still be reading from the buffer */
+      st_wait_texture_uploads(st_context(ctx));
       flags |= PIPE_TRANSFER_WRITE;
+   }
 
    if (access & GL_MAP_READ_BIT)
       flags |= PIPE_TRANSFER_READ;
@@ -394,6 +401,8 @@ st_copy_buffer_subdata(struct gl_context *ctx,
    if(!size)
       return;
 
+   st_wait_texture_uploads(st_context(ctx));
+
    /* buffer should not already be mapped */
    assert(!src->Pointer);
    assert(!dst->Pointer);
@@ -404,7 +404,9 @@ st_render_texture(struct gl_context *ctx,
    struct st_texture_object *stObj;
    struct pipe_surface surf_tmpl;
 
-   if (!st_finalize_texture(ctx, pipe, att->Texture))
+   if (!st_finalize_texture(ctx, pipe, att->Texture) ||
+       !st_texture_release_client_storage(st,
+                                          st_texture_object(att->Texture)))
       return;
 
    pt = st_get_texobj_resource(att->Texture);
@@ -40,6 +40,7 @@
 #include "st_cb_clear.h"
 #include "st_cb_fbo.h"
 #include "st_manager.h"
+#include "st_texture_threads.h"
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
@@ -83,6 +84,7 @@ void st_flush(struct st_context *st,
    FLUSH_CURRENT(st->ctx, 0);
 
    st_flush_bitmap_cache(st);
+   st_wait_texture_uploads(st);
 
    st->pipe->flush(st->pipe, fence, flags);
 }
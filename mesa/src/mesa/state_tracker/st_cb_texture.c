@@ -40,6 +40,7 @@
 #include "main/texgetimage.h"
 #include "main/teximage.h"
 #include "main/texobj.h"
+#include "main/texstate.h"
 #include "main/texstore.h"
 
 #include "state_tracker/st_debug.h"
@@ -50,6 +51,7 @@
 #include "state_tracker/st_cb_bufferobjects.h"
 #include "state_tracker/st_format.h"
 #include "state_tracker/st_texture.h"
+#include "state_tracker/st_texture_threads.h"
 #include "state_tracker/st_gen_mipmap.h"
 #include "state_tracker/st_atom.h"
 
@@ -155,6 +157,7 @@ st_DeleteTextureObject(struct gl_context *ctx,
    struct st_texture_object *stObj = st_texture_object(texObj);
    if (stObj->pt)
       pipe_resource_reference(&stObj->pt, NULL);
+   pipe_resource_reference(&stObj->client_storage, NULL);
    if (stObj->sampler_view) {
       pipe_sampler_view_release(st->pipe, &stObj->sampler_view);
    }
@@ -195,6 +198,8 @@ st_MapTextureImage(struct gl_context *ctx,
    unsigned pipeMode;
    GLubyte *map;
 
+   st_wait_texture_uploads(st);
+
    pipeMode = 0x0;
    if (mode & GL_MAP_READ_BIT)
       pipeMode |= PIPE_TRANSFER_READ;
@@ -203,6 +208,14 @@ st_MapTextureImage(struct gl_context *ctx,
    if (mode & GL_MAP_INVALIDATE_RANGE_BIT)
       pipeMode |= PIPE_TRANSFER_DISCARD_RANGE;
 
+   if ((mode & GL_MAP_WRITE_BIT) &&
+       !st_texture_release_client_storage(st,
+                                          st_texture_object(texImage->TexObject))) {
+      *mapOut = NULL;
+      *rowStrideOut = 0;
+      return;
+   }
+
    map = st_texture_image_map(st, stImage, pipeMode, x, y, slice, w, h, 1);
    if (map) {
       *mapOut = map;
@@ -256,6 +269,60 @@ default_bindings(struct st_context *st, enum pipe_format format)
 }
 
 
+/**
+ * GL_APPLE_client_storage: the application's memory must never be written
+ * to, and may well be read-only.  Before the texture gets modified, copy
+ * the image which lives there into a resource of our own and use that
+ * instead.
+ *
+ * \return GL_FALSE if out of memory
+ */
+GLboolean
+st_texture_release_client_storage(struct st_context *st,
+                                  struct st_texture_object *stObj)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_resource *client = stObj->client_storage;
+   struct st_texture_image *stImage =
+      st_texture_image(stObj->base.Image[0][0]);
+   struct pipe_resource *pt;
+   struct pipe_box box;
+
+   if (!client)
+      return GL_TRUE;
+
+   if (stObj->pt != client && (!stImage || stImage->pt != client)) {
+      /* the image has been respecified or reallocated meanwhile */
+      pipe_resource_reference(&stObj->client_storage, NULL);
+      return GL_TRUE;
+   }
+
+   pt = st_texture_create(st, client->target, client->format, 0,
+                          client->width0, client->height0, 1, 1, 0,
+                          default_bindings(st, client->format));
+   if (!pt)
+      return GL_FALSE;
+
+   u_box_origin_2d(client->width0, client->height0, &box);
+   pipe->resource_copy_region(pipe, pt, 0, 0, 0, 0, client, 0, &box);
+
+   if (stObj->pt == client) {
+      pipe_resource_reference(&stObj->pt, pt);
+      pipe_sampler_view_release(pipe, &stObj->sampler_view);
+   }
+   if (stImage && stImage->pt == client)
+      pipe_resource_reference(&stImage->pt, pt);
+
+   pipe_resource_reference(&pt, NULL);
+   pipe_resource_reference(&stObj->client_storage, NULL);
+
+   /* the sampler views must pick up the new storage */
+   st->ctx->NewState |= _NEW_TEXTURE;
+   _mesa_dirty_texobj_units(st->ctx, &stObj->base);
+   return GL_TRUE;
+}
+
+
 /**
  * Given the size of a mipmap image, try to compute the size of the level=0
  * mipmap image.
@@ -444,8 +511,11 @@ st_AllocTextureImageBuffer(struct gl_context *ctx,
    assert(!stImage->TexData);
    assert(!stImage->pt); /* xxx this might be wrong */
 
-   /* Look if the parent texture object has space for this image */
+   /* Look if the parent texture object has space for this image.  The
+    * application's memory (GL_APPLE_client_storage) is never reused.
+    */
    if (stObj->pt &&
+       stObj->pt != stObj->client_storage &&
        level <= stObj->pt->last_level &&
        st_texture_match_image(stObj->pt, texImage)) {
       /* this image will fit in the existing texture object's memory */
@@ -600,7 +670,7 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
    struct st_texture_object *stObj = st_texture_object(texImage->TexObject);
    struct pipe_context *pipe = st->pipe;
    struct pipe_screen *screen = pipe->screen;
-   struct pipe_resource *dst = stImage->pt;
+   struct pipe_resource *dst;
    struct pipe_resource *src = NULL;
    struct pipe_resource src_templ;
    struct pipe_transfer *transfer;
@@ -611,6 +681,14 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
    unsigned bind;
    GLubyte *map;
 
+   st_wait_texture_uploads(st);
+
+   if (!st_texture_release_client_storage(st, stObj)) {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glTexSubImage%uD", dims);
+      return;
+   }
+   dst = stImage->pt;
+
    if (!st->prefer_blit_based_texture_transfer) {
       goto fallback;
    }
@@ -786,11 +864,97 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
    return;
 
 fallback:
-   _mesa_store_texsubimage(ctx, dims, texImage, xoffset, yoffset, zoffset,
-                           width, height, depth, format, type, pixels,
-                           unpack);
+   if (!st_threaded_texsubimage(ctx, dims, texImage,
+                                xoffset, yoffset, zoffset,
+                                width, height, depth, format, type, pixels,
+                                unpack)) {
+      _mesa_store_texsubimage(ctx, dims, texImage, xoffset, yoffset, zoffset,
+                              width, height, depth, format, type, pixels,
+                              unpack);
+   }
+}
+
+/**
+ * GL_APPLE_client_storage: try to make the texture use the application's
+ * image memory directly instead of allocating storage and copying into it.
+ * This only works for a single level 2D image whose layout already matches
+ * the texture format exactly, and only if the driver can wrap the memory.
+ * Should the texture later need more levels it gets reallocated and the
+ * image copied, as if client storage had never been requested.
+ *
+ * \return GL_TRUE if the image now lives in the client's memory.
+ */
+static GLboolean
+try_client_storage(struct gl_context *ctx, GLuint dims,
+                   struct gl_texture_image *texImage,
+                   GLenum format, GLenum type, const void *pixels,
+                   const struct gl_pixelstore_attrib *unpack)
+{
+   struct st_context *st = st_context(ctx);
+   struct pipe_screen *screen = st->pipe->screen;
+   struct st_texture_image *stImage = st_texture_image(texImage);
+   struct st_texture_object *stObj = st_texture_object(texImage->TexObject);
+   struct pipe_resource templ, *pt;
+   enum pipe_format pipe_format;
+   GLint stride;
+   void *src;
+
+   if (!screen->resource_from_user_memory ||
+       !pixels ||
+       dims != 2 ||
+       texImage->Level != 0 ||
+       (stObj->base.Target != GL_TEXTURE_2D &&
+        stObj->base.Target != GL_TEXTURE_RECTANGLE) ||
+       _mesa_is_bufferobj(unpack->BufferObj) ||
+       unpack->Invert ||
+       stObj->base.GenerateMipmap)
+      return GL_FALSE;
+
+   if (!_mesa_texstore_can_use_memcpy(ctx, texImage->_BaseFormat,
+                                      texImage->TexFormat, format, type,
+                                      unpack))
+      return GL_FALSE;
+
+   stride = _mesa_image_row_stride(unpack, texImage->Width, format, type);
+   src = _mesa_image_address2d(unpack, pixels, texImage->Width,
+                               texImage->Height, format, type, 0, 0);
+   if (stride <= 0 || !src)
+      return GL_FALSE;
+
+   pipe_format = st_mesa_format_to_pipe_format(texImage->TexFormat);
+
+   memset(&templ, 0, sizeof(templ));
+   templ.target = gl_target_to_pipe(stObj->base.Target);
+   templ.format = pipe_format;
+   templ.width0 = texImage->Width;
+   templ.height0 = texImage->Height;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.last_level = 0;
+   templ.usage = PIPE_USAGE_DEFAULT;
+   /* only ever sampled from, see st_texture_release_client_storage() */
+   templ.bind = PIPE_BIND_SAMPLER_VIEW;
+
+   pt = screen->resource_from_user_memory(screen, &templ, src, stride);
+   if (!pt)
+      return GL_FALSE;
+
+   pipe_resource_reference(&stObj->pt, NULL);
+   pipe_sampler_view_release(st->pipe, &stObj->sampler_view);
+
+   stObj->pt = pt;
+   stObj->width0 = texImage->Width;
+   stObj->height0 = texImage->Height;
+   stObj->depth0 = 1;
+   stObj->lastLevel = 0;
+
+   pipe_resource_reference(&stImage->pt, stObj->pt);
+   pipe_resource_reference(&stObj->client_storage, stObj->pt);
+
+   return GL_TRUE;
 }
 
+
 static void
 st_TexImage(struct gl_context * ctx, GLuint dims,
             struct gl_texture_image *texImage,
@@ -804,6 +968,10 @@ st_TexImage(struct gl_context * ctx, GLuint dims,
    if (texImage->Width == 0 || texImage->Height == 0 || texImage->Depth == 0)
       return;
 
+   if (unpack->ClientStorage &&
+       try_client_storage(ctx, dims, texImage, format, type, pixels, unpack))
+      return;
+
    /* allocate storage for texture data */
    if (!ctx->Driver.AllocTextureImageBuffer(ctx, texImage)) {
       _mesa_error(ctx, GL_OUT_OF_MEMORY, "glTexImage%uD", dims);
@@ -867,6 +1035,8 @@ st_GetTexImage(struct gl_context * ctx,
    ubyte *map = NULL;
    boolean done = FALSE;
 
+   st_wait_texture_uploads(st);
+
    if (!st->prefer_blit_based_texture_transfer) {
       goto fallback;
    }
@@ -1115,7 +1285,8 @@ end:
    pipe_resource_reference(&dst, NULL);
 
 fallback:
-   if (!done) {
+   if (!done &&
+       !st_threaded_get_teximage(ctx, format, type, pixels, texImage)) {
       _mesa_get_teximage(ctx, format, type, pixels, texImage);
    }
 }
@@ -1305,6 +1476,13 @@ st_CopyTexSubImage(struct gl_context *ctx, GLuint dims,
       return;
    }
 
+   st_wait_texture_uploads(st);
+
+   if (!st_texture_release_client_storage(st, stObj)) {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glCopyTexSubImage%uD", dims);
+      return;
+   }
+
    if (_mesa_texstore_needs_transfer_ops(ctx, texImage->_BaseFormat,
                                          texImage->TexFormat)) {
       goto fallback;
@@ -1468,6 +1646,9 @@ st_finalize_texture(struct gl_context *ctx,
    enum pipe_format firstImageFormat;
    GLuint ptWidth, ptHeight, ptDepth, ptLayers, ptNumSamples;
 
+   /* Images may get copied into a new resource below */
+   st_wait_texture_uploads(st);
+
    if (_mesa_is_texture_complete(tObj, &tObj->Sampler)) {
       /* The texture is complete and we know exactly how many mipmap levels
        * are present/needed.  This is conditional because we may be called
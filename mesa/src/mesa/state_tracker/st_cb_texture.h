@@ -37,6 +37,7 @@ struct gl_context;
 struct gl_texture_object;
 struct pipe_context;
 struct st_context;
+struct st_texture_object;
 
 extern enum pipe_texture_target
 gl_target_to_pipe(GLenum target);
@@ -44,6 +45,10 @@ gl_target_to_pipe(GLenum target);
 unsigned
 st_get_blit_mask(GLenum srcFormat, GLenum dstFormat);
 
+extern GLboolean
+st_texture_release_client_storage(struct st_context *st,
+                                  struct st_texture_object *stObj);
+
 extern GLboolean
 st_finalize_texture(struct gl_context *ctx,
 		    struct pipe_context *pipe, 
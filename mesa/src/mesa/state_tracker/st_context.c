@@ -65,6 +65,8 @@
 #include "st_extensions.h"
 #include "st_gen_mipmap.h"
 #include "st_program.h"
+#include "st_shader_cache.h"
+#include "st_texture_threads.h"
 #include "pipe/p_context.h"
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
@@ -142,11 +144,16 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
 
    st->cso_context = cso_create_context(pipe);
 
+   memset(st->state.sampler_units, 0xff, sizeof(st->state.sampler_units));
+   memset(st->state.sampler_view_units, 0xff,
+          sizeof(st->state.sampler_view_units));
+
    st_init_atoms( st );
    st_init_bitmap(st);
    st_init_clear(st);
    st_init_draw( st );
    st_init_generate_mipmap(st);
+   st_init_shader_cache(st);
 
    if(pipe->screen->get_param(pipe->screen, PIPE_CAP_NPOT_TEXTURES))
       st->internal_target = PIPE_TEXTURE_2D;
@@ -252,6 +259,8 @@ static void st_destroy_context_priv( struct st_context *st )
    st_destroy_bitmap(st);
    st_destroy_drawpix(st);
    st_destroy_drawtex(st);
+   st_destroy_shader_cache(st);
+   st_destroy_texture_threads(st);
 
    for (shader = 0; shader < Elements(st->state.sampler_views); shader++) {
       for (i = 0; i < Elements(st->state.sampler_views[0]); i++) {
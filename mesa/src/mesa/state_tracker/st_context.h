@@ -38,9 +38,13 @@ struct dd_function_table;
 struct draw_context;
 struct draw_stage;
 struct gen_mipmap_state;
+struct st_atom_stats;
 struct st_context;
 struct st_fragment_program;
+struct st_texture_job;
+struct st_texture_threads;
 struct u_upload_mgr;
+struct util_disk_cache;
 
 
 #define ST_NEW_MESA                    (1 << 0) /* Mesa state has changed */
@@ -109,10 +113,17 @@ struct st_context
       GLuint num_samplers[PIPE_SHADER_TYPES];
       struct pipe_sampler_view *sampler_views[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
       GLuint num_sampler_views[PIPE_SHADER_TYPES];
+      /** The texture unit each sampler and sampler view was made from,
+       * ~0 if none.  Only samplers of dirty units get rebuilt, see
+       * gl_texture_attrib::_DirtyUnits.
+       */
+      GLuint sampler_units[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
+      GLuint sampler_view_units[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
       struct pipe_clip_state clip;
       struct {
          void *ptr;
          unsigned size;
+         GLuint serial;  /**< gl_program_parameter_list::ValuesSerial */
       } constants[PIPE_SHADER_TYPES];
       struct pipe_framebuffer_state framebuffer;
       struct pipe_scissor_state scissor;
@@ -129,6 +140,9 @@ struct st_context
 
    struct st_state_flags dirty;
 
+   /** Per-atom call counts and times, NULL unless ST_ATOM_STATS is set */
+   struct st_atom_stats *atom_stats;
+
    GLboolean missing_textures;
    GLboolean vertdata_edgeflags;
 
@@ -190,6 +204,14 @@ struct st_context
 
    struct cso_context *cso_context;
 
+   /** Cross-process TGSI cache, NULL if disabled */
+   struct util_disk_cache *shader_cache;
+
+   /** Texture transfer worker threads, created on first use */
+   struct st_texture_threads *texture_threads;
+   /** Queued asynchronous texture uploads, in submission order */
+   struct st_texture_job *pending_uploads;
+
    void *winsys_drawable_handle;
 
    /* The number of vertex buffers from the last call of validate_arrays. */
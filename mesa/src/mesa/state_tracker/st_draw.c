@@ -64,6 +64,12 @@
 #include "../glsl/ir_uniform.h"
 
 
+/**
+ * Max number of primitives passed to the driver in one multi-draw call.
+ */
+#define ST_MAX_BATCHED_DRAWS 64
+
+
 /**
  * This is very similar to vbo_all_varyings_in_vbos() but we are
  * only interested in per-vertex data.  See bug 38626.
@@ -199,7 +205,9 @@ st_draw_vbo(struct gl_context *ctx,
    struct st_context *st = st_context(ctx);
    struct pipe_index_buffer ibuffer = {0};
    struct pipe_draw_info info;
+   struct pipe_draw_info draws[ST_MAX_BATCHED_DRAWS];
    const struct gl_client_array **arrays = ctx->Array._DrawArrays;
+   unsigned num_draws = 0;
    unsigned i;
 
    /* Mesa core state should have been validated already */
@@ -276,17 +284,22 @@ st_draw_vbo(struct gl_context *ctx,
                       info.indexed);
       }
 
-      if (info.count_from_stream_output) {
-         cso_draw_vbo(st->cso_context, &info);
-      }
-      else if (info.primitive_restart) {
-         /* don't trim, restarts might be inside index list */
-         cso_draw_vbo(st->cso_context, &info);
+      /* don't trim with restarts, they might be inside index list */
+      if (!info.count_from_stream_output && !info.primitive_restart &&
+          !u_trim_pipe_prim(prims[i].mode, &info.count))
+         continue;
+
+      /* hand the primitives to the driver in as few calls as possible */
+      draws[num_draws++] = info;
+      if (num_draws == Elements(draws)) {
+         cso_multi_draw_vbo(st->cso_context, draws, num_draws);
+         num_draws = 0;
       }
-      else if (u_trim_pipe_prim(prims[i].mode, &info.count))
-         cso_draw_vbo(st->cso_context, &info);
    }
 
+   if (num_draws)
+      cso_multi_draw_vbo(st->cso_context, draws, num_draws);
+
    if (ib && st->indexbuf_uploader && !_mesa_is_bufferobj(ib->obj)) {
       pipe_resource_reference(&ibuffer.buffer, NULL);
    }
@@ -672,6 +672,10 @@ void st_init_extensions(struct st_context *st)
       ctx->Extensions.ARB_sync = GL_TRUE;
    }
 
+   if (screen->resource_from_user_memory) {
+      ctx->Extensions.APPLE_client_storage = GL_TRUE;
+   }
+
    /* Maximum sample count. */
    for (i = 16; i > 0; --i) {
       enum pipe_format pformat = st_choose_format(st, GL_RGBA,
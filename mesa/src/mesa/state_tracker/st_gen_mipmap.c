@@ -41,6 +41,7 @@
 #include "st_texture.h"
 #include "st_gen_mipmap.h"
 #include "st_cb_texture.h"
+#include "st_texture_threads.h"
 
 
 /**
@@ -142,6 +143,8 @@ st_generate_mipmap(struct gl_context *ctx, GLenum target,
    if (!pt)
       return;
 
+   st_wait_texture_uploads(st);
+
    /* not sure if this ultimately actually should work,
       but we're not supporting multisampled textures yet. */
    assert(pt->nr_samples < 2);
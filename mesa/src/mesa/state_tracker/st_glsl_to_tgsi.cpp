@@ -67,6 +67,7 @@ extern "C" {
 #include "st_program.h"
 #include "st_glsl_to_tgsi.h"
 #include "st_mesa_to_tgsi.h"
+#include "st_shader_cache.h"
 }
 
 #define PROGRAM_IMMEDIATE PROGRAM_FILE_MAX
@@ -4990,6 +4991,37 @@ out:
 }
 /* ----------------------------- End TGSI code ------------------------------ */
 
+/**
+ * Compute the shader cache key of one linked stage, which adds the
+ * locations the linker assigned to the stage's variables to the
+ * program-wide key.
+ */
+static void
+hash_linked_shader(const uint8_t prog_sha1[UTIL_SHA1_DIGEST_LENGTH],
+                   struct gl_shader *shader,
+                   uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH])
+{
+   struct util_sha1_ctx hash;
+
+   util_sha1_init(&hash);
+   util_sha1_update(&hash, prog_sha1, UTIL_SHA1_DIGEST_LENGTH);
+   util_sha1_update(&hash, &shader->Type, sizeof shader->Type);
+
+   foreach_list(node, shader->ir) {
+      ir_variable *const var = ((ir_instruction *) node)->as_variable();
+
+      if (var == NULL)
+         continue;
+
+      unsigned info[3] = { (unsigned) var->mode, (unsigned) var->location,
+                           (unsigned) var->index };
+      util_sha1_update(&hash, var->name, strlen(var->name) + 1);
+      util_sha1_update(&hash, info, sizeof info);
+   }
+
+   util_sha1_final(&hash, sha1);
+}
+
 /**
  * Convert a shader's GLSL IR into a Mesa gl_program, although without 
  * generating Mesa IR.
@@ -4997,7 +5029,8 @@ out:
 static struct gl_program *
 get_mesa_program(struct gl_context *ctx,
                  struct gl_shader_program *shader_program,
-                 struct gl_shader *shader)
+                 struct gl_shader *shader,
+                 const uint8_t prog_sha1[UTIL_SHA1_DIGEST_LENGTH])
 {
    glsl_to_tgsi_visitor* v;
    struct gl_program *prog;
@@ -5143,10 +5176,14 @@ get_mesa_program(struct gl_context *ctx,
    case GL_VERTEX_SHADER:
       stvp = (struct st_vertex_program *)prog;
       stvp->glsl_to_tgsi = v;
+      if (st_shader_cache_has_key(prog_sha1))
+         hash_linked_shader(prog_sha1, shader, stvp->sha1);
       break;
    case GL_FRAGMENT_SHADER:
       stfp = (struct st_fragment_program *)prog;
       stfp->glsl_to_tgsi = v;
+      if (st_shader_cache_has_key(prog_sha1))
+         hash_linked_shader(prog_sha1, shader, stfp->sha1);
       break;
    case GL_GEOMETRY_SHADER:
       stgp = (struct st_geometry_program *)prog;
@@ -5198,8 +5235,13 @@ st_new_shader_program(struct gl_context *ctx, GLuint name)
 GLboolean
 st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 {
+   uint8_t prog_sha1[UTIL_SHA1_DIGEST_LENGTH] = { 0 };
+
    assert(prog->LinkStatus);
 
+   if (ctx->st->shader_cache)
+      st_shader_cache_hash_program(ctx, prog, prog_sha1);
+
    for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
       if (prog->_LinkedShaders[i] == NULL)
          continue;
@@ -5276,7 +5318,8 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       if (prog->_LinkedShaders[i] == NULL)
          continue;
 
-      linked_prog = get_mesa_program(ctx, prog, prog->_LinkedShaders[i]);
+      linked_prog = get_mesa_program(ctx, prog, prog->_LinkedShaders[i],
+                                     prog_sha1);
 
       if (linked_prog) {
 	 _mesa_reference_program(ctx, &prog->_LinkedShaders[i]->Program,
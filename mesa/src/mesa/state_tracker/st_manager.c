@@ -32,6 +32,7 @@
 #include "main/texstate.h"
 #include "main/framebuffer.h"
 #include "main/fbobject.h"
+#include "main/glthread.h"
 #include "main/renderbuffer.h"
 #include "main/version.h"
 #include "st_texture.h"
@@ -46,6 +47,7 @@
 
 #include "pipe/p_context.h"
 #include "pipe/p_screen.h"
+#include "util/u_debug.h"
 #include "util/u_format.h"
 #include "util/u_pointer.h"
 #include "util/u_inlines.h"
@@ -452,6 +454,8 @@ st_context_flush(struct st_context_iface *stctxi, unsigned flags,
    struct st_context *st = (struct st_context *) stctxi;
    unsigned pipe_flags = 0;
 
+   _mesa_glthread_finish(st->ctx);
+
    if (flags & ST_FLUSH_END_OF_FRAME) {
       pipe_flags |= PIPE_FLUSH_END_OF_FRAME;
    }
@@ -478,6 +482,8 @@ st_context_teximage(struct st_context_iface *stctxi,
    GLuint width, height, depth;
    GLenum target;
 
+   _mesa_glthread_finish(ctx);
+
    switch (tex_type) {
    case ST_TEXTURE_1D:
       target = GL_TEXTURE_1D;
@@ -558,6 +564,8 @@ st_context_copy(struct st_context_iface *stctxi,
    struct st_context *st = (struct st_context *) stctxi;
    struct st_context *src = (struct st_context *) stsrci;
 
+   _mesa_glthread_finish(src->ctx);
+   _mesa_glthread_finish(st->ctx);
    _mesa_copy_context(src->ctx, st->ctx, mask);
 }
 
@@ -575,9 +583,14 @@ static void
 st_context_destroy(struct st_context_iface *stctxi)
 {
    struct st_context *st = (struct st_context *) stctxi;
+
+   /* Stop the driver thread before tearing down what it uses. */
+   _mesa_glthread_destroy(st->ctx);
    st_destroy_context(st);
 }
 
+DEBUG_GET_ONCE_BOOL_OPTION(glthread, "MESA_GLTHREAD", FALSE)
+
 static struct st_context_iface *
 st_api_create_context(struct st_api *stapi, struct st_manager *smapi,
                       const struct st_context_attribs *attribs,
@@ -645,6 +658,9 @@ st_api_create_context(struct st_api *stapi, struct st_manager *smapi,
    st->invalidate_on_gl_viewport =
       smapi->get_param(smapi, ST_MANAGER_BROKEN_INVALIDATE);
 
+   if (debug_get_option_glthread())
+      _mesa_glthread_init(st->ctx);
+
    st->iface.destroy = st_context_destroy;
    st->iface.flush = st_context_flush;
    st->iface.teximage = st_context_teximage;
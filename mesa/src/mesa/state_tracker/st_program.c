@@ -51,6 +51,7 @@
 #include "st_context.h"
 #include "st_program.h"
 #include "st_mesa_to_tgsi.h"
+#include "st_shader_cache.h"
 #include "cso_cache/cso_context.h"
 
 
@@ -302,6 +303,8 @@ st_translate_vertex_program(struct st_context *st,
    struct ureg_program *ureg;
    enum pipe_error error;
    unsigned num_outputs;
+   uint8_t cache_sha1[UTIL_SHA1_DIGEST_LENGTH];
+   GLuint num_params = stvp->Base.Base.Parameters->NumParameters;
 
    st_prepare_vertex_program(st->ctx, stvp);
 
@@ -310,12 +313,6 @@ st_translate_vertex_program(struct st_context *st,
       _mesa_remove_output_reads(&stvp->Base.Base, PROGRAM_OUTPUT);
    }
 
-   ureg = ureg_create( TGSI_PROCESSOR_VERTEX );
-   if (ureg == NULL) {
-      free(vpv);
-      return NULL;
-   }
-
    vpv->key = *key;
 
    vpv->num_inputs = stvp->num_inputs;
@@ -325,6 +322,26 @@ st_translate_vertex_program(struct st_context *st,
       num_outputs++;
    }
 
+   if (st_shader_cache_has_key(stvp->sha1)) {
+      struct st_vp_variant_key cache_key = *key;
+      cache_key.st = NULL;
+      st_shader_cache_variant_key(stvp->sha1, TGSI_PROCESSOR_VERTEX,
+                                  &cache_key, sizeof cache_key,
+                                  stvp->input_to_index, VERT_ATTRIB_MAX,
+                                  stvp->result_to_output, VARYING_SLOT_MAX,
+                                  &stvp->Base.Base, cache_sha1);
+      vpv->tgsi.tokens = st_shader_cache_load(st, cache_sha1,
+                                              &stvp->Base.Base);
+      if (vpv->tgsi.tokens)
+         goto translated;
+   }
+
+   ureg = ureg_create( TGSI_PROCESSOR_VERTEX );
+   if (ureg == NULL) {
+      free(vpv);
+      return NULL;
+   }
+
    if (ST_DEBUG & DEBUG_MESA) {
       _mesa_print_program(&stvp->Base.Base);
       _mesa_print_program_parameters(st->ctx, &stvp->Base.Base);
@@ -379,6 +396,11 @@ st_translate_vertex_program(struct st_context *st,
 
    ureg_destroy( ureg );
 
+   if (st_shader_cache_has_key(stvp->sha1))
+      st_shader_cache_store(st, cache_sha1, &stvp->Base.Base, num_params,
+                            vpv->tgsi.tokens);
+
+translated:
    if (stvp->glsl_to_tgsi) {
       st_translate_stream_output_info(stvp->glsl_to_tgsi,
                                       stvp->result_to_output,
@@ -470,7 +492,7 @@ st_translate_fragment_program(struct st_context *st,
    struct st_fp_variant *variant = CALLOC_STRUCT(st_fp_variant);
    GLboolean deleteFP = GL_FALSE;
 
-   GLuint outputMapping[FRAG_RESULT_MAX];
+   GLuint outputMapping[FRAG_RESULT_MAX] = { 0 };
    GLuint inputMapping[VARYING_SLOT_MAX];
    GLuint interpMode[PIPE_MAX_SHADER_INPUTS];  /* XXX size? */
    GLuint attr;
@@ -488,6 +510,9 @@ st_translate_fragment_program(struct st_context *st,
    ubyte fs_output_semantic_index[PIPE_MAX_SHADER_OUTPUTS];
    uint fs_num_outputs = 0;
 
+   uint8_t cache_sha1[UTIL_SHA1_DIGEST_LENGTH];
+   GLuint num_params;
+
    if (!variant)
       return NULL;
 
@@ -691,6 +716,22 @@ st_translate_fragment_program(struct st_context *st,
       }
    }
 
+   num_params = stfp->Base.Base.Parameters->NumParameters;
+
+   if (st_shader_cache_has_key(stfp->sha1)) {
+      struct st_fp_variant_key cache_key = *key;
+      cache_key.st = NULL;
+      st_shader_cache_variant_key(stfp->sha1, TGSI_PROCESSOR_FRAGMENT,
+                                  &cache_key, sizeof cache_key,
+                                  inputMapping, VARYING_SLOT_MAX,
+                                  outputMapping, FRAG_RESULT_MAX,
+                                  &stfp->Base.Base, cache_sha1);
+      variant->tgsi.tokens = st_shader_cache_load(st, cache_sha1,
+                                                  &stfp->Base.Base);
+      if (variant->tgsi.tokens)
+         goto translated;
+   }
+
    ureg = ureg_create( TGSI_PROCESSOR_FRAGMENT );
    if (ureg == NULL) {
       free(variant);
@@ -764,6 +805,11 @@ st_translate_fragment_program(struct st_context *st,
    variant->tgsi.tokens = ureg_get_tokens( ureg, NULL );
    ureg_destroy( ureg );
 
+   if (st_shader_cache_has_key(stfp->sha1))
+      st_shader_cache_store(st, cache_sha1, &stfp->Base.Base, num_params,
+                            variant->tgsi.tokens);
+
+translated:
    /* fill in variant */
    variant->driver_shader = pipe->create_fs_state(pipe, &variant->tgsi);
    variant->key = *key;
@@ -39,6 +39,7 @@
 #include "pipe/p_state.h"
 #include "st_context.h"
 #include "st_glsl_to_tgsi.h"
+#include "util/u_sha1.h"
 
 
 /** Fragment program variant key */
@@ -91,6 +92,9 @@ struct st_fragment_program
    struct gl_fragment_program Base;
    struct glsl_to_tgsi_visitor* glsl_to_tgsi;
 
+   /** Shader cache key of the linked program, all zero if not cacheable */
+   uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH];
+
    struct st_fp_variant *variants;
 };
 
@@ -146,6 +150,9 @@ struct st_vertex_program
    struct gl_vertex_program Base;  /**< The Mesa vertex program */
    struct glsl_to_tgsi_visitor* glsl_to_tgsi;
 
+   /** Shader cache key of the linked program, all zero if not cacheable */
+   uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH];
+
    /** maps a Mesa VERT_ATTRIB_x to a packed TGSI input index */
    GLuint input_to_index[VERT_ATTRIB_MAX];
    /** maps a TGSI input index back to a Mesa VERT_ATTRIB_x */
@@ -0,0 +1,342 @@
+/**************************************************************************
+ *
+ * Copyright 2013 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Cross-process TGSI cache.
+ *
+ * The key of a program variant is the SHA-1 of everything the translation
+ * depends on: the Mesa version, the driver, the context's compiler options,
+ * limits and extensions, the GLSL sources of the program, the link-time
+ * locations of its inputs and outputs, and finally the variant key and the
+ * register mappings handed to st_translate_program().
+ *
+ * Translation may append state references (such as the window position
+ * transform) to the program's parameter list.  These are recorded in the
+ * cache entry and replayed on a hit, so the constant indices referenced by
+ * the cached tokens stay valid.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "main/imports.h"
+#include "main/shaderobj.h"
+#include "program/prog_parameter.h"
+#include "program/prog_statevars.h"
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "tgsi/tgsi_parse.h"
+#include "util/u_debug.h"
+#include "util/u_disk_cache.h"
+
+#include "st_context.h"
+#include "st_mesa_to_tgsi.h"
+#include "st_shader_cache.h"
+
+
+#define ST_SHADER_CACHE_DEFAULT_SIZE (64 * 1024 * 1024)
+
+
+/** Header of a cached variant, followed by state refs and tokens */
+struct st_shader_cache_blob
+{
+   uint32_t num_params;       /**< parameters before translation */
+   uint32_t num_state_refs;   /**< parameters added by translation */
+   uint32_t num_tokens;
+};
+
+
+static uint64_t
+parse_size(const char *str)
+{
+   char *end;
+   uint64_t size = strtoull(str, &end, 10);
+
+   switch (*end) {
+   case 'g': case 'G':
+      size *= 1024;
+      /* fallthrough */
+   case 'm': case 'M':
+      size *= 1024;
+      /* fallthrough */
+   case 'k': case 'K':
+      size *= 1024;
+      break;
+   default:
+      break;
+   }
+
+   return size;
+}
+
+
+void
+st_init_shader_cache(struct st_context *st)
+{
+   const char *path = debug_get_option("MESA_SHADER_CACHE_DIR", NULL);
+   const char *max_size = debug_get_option("MESA_SHADER_CACHE_MAX_SIZE", NULL);
+
+   if (!path)
+      return;
+
+   st->shader_cache =
+      util_disk_cache_create(path, max_size ? parse_size(max_size)
+                                            : ST_SHADER_CACHE_DEFAULT_SIZE);
+   if (!st->shader_cache)
+      _mesa_warning(st->ctx, "cannot use shader cache directory %s", path);
+}
+
+
+void
+st_destroy_shader_cache(struct st_context *st)
+{
+   const char *stats_file = debug_get_option("MESA_SHADER_CACHE_STATS", NULL);
+
+   if (!st->shader_cache)
+      return;
+
+   if (stats_file) {
+      struct util_disk_cache_stats stats;
+      FILE *fp;
+
+      util_disk_cache_get_stats(st->shader_cache, &stats);
+
+      if (strcmp(stats_file, "stderr") == 0)
+         fp = stderr;
+      else
+         fp = fopen(stats_file, "a");
+
+      if (fp) {
+         fprintf(fp, "mesa_shader_cache pid=%ld hits=%u misses=%u stores=%u "
+                 "evictions=%u errors=%u bytes_read=%llu bytes_written=%llu "
+                 "size=%llu\n",
+                 (long) getpid(), stats.hits, stats.misses, stats.stores,
+                 stats.evictions, stats.errors,
+                 (unsigned long long) stats.bytes_read,
+                 (unsigned long long) stats.bytes_written,
+                 (unsigned long long) stats.total_size);
+         if (fp != stderr)
+            fclose(fp);
+      }
+   }
+
+   util_disk_cache_destroy(st->shader_cache);
+   st->shader_cache = NULL;
+}
+
+
+/**
+ * Compute the program-wide part of the cache key.  Called at link time.
+ */
+void
+st_shader_cache_hash_program(struct gl_context *ctx,
+                             const struct gl_shader_program *shProg,
+                             uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH])
+{
+   struct pipe_screen *screen = ctx->st->pipe->screen;
+   static const char version[] = "Mesa " PACKAGE_VERSION;
+   const char *name = screen->get_name(screen);
+   const char *vendor = screen->get_vendor(screen);
+   struct util_sha1_ctx hash;
+   GLuint i;
+
+   util_sha1_init(&hash);
+   util_sha1_update(&hash, version, sizeof version);
+   util_sha1_update(&hash, name, strlen(name) + 1);
+   util_sha1_update(&hash, vendor, strlen(vendor) + 1);
+   util_sha1_update(&hash, &ctx->st->needs_texcoord_semantic,
+                    sizeof ctx->st->needs_texcoord_semantic);
+   util_sha1_update(&hash, &ctx->API, sizeof ctx->API);
+   util_sha1_update(&hash, &ctx->Version, sizeof ctx->Version);
+   util_sha1_update(&hash, &ctx->Const, sizeof ctx->Const);
+   /* only the flags, the extension string pointer differs per process */
+   util_sha1_update(&hash, &ctx->Extensions,
+                    offsetof(struct gl_extensions, String));
+   util_sha1_update(&hash, ctx->ShaderCompilerOptions,
+                    sizeof ctx->ShaderCompilerOptions);
+
+   for (i = 0; i < shProg->NumShaders; i++) {
+      const struct gl_shader *sh = shProg->Shaders[i];
+
+      util_sha1_update(&hash, &sh->Type, sizeof sh->Type);
+      if (sh->Source)
+         util_sha1_update(&hash, sh->Source, strlen(sh->Source) + 1);
+   }
+
+   util_sha1_update(&hash, &shProg->TransformFeedback.BufferMode,
+                    sizeof shProg->TransformFeedback.BufferMode);
+   for (i = 0; i < shProg->TransformFeedback.NumVarying; i++) {
+      const char *varying = shProg->TransformFeedback.VaryingNames[i];
+      util_sha1_update(&hash, varying, strlen(varying) + 1);
+   }
+
+   util_sha1_final(&hash, sha1);
+}
+
+
+/**
+ * Compute the key of one variant of a program.
+ *
+ * \param key  variant key, with its st_context pointer cleared
+ */
+void
+st_shader_cache_variant_key(const uint8_t prog_sha1[UTIL_SHA1_DIGEST_LENGTH],
+                            unsigned processor,
+                            const void *key, size_t key_size,
+                            const GLuint *input_mapping, unsigned num_inputs,
+                            const GLuint *output_mapping, unsigned num_outputs,
+                            const struct gl_program *prog,
+                            uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH])
+{
+   struct util_sha1_ctx hash;
+
+   util_sha1_init(&hash);
+   util_sha1_update(&hash, prog_sha1, UTIL_SHA1_DIGEST_LENGTH);
+   util_sha1_update(&hash, &processor, sizeof processor);
+   util_sha1_update(&hash, key, key_size);
+   util_sha1_update(&hash, input_mapping, num_inputs * sizeof(GLuint));
+   util_sha1_update(&hash, output_mapping, num_outputs * sizeof(GLuint));
+   util_sha1_update(&hash, &prog->InputsRead, sizeof prog->InputsRead);
+   util_sha1_update(&hash, &prog->OutputsWritten, sizeof prog->OutputsWritten);
+   util_sha1_update(&hash, &prog->Parameters->NumParameters,
+                    sizeof prog->Parameters->NumParameters);
+   util_sha1_final(&hash, sha1);
+}
+
+
+/**
+ * Look up the TGSI of a variant.
+ *
+ * \return tokens to be released with st_free_tokens(), or NULL on a miss.
+ */
+const struct tgsi_token *
+st_shader_cache_load(struct st_context *st,
+                     const uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH],
+                     struct gl_program *prog)
+{
+   const struct st_shader_cache_blob *blob;
+   const gl_state_index *state_refs;
+   struct tgsi_token *tokens = NULL;
+   size_t size;
+   GLuint i;
+
+   if (!st->shader_cache)
+      return NULL;
+
+   blob = util_disk_cache_get(st->shader_cache, sha1, &size);
+   if (!blob)
+      return NULL;
+
+   if (size < sizeof *blob ||
+       size != sizeof *blob +
+               blob->num_state_refs * STATE_LENGTH * sizeof(gl_state_index) +
+               blob->num_tokens * sizeof(struct tgsi_token) ||
+       blob->num_params != prog->Parameters->NumParameters)
+      goto out;
+
+   state_refs = (const gl_state_index *) (blob + 1);
+   for (i = 0; i < blob->num_state_refs; i++) {
+      GLint index = _mesa_add_state_reference(prog->Parameters,
+                                              state_refs + i * STATE_LENGTH);
+      if (index != (GLint) (blob->num_params + i))
+         goto out;
+   }
+
+   tokens = tgsi_alloc_tokens(blob->num_tokens);
+   if (tokens) {
+      memcpy(tokens, state_refs + blob->num_state_refs * STATE_LENGTH,
+             blob->num_tokens * sizeof(struct tgsi_token));
+
+      if (blob->num_tokens < 2 ||
+          tgsi_num_tokens(tokens) != blob->num_tokens) {
+         st_free_tokens(tokens);
+         tokens = NULL;
+      }
+   }
+
+out:
+   free((void *) blob);
+   return tokens;
+}
+
+
+/**
+ * Store the TGSI of a freshly translated variant.
+ *
+ * \param first_new_param  number of parameters before the translation
+ */
+void
+st_shader_cache_store(struct st_context *st,
+                      const uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH],
+                      const struct gl_program *prog,
+                      unsigned first_new_param,
+                      const struct tgsi_token *tokens)
+{
+   const struct gl_program_parameter_list *params = prog->Parameters;
+   struct st_shader_cache_blob *blob;
+   gl_state_index *state_refs;
+   unsigned num_tokens;
+   size_t size;
+   GLuint i;
+
+   if (!st->shader_cache || !tokens)
+      return;
+
+   /* Only state references can be replayed on a hit */
+   for (i = first_new_param; i < params->NumParameters; i++) {
+      if (params->Parameters[i].Type != PROGRAM_STATE_VAR)
+         return;
+   }
+
+   num_tokens = tgsi_num_tokens(tokens);
+   size = sizeof *blob +
+          (params->NumParameters - first_new_param) *
+          STATE_LENGTH * sizeof(gl_state_index) +
+          num_tokens * sizeof(struct tgsi_token);
+
+   blob = malloc(size);
+   if (!blob)
+      return;
+
+   blob->num_params = first_new_param;
+   blob->num_state_refs = params->NumParameters - first_new_param;
+   blob->num_tokens = num_tokens;
+
+   state_refs = (gl_state_index *) (blob + 1);
+   for (i = 0; i < blob->num_state_refs; i++) {
+      memcpy(state_refs + i * STATE_LENGTH,
+             params->Parameters[first_new_param + i].StateIndexes,
+             STATE_LENGTH * sizeof(gl_state_index));
+   }
+   memcpy(state_refs + blob->num_state_refs * STATE_LENGTH, tokens,
+          num_tokens * sizeof(struct tgsi_token));
+
+   util_disk_cache_put(st->shader_cache, sha1, blob, size);
+   free(blob);
+}
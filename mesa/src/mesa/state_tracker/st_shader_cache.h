@@ -0,0 +1,104 @@
+/**************************************************************************
+ *
+ * Copyright 2013 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Cross-process cache of the TGSI generated for GLSL program variants.
+ *
+ * Enabled by setting MESA_SHADER_CACHE_DIR.  MESA_SHADER_CACHE_MAX_SIZE
+ * bounds the directory size (bytes, with an optional K/M/G suffix) and
+ * MESA_SHADER_CACHE_STATS names a file ("stderr" is accepted too) that gets
+ * one line of hit/miss counters appended when the context is destroyed.
+ */
+
+#ifndef ST_SHADER_CACHE_H
+#define ST_SHADER_CACHE_H
+
+#include "main/mtypes.h"
+#include "util/u_sha1.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct st_context;
+struct tgsi_token;
+
+
+extern void
+st_init_shader_cache(struct st_context *st);
+
+extern void
+st_destroy_shader_cache(struct st_context *st);
+
+extern void
+st_shader_cache_hash_program(struct gl_context *ctx,
+                             const struct gl_shader_program *shProg,
+                             uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH]);
+
+extern void
+st_shader_cache_variant_key(const uint8_t prog_sha1[UTIL_SHA1_DIGEST_LENGTH],
+                            unsigned processor,
+                            const void *key, size_t key_size,
+                            const GLuint *input_mapping, unsigned num_inputs,
+                            const GLuint *output_mapping, unsigned num_outputs,
+                            const struct gl_program *prog,
+                            uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH]);
+
+extern const struct tgsi_token *
+st_shader_cache_load(struct st_context *st,
+                     const uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH],
+                     struct gl_program *prog);
+
+extern void
+st_shader_cache_store(struct st_context *st,
+                      const uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH],
+                      const struct gl_program *prog,
+                      unsigned first_new_param,
+                      const struct tgsi_token *tokens);
+
+
+/**
+ * Programs that did not come from the GLSL linker have an all-zero digest
+ * and are never cached.
+ */
+static INLINE GLboolean
+st_shader_cache_has_key(const uint8_t sha1[UTIL_SHA1_DIGEST_LENGTH])
+{
+   unsigned i;
+   for (i = 0; i < UTIL_SHA1_DIGEST_LENGTH; i++) {
+      if (sha1[i])
+         return GL_TRUE;
+   }
+   return GL_FALSE;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ST_SHADER_CACHE_H */
@@ -97,6 +97,12 @@ struct st_texture_object
     * views and surfaces instead of pt->format.
     */
    enum pipe_format surface_format;
+
+   /* The resource wrapping the application's memory, if the level 0 image
+    * was specified with GL_APPLE_client_storage.  It may only be sampled
+    * from; it is replaced by a copy before anything writes to the texture.
+    */
+   struct pipe_resource *client_storage;
 };
 
 
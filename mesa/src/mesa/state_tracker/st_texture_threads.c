@@ -0,0 +1,807 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Multithreaded texture upload/download.
+ *
+ * A job is split into bands of rows.  The GL thread queues the job, the
+ * worker threads and the GL thread itself then grab bands until none are
+ * left.  Band functions must not touch any GL or gallium state the GL
+ * thread may change while they run: synchronous jobs may read the GL
+ * context (the GL thread is blocked in the job), asynchronous jobs may
+ * not.
+ */
+
+#include <limits.h>
+
+#include "main/imports.h"
+#include "main/formats.h"
+#include "main/image.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "main/pbo.h"
+#include "main/bufferobj.h"
+#include "main/texstore.h"
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "util/u_inlines.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_sse.h"
+#include "os/os_thread.h"
+
+#include "state_tracker/st_context.h"
+#include "state_tracker/st_cb_bufferobjects.h"
+#include "state_tracker/st_texture.h"
+#include "state_tracker/st_texture_threads.h"
+
+
+#define ST_MAX_TEXTURE_THREADS 8
+
+/** Transfers smaller than this are not worth waking up the threads */
+#define ST_TEXTURE_THREAD_MIN_BYTES (1024 * 1024)
+
+/** Target size of one band */
+#define ST_TEXTURE_BAND_BYTES (128 * 1024)
+
+
+struct st_texture_job
+{
+   /** Process one band, on any thread */
+   void (*run)(struct st_texture_job *job, unsigned band);
+
+   /** Release the job, on the GL thread, once all bands are done */
+   void (*finish)(struct st_context *st, struct st_texture_job *job);
+
+   unsigned num_bands;
+
+   /* Protected by st_texture_threads::mutex */
+   unsigned next_band;
+   unsigned bands_done;
+   struct st_texture_job *next_queued;
+
+   /** Only touched by the GL thread */
+   struct st_texture_job *next_pending;
+};
+
+
+struct st_texture_threads
+{
+   unsigned num_threads;
+   pipe_thread threads[ST_MAX_TEXTURE_THREADS];
+
+   pipe_mutex mutex;
+   pipe_condvar work_cond;   /**< signalled when jobs are queued */
+   pipe_condvar done_cond;   /**< signalled when a job completes */
+
+   /** Jobs with bands which haven't been started yet */
+   struct st_texture_job *queue_head;
+   struct st_texture_job *queue_tail;
+
+   boolean shutdown;
+};
+
+
+DEBUG_GET_ONCE_NUM_OPTION(texture_threads, "ST_TEXTURE_THREADS", -1)
+
+
+/**
+ * Take the next unstarted band off the queue.  Called with the mutex held.
+ */
+static struct st_texture_job *
+claim_band(struct st_texture_threads *threads, unsigned *band)
+{
+   struct st_texture_job *job = threads->queue_head;
+
+   if (!job)
+      return NULL;
+
+   *band = job->next_band++;
+   if (job->next_band == job->num_bands) {
+      threads->queue_head = job->next_queued;
+      if (!threads->queue_head)
+         threads->queue_tail = NULL;
+   }
+
+   return job;
+}
+
+
+/**
+ * Run a band with the mutex released.  Called with the mutex held.
+ */
+static void
+run_band(struct st_texture_threads *threads,
+         struct st_texture_job *job, unsigned band)
+{
+   pipe_mutex_unlock(threads->mutex);
+   job->run(job, band);
+   pipe_mutex_lock(threads->mutex);
+
+   if (++job->bands_done == job->num_bands)
+      pipe_condvar_broadcast(threads->done_cond);
+}
+
+
+/**
+ * Help with queued bands until the given job is complete.  Called with the
+ * mutex held.
+ */
+static void
+wait_job(struct st_texture_threads *threads, struct st_texture_job *job)
+{
+   while (job->bands_done < job->num_bands) {
+      struct st_texture_job *other;
+      unsigned band;
+
+      other = claim_band(threads, &band);
+      if (other)
+         run_band(threads, other, band);
+      else
+         pipe_condvar_wait(threads->done_cond, threads->mutex);
+   }
+}
+
+
+static PIPE_THREAD_ROUTINE( texture_thread_proc, init_data )
+{
+   struct st_texture_threads *threads = init_data;
+
+   pipe_mutex_lock(threads->mutex);
+   while (!threads->shutdown) {
+      struct st_texture_job *job;
+      unsigned band;
+
+      job = claim_band(threads, &band);
+      if (job)
+         run_band(threads, job, band);
+      else
+         pipe_condvar_wait(threads->work_cond, threads->mutex);
+   }
+   pipe_mutex_unlock(threads->mutex);
+
+   return 0;
+}
+
+
+/**
+ * Return the worker threads, creating them if needed, or NULL if there
+ * are none to use.
+ */
+static struct st_texture_threads *
+get_texture_threads(struct st_context *st)
+{
+   struct st_texture_threads *threads = st->texture_threads;
+   long num_threads;
+   unsigned i;
+
+   if (threads)
+      return threads->num_threads ? threads : NULL;
+
+   util_cpu_detect();
+
+   /* The GL thread helps with every job, so leave one cpu for it */
+   num_threads = debug_get_option_texture_threads();
+   if (num_threads < 0)
+      num_threads = MIN2(util_cpu_caps.nr_cpus, ST_MAX_TEXTURE_THREADS + 1) - 1;
+   num_threads = CLAMP(num_threads, 0, ST_MAX_TEXTURE_THREADS);
+
+   threads = ST_CALLOC_STRUCT(st_texture_threads);
+   if (!threads)
+      return NULL;
+
+   pipe_mutex_init(threads->mutex);
+   pipe_condvar_init(threads->work_cond);
+   pipe_condvar_init(threads->done_cond);
+
+   for (i = 0; i < num_threads; i++) {
+      threads->threads[i] = pipe_thread_create(texture_thread_proc, threads);
+      if (!threads->threads[i])
+         break;
+   }
+   threads->num_threads = i;
+
+   st->texture_threads = threads;
+
+   return threads->num_threads ? threads : NULL;
+}
+
+
+static void
+queue_job(struct st_texture_threads *threads, struct st_texture_job *job)
+{
+   job->next_queued = NULL;
+
+   pipe_mutex_lock(threads->mutex);
+   if (threads->queue_tail)
+      threads->queue_tail->next_queued = job;
+   else
+      threads->queue_head = job;
+   threads->queue_tail = job;
+   pipe_condvar_broadcast(threads->work_cond);
+   pipe_mutex_unlock(threads->mutex);
+}
+
+
+/**
+ * Run all bands of a job and wait for them.
+ *
+ * The first band always runs on the calling thread before the job is
+ * handed to the workers.  This takes care of the lazily built format
+ * function tables in core Mesa, which are not safe to initialize from
+ * several threads at once.
+ */
+static void
+run_job(struct st_texture_threads *threads, struct st_texture_job *job)
+{
+   job->run(job, 0);
+   if (job->num_bands == 1)
+      return;
+
+   job->next_band = 1;
+   job->bands_done = 1;
+   queue_job(threads, job);
+
+   pipe_mutex_lock(threads->mutex);
+   wait_job(threads, job);
+   pipe_mutex_unlock(threads->mutex);
+}
+
+
+/**
+ * Queue a job and return immediately.  It will be completed and released
+ * by st_finish_texture_uploads().
+ */
+static void
+queue_async_job(struct st_context *st, struct st_texture_threads *threads,
+                struct st_texture_job *job)
+{
+   struct st_texture_job **tail = &st->pending_uploads;
+
+   job->next_band = 0;
+   job->bands_done = 0;
+   job->next_pending = NULL;
+
+   while (*tail)
+      tail = &(*tail)->next_pending;
+   *tail = job;
+
+   queue_job(threads, job);
+}
+
+
+void
+st_finish_texture_uploads(struct st_context *st)
+{
+   struct st_texture_threads *threads = st->texture_threads;
+   struct st_texture_job *job, *next;
+
+   if (!st->pending_uploads)
+      return;
+
+   pipe_mutex_lock(threads->mutex);
+   for (job = st->pending_uploads; job; job = job->next_pending)
+      wait_job(threads, job);
+   pipe_mutex_unlock(threads->mutex);
+
+   for (job = st->pending_uploads; job; job = next) {
+      next = job->next_pending;
+      job->finish(st, job);
+   }
+   st->pending_uploads = NULL;
+}
+
+
+void
+st_destroy_texture_threads(struct st_context *st)
+{
+   struct st_texture_threads *threads = st->texture_threads;
+   unsigned i;
+
+   if (!threads)
+      return;
+
+   st_finish_texture_uploads(st);
+
+   pipe_mutex_lock(threads->mutex);
+   threads->shutdown = TRUE;
+   pipe_condvar_broadcast(threads->work_cond);
+   pipe_mutex_unlock(threads->mutex);
+
+   for (i = 0; i < threads->num_threads; i++)
+      pipe_thread_wait(threads->threads[i]);
+
+   pipe_condvar_destroy(threads->done_cond);
+   pipe_condvar_destroy(threads->work_cond);
+   pipe_mutex_destroy(threads->mutex);
+
+   free(threads);
+   st->texture_threads = NULL;
+}
+
+
+/**
+ * Copy a row into memory nobody is going to read back soon, without
+ * pulling it into the cache.
+ */
+static void
+copy_row_streaming(GLubyte *dst, const GLubyte *src, unsigned size)
+{
+#if defined(PIPE_ARCH_SSE)
+   unsigned head = (16 - ((uintptr_t) dst & 15)) & 15;
+
+   if (size >= head + 64) {
+      memcpy(dst, src, head);
+      dst += head;
+      src += head;
+      size -= head;
+
+      while (size >= 64) {
+         __m128i a = _mm_loadu_si128((const __m128i *) src);
+         __m128i b = _mm_loadu_si128((const __m128i *) (src + 16));
+         __m128i c = _mm_loadu_si128((const __m128i *) (src + 32));
+         __m128i d = _mm_loadu_si128((const __m128i *) (src + 48));
+         _mm_stream_si128((__m128i *) dst, a);
+         _mm_stream_si128((__m128i *) (dst + 16), b);
+         _mm_stream_si128((__m128i *) (dst + 32), c);
+         _mm_stream_si128((__m128i *) (dst + 48), d);
+         dst += 64;
+         src += 64;
+         size -= 64;
+      }
+   }
+#endif
+
+   memcpy(dst, src, size);
+}
+
+
+static INLINE void
+copy_rows_done(void)
+{
+#if defined(PIPE_ARCH_SSE)
+   /* make the streaming stores visible before the band is reported done */
+   _mm_sfence();
+#endif
+}
+
+
+/**
+ * Split a transfer of width x height x depth texels into bands.
+ */
+static void
+compute_bands(unsigned bytes_per_row, unsigned height, unsigned depth,
+              unsigned *rows_per_band, unsigned *bands_per_slice,
+              unsigned *num_bands)
+{
+   *rows_per_band = MAX2(1, ST_TEXTURE_BAND_BYTES / bytes_per_row);
+   *rows_per_band = MIN2(*rows_per_band, height);
+   *bands_per_slice = (height + *rows_per_band - 1) / *rows_per_band;
+   *num_bands = *bands_per_slice * depth;
+}
+
+
+/**
+ * Return the number of slices and the dimensions to use for image
+ * addressing, or FALSE for targets this file doesn't handle.
+ */
+static GLboolean
+get_slices(GLenum target, GLint depth, GLuint *dims, GLuint *num_slices)
+{
+   switch (target) {
+   case GL_TEXTURE_2D:
+   case GL_TEXTURE_RECTANGLE:
+   case GL_TEXTURE_CUBE_MAP:
+      *dims = 2;
+      *num_slices = 1;
+      return GL_TRUE;
+   case GL_TEXTURE_3D:
+   case GL_TEXTURE_2D_ARRAY:
+   case GL_TEXTURE_CUBE_MAP_ARRAY:
+      *dims = 3;
+      *num_slices = depth;
+      return GL_TRUE;
+   default:
+      /* 1D images are too small to bother */
+      return GL_FALSE;
+   }
+}
+
+
+static GLubyte *
+map_image(struct st_context *st, struct st_texture_image *stImage,
+          enum pipe_transfer_usage usage,
+          GLuint x, GLuint y, GLuint z, GLuint w, GLuint h, GLuint d,
+          struct pipe_transfer **transfer)
+{
+   struct st_texture_object *stObj =
+      st_texture_object(stImage->base.TexObject);
+   GLuint level = stObj->pt != stImage->pt ? 0 : stImage->base.Level;
+
+   return pipe_transfer_map_3d(st->pipe, stImage->pt, level, usage,
+                               x, y, z + stImage->base.Face,
+                               w, h, d, transfer);
+}
+
+
+struct texstore_job
+{
+   struct st_texture_job base;
+
+   struct gl_context *ctx;
+   GLuint dims;
+   GLenum baseFormat;
+   gl_format texFormat;
+   GLenum format, type;
+   GLint width, height;
+
+   /** Client memory or mapped PBO, and how to walk it */
+   const GLubyte *pixels;
+   struct gl_pixelstore_attrib unpack;
+
+   GLubyte *map;
+   unsigned stride, layer_stride;
+   unsigned rows_per_band, bands_per_slice;
+
+   /** Nonzero if the rows can be copied as they are */
+   unsigned copy_bytes;
+
+   boolean failed;
+
+   /* Held by asynchronous jobs until they are finished */
+   struct pipe_resource *pt, *pbo;
+   struct pipe_transfer *transfer, *pbo_transfer;
+};
+
+
+static void
+texstore_band(struct st_texture_job *base, unsigned band)
+{
+   struct texstore_job *job = (struct texstore_job *) base;
+   unsigned slice = band / job->bands_per_slice;
+   unsigned y0 = (band % job->bands_per_slice) * job->rows_per_band;
+   unsigned rows = MIN2(job->rows_per_band, job->height - y0);
+   GLubyte *dst = job->map + slice * job->layer_stride + y0 * job->stride;
+
+   if (job->copy_bytes) {
+      unsigned row;
+
+      for (row = 0; row < rows; row++) {
+         const GLubyte *src =
+            _mesa_image_address(job->dims, &job->unpack, job->pixels,
+                                job->width, job->height,
+                                job->format, job->type, slice, y0 + row, 0);
+         copy_row_streaming(dst, src, job->copy_bytes);
+         dst += job->stride;
+      }
+      copy_rows_done();
+   }
+   else {
+      /* Point the unpacking parameters at the first row of the band */
+      struct gl_pixelstore_attrib unpack = job->unpack;
+
+      unpack.SkipRows += y0;
+      unpack.SkipImages += slice;
+
+      if (!_mesa_texstore(job->ctx, job->dims, job->baseFormat,
+                          job->texFormat, job->stride, &dst,
+                          job->width, rows, 1,
+                          job->format, job->type, job->pixels, &unpack))
+         job->failed = TRUE;
+   }
+}
+
+
+static void
+texstore_async_finish(struct st_context *st, struct st_texture_job *base)
+{
+   struct texstore_job *job = (struct texstore_job *) base;
+
+   pipe_transfer_unmap(st->pipe, job->pbo_transfer);
+   pipe_transfer_unmap(st->pipe, job->transfer);
+   pipe_resource_reference(&job->pbo, NULL);
+   pipe_resource_reference(&job->pt, NULL);
+   free(job);
+}
+
+
+/**
+ * Threaded replacement for _mesa_store_texsubimage().
+ *
+ * Returns GL_FALSE if the upload was not handled and the caller should
+ * fall back to the core Mesa path.
+ */
+GLboolean
+st_threaded_texsubimage(struct gl_context *ctx, GLuint dims,
+                        struct gl_texture_image *texImage,
+                        GLint xoffset, GLint yoffset, GLint zoffset,
+                        GLint width, GLint height, GLint depth,
+                        GLenum format, GLenum type, const void *pixels,
+                        const struct gl_pixelstore_attrib *unpack)
+{
+   struct st_context *st = st_context(ctx);
+   struct st_texture_image *stImage = st_texture_image(texImage);
+   struct st_texture_threads *threads;
+   struct texstore_job *job;
+   struct pipe_transfer *transfer;
+   GLuint img_dims, num_slices, num_bands;
+   unsigned bytes_per_row;
+   GLboolean async;
+   GLubyte *map;
+
+   if (!stImage->pt ||
+       unpack->Invert ||
+       _mesa_is_format_compressed(texImage->TexFormat) ||
+       texImage->_BaseFormat == GL_DEPTH_STENCIL ||
+       !get_slices(texImage->TexObject->Target, depth, &img_dims, &num_slices))
+      return GL_FALSE;
+
+   bytes_per_row = width * _mesa_get_format_bytes(texImage->TexFormat);
+   if (bytes_per_row * height * num_slices < ST_TEXTURE_THREAD_MIN_BYTES)
+      return GL_FALSE;
+
+   threads = get_texture_threads(st);
+   if (!threads)
+      return GL_FALSE;
+
+   job = ST_CALLOC_STRUCT(texstore_job);
+   if (!job)
+      return GL_FALSE;
+
+   job->ctx = ctx;
+   job->dims = img_dims;
+   job->baseFormat = texImage->_BaseFormat;
+   job->texFormat = texImage->TexFormat;
+   job->format = format;
+   job->type = type;
+   job->width = width;
+   job->height = height;
+   job->unpack = *unpack;
+   job->unpack.BufferObj = NULL;
+   if (!job->unpack.ImageHeight)
+      job->unpack.ImageHeight = height;
+
+   if (_mesa_texstore_can_use_memcpy(ctx, texImage->_BaseFormat,
+                                     texImage->TexFormat, format, type,
+                                     unpack))
+      job->copy_bytes = bytes_per_row;
+
+   /* Only plain copies may run behind the GL thread's back, converting
+    * uploads look at GL pixel transfer state.
+    */
+   async = job->copy_bytes && _mesa_is_bufferobj(unpack->BufferObj) &&
+           st_buffer_object(unpack->BufferObj)->buffer;
+
+   if (async) {
+      struct pipe_resource *pbo = st_buffer_object(unpack->BufferObj)->buffer;
+      const GLubyte *pbo_map;
+
+      if (!_mesa_validate_pbo_access(dims, unpack, width, height, depth,
+                                     format, type, INT_MAX, pixels)) {
+         _mesa_error(ctx, GL_INVALID_OPERATION,
+                     "glTexSubImage%uD(invalid PBO access)", dims);
+         free(job);
+         return GL_TRUE;
+      }
+      if (_mesa_bufferobj_mapped(unpack->BufferObj)) {
+         _mesa_error(ctx, GL_INVALID_OPERATION,
+                     "glTexSubImage%uD(PBO is mapped)", dims);
+         free(job);
+         return GL_TRUE;
+      }
+
+      pbo_map = pipe_buffer_map(st->pipe, pbo, PIPE_TRANSFER_READ,
+                                &job->pbo_transfer);
+      if (!pbo_map) {
+         free(job);
+         return GL_FALSE;
+      }
+
+      /* Keep the storage alive even if the buffer or texture gets
+       * reallocated before the upload is done.
+       */
+      pipe_resource_reference(&job->pbo, pbo);
+      pipe_resource_reference(&job->pt, stImage->pt);
+      job->pixels = ADD_POINTERS(pbo_map, pixels);
+   }
+   else {
+      job->pixels = _mesa_validate_pbo_teximage(ctx, dims, width, height,
+                                                depth, format, type, pixels,
+                                                unpack, "glTexSubImage");
+      if (!job->pixels) {
+         free(job);
+         return GL_TRUE;
+      }
+   }
+
+   map = map_image(st, stImage, PIPE_TRANSFER_WRITE, xoffset, yoffset,
+                   img_dims == 3 ? zoffset : 0, width, height, num_slices,
+                   &transfer);
+   if (!map) {
+      if (async) {
+         pipe_transfer_unmap(st->pipe, job->pbo_transfer);
+         pipe_resource_reference(&job->pbo, NULL);
+         pipe_resource_reference(&job->pt, NULL);
+      }
+      else {
+         _mesa_unmap_teximage_pbo(ctx, unpack);
+      }
+      free(job);
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glTexSubImage%uD", dims);
+      return GL_TRUE;
+   }
+
+   job->map = map;
+   job->transfer = transfer;
+   job->stride = transfer->stride;
+   job->layer_stride = transfer->layer_stride;
+
+   compute_bands(bytes_per_row, height, num_slices,
+                 &job->rows_per_band, &job->bands_per_slice, &num_bands);
+   job->base.run = texstore_band;
+   job->base.finish = texstore_async_finish;
+   job->base.num_bands = num_bands;
+
+   if (async) {
+      queue_async_job(st, threads, &job->base);
+      return GL_TRUE;
+   }
+
+   run_job(threads, &job->base);
+
+   pipe_transfer_unmap(st->pipe, transfer);
+   _mesa_unmap_teximage_pbo(ctx, unpack);
+
+   if (job->failed)
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glTexSubImage%uD", dims);
+
+   free(job);
+   return GL_TRUE;
+}
+
+
+struct get_teximage_job
+{
+   struct st_texture_job base;
+
+   GLuint dims;
+   GLenum format, type;
+   GLint width, height;
+
+   GLubyte *pixels;
+   const struct gl_pixelstore_attrib *pack;
+
+   const GLubyte *map;
+   unsigned stride, layer_stride;
+   unsigned rows_per_band, bands_per_slice;
+   unsigned bytes_per_row;
+};
+
+
+static void
+get_teximage_band(struct st_texture_job *base, unsigned band)
+{
+   struct get_teximage_job *job = (struct get_teximage_job *) base;
+   unsigned slice = band / job->bands_per_slice;
+   unsigned y0 = (band % job->bands_per_slice) * job->rows_per_band;
+   unsigned rows = MIN2(job->rows_per_band, job->height - y0);
+   const GLubyte *src = job->map + slice * job->layer_stride +
+                        y0 * job->stride;
+   unsigned row;
+
+   for (row = 0; row < rows; row++) {
+      GLubyte *dst = _mesa_image_address(job->dims, job->pack, job->pixels,
+                                         job->width, job->height,
+                                         job->format, job->type,
+                                         slice, y0 + row, 0);
+      memcpy(dst, src, job->bytes_per_row);
+      src += job->stride;
+   }
+}
+
+
+/**
+ * Threaded version of the memcpy path of _mesa_get_teximage(), which also
+ * covers 3D and array textures.
+ *
+ * Returns GL_FALSE if the download was not handled and the caller should
+ * fall back to the core Mesa path.
+ */
+GLboolean
+st_threaded_get_teximage(struct gl_context *ctx,
+                         GLenum format, GLenum type, GLvoid *pixels,
+                         struct gl_texture_image *texImage)
+{
+   struct st_context *st = st_context(ctx);
+   struct st_texture_image *stImage = st_texture_image(texImage);
+   struct st_texture_threads *threads;
+   struct get_teximage_job job;
+   struct pipe_transfer *transfer;
+   GLuint img_dims, num_slices;
+   unsigned bytes_per_row;
+   GLubyte *dest;
+
+   if (!stImage->pt ||
+       ctx->Pack.Invert ||
+       _mesa_get_format_base_format(texImage->TexFormat) !=
+       texImage->_BaseFormat ||
+       !_mesa_format_matches_format_and_type(texImage->TexFormat, format,
+                                             type, ctx->Pack.SwapBytes) ||
+       !get_slices(texImage->TexObject->Target, texImage->Depth,
+                   &img_dims, &num_slices))
+      return GL_FALSE;
+
+   bytes_per_row =
+      texImage->Width * _mesa_get_format_bytes(texImage->TexFormat);
+   if (bytes_per_row * texImage->Height * num_slices <
+       ST_TEXTURE_THREAD_MIN_BYTES)
+      return GL_FALSE;
+
+   threads = get_texture_threads(st);
+   if (!threads)
+      return GL_FALSE;
+
+   dest = _mesa_map_pbo_dest(ctx, &ctx->Pack, pixels);
+   if (!dest) {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glGetTexImage(map PBO failed)");
+      return GL_TRUE;
+   }
+
+   memset(&job, 0, sizeof job);
+   job.map = map_image(st, stImage, PIPE_TRANSFER_READ, 0, 0, 0,
+                       texImage->Width, texImage->Height, num_slices,
+                       &transfer);
+   if (!job.map) {
+      _mesa_unmap_pbo_dest(ctx, &ctx->Pack);
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glGetTexImage");
+      return GL_TRUE;
+   }
+
+   job.dims = img_dims;
+   job.format = format;
+   job.type = type;
+   job.width = texImage->Width;
+   job.height = texImage->Height;
+   job.pixels = dest;
+   job.pack = &ctx->Pack;
+   job.stride = transfer->stride;
+   job.layer_stride = transfer->layer_stride;
+   job.bytes_per_row = bytes_per_row;
+
+   compute_bands(bytes_per_row, texImage->Height, num_slices,
+                 &job.rows_per_band, &job.bands_per_slice,
+                 &job.base.num_bands);
+   job.base.run = get_teximage_band;
+
+   run_job(threads, &job.base);
+
+   pipe_transfer_unmap(st->pipe, transfer);
+   _mesa_unmap_pbo_dest(ctx, &ctx->Pack);
+
+   return GL_TRUE;
+}
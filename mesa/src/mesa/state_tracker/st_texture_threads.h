@@ -0,0 +1,84 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Worker threads which split the CPU side of large texture uploads and
+ * downloads into bands of rows.
+ *
+ * The threads are only created on the first transfer big enough to use
+ * them.  ST_TEXTURE_THREADS overrides the number of worker threads; zero
+ * disables the whole thing.
+ *
+ * Uploads from a PBO which only need a memcpy are queued and the call
+ * returns immediately.  Such pending uploads are completed by
+ * st_wait_texture_uploads(), which must be called before anything may
+ * look at the texture or write to the PBO.
+ */
+
+#ifndef ST_TEXTURE_THREADS_H
+#define ST_TEXTURE_THREADS_H
+
+#include "main/glheader.h"
+#include "state_tracker/st_context.h"
+
+struct gl_context;
+struct gl_pixelstore_attrib;
+struct gl_texture_image;
+
+
+extern void
+st_destroy_texture_threads(struct st_context *st);
+
+extern void
+st_finish_texture_uploads(struct st_context *st);
+
+extern GLboolean
+st_threaded_texsubimage(struct gl_context *ctx, GLuint dims,
+                        struct gl_texture_image *texImage,
+                        GLint xoffset, GLint yoffset, GLint zoffset,
+                        GLint width, GLint height, GLint depth,
+                        GLenum format, GLenum type, const void *pixels,
+                        const struct gl_pixelstore_attrib *unpack);
+
+extern GLboolean
+st_threaded_get_teximage(struct gl_context *ctx,
+                         GLenum format, GLenum type, GLvoid *pixels,
+                         struct gl_texture_image *texImage);
+
+
+/**
+ * Complete any asynchronous texture uploads.
+ */
+static INLINE void
+st_wait_texture_uploads(struct st_context *st)
+{
+   if (st->pending_uploads)
+      st_finish_texture_uploads(st);
+}
+
+
+#endif /* ST_TEXTURE_THREADS_H */
@@ -39,6 +39,7 @@
 #include "s_lines.h"
 #include "s_points.h"
 #include "s_span.h"
+#include "s_spanbin.h"
 #include "s_texfetch.h"
 #include "s_triangle.h"
 #include "s_texfilter.h"
@@ -415,8 +416,14 @@ _swrast_validate_blend_func(struct gl_context *ctx, GLuint n, const GLubyte mask
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
 
-   _swrast_validate_derived( ctx ); /* why is this needed? */
-   _swrast_choose_blend_func( ctx, chanType );
+   /* may be called by several threads rendering binned spans */
+#ifdef _OPENMP
+#pragma omp critical (swrast_validate_blend_func)
+#endif
+   {
+      _swrast_validate_derived( ctx ); /* why is this needed? */
+      _swrast_choose_blend_func( ctx, chanType );
+   }
 
    swrast->BlendFunc( ctx, n, mask, src, dst, chanType );
 }
@@ -637,6 +644,8 @@ _swrast_Line( struct gl_context *ctx, const SWvertex *v0, const SWvertex *v1 )
       _swrast_print_vertex( ctx, v0 );
       _swrast_print_vertex( ctx, v1 );
    }
+   if (SWRAST_CONTEXT(ctx)->SpanBins.Count > 0)
+      _swrast_flush_span_bins(ctx);
    SWRAST_CONTEXT(ctx)->Line( ctx, v0, v1 );
 }
 
@@ -647,6 +656,8 @@ _swrast_Point( struct gl_context *ctx, const SWvertex *v0 )
       _mesa_debug(ctx, "_swrast_Point\n");
       _swrast_print_vertex( ctx, v0 );
    }
+   if (SWRAST_CONTEXT(ctx)->SpanBins.Count > 0)
+      _swrast_flush_span_bins(ctx);
    SWRAST_CONTEXT(ctx)->Point( ctx, v0 );
 }
 
@@ -800,12 +811,21 @@ _swrast_CreateContext( struct gl_context *ctx )
 
    ctx->swrast_context = swrast;
 
-   swrast->stencil_temp.buf1 = malloc(SWRAST_MAX_WIDTH * sizeof(GLubyte));
-   swrast->stencil_temp.buf2 = malloc(SWRAST_MAX_WIDTH * sizeof(GLubyte));
-   swrast->stencil_temp.buf3 = malloc(SWRAST_MAX_WIDTH * sizeof(GLubyte));
-   swrast->stencil_temp.buf4 = malloc(SWRAST_MAX_WIDTH * sizeof(GLubyte));
+   swrast->MaxThreads = maxThreads;
+
+   /* Like SpanArrays, these are used while processing spans and so need
+    * one instance per thread.
+    */
+   swrast->FragProgMachine =
+      calloc(maxThreads, sizeof(struct gl_program_machine));
+
+   swrast->stencil_temp.buf1 = malloc(maxThreads * SWRAST_MAX_WIDTH * sizeof(GLubyte));
+   swrast->stencil_temp.buf2 = malloc(maxThreads * SWRAST_MAX_WIDTH * sizeof(GLubyte));
+   swrast->stencil_temp.buf3 = malloc(maxThreads * SWRAST_MAX_WIDTH * sizeof(GLubyte));
+   swrast->stencil_temp.buf4 = malloc(maxThreads * SWRAST_MAX_WIDTH * sizeof(GLubyte));
 
-   if (!swrast->stencil_temp.buf1 ||
+   if (!swrast->FragProgMachine ||
+       !swrast->stencil_temp.buf1 ||
        !swrast->stencil_temp.buf2 ||
        !swrast->stencil_temp.buf3 ||
        !swrast->stencil_temp.buf4) {
@@ -828,6 +848,9 @@ _swrast_DestroyContext( struct gl_context *ctx )
    free( swrast->SpanArrays );
    free( swrast->ZoomedArrays );
    free( swrast->TexelBuffer );
+   free( swrast->FragProgMachine );
+
+   _swrast_free_span_bins(ctx);
 
    free(swrast->stencil_temp.buf1);
    free(swrast->stencil_temp.buf2);
@@ -851,6 +874,11 @@ void
 _swrast_flush( struct gl_context *ctx )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   /* render any binned triangle spans */
+   if (swrast->SpanBins.Count > 0)
+      _swrast_flush_span_bins(ctx);
+
    /* flush any pending fragments from rendering points */
    if (swrast->PointSpan.end > 0) {
       _swrast_write_rgba_span(ctx, &(swrast->PointSpan));
@@ -894,6 +922,11 @@ _swrast_render_start( struct gl_context *ctx )
    if (swrast->Driver.SpanRenderStart)
       swrast->Driver.SpanRenderStart( ctx );
    swrast->PointSpan.end = 0;
+
+   /* With several threads, triangle spans are binned and rendered in
+    * parallel by _swrast_flush().
+    */
+   swrast->SpanBins.Active = swrast->MaxThreads > 1;
 }
  
 void
@@ -902,6 +935,7 @@ _swrast_render_finish( struct gl_context *ctx )
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
 
    _swrast_flush(ctx);
+   swrast->SpanBins.Active = GL_FALSE;
 
    if (swrast->Driver.SpanRenderFinish)
       swrast->Driver.SpanRenderFinish( ctx );
@@ -51,6 +51,10 @@
 #include "s_fragprog.h"
 #include "s_span.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 typedef void (*texture_sample_func)(struct gl_context *ctx,
                                     const struct gl_sampler_object *samp,
@@ -321,16 +325,31 @@ typedef struct
 
    validate_texture_image_func ValidateTextureImage;
 
-   /** State used during execution of fragment programs */
-   struct gl_program_machine FragProgMachine;
+   /** State used during execution of fragment programs, one per thread */
+   struct gl_program_machine *FragProgMachine;
 
    /** Temporary arrays for stencil operations.  To avoid large stack
-    * allocations.
+    * allocations.  Each holds SWRAST_MAX_WIDTH values per thread.
     */
    struct {
       GLubyte *buf1, *buf2, *buf3, *buf4;
    } stencil_temp;
 
+   /** Number of threads the per-thread buffers above are allocated for */
+   GLuint MaxThreads;
+
+   /**
+    * Triangle spans waiting to be rendered in parallel, see s_spanbin.c.
+    * Only active between _swrast_render_start() and _swrast_flush(), and
+    * only if MaxThreads > 1.
+    */
+   struct {
+      GLboolean Active;
+      GLuint Count;
+      SWspan *Spans;
+      GLuint *Order;    /**< span indices sorted by band */
+   } SpanBins;
+
 } SWcontext;
 
 
@@ -341,6 +360,21 @@ extern void
 _swrast_update_texture_samplers(struct gl_context *ctx);
 
 
+/**
+ * Index of the calling thread into the per-thread buffers of SWcontext
+ * (SpanArrays, FragProgMachine, stencil_temp, ...).
+ */
+static inline GLuint
+swrast_thread_index(void)
+{
+#ifdef _OPENMP
+   return omp_get_thread_num();
+#else
+   return 0;
+#endif
+}
+
+
 /** Return SWcontext for the given struct gl_context */
 static inline SWcontext *
 SWRAST_CONTEXT(struct gl_context *ctx)
@@ -212,7 +212,8 @@ run_program(struct gl_context *ctx, SWspan *span, GLuint start, GLuint end)
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
    const struct gl_fragment_program *program = ctx->FragmentProgram._Current;
    const GLbitfield64 outputsWritten = program->Base.OutputsWritten;
-   struct gl_program_machine *machine = &swrast->FragProgMachine;
+   struct gl_program_machine *machine =
+      &swrast->FragProgMachine[swrast_thread_index()];
    GLuint i;
 
    for (i = start; i < end; i++) {
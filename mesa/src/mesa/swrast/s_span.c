@@ -1240,9 +1240,14 @@ _swrast_write_rgba_span( struct gl_context *ctx, SWspan *span)
    if (ctx->Query.CurrentOcclusionObject) {
       /* update count of 'passed' fragments */
       struct gl_query_object *q = ctx->Query.CurrentOcclusionObject;
-      GLuint i;
+      GLuint i, passed = 0;
       for (i = 0; i < span->end; i++)
-         q->Result += span->array->mask[i];
+         passed += span->array->mask[i];
+      /* spans may be written by several threads, see s_spanbin.c */
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+      q->Result += passed;
    }
 
    /* We had to wait until now to check for glColorMask(0,0,0,0) because of
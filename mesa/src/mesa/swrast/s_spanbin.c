@@ -0,0 +1,175 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  VMware, Inc.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file s_spanbin.c
+ * Parallel rendering of triangle spans.
+ *
+ * When swrast runs with more than one OpenMP thread, the triangle
+ * functions don't write their spans right away.  The spans are copied
+ * into bins instead and rendered when the primitives are flushed.  The
+ * framebuffer is divided into bands of SPAN_BAND_HEIGHT rows and each
+ * band is rendered by one thread, with the regular span functions.
+ * Within a band the spans are written in the order they were emitted, so
+ * depth testing, blending, etc. give the same results as without binning.
+ */
+
+
+#include "main/glheader.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+
+#include "s_context.h"
+#include "s_span.h"
+#include "s_spanbin.h"
+#include "s_texcombine.h"
+#include "s_texfilter.h"
+
+
+/** Number of rows in a band */
+#define SPAN_BAND_HEIGHT 16
+
+#define MAX_SPAN_BANDS (SWRAST_MAX_WIDTH / SPAN_BAND_HEIGHT)
+
+/**
+ * Number of spans binned before they're flushed, about 6MB worth of
+ * SWspans.
+ */
+#define MAX_BINNED_SPANS 2048
+
+
+/**
+ * Return the band a span belongs to.  Spans outside the framebuffer are
+ * clipped away when written, they just need to go in some band.
+ */
+static inline GLint
+span_band(const SWspan *span)
+{
+   const GLint y = CLAMP(span->y, 0, SWRAST_MAX_WIDTH - 1);
+   return y / SPAN_BAND_HEIGHT;
+}
+
+
+/**
+ * Add a triangle span to the bins.  The span is copied, so the caller
+ * may reuse it.
+ */
+void
+_swrast_bin_span(struct gl_context *ctx, SWspan *span)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   ASSERT(span->primitive == GL_POLYGON);
+   ASSERT(span->arrayMask == 0x0);
+
+   if (!swrast->SpanBins.Spans) {
+      swrast->SpanBins.Spans = malloc(MAX_BINNED_SPANS * sizeof(SWspan));
+      swrast->SpanBins.Order = malloc(MAX_BINNED_SPANS * sizeof(GLuint));
+      if (!swrast->SpanBins.Spans || !swrast->SpanBins.Order) {
+         _swrast_free_span_bins(ctx);
+         _swrast_write_rgba_span(ctx, span);
+         return;
+      }
+   }
+   else if (swrast->SpanBins.Count == MAX_BINNED_SPANS) {
+      _swrast_flush_span_bins(ctx);
+   }
+
+   swrast->SpanBins.Spans[swrast->SpanBins.Count++] = *span;
+}
+
+
+/**
+ * Write all the binned spans, one band per thread.
+ */
+void
+_swrast_flush_span_bins(struct gl_context *ctx)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   SWspan *spans = swrast->SpanBins.Spans;
+   GLuint *order = swrast->SpanBins.Order;
+   const GLuint count = swrast->SpanBins.Count;
+   GLuint bandStart[MAX_SPAN_BANDS + 1];
+   GLuint bandNext[MAX_SPAN_BANDS];
+   GLint numBands = 0, b;
+   GLuint i;
+
+   if (count == 0)
+      return;
+
+   /* Sort the spans by band, keeping them in order within each band. */
+   memset(bandStart, 0, sizeof(bandStart));
+   for (i = 0; i < count; i++) {
+      const GLint band = span_band(&spans[i]);
+      bandStart[band + 1]++;
+      numBands = MAX2(numBands, band + 1);
+   }
+   for (b = 0; b < numBands; b++) {
+      bandStart[b + 1] += bandStart[b];
+      bandNext[b] = bandStart[b];
+   }
+   for (i = 0; i < count; i++) {
+      order[bandNext[span_band(&spans[i])]++] = i;
+   }
+
+   /* Things that are otherwise set up on first use, by whichever thread
+    * gets there first.
+    */
+   if (ctx->Texture._EnabledCoordUnits) {
+      _swrast_alloc_texel_buffer(ctx);
+      _swrast_create_filter_table();
+   }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(swrast->MaxThreads)
+#endif
+   for (b = 0; b < numBands; b++) {
+      /* each thread needs to use a different (global) SpanArrays variable */
+      SWspanarrays *array = swrast->SpanArrays + swrast_thread_index();
+      GLuint j;
+
+      for (j = bandStart[b]; j < bandStart[b + 1]; j++) {
+         SWspan *span = &spans[order[j]];
+         span->array = array;
+         _swrast_write_rgba_span(ctx, span);
+      }
+   }
+
+   swrast->SpanBins.Count = 0;
+}
+
+
+void
+_swrast_free_span_bins(struct gl_context *ctx)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   free(swrast->SpanBins.Spans);
+   free(swrast->SpanBins.Order);
+   swrast->SpanBins.Spans = NULL;
+   swrast->SpanBins.Order = NULL;
+   swrast->SpanBins.Count = 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  VMware, Inc.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef S_SPANBIN_H
+#define S_SPANBIN_H
+
+#include "main/mtypes.h"
+#include "s_context.h"
+#include "s_span.h"
+
+
+extern void
+_swrast_bin_span(struct gl_context *ctx, SWspan *span);
+
+extern void
+_swrast_flush_span_bins(struct gl_context *ctx);
+
+extern void
+_swrast_free_span_bins(struct gl_context *ctx);
+
+
+/**
+ * Write a triangle span, or bin it to be written in parallel with the
+ * other spans of the current primitives.
+ */
+static inline void
+_swrast_write_triangle_span(struct gl_context *ctx, SWspan *span)
+{
+   if (SWRAST_CONTEXT(ctx)->SpanBins.Active)
+      _swrast_bin_span(ctx, span);
+   else
+      _swrast_write_rgba_span(ctx, span);
+}
+
+
+#endif
@@ -55,6 +55,16 @@ ENDIF
 
 
 
+/**
+ * Return the calling thread's part of one of the stencil_temp buffers.
+ */
+static inline GLubyte *
+stencil_temp(GLubyte *buf)
+{
+   return buf + swrast_thread_index() * SWRAST_MAX_WIDTH;
+}
+
+
 /**
  * Compute/return the offset of the stencil value in a pixel.
  * For example, if the format is Z24+S8, the position of the stencil bits
@@ -213,7 +223,7 @@ do_stencil_test(struct gl_context *ctx, GLuint face, GLuint n,
                 GLubyte stencil[], GLubyte mask[], GLint stride)
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
-   GLubyte *fail = swrast->stencil_temp.buf2;
+   GLubyte *fail = stencil_temp(swrast->stencil_temp.buf2);
    GLboolean allfail = GL_FALSE;
    GLuint i, j;
    const GLuint valueMask = ctx->Stencil.ValueMask[face];
@@ -358,7 +368,7 @@ _swrast_stencil_and_ztest_span(struct gl_context *ctx, SWspan *span)
    const GLuint face = (span->facing == 0) ? 0 : ctx->Stencil._BackFace;
    const GLuint count = span->end;
    GLubyte *mask = span->array->mask;
-   GLubyte *stencilTemp = swrast->stencil_temp.buf1;
+   GLubyte *stencilTemp = stencil_temp(swrast->stencil_temp.buf1);
    GLubyte *stencilBuf;
 
    if (span->arrayMask & SPAN_XY) {
@@ -407,9 +417,9 @@ _swrast_stencil_and_ztest_span(struct gl_context *ctx, SWspan *span)
        * Perform depth buffering, then apply zpass or zfail stencil function.
        */
       SWcontext *swrast = SWRAST_CONTEXT(ctx);
-      GLubyte *passMask = swrast->stencil_temp.buf2;
-      GLubyte *failMask = swrast->stencil_temp.buf3;
-      GLubyte *origMask = swrast->stencil_temp.buf4;
+      GLubyte *passMask = stencil_temp(swrast->stencil_temp.buf2);
+      GLubyte *failMask = stencil_temp(swrast->stencil_temp.buf3);
+      GLubyte *origMask = stencil_temp(swrast->stencil_temp.buf4);
 
       /* save the current mask bits */
       memcpy(origMask, mask, count * sizeof(GLubyte));
@@ -525,8 +535,8 @@ _swrast_write_stencil_span(struct gl_context *ctx, GLint n, GLint x, GLint y,
 
    if ((stencilMask & stencilMax) != stencilMax) {
       /* need to apply writemask */
-      GLubyte *destVals = swrast->stencil_temp.buf1;
-      GLubyte *newVals = swrast->stencil_temp.buf2;
+      GLubyte *destVals = stencil_temp(swrast->stencil_temp.buf1);
+      GLubyte *newVals = stencil_temp(swrast->stencil_temp.buf2);
       GLint i;
 
       _mesa_unpack_ubyte_stencil_row(rb->Format, n, stencilBuf, destVals);
@@ -590,33 +590,42 @@ swizzle_texels(GLuint swizzle, GLuint count, float4_array texels)
 
 
 /**
- * Apply texture mapping to a span of fragments.
+ * Allocate swrast->TexelBuffer if that hasn't been done yet.
+ * \return GL_FALSE if out of memory
  */
-void
-_swrast_texture_span( struct gl_context *ctx, SWspan *span )
+GLboolean
+_swrast_alloc_texel_buffer(struct gl_context *ctx)
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
-   float4_array primary_rgba;
-   GLuint unit;
 
    if (!swrast->TexelBuffer) {
-#ifdef _OPENMP
-      const GLint maxThreads = omp_get_max_threads();
-#else
-      const GLint maxThreads = 1;
-#endif
-
       /* TexelBuffer is also global and normally shared by all SWspan
        * instances; when running with multiple threads, create one per
        * thread.
        */
       swrast->TexelBuffer =
-	 malloc(ctx->Const.FragmentProgram.MaxTextureImageUnits * maxThreads *
-			    SWRAST_MAX_WIDTH * 4 * sizeof(GLfloat));
-      if (!swrast->TexelBuffer) {
-	 _mesa_error(ctx, GL_OUT_OF_MEMORY, "texture_combine");
-	 return;
-      }
+	 malloc(ctx->Const.FragmentProgram.MaxTextureImageUnits *
+                swrast->MaxThreads *
+                SWRAST_MAX_WIDTH * 4 * sizeof(GLfloat));
+   }
+
+   return swrast->TexelBuffer != NULL;
+}
+
+
+/**
+ * Apply texture mapping to a span of fragments.
+ */
+void
+_swrast_texture_span( struct gl_context *ctx, SWspan *span )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   float4_array primary_rgba;
+   GLuint unit;
+
+   if (!_swrast_alloc_texel_buffer(ctx)) {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "texture_combine");
+      return;
    }
 
    primary_rgba = malloc(span->end * 4 * sizeof(GLfloat));
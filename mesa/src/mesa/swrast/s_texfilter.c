@@ -1613,10 +1613,11 @@ sample_lambda_2d(struct gl_context *ctx,
 static GLfloat *weightLut = NULL;
 
 /**
- * Creates the look-up table used to speed-up EWA sampling
+ * Creates the look-up table used to speed-up EWA sampling.
+ * Threaded span writers have to call this before they start.
  */
-static void
-create_filter_table(void)
+void
+_swrast_create_filter_table(void)
 {
    GLuint i;
    if (!weightLut) {
@@ -1905,7 +1906,7 @@ sample_lambda_2d_aniso(struct gl_context *ctx,
    
    /* on first access create the lookup table containing the filter weights. */
    if (!weightLut) {
-      create_filter_table();
+      _swrast_create_filter_table();
    }
 
    texW = swImg->WidthScale;
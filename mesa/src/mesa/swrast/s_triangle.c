@@ -43,6 +43,7 @@
 #include "s_context.h"
 #include "s_feedback.h"
 #include "s_span.h"
+#include "s_spanbin.h"
 #include "s_triangle.h"
 
 
@@ -88,7 +89,7 @@ _swrast_culltriangle( struct gl_context *ctx,
    span.greenStep = 0;				\
    span.blueStep = 0;				\
    span.alphaStep = 0;
-#define RENDER_SPAN( span )  _swrast_write_rgba_span(ctx, &span);
+#define RENDER_SPAN( span )  _swrast_write_triangle_span(ctx, &span);
 #include "s_tritemp.h"
 
 
@@ -106,7 +107,7 @@ _swrast_culltriangle( struct gl_context *ctx,
       ASSERT(ctx->Texture._EnabledCoordUnits == 0);	\
       ASSERT(ctx->Light.ShadeModel==GL_SMOOTH);	\
    }
-#define RENDER_SPAN( span )  _swrast_write_rgba_span(ctx, &span);
+#define RENDER_SPAN( span )  _swrast_write_triangle_span(ctx, &span);
 #include "s_tritemp.h"
 
 
@@ -869,7 +870,7 @@ fast_persp_span(struct gl_context *ctx, SWspan *span,
 #define INTERP_RGB 1
 #define INTERP_ALPHA 1
 #define INTERP_ATTRIBS 1
-#define RENDER_SPAN( span )   _swrast_write_rgba_span(ctx, &span);
+#define RENDER_SPAN( span )   _swrast_write_triangle_span(ctx, &span);
 #include "s_tritemp.h"
 
 
@@ -1067,8 +1068,13 @@ _swrast_choose_triangle( struct gl_context *ctx )
          magFilter = texObj2D ? samp->MagFilter : GL_NONE;
          envMode = ctx->Texture.Unit[0].EnvMode;
 
-         /* First see if we can use an optimized 2-D texture function */
-         if (ctx->Texture._EnabledCoordUnits == 0x1
+         /* First see if we can use an optimized 2-D texture function.
+          * Those write their spans directly, so when rendering with
+          * several threads the general function, whose spans are binned
+          * and rendered in parallel, is faster.
+          */
+         if (swrast->MaxThreads == 1
+             && ctx->Texture._EnabledCoordUnits == 0x1
              && !_swrast_use_fragment_program(ctx)
              && !ctx->ATIFragmentShader._Enabled
              && ctx->Texture._EnabledUnits == 0x1
@@ -155,6 +155,18 @@ vbo_get_minmax_indices(struct gl_context *ctx, const struct _mesa_prim *prim,
                        const struct _mesa_index_buffer *ib,
                        GLuint *min_index, GLuint *max_index, GLuint nr_prims);
 
+void
+vbo_minmax_index_array(const void *indices, unsigned index_size,
+                       GLuint count, GLboolean restart, GLuint restart_index,
+                       GLuint *min_index, GLuint *max_index);
+
+GLuint
+vbo_find_restart_index(const void *indices, unsigned index_size,
+                       GLuint start, GLuint end, GLuint restart_index);
+
+void
+vbo_delete_minmax_cache(struct gl_buffer_object *bufferObj);
+
 void vbo_use_buffer_objects(struct gl_context *ctx);
 
 void vbo_always_unmap_buffers(struct gl_context *ctx);
@@ -52,6 +52,7 @@ void vbo_exec_init( struct gl_context *ctx )
    ctx->Driver.CurrentExecPrimitive = PRIM_OUTSIDE_BEGIN_END;
    ctx->Driver.BeginVertices = vbo_exec_BeginVertices;
    ctx->Driver.FlushVertices = vbo_exec_FlushVertices;
+   ctx->Driver.DeferFlushVertices = vbo_exec_DeferFlushVertices;
 
    vbo_exec_invalidate_state( ctx, ~0 );
 }
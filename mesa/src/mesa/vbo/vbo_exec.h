@@ -51,6 +51,14 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define VBO_VERT_BUFFER_SIZE (1024*64)	/* bytes */
 
 
+/**
+ * Size of the buffer object once real VBOs are in use, see
+ * vbo_use_buffer_objects().  The buffer is filled front to back across
+ * flushes and only invalidated when it wraps around.
+ */
+#define VBO_VERT_RING_SIZE (1024*1024)	/* bytes */
+
+
 /** Current vertex program mode */
 enum vp_mode {
    VP_NONE,   /**< fixed function */
@@ -76,6 +84,17 @@ struct vbo_exec_copied_vtx {
 };
 
 
+/**
+ * Matrices recorded by vbo_exec_DeferFlushVertices() in place of drawing
+ * the buffered primitives.
+ */
+struct vbo_exec_batch_state {
+   GLuint end_prim;          /**< primitives before this one use these */
+   GLfloat modelview[16];
+   GLfloat projection[16];
+};
+
+
 struct vbo_exec_context
 {
    struct gl_context *ctx;   
@@ -94,6 +113,7 @@ struct vbo_exec_context
       GLfloat *buffer_map;
       GLfloat *buffer_ptr;              /* cursor, points into buffer */
       GLuint   buffer_used;             /* in bytes */
+      GLuint   buffer_size;             /* in bytes */
       GLfloat vertex[VBO_ATTRIB_MAX*4]; /* current vertex */
 
       GLuint vert_count;
@@ -130,6 +150,12 @@ struct vbo_exec_context
       GLboolean recalculate_inputs;
    } array;
 
+   struct {
+      GLboolean enabled;
+      struct vbo_exec_batch_state state[VBO_MAX_PRIM];
+      GLuint nr;
+   } batch;
+
    /* Which flags to set in vbo_exec_BeginVertices() */
    GLbitfield begin_vertices_flags;
 
@@ -148,6 +174,8 @@ void vbo_exec_invalidate_state( struct gl_context *ctx, GLuint new_state );
 
 void vbo_exec_BeginVertices( struct gl_context *ctx );
 void vbo_exec_FlushVertices( struct gl_context *ctx, GLuint flags );
+GLboolean vbo_exec_DeferFlushVertices( struct gl_context *ctx,
+                                       GLbitfield newstate );
 
 
 /* Internal functions:
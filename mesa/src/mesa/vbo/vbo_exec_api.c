@@ -279,7 +279,7 @@ vbo_exec_wrap_upgrade_vertex(struct vbo_exec_context *exec,
     */
    exec->vtx.attrsz[attr] = newSize;
    exec->vtx.vertex_size += newSize - oldSize;
-   exec->vtx.max_vert = ((VBO_VERT_BUFFER_SIZE - exec->vtx.buffer_used) / 
+   exec->vtx.max_vert = ((exec->vtx.buffer_size - exec->vtx.buffer_used) / 
                          (exec->vtx.vertex_size * sizeof(GLfloat)));
    exec->vtx.vert_count = 0;
    exec->vtx.buffer_ptr = exec->vtx.buffer_map;
@@ -730,7 +730,11 @@ try_vbo_merge(struct vbo_exec_context *exec)
 
    vbo_try_prim_conversion(cur);
 
-   if (exec->vtx.prim_count >= 2) {
+   /* Don't merge across matrices recorded by vbo_exec_DeferFlushVertices */
+   if (exec->vtx.prim_count >= 2 &&
+       !(exec->batch.nr &&
+         exec->batch.state[exec->batch.nr - 1].end_prim ==
+         exec->vtx.prim_count - 1)) {
       struct _mesa_prim *prev = &exec->vtx.prim[exec->vtx.prim_count - 2];
       assert(prev == cur - 1);
 
@@ -985,7 +989,7 @@ void vbo_use_buffer_objects(struct gl_context *ctx)
    GLuint bufName = IMM_BUFFER_NAME;
    GLenum target = GL_ARRAY_BUFFER_ARB;
    GLenum usage = GL_STREAM_DRAW_ARB;
-   GLsizei size = VBO_VERT_BUFFER_SIZE;
+   GLsizei size = VBO_VERT_RING_SIZE;
 
    /* Make sure this func is only used once */
    assert(exec->vtx.bufferobj == ctx->Shared->NullBufferObj);
@@ -1001,6 +1005,8 @@ void vbo_use_buffer_objects(struct gl_context *ctx)
    if (!ctx->Driver.BufferData(ctx, target, size, NULL, usage, exec->vtx.bufferobj)) {
       _mesa_error(ctx, GL_OUT_OF_MEMORY, "VBO allocation");
    }
+   exec->vtx.buffer_size = size;
+   exec->vtx.buffer_used = 0;
 }
 
 
@@ -1035,6 +1041,10 @@ void vbo_exec_vtx_init( struct vbo_exec_context *exec )
    ASSERT(!exec->vtx.buffer_map);
    exec->vtx.buffer_map = _mesa_align_malloc(VBO_VERT_BUFFER_SIZE, 64);
    exec->vtx.buffer_ptr = exec->vtx.buffer_map;
+   exec->vtx.buffer_size = VBO_VERT_BUFFER_SIZE;
+
+   exec->batch.enabled = !_mesa_getenv("MESA_NO_IMMEDIATE_BATCHING");
+   exec->batch.nr = 0;
 
    vbo_exec_vtxfmt_init( exec );
    _mesa_noop_vtxfmt_init(&exec->vtxfmt_noop);
@@ -1137,6 +1147,47 @@ void vbo_exec_BeginVertices( struct gl_context *ctx )
 }
 
 
+/**
+ * Called via ctx->Driver.DeferFlushVertices() before the modelview or
+ * projection matrix changes.  Instead of drawing the buffered primitives
+ * now, record the current matrices so that vbo_exec_vtx_flush() can load
+ * them again when it draws those primitives.  Applications drawing many
+ * small glBegin/glEnd objects with a glPushMatrix/glTranslate/glPopMatrix
+ * around each then get one flush for the lot instead of one per object.
+ */
+GLboolean
+vbo_exec_DeferFlushVertices( struct gl_context *ctx, GLbitfield newstate )
+{
+   struct vbo_exec_context *exec = &vbo_context(ctx)->exec;
+   struct vbo_exec_batch_state *state;
+
+   if (!exec->batch.enabled ||
+       (newstate & ~(_NEW_MODELVIEW | _NEW_PROJECTION)) ||
+       _mesa_inside_begin_end(ctx) ||
+       exec->vtx.prim_count == 0)
+      return GL_FALSE;
+
+   if (exec->batch.nr) {
+      state = &exec->batch.state[exec->batch.nr - 1];
+
+      /* Nothing was drawn since the last change */
+      if (state->end_prim == exec->vtx.prim_count)
+         return GL_TRUE;
+   }
+
+   assert(exec->batch.nr < Elements(exec->batch.state));
+
+   state = &exec->batch.state[exec->batch.nr++];
+   state->end_prim = exec->vtx.prim_count;
+   memcpy(state->modelview, ctx->ModelviewMatrixStack.Top->m,
+          sizeof(state->modelview));
+   memcpy(state->projection, ctx->ProjectionMatrixStack.Top->m,
+          sizeof(state->projection));
+
+   return GL_TRUE;
+}
+
+
 /**
  * Called via ctx->Driver.FlushVertices()
  * \param flags  bitmask of FLUSH_STORED_VERTICES, FLUSH_UPDATE_CURRENT
@@ -32,6 +32,7 @@
 #include "main/enums.h"
 #include "main/state.h"
 #include "main/vtxfmt.h"
+#include "math/m_matrix.h"
 
 #include "vbo_context.h"
 #include "vbo_noop.h"
@@ -272,7 +273,7 @@ vbo_exec_vtx_unmap( struct vbo_exec_context *exec )
       exec->vtx.buffer_used += (exec->vtx.buffer_ptr -
                                 exec->vtx.buffer_map) * sizeof(float);
 
-      assert(exec->vtx.buffer_used <= VBO_VERT_BUFFER_SIZE);
+      assert(exec->vtx.buffer_used <= exec->vtx.buffer_size);
       assert(exec->vtx.buffer_ptr != NULL);
       
       ctx->Driver.UnmapBuffer(ctx, exec->vtx.bufferobj);
@@ -295,6 +296,10 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
                               GL_MAP_UNSYNCHRONIZED_BIT |
                               GL_MAP_FLUSH_EXPLICIT_BIT |
                               MESA_MAP_NOWAIT_BIT;
+   const GLenum accessWrap = GL_MAP_WRITE_BIT |
+                             GL_MAP_INVALIDATE_BUFFER_BIT |
+                             GL_MAP_FLUSH_EXPLICIT_BIT |
+                             MESA_MAP_NOWAIT_BIT;
    const GLenum usage = GL_STREAM_DRAW_ARB;
    
    if (!_mesa_is_bufferobj(exec->vtx.bufferobj))
@@ -303,13 +308,13 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
    assert(!exec->vtx.buffer_map);
    assert(!exec->vtx.buffer_ptr);
 
-   if (VBO_VERT_BUFFER_SIZE > exec->vtx.buffer_used + 1024) {
+   if (exec->vtx.buffer_size > exec->vtx.buffer_used + 1024) {
       /* The VBO exists and there's room for more */
       if (exec->vtx.bufferobj->Size > 0) {
          exec->vtx.buffer_map =
             (GLfloat *)ctx->Driver.MapBufferRange(ctx, 
                                                   exec->vtx.buffer_used,
-                                                  (VBO_VERT_BUFFER_SIZE - 
+                                                  (exec->vtx.buffer_size -
                                                    exec->vtx.buffer_used),
                                                   accessRange,
                                                   exec->vtx.bufferobj);
@@ -320,17 +325,31 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
       }
    }
    
+   if (!exec->vtx.buffer_map && exec->vtx.bufferobj->Size > 0) {
+      /* The buffer is full: wrap around to the start.  Invalidating the
+       * whole buffer lets the driver rename or recycle its storage while
+       * the GPU may still read the old contents, which is cheaper than
+       * allocating a new buffer object.
+       */
+      exec->vtx.buffer_used = 0;
+      exec->vtx.buffer_map =
+         (GLfloat *)ctx->Driver.MapBufferRange(ctx,
+                                               0, exec->vtx.buffer_size,
+                                               accessWrap,
+                                               exec->vtx.bufferobj);
+   }
+
    if (!exec->vtx.buffer_map) {
       /* Need to allocate a new VBO */
       exec->vtx.buffer_used = 0;
 
       if (ctx->Driver.BufferData(ctx, GL_ARRAY_BUFFER_ARB,
-                                  VBO_VERT_BUFFER_SIZE, 
+                                  exec->vtx.buffer_size,
                                   NULL, usage, exec->vtx.bufferobj)) {
          /* buffer allocation worked, now map the buffer */
          exec->vtx.buffer_map =
             (GLfloat *)ctx->Driver.MapBufferRange(ctx,
-                                                  0, VBO_VERT_BUFFER_SIZE,
+                                                  0, exec->vtx.buffer_size,
                                                   accessRange,
                                                   exec->vtx.bufferobj);
       }
@@ -362,6 +381,57 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
 
 
 
+/**
+ * Draw the buffered primitives in groups, loading the matrices that
+ * vbo_exec_DeferFlushVertices() recorded for each group first.  The
+ * last group is drawn with the current matrices, which are left in
+ * place afterwards.
+ */
+static void
+vbo_exec_draw_batched_prims( struct vbo_exec_context *exec )
+{
+   struct gl_context *ctx = exec->ctx;
+   GLmatrix *modelview = ctx->ModelviewMatrixStack.Top;
+   GLmatrix *projection = ctx->ProjectionMatrixStack.Top;
+   GLfloat cur_modelview[16], cur_projection[16];
+   GLuint start = 0, i;
+
+   memcpy(cur_modelview, modelview->m, sizeof(cur_modelview));
+   memcpy(cur_projection, projection->m, sizeof(cur_projection));
+
+   for (i = 0; i <= exec->batch.nr; i++) {
+      const struct vbo_exec_batch_state *state = &exec->batch.state[i];
+      GLuint end;
+
+      if (i < exec->batch.nr) {
+         _math_matrix_loadf(modelview, state->modelview);
+         _math_matrix_loadf(projection, state->projection);
+         end = state->end_prim;
+      }
+      else {
+         _math_matrix_loadf(modelview, cur_modelview);
+         _math_matrix_loadf(projection, cur_projection);
+         end = exec->vtx.prim_count;
+      }
+
+      ctx->NewState |= _NEW_MODELVIEW | _NEW_PROJECTION;
+      _mesa_update_state( ctx );
+
+      if (end > start) {
+         vbo_context(ctx)->draw_prims( ctx,
+                                       exec->vtx.prim + start,
+                                       end - start,
+                                       NULL,
+                                       GL_TRUE,
+                                       0,
+                                       exec->vtx.vert_count - 1,
+                                       NULL);
+      }
+      start = end;
+   }
+}
+
+
 /**
  * Execute the buffer and save copied verts.
  * \param keep_unmapped  if true, leave the VBO unmapped when we're done.
@@ -385,7 +455,7 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
 	  */
 	 vbo_exec_bind_arrays( ctx );
 
-         if (ctx->NewState)
+         if (ctx->NewState && !exec->batch.nr)
             _mesa_update_state( ctx );
 
          if (_mesa_is_bufferobj(exec->vtx.bufferobj)) {
@@ -396,14 +466,19 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
             printf("%s %d %d\n", __FUNCTION__, exec->vtx.prim_count,
 		   exec->vtx.vert_count);
 
-	 vbo_context(ctx)->draw_prims( ctx, 
-				       exec->vtx.prim,
-				       exec->vtx.prim_count,
-				       NULL,
-				       GL_TRUE,
-				       0,
-				       exec->vtx.vert_count - 1,
-				       NULL);
+         if (exec->batch.nr) {
+            vbo_exec_draw_batched_prims( exec );
+         }
+         else {
+            vbo_context(ctx)->draw_prims( ctx,
+                                          exec->vtx.prim,
+                                          exec->vtx.prim_count,
+                                          NULL,
+                                          GL_TRUE,
+                                          0,
+                                          exec->vtx.vert_count - 1,
+                                          NULL);
+         }
 
 	 /* If using a real VBO, get new storage -- unless asked not to.
           */
@@ -424,10 +499,11 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
    if (keepUnmapped || exec->vtx.vertex_size == 0)
       exec->vtx.max_vert = 0;
    else
-      exec->vtx.max_vert = ((VBO_VERT_BUFFER_SIZE - exec->vtx.buffer_used) / 
+      exec->vtx.max_vert = ((exec->vtx.buffer_size - exec->vtx.buffer_used) /
                             (exec->vtx.vertex_size * sizeof(GLfloat)));
 
    exec->vtx.buffer_ptr = exec->vtx.buffer_map;
    exec->vtx.prim_count = 0;
    exec->vtx.vert_count = 0;
+   exec->batch.nr = 0;
 }
@@ -0,0 +1,529 @@
+/**************************************************************************
+ *
+ * Copyright 2003 Tungsten Graphics, Inc., Cedar Park, Texas.
+ * Copyright 2009 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL TUNGSTEN GRAPHICS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file vbo_minmax_index.c
+ * Scanning of index buffers for their range of indices and for primitive
+ * restart indices.
+ *
+ * The scans use SSE2 when the compiler targets it, which is always the case
+ * on x86-64.  The ranges found in buffer objects are cached in the buffer
+ * object, so that drawing the same indices again doesn't map and scan the
+ * buffer again.  Writing the buffer through the API flags the cache as
+ * dirty, and buffers that rendering may write to are never cached.
+ */
+
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/bufferobj.h"
+#include "main/hash_table.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "main/varray.h"
+
+#include "vbo.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/** Number of ranges cached per buffer object before starting over */
+#define MAX_MINMAX_CACHE_ENTRIES 256
+
+
+struct minmax_cache_key {
+   GLintptr offset;
+   GLuint count;
+   GLuint index_size;
+   GLuint restart_index;
+   GLboolean restart;
+};
+
+
+struct minmax_cache_entry {
+   struct minmax_cache_key key;
+   GLuint min;
+   GLuint max;
+};
+
+
+#ifdef __SSE2__
+
+/* SSE2 only compares signed 32-bit integers, the values passed to these
+ * are biased by 0x80000000.
+ */
+static inline __m128i
+min_epi32(__m128i a, __m128i b)
+{
+   __m128i gt = _mm_cmpgt_epi32(a, b);
+   return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+
+static inline __m128i
+max_epi32(__m128i a, __m128i b)
+{
+   __m128i gt = _mm_cmpgt_epi32(a, b);
+   return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+
+/**
+ * Scan the indices 16 bytes at a time for their min and max.
+ * Restart indices are turned into ~0 for the min and into 0 for the max so
+ * that they don't count.  Returns the number of indices scanned.
+ */
+static GLuint
+minmax_sse2(const void *indices, unsigned index_size, GLuint count,
+            GLboolean restart, GLuint restart_index,
+            GLuint *min_index, GLuint *max_index)
+{
+   const unsigned per_vec = 16 / index_size;
+   const __m128i *vec = (const __m128i *) indices;
+   const GLuint num_vecs = count / per_vec;
+   union {
+      __m128i v;
+      GLuint ui[4];
+      GLushort us[8];
+      GLubyte ub[16];
+   } vmin, vmax;
+   __m128i bias, restart_vec;
+   GLuint min = *min_index, max = *max_index;
+   GLuint i;
+
+   switch (index_size) {
+   case 4:
+      bias = _mm_set1_epi32(0x80000000);
+      restart_vec = _mm_set1_epi32(restart_index);
+      vmin.v = _mm_set1_epi32(0x7fffffff);
+      vmax.v = _mm_set1_epi32(0x80000000);
+      for (i = 0; i < num_vecs; i++) {
+         __m128i lo = _mm_loadu_si128(&vec[i]), hi = lo;
+         if (restart) {
+            __m128i eq = _mm_cmpeq_epi32(lo, restart_vec);
+            lo = _mm_or_si128(lo, eq);
+            hi = _mm_andnot_si128(eq, hi);
+         }
+         vmin.v = min_epi32(vmin.v, _mm_xor_si128(lo, bias));
+         vmax.v = max_epi32(vmax.v, _mm_xor_si128(hi, bias));
+      }
+      for (i = 0; i < 4; i++) {
+         min = MIN2(min, vmin.ui[i] ^ 0x80000000);
+         max = MAX2(max, vmax.ui[i] ^ 0x80000000);
+      }
+      break;
+   case 2:
+      bias = _mm_set1_epi16(-0x8000);
+      restart_vec = _mm_set1_epi16((short) restart_index);
+      vmin.v = _mm_set1_epi16(0x7fff);
+      vmax.v = _mm_set1_epi16(-0x8000);
+      for (i = 0; i < num_vecs; i++) {
+         __m128i lo = _mm_loadu_si128(&vec[i]), hi = lo;
+         if (restart) {
+            __m128i eq = _mm_cmpeq_epi16(lo, restart_vec);
+            lo = _mm_or_si128(lo, eq);
+            hi = _mm_andnot_si128(eq, hi);
+         }
+         vmin.v = _mm_min_epi16(vmin.v, _mm_xor_si128(lo, bias));
+         vmax.v = _mm_max_epi16(vmax.v, _mm_xor_si128(hi, bias));
+      }
+      for (i = 0; i < 8; i++) {
+         min = MIN2(min, (GLuint) (vmin.us[i] ^ 0x8000));
+         max = MAX2(max, (GLuint) (vmax.us[i] ^ 0x8000));
+      }
+      break;
+   case 1:
+      restart_vec = _mm_set1_epi8((char) restart_index);
+      vmin.v = _mm_set1_epi8(-1);
+      vmax.v = _mm_setzero_si128();
+      for (i = 0; i < num_vecs; i++) {
+         __m128i lo = _mm_loadu_si128(&vec[i]), hi = lo;
+         if (restart) {
+            __m128i eq = _mm_cmpeq_epi8(lo, restart_vec);
+            lo = _mm_or_si128(lo, eq);
+            hi = _mm_andnot_si128(eq, hi);
+         }
+         vmin.v = _mm_min_epu8(vmin.v, lo);
+         vmax.v = _mm_max_epu8(vmax.v, hi);
+      }
+      for (i = 0; i < 16; i++) {
+         min = MIN2(min, (GLuint) vmin.ub[i]);
+         max = MAX2(max, (GLuint) vmax.ub[i]);
+      }
+      break;
+   default:
+      assert(0);
+      return 0;
+   }
+
+   *min_index = min;
+   *max_index = max;
+   return num_vecs * per_vec;
+}
+
+#endif /* __SSE2__ */
+
+
+/**
+ * Find the min and max of count indices of the given size, ignoring
+ * restart indices if restart is set.  If there are no indices left, min is
+ * ~0 and max is 0.
+ */
+void
+vbo_minmax_index_array(const void *indices, unsigned index_size,
+                       GLuint count, GLboolean restart, GLuint restart_index,
+                       GLuint *min_index, GLuint *max_index)
+{
+   GLuint min = ~0U, max = 0;
+   GLuint i = 0;
+
+   /* a restart index which doesn't fit the type never matches */
+   if (index_size < 4 && (restart_index >> (index_size * 8)))
+      restart = GL_FALSE;
+
+#ifdef __SSE2__
+   if (count >= 16 / index_size)
+      i = minmax_sse2(indices, index_size, count, restart, restart_index,
+                      &min, &max);
+#endif
+
+#define SCAN_INDICES(TYPE)                                    \
+   for (; i < count; i++) {                                   \
+      const GLuint index = ((const TYPE *) indices)[i];       \
+      if (restart && index == restart_index)                  \
+         continue;                                            \
+      if (index > max) max = index;                           \
+      if (index < min) min = index;                           \
+   }
+
+   switch (index_size) {
+   case 4:
+      SCAN_INDICES(GLuint);
+      break;
+   case 2:
+      SCAN_INDICES(GLushort);
+      break;
+   case 1:
+      SCAN_INDICES(GLubyte);
+      break;
+   default:
+      assert(0);
+      break;
+   }
+
+#undef SCAN_INDICES
+
+   /* only restart indices, the vector scan leaves the type's max in min */
+   if (min > max)
+      min = ~0U;
+
+   *min_index = min;
+   *max_index = max;
+}
+
+
+/**
+ * Return the position of the first restart index in [start, end), or end
+ * if there is none.
+ */
+GLuint
+vbo_find_restart_index(const void *indices, unsigned index_size,
+                       GLuint start, GLuint end, GLuint restart_index)
+{
+   GLuint i = start;
+
+   if (index_size < 4 && (restart_index >> (index_size * 8)))
+      return end;
+
+#ifdef __SSE2__
+   {
+      const unsigned per_vec = 16 / index_size;
+      const GLubyte *bytes = (const GLubyte *) indices;
+      __m128i restart_vec;
+
+      switch (index_size) {
+      case 4:
+         restart_vec = _mm_set1_epi32(restart_index);
+         break;
+      case 2:
+         restart_vec = _mm_set1_epi16((short) restart_index);
+         break;
+      default:
+         restart_vec = _mm_set1_epi8((char) restart_index);
+         break;
+      }
+
+      /* skip whole vectors without a restart index, the scalar loop below
+       * finds the exact position in the one which has it
+       */
+      for (; i + per_vec <= end; i += per_vec) {
+         __m128i v = _mm_loadu_si128((const __m128i *)
+                                     (bytes + i * index_size));
+         __m128i eq;
+
+         switch (index_size) {
+         case 4:
+            eq = _mm_cmpeq_epi32(v, restart_vec);
+            break;
+         case 2:
+            eq = _mm_cmpeq_epi16(v, restart_vec);
+            break;
+         default:
+            eq = _mm_cmpeq_epi8(v, restart_vec);
+            break;
+         }
+
+         if (_mm_movemask_epi8(eq))
+            return i + (ffs(_mm_movemask_epi8(eq)) - 1) / index_size;
+      }
+   }
+#endif
+
+#define FIND_RESTART(TYPE)                                    \
+   for (; i < end; i++) {                                     \
+      if (((const TYPE *) indices)[i] == restart_index)       \
+         return i;                                            \
+   }
+
+   switch (index_size) {
+   case 4:
+      FIND_RESTART(GLuint);
+      break;
+   case 2:
+      FIND_RESTART(GLushort);
+      break;
+   case 1:
+      FIND_RESTART(GLubyte);
+      break;
+   default:
+      assert(0);
+      break;
+   }
+
+#undef FIND_RESTART
+
+   return end;
+}
+
+
+static bool
+minmax_cache_key_equals(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct minmax_cache_key)) == 0;
+}
+
+
+static void
+minmax_cache_delete_entry(struct hash_entry *entry)
+{
+   free(entry->data);
+}
+
+
+/**
+ * Free the cached index ranges of a buffer object which is being deleted.
+ */
+void
+vbo_delete_minmax_cache(struct gl_buffer_object *bufferObj)
+{
+   if (bufferObj->MinMaxCache) {
+      _mesa_hash_table_destroy(bufferObj->MinMaxCache,
+                               minmax_cache_delete_entry);
+      bufferObj->MinMaxCache = NULL;
+   }
+   _glthread_DESTROY_MUTEX(bufferObj->MinMaxCacheMutex);
+}
+
+
+static GLboolean
+vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
+                      const struct minmax_cache_key *key,
+                      GLuint *min_index, GLuint *max_index)
+{
+   GLboolean found = GL_FALSE;
+
+   _glthread_LOCK_MUTEX(bufferObj->MinMaxCacheMutex);
+
+   if (bufferObj->MinMaxCacheDirty) {
+      if (bufferObj->MinMaxCache) {
+         _mesa_hash_table_destroy(bufferObj->MinMaxCache,
+                                  minmax_cache_delete_entry);
+         bufferObj->MinMaxCache = NULL;
+      }
+      bufferObj->MinMaxCacheDirty = GL_FALSE;
+   }
+
+   if (bufferObj->MinMaxCache) {
+      struct hash_entry *entry =
+         _mesa_hash_table_search(bufferObj->MinMaxCache,
+                                 _mesa_hash_data(key, sizeof(*key)), key);
+      if (entry) {
+         const struct minmax_cache_entry *range = entry->data;
+         *min_index = range->min;
+         *max_index = range->max;
+         found = GL_TRUE;
+      }
+   }
+
+   _glthread_UNLOCK_MUTEX(bufferObj->MinMaxCacheMutex);
+
+   return found;
+}
+
+
+static void
+vbo_minmax_cache_store(struct gl_buffer_object *bufferObj,
+                       const struct minmax_cache_key *key,
+                       GLuint min_index, GLuint max_index)
+{
+   struct minmax_cache_entry *range;
+
+   _glthread_LOCK_MUTEX(bufferObj->MinMaxCacheMutex);
+
+   /* the buffer was written while we were scanning it */
+   if (bufferObj->MinMaxCacheDirty)
+      goto out;
+
+   if (bufferObj->MinMaxCache &&
+       bufferObj->MinMaxCache->entries >= MAX_MINMAX_CACHE_ENTRIES) {
+      _mesa_hash_table_destroy(bufferObj->MinMaxCache,
+                               minmax_cache_delete_entry);
+      bufferObj->MinMaxCache = NULL;
+   }
+
+   if (!bufferObj->MinMaxCache) {
+      bufferObj->MinMaxCache =
+         _mesa_hash_table_create(NULL, minmax_cache_key_equals);
+      if (!bufferObj->MinMaxCache)
+         goto out;
+   }
+
+   range = malloc(sizeof(*range));
+   if (!range)
+      goto out;
+
+   memcpy(&range->key, key, sizeof(*key));
+   range->min = min_index;
+   range->max = max_index;
+   _mesa_hash_table_insert(bufferObj->MinMaxCache,
+                           _mesa_hash_data(key, sizeof(*key)),
+                           &range->key, range);
+
+out:
+   _glthread_UNLOCK_MUTEX(bufferObj->MinMaxCacheMutex);
+}
+
+
+/**
+ * Compute min and max elements by scanning the index buffer for
+ * glDraw[Range]Elements() calls.
+ * If primitive restart is enabled, we need to ignore restart
+ * indexes when computing min/max.
+ */
+static void
+vbo_get_minmax_index(struct gl_context *ctx,
+		     const struct _mesa_prim *prim,
+		     const struct _mesa_index_buffer *ib,
+		     GLuint *min_index, GLuint *max_index,
+		     const GLuint count)
+{
+   const GLboolean restart = ctx->Array._PrimitiveRestart;
+   const GLuint restartIndex = _mesa_primitive_restart_index(ctx, ib->type);
+   const int index_size = vbo_sizeof_ib_type(ib->type);
+   struct gl_buffer_object *bufferObj = ib->obj;
+   struct minmax_cache_key key;
+   GLboolean use_cache = GL_FALSE;
+   const char *indices;
+
+   indices = (char *) ib->ptr + prim->start * index_size;
+   if (_mesa_is_bufferobj(bufferObj)) {
+      GLsizeiptr size = MIN2(count * index_size, bufferObj->Size);
+
+      use_cache = !bufferObj->DeviceWritable &&
+                  !_mesa_bufferobj_mapped(bufferObj);
+      if (use_cache) {
+         memset(&key, 0, sizeof(key));
+         key.offset = (GLintptr) indices;
+         key.count = count;
+         key.index_size = index_size;
+         key.restart = restart;
+         key.restart_index = restart ? restartIndex : 0;
+
+         if (vbo_get_minmax_cached(bufferObj, &key, min_index, max_index))
+            return;
+      }
+
+      indices = ctx->Driver.MapBufferRange(ctx, (GLintptr) indices, size,
+                                           GL_MAP_READ_BIT, bufferObj);
+   }
+
+   vbo_minmax_index_array(indices, index_size, count, restart, restartIndex,
+                          min_index, max_index);
+
+   if (_mesa_is_bufferobj(bufferObj)) {
+      ctx->Driver.UnmapBuffer(ctx, bufferObj);
+
+      if (use_cache)
+         vbo_minmax_cache_store(bufferObj, &key, *min_index, *max_index);
+   }
+}
+
+/**
+ * Compute min and max elements for nr_prims
+ */
+void
+vbo_get_minmax_indices(struct gl_context *ctx,
+                       const struct _mesa_prim *prims,
+                       const struct _mesa_index_buffer *ib,
+                       GLuint *min_index,
+                       GLuint *max_index,
+                       GLuint nr_prims)
+{
+   GLuint tmp_min, tmp_max;
+   GLuint i;
+   GLuint count;
+
+   *min_index = ~0;
+   *max_index = 0;
+
+   for (i = 0; i < nr_prims; i++) {
+      const struct _mesa_prim *start_prim;
+
+      start_prim = &prims[i];
+      count = start_prim->count;
+      /* Do combination if possible to reduce map/unmap count */
+      while ((i + 1 < nr_prims) &&
+             (prims[i].start + prims[i].count == prims[i+1].start)) {
+         count += prims[i+1].count;
+         i++;
+      }
+      vbo_get_minmax_index(ctx, start_prim, ib, &tmp_min, &tmp_max, count);
+      *min_index = MIN2(*min_index, tmp_min);
+      *max_index = MAX2(*max_index, tmp_max);
+   }
+}
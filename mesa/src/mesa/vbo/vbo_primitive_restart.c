@@ -36,9 +36,6 @@
 #include "vbo.h"
 #include "vbo_context.h"
 
-#define UPDATE_MIN2(a, b) (a) = MIN2((a), (b))
-#define UPDATE_MAX2(a, b) (a) = MAX2((a), (b))
-
 /*
  * Notes on primitive restart:
  * The code below is used when the driver does not support primitive
@@ -83,8 +80,7 @@ find_sub_primitives(const void *elements, unsigned element_size,
 {
    const unsigned max_prims = end - start;
    struct sub_primitive *sub_prims;
-   unsigned i, cur_start, cur_count;
-   GLuint scan_index;
+   unsigned i, restart;
    unsigned scan_num;
 
    sub_prims =
@@ -95,58 +91,23 @@ find_sub_primitives(const void *elements, unsigned element_size,
       return NULL;
    }
 
-   cur_start = start;
-   cur_count = 0;
    scan_num = 0;
 
-#define IB_INDEX_READ(TYPE, INDEX) (((const GL##TYPE *) elements)[INDEX])
-
-#define SCAN_ELEMENTS(TYPE) \
-   sub_prims[scan_num].min_index = (GL##TYPE) 0xffffffff; \
-   sub_prims[scan_num].max_index = 0; \
-   for (i = start; i < end; i++) { \
-      scan_index = IB_INDEX_READ(TYPE, i); \
-      if (scan_index == restart_index) { \
-         if (cur_count > 0) { \
-            assert(scan_num < max_prims); \
-            sub_prims[scan_num].start = cur_start; \
-            sub_prims[scan_num].count = cur_count; \
-            scan_num++; \
-            sub_prims[scan_num].min_index = (GL##TYPE) 0xffffffff; \
-            sub_prims[scan_num].max_index = 0; \
-         } \
-         cur_start = i + 1; \
-         cur_count = 0; \
-      } \
-      else { \
-         UPDATE_MIN2(sub_prims[scan_num].min_index, scan_index); \
-         UPDATE_MAX2(sub_prims[scan_num].max_index, scan_index); \
-         cur_count++; \
-      } \
-   } \
-   if (cur_count > 0) { \
-      assert(scan_num < max_prims); \
-      sub_prims[scan_num].start = cur_start; \
-      sub_prims[scan_num].count = cur_count; \
-      scan_num++; \
-   }
-
-   switch (element_size) {
-   case 1:
-      SCAN_ELEMENTS(ubyte);
-      break;
-   case 2:
-      SCAN_ELEMENTS(ushort);
-      break;
-   case 4:
-      SCAN_ELEMENTS(uint);
-      break;
-   default:
-      assert(0 && "bad index_size in find_sub_primitives()");
+   for (i = start; i < end; i = restart + 1) {
+      restart = vbo_find_restart_index(elements, element_size, i, end,
+                                       restart_index);
+      if (restart > i) {
+         assert(scan_num < max_prims);
+         sub_prims[scan_num].start = i;
+         sub_prims[scan_num].count = restart - i;
+         vbo_minmax_index_array((const GLubyte *) elements + i * element_size,
+                                element_size, restart - i, GL_FALSE, 0,
+                                &sub_prims[scan_num].min_index,
+                                &sub_prims[scan_num].max_index);
+         scan_num++;
+      }
    }
 
-#undef SCAN_ELEMENTS
-
    *num_sub_prims = scan_num;
 
    return sub_prims;
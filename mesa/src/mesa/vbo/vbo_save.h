@@ -97,6 +97,11 @@ struct vbo_save_vertex_list {
  */
 #define VBO_SAVE_BUFFER_SIZE (8*1024) /* dwords */
 #define VBO_SAVE_PRIM_SIZE   128
+
+/* Limit for the static buffers which vertex lists are coalesced into
+ * when a display list is optimized.
+ */
+#define VBO_SAVE_MERGED_BUFFER_SIZE (256*1024) /* dwords */
 #define VBO_SAVE_PRIM_MODE_MASK         0x3f
 #define VBO_SAVE_PRIM_WEAK              0x40
 #define VBO_SAVE_PRIM_NO_CURRENT_UPDATE 0x80
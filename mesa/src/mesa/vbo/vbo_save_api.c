@@ -1518,6 +1518,190 @@ vbo_print_vertex_list(struct gl_context *ctx, void *data)
 }
 
 
+/**
+ * Can vertex list b, executed right after vertex list a, be drawn together
+ * with it?
+ */
+static GLboolean
+can_coalesce_vertex_lists(const struct vbo_save_vertex_list *a,
+                          const struct vbo_save_vertex_list *b)
+{
+   return (a->vertex_size == b->vertex_size &&
+           memcmp(a->attrsz, b->attrsz, sizeof(a->attrsz)) == 0 &&
+           memcmp(a->attrtype, b->attrtype, sizeof(a->attrtype)) == 0 &&
+           !b->dangling_attr_ref &&
+           b->wrap_count == 0 &&
+           b->count > 0 &&
+           b->prim_count > 0 &&
+           a->prim[a->prim_count - 1].end &&
+           b->prim[0].begin &&
+           a->prim[0].no_current_update == b->prim[0].no_current_update);
+}
+
+
+/**
+ * Coalesce vertex lists which are executed back to back into a single one,
+ * whose vertices are copied into a new static buffer object.  Lists of
+ * independent primitives of the same mode end up as a single primitive.
+ */
+static GLuint
+vbo_coalesce_vertex_lists(struct gl_context *ctx, void *dst,
+                          void **src, GLuint count)
+{
+   struct vbo_save_vertex_list **lists = (struct vbo_save_vertex_list **) src;
+   struct vbo_save_vertex_list *node = (struct vbo_save_vertex_list *) dst;
+   const struct vbo_save_vertex_list *first = lists[0], *last;
+   struct vbo_save_primitive_store *prim_store;
+   struct vbo_save_vertex_store *vertex_store;
+   struct gl_buffer_object *mapped = NULL;
+   const char *map = NULL;
+   GLuint prim_count = 0, vert_count = 0, size, offset, n, i;
+   GLboolean ok;
+   char *buffer;
+
+   if (first->dangling_attr_ref ||
+       first->count == 0 ||
+       first->prim_count == 0)
+      return 0;
+
+   prim_store = alloc_prim_store(ctx);
+   if (!prim_store)
+      return 0;
+
+   for (n = 0; n < count; n++) {
+      const struct vbo_save_vertex_list *list = lists[n];
+
+      if (n > 0 && !can_coalesce_vertex_lists(lists[n - 1], list))
+         break;
+
+      if ((vert_count + list->count) * list->vertex_size >
+          VBO_SAVE_MERGED_BUFFER_SIZE)
+         break;
+
+      if (prim_count + list->prim_count > VBO_SAVE_PRIM_SIZE) {
+         merge_prims(ctx, prim_store->buffer, &prim_count);
+         if (prim_count + list->prim_count > VBO_SAVE_PRIM_SIZE)
+            break;
+      }
+
+      for (i = 0; i < list->prim_count; i++) {
+         prim_store->buffer[prim_count] = list->prim[i];
+         prim_store->buffer[prim_count].start += vert_count;
+         prim_count++;
+      }
+      vert_count += list->count;
+   }
+
+   if (n < 2) {
+      free(prim_store);
+      return 0;
+   }
+
+   merge_prims(ctx, prim_store->buffer, &prim_count);
+   prim_store->used = prim_count;
+   last = lists[n - 1];
+
+   /* Gather the vertices, mapping each vertex store only once for runs of
+    * lists in the same one.
+    */
+   buffer = malloc(vert_count * first->vertex_size * sizeof(GLfloat));
+   if (!buffer) {
+      free(prim_store);
+      return 0;
+   }
+
+   for (i = 0, offset = 0; i < n; i++) {
+      const struct vbo_save_vertex_list *list = lists[i];
+
+      if (list->vertex_store->bufferobj != mapped) {
+         if (mapped)
+            ctx->Driver.UnmapBuffer(ctx, mapped);
+         mapped = list->vertex_store->bufferobj;
+         map = ctx->Driver.MapBufferRange(ctx, 0, mapped->Size,
+                                          GL_MAP_READ_BIT, mapped);
+         if (!map) {
+            free(buffer);
+            free(prim_store);
+            return 0;
+         }
+      }
+
+      size = list->count * list->vertex_size * sizeof(GLfloat);
+      memcpy(buffer + offset, map + list->buffer_offset, size);
+      offset += size;
+   }
+   ctx->Driver.UnmapBuffer(ctx, mapped);
+
+   vertex_store = CALLOC_STRUCT(vbo_save_vertex_store);
+   if (!vertex_store) {
+      free(buffer);
+      free(prim_store);
+      return 0;
+   }
+
+   vertex_store->bufferobj = ctx->Driver.NewBufferObject(ctx,
+                                                         VBO_BUF_ID,
+                                                         GL_ARRAY_BUFFER_ARB);
+   ok = vertex_store->bufferobj &&
+        ctx->Driver.BufferData(ctx, GL_ARRAY_BUFFER_ARB, offset, buffer,
+                               GL_STATIC_DRAW_ARB, vertex_store->bufferobj);
+   free(buffer);
+   if (!ok) {
+      free_vertex_store(ctx, vertex_store);
+      free(prim_store);
+      return 0;
+   }
+   vertex_store->used = vert_count * first->vertex_size;
+   vertex_store->refcount = 1;
+
+   memcpy(node->attrsz, first->attrsz, sizeof(node->attrsz));
+   memcpy(node->attrtype, first->attrtype, sizeof(node->attrtype));
+   node->vertex_size = first->vertex_size;
+   node->buffer_offset = 0;
+   node->count = vert_count;
+   node->wrap_count = 0;
+   node->dangling_attr_ref = GL_FALSE;
+   node->prim = prim_store->buffer;
+   node->prim_count = prim_count;
+   node->vertex_store = vertex_store;
+   node->prim_store = prim_store;
+
+   /* If the malloc fails, the current values are read from the VBO. */
+   node->current_size = last->current_size;
+   node->current_data = NULL;
+   if (last->current_data) {
+      node->current_data = malloc(node->current_size * sizeof(GLfloat));
+      if (node->current_data)
+         memcpy(node->current_data, last->current_data,
+                node->current_size * sizeof(GLfloat));
+   }
+
+   return n;
+}
+
+
+/**
+ * The current values of the attributes stored per vertex change when a
+ * vertex list is executed.
+ */
+static GLbitfield64
+vbo_vertex_list_attribs(struct gl_context *ctx, void *data)
+{
+   const struct vbo_save_vertex_list *node =
+      (const struct vbo_save_vertex_list *) data;
+   GLbitfield64 attribs = 0;
+   GLuint i;
+   (void) ctx;
+
+   for (i = 0; i < VERT_ATTRIB_MAX; i++) {
+      if (node->attrsz[i])
+         attribs |= VERT_BIT(i);
+   }
+
+   return attribs;
+}
+
+
 /**
  * Called during context creation/init.
  */
@@ -1557,7 +1741,9 @@ vbo_save_api_init(struct vbo_save_context *save)
                                sizeof(struct vbo_save_vertex_list),
                                vbo_save_playback_vertex_list,
                                vbo_destroy_vertex_list,
-                               vbo_print_vertex_list);
+                               vbo_print_vertex_list,
+                               vbo_coalesce_vertex_lists,
+                               vbo_vertex_list_attribs);
 
    ctx->Driver.NotifySaveBegin = vbo_save_NotifyBegin;
 